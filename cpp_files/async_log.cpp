@@ -0,0 +1,179 @@
+#include "common/async_log.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace {
+
+// Writer thread sleep when every ring is empty
+#define ASYNC_LOG_IDLE_US 200
+
+const char kSeverityLetters[] = "IWEF";
+
+thread_local LogRing *thread_ring = nullptr;
+
+// String held in a fixed-size field of a LogOrder
+std::string Field(const char *field, size_t size) {
+  return std::string(field, strnlen(field, size));
+}
+
+void FromLogOrder(const LogOrder &log_order, Order *order) {
+  order->order_id_ = Field(log_order.order_id_, ASYNC_LOG_ID_SIZE);
+  order->cancel_id_ = Field(log_order.cancel_id_, ASYNC_LOG_ID_SIZE);
+  order->symbol_ = Field(log_order.symbol_, ASYNC_LOG_STRING_SIZE);
+  order->client_id_ = Field(log_order.client_id_, ASYNC_LOG_STRING_SIZE);
+  order->genesis_timestamp_ = log_order.genesis_timestamp_;
+  order->gateway_timestamp_ = log_order.gateway_timestamp_;
+  order->enqueue_timestamp_ = log_order.enqueue_timestamp_;
+  order->dequeue_timestamp_ = log_order.dequeue_timestamp_;
+  order->order_serial_num_ = log_order.order_serial_num_;
+  order->num_shares_ = log_order.num_shares_;
+  order->limit_price_ = log_order.limit_price_;
+  order->action_ = static_cast<OrderAction>(log_order.action_);
+  order->type_ = static_cast<OrderType>(log_order.type_);
+  order->result_ = static_cast<OrderResult>(log_order.result_);
+}
+
+}  // namespace
+
+AsyncLogger *AsyncLogger::Get() {
+  static AsyncLogger *logger = new AsyncLogger();
+  return logger;
+}
+
+void AsyncLogger::Start(FILE *sink) {
+  if (running_.load()) return;
+  sink_ = sink != nullptr ? sink : stderr;
+  stop_ = false;
+  writer_thread_ = std::thread(&AsyncLogger::WriterFunc, this);
+  running_.store(true, std::memory_order_release);
+}
+
+void AsyncLogger::Stop() {
+  if (!running_.load()) return;
+  running_.store(false, std::memory_order_seq_cst);
+  // A call that saw running_ before the store publishes into its ring; wait
+  // for it so the final drain writes the record instead of losing it
+  std::vector<LogRing *> rings;
+  {
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    for (auto &ring : rings_) rings.push_back(ring.get());
+  }
+  for (LogRing *ring : rings) {
+    while (ring->writing()) std::this_thread::yield();
+  }
+  stop_ = true;
+  writer_thread_.join();
+  if (dropped_.load() > 0) {
+    LOG(WARNING) << "Async Log Dropped " << dropped_.load() << " Records";
+  }
+}
+
+LogRing *AsyncLogger::ThreadRing() {
+  if (thread_ring == nullptr) {
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    rings_.emplace_back(new LogRing(rings_.size()));
+    thread_ring = rings_.back().get();
+  }
+  return thread_ring;
+}
+
+void AsyncLogger::Format(const LogRecord &record, size_t thread_index,
+                         std::string *out) {
+  char prefix[64];
+  int severity = std::min<int>(record.severity_, 3);
+  snprintf(prefix, sizeof(prefix), "%c%llu.%06llu T%zu] ",
+           kSeverityLetters[severity],
+           static_cast<unsigned long long>(record.timestamp_ / 1000000),
+           static_cast<unsigned long long>(record.timestamp_ % 1000000),
+           thread_index);
+  out->append(prefix);
+
+  int arg = 0;
+  for (const char *c = record.format_; *c != '\0'; c++) {
+    if (c[0] != '{' || c[1] != '}' || arg >= record.num_args_) {
+      out->push_back(*c);
+      continue;
+    }
+    c++;
+    char number[32];
+    const uint64_t &value = record.args_[arg];
+    switch (record.arg_types_[arg++]) {
+      case LogArgType::integer:
+        snprintf(number, sizeof(number), "%lld",
+                 static_cast<long long>(value));
+        out->append(number);
+        break;
+      case LogArgType::unsigned_integer:
+        snprintf(number, sizeof(number), "%llu",
+                 static_cast<unsigned long long>(value));
+        out->append(number);
+        break;
+      case LogArgType::real: {
+        double real;
+        memcpy(&real, &value, sizeof(real));
+        snprintf(number, sizeof(number), "%g", real);
+        out->append(number);
+        break;
+      }
+      case LogArgType::string: {
+        const char *text = record.strings_[value];
+        out->append(text, strnlen(text, ASYNC_LOG_STRING_SIZE));
+        break;
+      }
+      case LogArgType::order: {
+        Order order;
+        FromLogOrder(record.order_, &order);
+        out->append(order.SerializeOrder());
+        break;
+      }
+    }
+  }
+  out->push_back('\n');
+}
+
+void AsyncLogger::WriteNow(const LogRecord &record) {
+  std::string text;
+  Format(record, 0, &text);
+  std::lock_guard<std::mutex> lock(sink_mutex_);
+  fwrite(text.data(), 1, text.size(), sink_);
+  written_++;
+}
+
+size_t AsyncLogger::Drain(std::string *buffer) {
+  std::vector<LogRing *> rings;
+  {
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    for (auto &ring : rings_) rings.push_back(ring.get());
+  }
+  size_t count = 0;
+  buffer->clear();
+  for (LogRing *ring : rings) {
+    uint64_t head = ring->head();
+    uint64_t tail = ring->tail();
+    for (uint64_t i = head; i < tail; i++) {
+      Format(ring->record(i), ring->thread_index(), buffer);
+    }
+    ring->Release(tail);
+    count += tail - head;
+  }
+  if (count > 0) {
+    std::lock_guard<std::mutex> lock(sink_mutex_);
+    fwrite(buffer->data(), 1, buffer->size(), sink_);
+    fflush(sink_);
+    written_ += count;
+  }
+  return count;
+}
+
+void AsyncLogger::WriterFunc() {
+  std::string buffer;
+  while (!stop_.load()) {
+    if (Drain(&buffer) == 0) {
+      usleep(ASYNC_LOG_IDLE_US);
+    }
+  }
+  // Records published before Stop
+  Drain(&buffer);
+}
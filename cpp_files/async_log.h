@@ -0,0 +1,283 @@
+#ifndef COMMON_ASYNC_LOG_H_
+#define COMMON_ASYNC_LOG_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "common/clock.h"
+#include "common/message_types.h"
+
+// Logging for the trading threads. A call copies its format pointer and
+// arguments into a fixed-size record in the calling thread's lock-free ring
+// and returns; a background thread formats the records and writes them out.
+// The hot path takes no lock and does no string formatting or I/O.
+//
+//   ASYNC_LOG(ERROR, "{}: Sell Triggered: {}\t{}", symbol, timestamp, shares);
+//   ASYNC_LOG(ERROR, "Submitted Selling Order {}", order);
+//
+// Each {} is replaced by the next argument; a call takes at most
+// ASYNC_LOG_MAX_ARGS of them, checked at compile time. Arguments are
+// integers, doubles, up to ASYNC_LOG_MAX_STRINGS short strings
+// (ASYNC_LOG_STRING_SIZE bytes, longer ones are cut) and at most one Order,
+// copied into the record as a LogOrder and printed with SerializeOrder; the
+// string and order limits are checked at compile time too. The format is
+// kept by pointer and must be a string literal. Records below
+// FLAGS_minloglevel are skipped, and a record that finds its ring full is
+// dropped and counted rather than blocking. Lines of different threads may
+// be written out of order; each carries its timestamp and thread.
+#define ASYNC_LOG_MAX_ARGS 5
+#define ASYNC_LOG_MAX_STRINGS 3
+#define ASYNC_LOG_STRING_SIZE 16  // Symbols and client ids like G1_C3_1007
+#define ASYNC_LOG_ID_SIZE 24  // Order and cancel ids, longer ones are cut
+#define ASYNC_LOG_RING_SIZE 4096  // Records per thread, a power of two
+
+#define ASYNC_LOG(severity, format, ...) \
+  AsyncLogger::Get()->Log(google::severity, format, ##__VA_ARGS__)
+
+enum class LogArgType : uint8_t { integer, unsigned_integer, real, string,
+                                  order };
+
+// Order argument of a log call. The strings are copied in as bytes (not
+// NUL-terminated when they fill their field), so logging an order takes no
+// lock and does not allocate.
+struct LogOrder {
+  char order_id_[ASYNC_LOG_ID_SIZE];
+  char cancel_id_[ASYNC_LOG_ID_SIZE];
+  char symbol_[ASYNC_LOG_STRING_SIZE];
+  char client_id_[ASYNC_LOG_STRING_SIZE];
+  uint64_t genesis_timestamp_;
+  uint64_t gateway_timestamp_;
+  uint64_t enqueue_timestamp_;
+  uint64_t dequeue_timestamp_;
+  uint64_t order_serial_num_;
+  int32_t num_shares_;
+  int32_t limit_price_;
+  uint8_t action_;
+  uint8_t type_;
+  uint8_t result_;
+};
+
+// One log call. The arguments fill the first cache line, a string argument
+// holding the index of its text in strings_; the strings and the order, if
+// any, the other three.
+struct alignas(64) LogRecord {
+  uint64_t timestamp_;
+  const char *format_;
+  uint64_t args_[ASYNC_LOG_MAX_ARGS];
+  uint8_t severity_;
+  uint8_t num_args_;
+  uint8_t num_strings_;
+  LogArgType arg_types_[ASYNC_LOG_MAX_ARGS];
+  char strings_[ASYNC_LOG_MAX_STRINGS][ASYNC_LOG_STRING_SIZE];
+  LogOrder order_;
+};
+static_assert(sizeof(LogRecord) == 256,
+              "LogRecord must fit four cache lines");
+
+// Single producer, single consumer ring of records
+class LogRing {
+ public:
+  explicit LogRing(size_t thread_index)
+      : thread_index_(thread_index), records_(ASYNC_LOG_RING_SIZE) {}
+
+  // Producer side: slot for the next record, or nullptr if the ring is full
+  LogRecord *Claim() {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) >= records_.size()) {
+      return nullptr;
+    }
+    return &records_[tail & (records_.size() - 1)];
+  }
+  void Publish() {
+    tail_.store(tail_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+  }
+  // Set by the producer around a log call into the ring, so Stop can wait
+  // for a call that saw the logger running to publish its record
+  void SetWriting(bool writing) {
+    writing_.store(writing, writing ? std::memory_order_seq_cst
+                                    : std::memory_order_release);
+  }
+  bool writing() const { return writing_.load(std::memory_order_acquire); }
+
+  // Consumer side
+  uint64_t head() const { return head_.load(std::memory_order_relaxed); }
+  uint64_t tail() const { return tail_.load(std::memory_order_acquire); }
+  const LogRecord &record(uint64_t index) const {
+    return records_[index & (records_.size() - 1)];
+  }
+  void Release(uint64_t head) {
+    head_.store(head, std::memory_order_release);
+  }
+
+  size_t thread_index() const { return thread_index_; }
+
+ private:
+  size_t thread_index_;
+  std::vector<LogRecord> records_;
+  alignas(64) std::atomic<uint64_t> head_{0};
+  alignas(64) std::atomic<uint64_t> tail_{0};
+  std::atomic<bool> writing_{false};
+};
+
+class AsyncLogger {
+ public:
+  // Process-wide logger
+  static AsyncLogger *Get();
+
+  // Start the writer thread, writing to sink (stderr if null). Until Start,
+  // and after Stop, records are formatted and written by the calling thread.
+  void Start(FILE *sink = nullptr);
+  // Wait for log calls already writing into a ring, drain every ring and
+  // join the writer thread. Calls that start later write synchronously.
+  void Stop();
+
+  // Clock of the record timestamps, RealTimeClock() by default. Set it to
+  // the trading clock so log lines of a replay carry replayed time. The
+  // clock must outlive the logger's use of it.
+  void SetClock(Clock *clock) { clock_.store(clock); }
+
+  template <typename... Args>
+  void Log(int severity, const char *format, const Args &... args) {
+    static_assert(NumOrders<Args...>() <= 1,
+                  "At most one Order per ASYNC_LOG call");
+    static_assert(NumStrings<Args...>() <= ASYNC_LOG_MAX_STRINGS,
+                  "Too many ASYNC_LOG string arguments; split the call");
+    if (severity < FLAGS_minloglevel) return;
+    LogRecord local;
+    LogRing *ring = nullptr;
+    if (running_.load(std::memory_order_acquire)) {
+      ring = ThreadRing();
+      // Announced before running_ is read again: either Stop sees this call
+      // writing and waits for it, or the call sees the logger stopped
+      ring->SetWriting(true);
+      if (!running_.load(std::memory_order_seq_cst)) {
+        ring->SetWriting(false);
+        ring = nullptr;
+      }
+    }
+    LogRecord *record = ring != nullptr ? ring->Claim() : &local;
+    if (record == nullptr) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      ring->SetWriting(false);
+      return;
+    }
+    record->timestamp_ = clock_.load(std::memory_order_relaxed)->Now();
+    record->format_ = format;
+    record->severity_ = severity;
+    record->num_args_ = 0;
+    record->num_strings_ = 0;
+    SetArgs(record, args...);
+    if (ring != nullptr) {
+      ring->Publish();
+      ring->SetWriting(false);
+    } else {
+      WriteNow(local);
+    }
+  }
+
+  uint64_t records_written() const { return written_.load(); }
+  uint64_t records_dropped() const { return dropped_.load(); }
+
+ private:
+  AsyncLogger() = default;
+
+  // Ring of the calling thread, created on first use
+  LogRing *ThreadRing();
+
+  // Arguments with a per-call limit
+  template <typename... Args>
+  static constexpr int NumOrders() {
+    return (0 + ... + (std::is_same<Args, Order>::value ? 1 : 0));
+  }
+  template <typename... Args>
+  static constexpr int NumStrings() {
+    return (0 + ... +
+            (std::is_same<Args, std::string>::value ||
+                     std::is_convertible<const Args &, const char *>::value
+                 ? 1
+                 : 0));
+  }
+
+  static void SetArgs(LogRecord *) {}
+  template <typename T, typename... Rest>
+  static void SetArgs(LogRecord *record, const T &arg, const Rest &... rest) {
+    static_assert(sizeof...(Rest) < ASYNC_LOG_MAX_ARGS,
+                  "Too many ASYNC_LOG arguments; split the call");
+    SetArg(record, record->num_args_++, arg);
+    SetArgs(record, rest...);
+  }
+
+  template <typename T>
+  static void SetArg(LogRecord *record, int i, T arg) {
+    static_assert(std::is_arithmetic<T>::value, "Unsupported Log Argument");
+    if (std::is_floating_point<T>::value) {
+      double value = static_cast<double>(arg);
+      memcpy(&record->args_[i], &value, sizeof(value));
+      record->arg_types_[i] = LogArgType::real;
+    } else if (std::is_signed<T>::value) {
+      record->args_[i] = static_cast<int64_t>(arg);
+      record->arg_types_[i] = LogArgType::integer;
+    } else {
+      record->args_[i] = static_cast<uint64_t>(arg);
+      record->arg_types_[i] = LogArgType::unsigned_integer;
+    }
+  }
+  static void SetArg(LogRecord *record, int i, const char *arg) {
+    uint8_t string = record->num_strings_++;
+    strncpy(record->strings_[string], arg, ASYNC_LOG_STRING_SIZE);
+    record->args_[i] = string;
+    record->arg_types_[i] = LogArgType::string;
+  }
+  static void SetArg(LogRecord *record, int i, const std::string &arg) {
+    SetArg(record, i, arg.c_str());
+  }
+  static void SetArg(LogRecord *record, int i, const Order &arg) {
+    LogOrder &order = record->order_;
+    strncpy(order.order_id_, arg.order_id_.c_str(), ASYNC_LOG_ID_SIZE);
+    strncpy(order.cancel_id_, arg.cancel_id_.c_str(), ASYNC_LOG_ID_SIZE);
+    strncpy(order.symbol_, arg.symbol_.c_str(), ASYNC_LOG_STRING_SIZE);
+    strncpy(order.client_id_, arg.client_id_.c_str(), ASYNC_LOG_STRING_SIZE);
+    order.genesis_timestamp_ = arg.genesis_timestamp_;
+    order.gateway_timestamp_ = arg.gateway_timestamp_;
+    order.enqueue_timestamp_ = arg.enqueue_timestamp_;
+    order.dequeue_timestamp_ = arg.dequeue_timestamp_;
+    order.order_serial_num_ = arg.order_serial_num_;
+    order.num_shares_ = arg.num_shares_;
+    order.limit_price_ = arg.limit_price_;
+    order.action_ = static_cast<uint8_t>(arg.action_);
+    order.type_ = static_cast<uint8_t>(arg.type_);
+    order.result_ = static_cast<uint8_t>(arg.result_);
+    record->arg_types_[i] = LogArgType::order;
+  }
+
+  // Append the text of record to out
+  static void Format(const LogRecord &record, size_t thread_index,
+                     std::string *out);
+  void WriteNow(const LogRecord &record);
+  void WriterFunc();
+  // Format and write everything published so far. Returns the record count.
+  size_t Drain(std::string *buffer);
+
+  std::atomic<Clock *> clock_{RealTimeClock()};
+  std::atomic<bool> running_{false};
+  std::atomic<bool> stop_{false};
+  std::thread writer_thread_;
+  FILE *sink_ = stderr;
+  std::mutex sink_mutex_;  // Synchronous writes before Start/after Stop
+  std::vector<std::unique_ptr<LogRing> > rings_;
+  std::mutex rings_mutex_;
+  std::atomic<uint64_t> written_{0};
+  std::atomic<uint64_t> dropped_{0};
+};
+
+#endif  // COMMON_ASYNC_LOG_H_
@@ -0,0 +1,248 @@
+#include "trader/backtest.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "common/lazy_book.h"
+#include "trader/market_data_api.h"
+#include "trader/mean_reversion_strategy.h"
+#include "trader/momentum_strategy.h"
+#include "trader/pairs_strategy.h"
+
+#define MARKET_TAPE_MAGIC 0x31455041544b4d43ULL  // "CMKTAPE1"
+
+bool LoadMarketTape(const TraderConfig &config,
+                    const std::vector<std::string> &symbols,
+                    const std::string &column, uint64_t start_time_ms,
+                    uint64_t end_time_ms, MarketTape *tape) {
+  tape->symbols_ = symbols;
+  tape->events_.clear();
+  std::vector<std::string> cell_strings;
+  // Only the top levels are kept, so no order is parsed
+  LazyLimitOrderBook lob;
+  for (size_t i = 0; i < symbols.size(); i++) {
+    cell_strings.clear();
+    if (MarketDataAPI::PullMarketData(
+            config.project_id_, config.bigtable_id_, config.table_name_,
+            column, symbols[i], start_time_ms, end_time_ms,
+            &cell_strings) < 0) {
+      LOG(ERROR) << "Failed to Pull Market Data: " << symbols[i];
+      return false;
+    }
+    for (auto &cell : cell_strings) {
+      TapeEvent event;
+      event.symbol_index_ = i;
+      lob.Assign(std::move(cell));
+      event.depth_.Build(lob);
+      tape->events_.push_back(event);
+    }
+  }
+  // Rows of different symbols arrive one symbol at a time
+  std::stable_sort(tape->events_.begin(), tape->events_.end(),
+                   [](const TapeEvent &a, const TapeEvent &b) {
+                     return a.depth_.creation_timestamp_ <
+                            b.depth_.creation_timestamp_;
+                   });
+  return true;
+}
+
+bool SaveMarketTapeFile(const MarketTape &tape, const std::string &path) {
+  FILE *file = fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    LOG(ERROR) << "Failed to Open: " << path;
+    return false;
+  }
+  uint64_t header[3] = {MARKET_TAPE_MAGIC, tape.symbols_.size(),
+                        tape.events_.size()};
+  bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+  for (auto &symbol : tape.symbols_) {
+    uint64_t length = symbol.size();
+    ok = ok && fwrite(&length, sizeof(length), 1, file) == 1 &&
+         fwrite(symbol.data(), 1, length, file) == length;
+  }
+  ok = ok && fwrite(tape.events_.data(), sizeof(TapeEvent),
+                    tape.events_.size(), file) == tape.events_.size();
+  fclose(file);
+  return ok;
+}
+
+bool LoadMarketTapeFile(const std::string &path, MarketTape *tape) {
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    LOG(ERROR) << "Failed to Open: " << path;
+    return false;
+  }
+  // The counts of the header are checked against the bytes left before
+  // anything is sized by them
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  uint64_t remaining = size > 0 ? size : 0;
+  rewind(file);
+  uint64_t header[3];
+  bool ok = remaining >= sizeof(header) &&
+            fread(header, sizeof(header), 1, file) == 1 &&
+            header[0] == MARKET_TAPE_MAGIC;
+  if (ok) remaining -= sizeof(header);
+  tape->symbols_.clear();
+  for (uint64_t i = 0; ok && i < header[1]; i++) {
+    uint64_t length;
+    ok = remaining >= sizeof(length) &&
+         fread(&length, sizeof(length), 1, file) == 1 &&
+         length <= remaining - sizeof(length);
+    if (!ok) break;
+    remaining -= sizeof(length) + length;
+    std::string symbol(length, '\0');
+    ok = fread(&symbol[0], 1, length, file) == length;
+    tape->symbols_.push_back(symbol);
+  }
+  if (ok) ok = header[2] <= remaining / sizeof(TapeEvent);
+  if (ok) {
+    tape->events_.resize(header[2]);
+    ok = fread(tape->events_.data(), sizeof(TapeEvent), header[2], file) ==
+         header[2];
+  }
+  fclose(file);
+  if (!ok) {
+    LOG(ERROR) << "Not a Market Tape: " << path;
+  }
+  return ok;
+}
+
+BacktestExecutor::BacktestExecutor(const MarketView *view)
+    : view_(view),
+      liquidity_(view->size()),
+      liquidity_timestamps_(view->size(), UINT64_MAX),
+      positions_(view->size(), 0),
+      marks_(view->size(), 0) {}
+
+TopOfBook *BacktestExecutor::Liquidity(int symbol_index) {
+  if (liquidity_timestamps_[symbol_index] != view_->timestamp()) {
+    liquidity_[symbol_index] = view_->depth(symbol_index);
+    liquidity_timestamps_[symbol_index] = view_->timestamp();
+  }
+  return &liquidity_[symbol_index];
+}
+
+void BacktestExecutor::Fill(int symbol_index, OrderAction action,
+                            int num_shares, int price) {
+  if (action == OrderAction::buy) {
+    positions_[symbol_index] += num_shares;
+    cash_ -= static_cast<double>(num_shares) * price;
+  } else {
+    positions_[symbol_index] -= num_shares;
+    cash_ += static_cast<double>(num_shares) * price;
+  }
+  result_.num_fills_++;
+  result_.shares_traded_ += num_shares;
+}
+
+OrderResult BacktestExecutor::Submit(const std::string &symbol,
+                                     OrderAction action, int num_shares,
+                                     int limit_price, Order *order) {
+  int symbol_index = view_->SymbolIndex(symbol);
+  if (symbol_index < 0 || num_shares <= 0 || limit_price <= 0 ||
+      (action != OrderAction::buy && action != OrderAction::sell)) {
+    return OrderResult::malformed;
+  }
+  uint64_t order_id = next_order_id_++;
+  order->symbol_ = symbol;
+  order->order_id_ = "BT_" + std::to_string(order_id);
+  order->action_ = action;
+  order->type_ = OrderType::limit;
+  order->num_shares_ = num_shares;
+  order->limit_price_ = limit_price;
+  order->result_ = OrderResult::valid;
+  result_.num_orders_++;
+
+  // Take liquidity from the opposite side while it is within the limit
+  TopOfBook *depth = Liquidity(symbol_index);
+  bool buy = action == OrderAction::buy;
+  int num_levels = buy ? depth->num_sell_levels_ : depth->num_buy_levels_;
+  const int32_t *prices = buy ? depth->sell_prices_ : depth->buy_prices_;
+  int32_t *shares = buy ? depth->sell_shares_ : depth->buy_shares_;
+  for (int i = 0; i < num_levels && num_shares > 0; i++) {
+    if (buy ? prices[i] > limit_price : prices[i] < limit_price) break;
+    // Taken by an earlier order of this tick
+    if (shares[i] == 0) continue;
+    int filled = std::min(num_shares, shares[i]);
+    Fill(symbol_index, action, filled, prices[i]);
+    shares[i] -= filled;
+    num_shares -= filled;
+  }
+  if (num_shares > 0) {
+    resting_orders_.push_back(
+        {order_id, symbol_index, action, num_shares, limit_price});
+  }
+  return OrderResult::valid;
+}
+
+OrderResult BacktestExecutor::Cancel(const std::string &order_id) {
+  if (order_id.compare(0, 3, "BT_") != 0) {
+    return OrderResult::malformed;
+  }
+  uint64_t id = strtoull(order_id.c_str() + 3, nullptr, 10);
+  for (size_t i = 0; i < resting_orders_.size(); i++) {
+    if (resting_orders_[i].order_id_ == id) {
+      resting_orders_.erase(resting_orders_.begin() + i);
+      return OrderResult::valid;
+    }
+  }
+  // Already filled
+  return OrderResult::invalid;
+}
+
+void BacktestExecutor::Match() {
+  size_t kept = 0;
+  for (size_t i = 0; i < resting_orders_.size(); i++) {
+    const RestingOrder &order = resting_orders_[i];
+    const BookTop &top = view_->top(order.symbol_index_);
+    bool crossed = order.action_ == OrderAction::buy
+                       ? top.lowest_sell_price_ <= order.limit_price_
+                       : top.highest_buy_price_ >= order.limit_price_ &&
+                             top.highest_buy_price_ > LOWEST_BUY_PRICE;
+    if (crossed) {
+      Fill(order.symbol_index_, order.action_, order.num_shares_,
+           order.limit_price_);
+    } else {
+      resting_orders_[kept++] = order;
+    }
+  }
+  resting_orders_.resize(kept);
+}
+
+double BacktestExecutor::Equity() {
+  double equity = cash_;
+  for (size_t i = 0; i < positions_.size(); i++) {
+    double bid = view_->top(i).highest_buy_price_;
+    if (bid > LOWEST_BUY_PRICE) {
+      marks_[i] = bid;
+    }
+    equity += positions_[i] * marks_[i];
+  }
+  return equity;
+}
+
+bool RunStrategyBacktest(const MarketTape &tape, const StrategyParams &params,
+                         BacktestResult *result) {
+  if (params.strategy_ == "mean_reversion" && params.symbols_.size() == 1) {
+    *result = RunBacktest(
+        tape, MeanReversionStrategy(params.symbols_[0], params.moving_window_,
+                                    params.tick_length_, params.threshold_,
+                                    params.base_shares_));
+  } else if (params.strategy_ == "momentum" && params.symbols_.size() == 1) {
+    *result = RunBacktest(
+        tape, MomentumStrategy(params.symbols_[0], params.moving_window_,
+                               params.tick_length_, params.threshold_,
+                               params.base_shares_, params.p1_, params.p2_));
+  } else if (params.strategy_ == "pairs" && params.symbols_.size() == 2) {
+    *result = RunBacktest(
+        tape, PairsStrategy(params.symbols_[0], params.symbols_[1],
+                            params.moving_window_, params.tick_length_,
+                            params.threshold_, params.base_shares_));
+  } else {
+    return false;
+  }
+  return true;
+}
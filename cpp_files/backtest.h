@@ -0,0 +1,163 @@
+#ifndef TRADER_BACKTEST_H_
+#define TRADER_BACKTEST_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "trader/strategy.h"
+#include "trader/top_of_book.h"
+#include "trader/trader_config.h"
+
+// One book update of a MarketTape
+class TapeEvent {
+ public:
+  int symbol_index_;  // Index into MarketTape::symbols_
+  TopOfBook depth_;   // depth_.creation_timestamp_ orders the tape
+};
+
+// Historical top-of-book updates of a set of symbols, in time order. Loaded
+// once and shared read-only by every backtest of a sweep.
+class MarketTape {
+ public:
+  std::vector<std::string> symbols_;
+  std::vector<TapeEvent> events_;
+
+  uint64_t start_timestamp() const {
+    return events_.empty() ? 0 : events_.front().depth_.creation_timestamp_;
+  }
+  uint64_t end_timestamp() const {
+    return events_.empty() ? 0 : events_.back().depth_.creation_timestamp_;
+  }
+};
+
+// Pull the books of symbols between start_time_ms and end_time_ms from the
+// market data table in config and summarize them into tape. Books are read
+// from column, with the symbol as the row prefix.
+bool LoadMarketTape(const TraderConfig &config,
+                    const std::vector<std::string> &symbols,
+                    const std::string &column, uint64_t start_time_ms,
+                    uint64_t end_time_ms, MarketTape *tape);
+
+// Local binary copy of a tape, so repeated sweeps skip Bigtable
+bool SaveMarketTapeFile(const MarketTape &tape, const std::string &path);
+bool LoadMarketTapeFile(const std::string &path, MarketTape *tape);
+
+// Outcome of one backtest. Prices and cash are in the gateway's integer
+// price units.
+class BacktestResult {
+ public:
+  double pnl_ = 0;           // Final equity (cash + positions at best bid)
+  double max_drawdown_ = 0;  // Largest fall of equity from a previous peak
+  uint64_t num_orders_ = 0;
+  uint64_t num_fills_ = 0;
+  uint64_t shares_traded_ = 0;
+};
+
+// Tunables of the strategy binaries, for running any of them by name
+class StrategyParams {
+ public:
+  std::string strategy_;  // One of mean_reversion, momentum, pairs
+  std::vector<std::string> symbols_;  // Target (and baseline for pairs)
+  uint32_t moving_window_ = 5;
+  uint32_t tick_length_ = 1;
+  double threshold_ = 5;
+  int base_shares_ = 5000;
+  double p1_ = .5;  // Momentum only
+  double p2_ = .5;  // Momentum only
+};
+
+// Executor for backtests (see TraderExecutor). Orders that cross the
+// current depth fill immediately level by level, and the shares they take
+// are gone for the other orders of the same tick; the remainder rests at
+// its limit price and fills in full once the opposite side of a later book
+// reaches it. There is no queue position, market impact or cash check, so
+// results rank parameter settings rather than predict live PnL.
+class BacktestExecutor {
+ public:
+  explicit BacktestExecutor(const MarketView *view);
+
+  OrderResult Submit(const std::string &symbol, OrderAction action,
+                     int num_shares, int limit_price, Order *order);
+  OrderResult Cancel(const std::string &order_id);
+
+  // Fill resting orders crossed by the current view
+  void Match();
+
+  // Cash plus positions marked at the best bid (or the last one seen)
+  double Equity();
+
+  const BacktestResult &result() const { return result_; }
+  BacktestResult *mutable_result() { return &result_; }
+
+ private:
+  class RestingOrder {
+   public:
+    uint64_t order_id_;
+    int symbol_index_;
+    OrderAction action_;
+    int num_shares_;
+    int limit_price_;
+  };
+
+  void Fill(int symbol_index, OrderAction action, int num_shares, int price);
+
+  // Depth of symbol left to take in the current tick: a copy of the view's
+  // depth, made on the first order of each tick and consumed by the fills
+  TopOfBook *Liquidity(int symbol_index);
+
+  const MarketView *view_;
+  std::vector<TopOfBook> liquidity_;
+  std::vector<uint64_t> liquidity_timestamps_;  // View timestamp of the copy
+  std::vector<RestingOrder> resting_orders_;
+  std::vector<int64_t> positions_;
+  std::vector<double> marks_;
+  double cash_ = 0;
+  uint64_t next_order_id_ = 1;
+  BacktestResult result_;
+};
+
+// Run strategy over tape, ticking every strategy.tick_length() seconds of
+// tape time exactly as StrategyRunner would live
+template <typename S>
+BacktestResult RunBacktest(const MarketTape &tape, S strategy) {
+  MarketView view;
+  for (auto &symbol : tape.symbols_) {
+    view.AddSymbol(symbol);
+  }
+  uint64_t tick = static_cast<uint64_t>(strategy.tick_length()) * 1000 * 1000;
+  if (tick == 0) tick = 1000 * 1000;
+  strategy.Bind(&view, strategy.tick_length());
+  BacktestExecutor executor(&view);
+
+  double peak = 0;
+  size_t cursor = 0;
+  for (uint64_t timestamp = tape.start_timestamp() + tick;
+       cursor < tape.events_.size(); timestamp += tick) {
+    for (; cursor < tape.events_.size() &&
+           tape.events_[cursor].depth_.creation_timestamp_ <= timestamp;
+         cursor++) {
+      const TapeEvent &event = tape.events_[cursor];
+      *view.mutable_depth(event.symbol_index_) = event.depth_;
+      view.UpdateTop(event.symbol_index_);
+    }
+    view.set_timestamp(timestamp);
+    executor.Match();
+    strategy.Tick(view, &executor);
+
+    double equity = executor.Equity();
+    peak = std::max(peak, equity);
+    BacktestResult *result = executor.mutable_result();
+    result->max_drawdown_ = std::max(result->max_drawdown_, peak - equity);
+  }
+  executor.mutable_result()->pnl_ = executor.Equity();
+  return executor.result();
+}
+
+// Backtest the strategy named by params over tape. Returns false if the
+// strategy is unknown or given the wrong number of symbols.
+bool RunStrategyBacktest(const MarketTape &tape, const StrategyParams &params,
+                         BacktestResult *result);
+
+#endif  // TRADER_BACKTEST_H_
@@ -0,0 +1,134 @@
+#include "trader/bar_aggregator.h"
+
+#include <algorithm>
+
+Bar::Bar()
+    : start_timestamp_(0),
+      end_timestamp_(0),
+      open_price_(0),
+      high_price_(0),
+      low_price_(0),
+      close_price_(0),
+      volume_(0),
+      cash_traded_(0),
+      num_trades_(0) {}
+
+double Bar::Vwap() const {
+  if (volume_ == 0) return close_price_;
+  return static_cast<double>(cash_traded_) / volume_;
+}
+
+BarAggregator::BarAggregator(BarType type, uint64_t interval)
+    : type_(type), interval_(std::max<uint64_t>(interval, 1)) {}
+
+void BarAggregator::OpenTimeBar(SymbolState *state, const std::string &symbol,
+                                uint64_t start, int carry_price) {
+  Bar &bar = state->bar;
+  bar = Bar();
+  bar.symbol_ = symbol;
+  bar.start_timestamp_ = start;
+  bar.end_timestamp_ = start + interval_;
+  bar.open_price_ = bar.high_price_ = bar.low_price_ = bar.close_price_ =
+      carry_price;
+  state->open = true;
+}
+
+void BarAggregator::AddTrade(const Trade &trade,
+                             std::vector<Bar> *completed_bars) {
+  SymbolState &state = symbol_states_[trade.symbol_];
+  uint64_t timestamp = trade.creation_timestamp_;
+  int price = trade.exec_price_;
+
+  if (type_ == BarType::time) {
+    uint64_t bucket = timestamp - timestamp % interval_;
+    if (!state.open) {
+      OpenTimeBar(&state, trade.symbol_, bucket, price);
+    } else if (bucket >= state.bar.end_timestamp_) {
+      // Close the current bucket and every empty bucket in between
+      CloseTimeBars(&state, trade.symbol_, bucket, completed_bars);
+    }
+  } else if (!state.open) {
+    state.bar = Bar();
+    state.bar.symbol_ = trade.symbol_;
+    state.bar.start_timestamp_ = timestamp;
+    state.open = true;
+  }
+
+  Bar &bar = state.bar;
+  if (bar.num_trades_ == 0) {
+    bar.open_price_ = bar.high_price_ = bar.low_price_ = price;
+  } else {
+    bar.high_price_ = std::max(bar.high_price_, price);
+    bar.low_price_ = std::min(bar.low_price_, price);
+  }
+  bar.close_price_ = price;
+  bar.volume_ += trade.shares_traded_;
+  bar.cash_traded_ += trade.cash_traded_;
+  bar.num_trades_++;
+  if (type_ != BarType::time) {
+    bar.end_timestamp_ = timestamp;
+  }
+
+  if ((type_ == BarType::volume &&
+       static_cast<uint64_t>(bar.volume_) >= interval_) ||
+      (type_ == BarType::tick &&
+       static_cast<uint64_t>(bar.num_trades_) >= interval_)) {
+    completed_bars->push_back(bar);
+    state.open = false;
+  }
+}
+
+void BarAggregator::AdvanceTime(uint64_t timestamp,
+                                std::vector<Bar> *completed_bars) {
+  if (type_ != BarType::time) return;
+  for (auto &p : symbol_states_) {
+    CloseTimeBars(&p.second, p.first, timestamp, completed_bars);
+  }
+}
+
+void BarAggregator::CloseTimeBars(SymbolState *state,
+                                  const std::string &symbol,
+                                  uint64_t timestamp,
+                                  std::vector<Bar> *completed_bars) {
+  while (state->open && state->bar.end_timestamp_ <= timestamp) {
+    completed_bars->push_back(state->bar);
+    OpenTimeBar(state, symbol, state->bar.end_timestamp_,
+                state->bar.close_price_);
+  }
+}
+
+void BarAggregator::Flush(std::vector<Bar> *completed_bars) {
+  for (auto &p : symbol_states_) {
+    if (p.second.open && p.second.bar.num_trades_ > 0) {
+      completed_bars->push_back(p.second.bar);
+    }
+    p.second.open = false;
+  }
+}
+
+bool BarAggregator::GetOpenBar(const std::string &symbol, Bar *bar) const {
+  auto it = symbol_states_.find(symbol);
+  if (it == symbol_states_.end() || !it->second.open) {
+    return false;
+  }
+  *bar = it->second.bar;
+  return true;
+}
+
+void AggregateTrades(const std::vector<Trade> &trades, BarType type,
+                     uint64_t interval, std::vector<Bar> *bars) {
+  // PullTrades does not guarantee ordering across rows
+  std::vector<const Trade *> sorted_trades;
+  sorted_trades.reserve(trades.size());
+  for (auto &trade : trades) {
+    sorted_trades.push_back(&trade);
+  }
+  std::stable_sort(sorted_trades.begin(), sorted_trades.end(),
+                   [](const Trade *a, const Trade *b) { return *a < *b; });
+
+  BarAggregator aggregator(type, interval);
+  for (auto trade : sorted_trades) {
+    aggregator.AddTrade(*trade, bars);
+  }
+  aggregator.Flush(bars);
+}
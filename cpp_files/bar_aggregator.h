@@ -0,0 +1,96 @@
+#ifndef TRADER_BAR_AGGREGATOR_H_
+#define TRADER_BAR_AGGREGATOR_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "common/message_types.h"
+
+// Bar Closing Rule
+//
+//   time      A bar covers [start, start + interval) microseconds. Intervals
+//             without trades produce empty bars (zero volume, prices carried
+//             forward from the previous close).
+//   volume    A bar closes once it holds at least interval shares.
+//   tick      A bar closes once it holds interval trades.
+enum class BarType { time, volume, tick };
+
+// OHLCV Bar Class
+class Bar {
+ public:
+  std::string symbol_;         // Unique Stock Identifier
+  uint64_t start_timestamp_;   // Bucket start (time) or first trade timestamp
+  uint64_t end_timestamp_;     // Bucket end (time) or last trade timestamp
+  int open_price_;             // Price of the first trade in the bar
+  int high_price_;             // Highest execution price in the bar
+  int low_price_;              // Lowest execution price in the bar
+  int close_price_;            // Price of the last trade in the bar
+  int64_t volume_;             // Total shares traded in the bar
+  int64_t cash_traded_;        // Total cash traded in the bar
+  int num_trades_;             // Number of trades in the bar
+
+  Bar();
+
+  // Volume weighted average price (close price for an empty bar)
+  double Vwap() const;
+
+  // Timestamp-Based Bar Comparator
+  bool operator<(const Bar &bar) const {
+    return start_timestamp_ < bar.start_timestamp_;
+  }
+};
+
+// Incrementally aggregates trade reports of any number of symbols into bars.
+// The same object is used on live trade reports and on historical trades, so
+// live strategies and backtests see identical bars. Not thread safe.
+class BarAggregator {
+ public:
+  // interval is in microseconds for time bars, shares for volume bars and
+  // trades for tick bars.
+  BarAggregator(BarType type, uint64_t interval);
+
+  // Add one trade. Trades must arrive in creation_timestamp_ order per symbol.
+  // Bars closed by this trade are appended to *completed_bars.
+  void AddTrade(const Trade &trade, std::vector<Bar> *completed_bars);
+
+  // Close every time bar that ends at or before timestamp, so quiet symbols
+  // still produce bars. No-op for volume and tick bars.
+  void AdvanceTime(uint64_t timestamp, std::vector<Bar> *completed_bars);
+
+  // Close all open bars, complete or not.
+  void Flush(std::vector<Bar> *completed_bars);
+
+  // Returns the open (not yet complete) bar for symbol.
+  bool GetOpenBar(const std::string &symbol, Bar *bar) const;
+
+  BarType type() const { return type_; }
+  uint64_t interval() const { return interval_; }
+
+ private:
+  struct SymbolState {
+    Bar bar;            // Bar currently being filled
+    bool open = false;  // Whether bar holds at least one trade / time bucket
+  };
+
+  // Start a new time bucket at start, carrying forward the previous close
+  void OpenTimeBar(SymbolState *state, const std::string &symbol,
+                   uint64_t start, int carry_price);
+
+  // Close the time bars of one symbol that end at or before timestamp
+  void CloseTimeBars(SymbolState *state, const std::string &symbol,
+                     uint64_t timestamp, std::vector<Bar> *completed_bars);
+
+  BarType type_;
+  uint64_t interval_;
+  std::map<std::string, SymbolState> symbol_states_;
+};
+
+// Replay helper: aggregate a historical trade vector (i.e. the output of
+// MarketDataAPI::PullTrades) into bars, including the final partial bars.
+void AggregateTrades(const std::vector<Trade> &trades, BarType type,
+                     uint64_t interval, std::vector<Bar> *bars);
+
+#endif  // TRADER_BAR_AGGREGATOR_H_
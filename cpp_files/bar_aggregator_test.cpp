@@ -0,0 +1,101 @@
+#include "trader/bar_aggregator.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+Trade MakeTrade(const std::string &symbol, uint64_t timestamp, int price,
+                int shares) {
+  Trade trade;
+  trade.symbol_ = symbol;
+  trade.exec_price_ = price;
+  trade.shares_traded_ = shares;
+  trade.cash_traded_ = price * shares;
+  trade.creation_timestamp_ = timestamp;
+  trade.release_timestamp_ = timestamp;
+  return trade;
+}
+
+TEST(BarAggregatorTest, AdvanceTimeClosesQuietSymbols) {
+  BarAggregator aggregator(BarType::time, 100);
+  std::vector<Bar> bars;
+  aggregator.AddTrade(MakeTrade("AA", 1010, 50, 10), &bars);
+  aggregator.AddTrade(MakeTrade("AB", 1020, 70, 5), &bars);
+  aggregator.AddTrade(MakeTrade("AA", 1050, 52, 10), &bars);
+  EXPECT_TRUE(bars.empty());
+
+  // Still inside the first bucket
+  aggregator.AdvanceTime(1099, &bars);
+  EXPECT_TRUE(bars.empty());
+
+  // Closes [1000, 1100) and the empty [1100, 1200) of both symbols
+  aggregator.AdvanceTime(1200, &bars);
+  ASSERT_EQ(bars.size(), 4u);
+  EXPECT_EQ(bars[0].symbol_, "AA");
+  EXPECT_EQ(bars[0].start_timestamp_, 1000u);
+  EXPECT_EQ(bars[0].open_price_, 50);
+  EXPECT_EQ(bars[0].close_price_, 52);
+  EXPECT_EQ(bars[0].volume_, 20);
+  EXPECT_EQ(bars[1].symbol_, "AA");
+  EXPECT_EQ(bars[1].start_timestamp_, 1100u);
+  EXPECT_EQ(bars[1].num_trades_, 0);
+  EXPECT_EQ(bars[1].open_price_, 52);
+  EXPECT_EQ(bars[1].close_price_, 52);
+  EXPECT_EQ(bars[2].symbol_, "AB");
+  EXPECT_EQ(bars[2].volume_, 5);
+  EXPECT_EQ(bars[3].symbol_, "AB");
+  EXPECT_EQ(bars[3].num_trades_, 0);
+  EXPECT_EQ(bars[3].close_price_, 70);
+
+  // The open bar moved on, so a later trade lands in its own bucket
+  Bar open;
+  ASSERT_TRUE(aggregator.GetOpenBar("AA", &open));
+  EXPECT_EQ(open.start_timestamp_, 1200u);
+  bars.clear();
+  aggregator.AddTrade(MakeTrade("AA", 1250, 55, 1), &bars);
+  EXPECT_TRUE(bars.empty());
+  aggregator.AdvanceTime(1300, &bars);
+  ASSERT_EQ(bars.size(), 2u);
+  EXPECT_EQ(bars[0].symbol_, "AA");
+  EXPECT_EQ(bars[0].open_price_, 55);
+  EXPECT_EQ(bars[0].volume_, 1);
+}
+
+TEST(BarAggregatorTest, AdvanceTimeMatchesTradeDrivenBars) {
+  // Advancing between trades must not change the bars a symbol produces
+  BarAggregator advanced(BarType::time, 100);
+  BarAggregator trade_driven(BarType::time, 100);
+  std::vector<Bar> advanced_bars;
+  std::vector<Bar> trade_bars;
+  for (uint64_t timestamp = 1000; timestamp < 3000; timestamp += 130) {
+    Trade trade = MakeTrade("AA", timestamp, timestamp % 97, 1);
+    advanced.AddTrade(trade, &advanced_bars);
+    advanced.AdvanceTime(timestamp + 60, &advanced_bars);
+    trade_driven.AddTrade(trade, &trade_bars);
+  }
+  advanced.AdvanceTime(3000, &advanced_bars);
+  trade_driven.AdvanceTime(3000, &trade_bars);
+  ASSERT_EQ(advanced_bars.size(), trade_bars.size());
+  for (size_t i = 0; i < trade_bars.size(); i++) {
+    EXPECT_EQ(advanced_bars[i].start_timestamp_,
+              trade_bars[i].start_timestamp_);
+    EXPECT_EQ(advanced_bars[i].close_price_, trade_bars[i].close_price_);
+    EXPECT_EQ(advanced_bars[i].num_trades_, trade_bars[i].num_trades_);
+  }
+}
+
+TEST(BarAggregatorTest, AdvanceTimeLeavesVolumeBars) {
+  BarAggregator aggregator(BarType::volume, 100);
+  std::vector<Bar> bars;
+  aggregator.AddTrade(MakeTrade("AA", 1000, 50, 60), &bars);
+  aggregator.AdvanceTime(1000000, &bars);
+  EXPECT_TRUE(bars.empty());
+  aggregator.AddTrade(MakeTrade("AA", 1000001, 51, 40), &bars);
+  ASSERT_EQ(bars.size(), 1u);
+  EXPECT_EQ(bars[0].volume_, 100);
+}
+
+}  // namespace
@@ -0,0 +1,31 @@
+#ifndef TRADER_BOOK_UTILS_H_
+#define TRADER_BOOK_UTILS_H_
+
+#include "common/message_types.h"
+
+#define HIGHEST_SELL_PRICE 99999999
+#define LOWEST_BUY_PRICE 0
+
+// Highest resting buy price in the book (LOWEST_BUY_PRICE if none)
+inline double GetHighestBuyPrice(const LimitOrderBook &lob) {
+  double highest_buy_price = LOWEST_BUY_PRICE;
+  for (auto &p : lob.buy_queue_) {
+    if (highest_buy_price < (p.second).limit_price_) {
+      highest_buy_price = (p.second).limit_price_;
+    }
+  }
+  return highest_buy_price;
+}
+
+// Lowest resting sell price in the book (HIGHEST_SELL_PRICE if none)
+inline double GetLowestSellPrice(const LimitOrderBook &lob) {
+  double lowest_sell_price = HIGHEST_SELL_PRICE;
+  for (auto &p : lob.sell_queue_) {
+    if (lowest_sell_price > (p.second).limit_price_) {
+      lowest_sell_price = (p.second).limit_price_;
+    }
+  }
+  return lowest_sell_price;
+}
+
+#endif  // TRADER_BOOK_UTILS_H_
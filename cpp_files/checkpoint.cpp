@@ -0,0 +1,153 @@
+#include "trader/checkpoint.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+
+#include "common/utils.h"
+
+namespace {
+
+// File header: magic, slot size; the slots start at the next page
+const size_t kHeaderSize = 4096;
+const size_t kSlotHeaderSize = 24;
+
+uint64_t Checksum(const char *data, size_t size) {
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ static_cast<uint8_t>(data[i])) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+uint64_t Load64(const char *data) {
+  uint64_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+void Store64(char *data, uint64_t value) {
+  memcpy(data, &value, sizeof(value));
+}
+
+}  // namespace
+
+CheckpointFile::CheckpointFile(const std::string &path, size_t slot_size)
+    : path_(path),
+      fd_(open(path.c_str(), O_RDWR | O_CREAT, 0644)),
+      data_(nullptr),
+      size_(0),
+      slot_size_(slot_size) {
+  struct stat info;
+  if (fd_ < 0 || fstat(fd_, &info) != 0) {
+    LOG(ERROR) << "Failed to Open Checkpoint: " << path;
+    return;
+  }
+  bool created = info.st_size == 0;
+  if (!created) {
+    // Keep the slot size the file was created with
+    char header[CHECKPOINT_MAGIC_SIZE + sizeof(uint64_t)];
+    if (pread(fd_, header, sizeof(header), 0) != sizeof(header) ||
+        memcmp(header, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_SIZE) != 0) {
+      LOG(ERROR) << "Not a Checkpoint File: " << path;
+      return;
+    }
+    slot_size_ = Load64(header + CHECKPOINT_MAGIC_SIZE);
+  }
+  if (slot_size_ < kSlotHeaderSize ||
+      slot_size_ > (SIZE_MAX - kHeaderSize) / 2) {
+    LOG(ERROR) << "Invalid Checkpoint Slot Size " << slot_size_ << ": "
+               << path;
+    return;
+  }
+  size_ = kHeaderSize + 2 * slot_size_;
+  if ((created || static_cast<size_t>(info.st_size) < size_) &&
+      ftruncate(fd_, size_) != 0) {
+    LOG(ERROR) << "Failed to Size Checkpoint: " << path;
+    return;
+  }
+  void *mapping =
+      mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (mapping == MAP_FAILED) {
+    LOG(ERROR) << "Failed to Map Checkpoint: " << path;
+    return;
+  }
+  data_ = static_cast<char *>(mapping);
+  if (created) {
+    memcpy(data_, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_SIZE);
+    Store64(data_ + CHECKPOINT_MAGIC_SIZE, slot_size_);
+  }
+}
+
+CheckpointFile::~CheckpointFile() {
+  if (data_ != nullptr) munmap(data_, size_);
+  if (fd_ >= 0) close(fd_);
+}
+
+char *CheckpointFile::Slot(int index) const {
+  return data_ + kHeaderSize + index * slot_size_;
+}
+
+bool CheckpointFile::SlotValid(int index, uint64_t *sequence) const {
+  const char *slot = Slot(index);
+  uint64_t length = Load64(slot + 8);
+  *sequence = Load64(slot);
+  return *sequence > 0 && length <= slot_size_ - kSlotHeaderSize &&
+         Checksum(slot + kSlotHeaderSize, length) == Load64(slot + 16);
+}
+
+bool CheckpointFile::Save(const std::string &data) {
+  if (data_ == nullptr) return false;
+  if (data.size() > slot_size_ - kSlotHeaderSize) {
+    LOG(ERROR) << "Checkpoint of " << data.size()
+               << " Bytes Exceeds Slot Size " << slot_size_ << ": " << path_;
+    return false;
+  }
+  // Overwrite the slot not holding the newest valid checkpoint; a torn
+  // slot may carry the higher sequence but must not protect itself
+  int newest = -1;
+  uint64_t newest_sequence = 0;
+  for (int i = 0; i < 2; i++) {
+    uint64_t slot_sequence;
+    if (SlotValid(i, &slot_sequence) && slot_sequence > newest_sequence) {
+      newest = i;
+      newest_sequence = slot_sequence;
+    }
+  }
+  char *slot = Slot(newest == 0 ? 1 : 0);
+
+  // Invalidate the slot, write the payload, then stamp it
+  Store64(slot, 0);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(slot + kSlotHeaderSize, data.data(), data.size());
+  Store64(slot + 8, data.size());
+  Store64(slot + 16, Checksum(data.data(), data.size()));
+  std::atomic_thread_fence(std::memory_order_release);
+  Store64(slot, newest_sequence + 1);
+  // Start writeback now; the page cache already survives a process crash
+  msync(data_, size_, MS_ASYNC);
+  return true;
+}
+
+bool CheckpointFile::Load(std::string *data, uint64_t *sequence) const {
+  if (data_ == nullptr) return false;
+  int best = -1;
+  uint64_t best_sequence = 0;
+  for (int i = 0; i < 2; i++) {
+    uint64_t slot_sequence;
+    if (!SlotValid(i, &slot_sequence) || slot_sequence <= best_sequence) {
+      continue;
+    }
+    best = i;
+    best_sequence = slot_sequence;
+  }
+  if (best < 0) return false;
+  const char *slot = Slot(best);
+  data->assign(slot + kSlotHeaderSize, Load64(slot + 8));
+  if (sequence != nullptr) *sequence = best_sequence;
+  return true;
+}
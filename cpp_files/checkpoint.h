@@ -0,0 +1,142 @@
+#ifndef TRADER_CHECKPOINT_H_
+#define TRADER_CHECKPOINT_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "common/message_types.h"
+
+// Appends fixed-size values and length-prefixed strings to a byte buffer
+class CheckpointWriter {
+ public:
+  template <typename T>
+  void Put(T value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Checkpoint values must be trivially copyable");
+    data_.append(reinterpret_cast<const char *>(&value), sizeof(value));
+  }
+  void PutString(const std::string &value) {
+    Put<uint32_t>(value.size());
+    data_ += value;
+  }
+  void PutDoubles(const std::vector<double> &values) {
+    Put<uint32_t>(values.size());
+    data_.append(reinterpret_cast<const char *>(values.data()),
+                 values.size() * sizeof(double));
+  }
+
+  const std::string &data() const { return data_; }
+  void Clear() { data_.clear(); }
+
+ private:
+  std::string data_;
+};
+
+// Reads back what a CheckpointWriter wrote. Every getter returns false once
+// the data runs out, and keeps returning false afterwards.
+class CheckpointReader {
+ public:
+  CheckpointReader(const char *data, size_t size)
+      : cursor_(data), end_(data + size) {}
+  explicit CheckpointReader(const std::string &data)
+      : CheckpointReader(data.data(), data.size()) {}
+
+  template <typename T>
+  bool Get(T *value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Checkpoint values must be trivially copyable");
+    if (!ok_ || static_cast<size_t>(end_ - cursor_) < sizeof(T)) {
+      return ok_ = false;
+    }
+    memcpy(value, cursor_, sizeof(T));
+    cursor_ += sizeof(T);
+    return true;
+  }
+  bool GetString(std::string *value) {
+    uint32_t size;
+    if (!Get(&size) || static_cast<size_t>(end_ - cursor_) < size) {
+      return ok_ = false;
+    }
+    value->assign(cursor_, size);
+    cursor_ += size;
+    return true;
+  }
+  bool GetDoubles(std::vector<double> *values) {
+    uint32_t size;
+    if (!Get(&size) ||
+        static_cast<size_t>(end_ - cursor_) / sizeof(double) < size) {
+      return ok_ = false;
+    }
+    values->resize(size);
+    memcpy(values->data(), cursor_, size * sizeof(double));
+    cursor_ += size * sizeof(double);
+    return true;
+  }
+
+  bool ok() const { return ok_; }
+  bool done() const { return cursor_ == end_; }
+
+ private:
+  const char *cursor_;
+  const char *end_;
+  bool ok_ = true;
+};
+
+// Memory-mapped file holding the newest of a sequence of checkpoints. The
+// file has two slots of slot_size bytes; each Save writes the slot not
+// holding the newest checkpoint, and only then stamps it with the next
+// sequence number and a checksum. A crash during Save leaves the previous
+// checkpoint intact, and Load takes the newest slot whose checksum matches.
+#define CHECKPOINT_MAGIC "CXCKPT01"
+#define CHECKPOINT_MAGIC_SIZE 8
+#define CHECKPOINT_SLOT_SIZE (64 << 20)
+
+class CheckpointFile {
+ public:
+  // Opens or creates path. slot_size is fixed when the file is created.
+  explicit CheckpointFile(const std::string &path,
+                          size_t slot_size = CHECKPOINT_SLOT_SIZE);
+  ~CheckpointFile();
+
+  bool ok() const { return data_ != nullptr; }
+
+  // Returns false if data does not fit a slot
+  bool Save(const std::string &data);
+
+  // Newest valid checkpoint and its sequence number. Returns false if there
+  // is none.
+  bool Load(std::string *data, uint64_t *sequence = nullptr) const;
+
+ private:
+  // Slot header: sequence, length, checksum
+  char *Slot(int index) const;
+  // Whether the slot holds a checkpoint its checksum matches
+  bool SlotValid(int index, uint64_t *sequence) const;
+
+  std::string path_;
+  int fd_;
+  char *data_;
+  size_t size_;
+  size_t slot_size_;
+};
+
+// Differences between the orders and portfolio in a checkpoint and the
+// client information the gateway reports on restart
+class StateReconciliation {
+ public:
+  uint64_t checkpoint_timestamp_ = 0;  // Clock time of the checkpoint
+  ClientInformationSnapshot snapshot_;  // Current state, from the gateway
+  // Outstanding at the checkpoint, since filled or cancelled
+  std::vector<Order> closed_orders_;
+  // Outstanding now but unknown to the checkpoint
+  std::vector<Order> new_orders_;
+  // Current minus checkpointed holdings, for symbols that changed
+  std::map<std::string, int> position_changes_;
+};
+
+#endif  // TRADER_CHECKPOINT_H_
@@ -0,0 +1,231 @@
+#include "common/client_info_delta.h"
+
+#include <string.h>
+
+#include <set>
+#include <unordered_map>
+
+#include "common/record_codec.h"
+
+namespace {
+
+template <typename T>
+void PutFixed(std::string *message, T value) {
+  message->append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void PutString(std::string *message, const std::string &value) {
+  PutFixed<uint32_t>(message, static_cast<uint32_t>(value.size()));
+  message->append(value);
+}
+
+class MessageReader {
+ public:
+  MessageReader(const char *data, size_t len) : data_(data), left_(len) {}
+
+  template <typename T>
+  bool GetFixed(T *value) {
+    if (left_ < sizeof(T)) return false;
+    memcpy(value, data_, sizeof(T));
+    data_ += sizeof(T);
+    left_ -= sizeof(T);
+    return true;
+  }
+
+  bool GetString(std::string *value) {
+    uint32_t len;
+    if (!GetFixed(&len) || left_ < len) return false;
+    value->assign(data_, len);
+    data_ += len;
+    left_ -= len;
+    return true;
+  }
+
+  bool done() const { return left_ == 0; }
+
+ private:
+  const char *data_;
+  size_t left_;
+};
+
+// Whether an outstanding order has changed in a way the client must see
+bool OrderChanged(const Order &before, const Order &after) {
+  return before.num_shares_ != after.num_shares_ ||
+         before.limit_price_ != after.limit_price_ ||
+         before.result_ != after.result_;
+}
+
+}  // namespace
+
+void DiffClientInformation(const ClientInformationSnapshot &base,
+                           const ClientInformationSnapshot &current,
+                           ClientInformationDelta *delta) {
+  delta->client_id_ = current.client_id_;
+  delta->base_global_serial_num_ = base.global_serial_num_;
+  delta->base_order_serial_num_ = base.order_serial_num_;
+  delta->global_serial_num_ = current.global_serial_num_;
+  delta->order_serial_num_ = current.order_serial_num_;
+  delta->positions_.clear();
+  delta->removed_symbols_.clear();
+  delta->orders_.clear();
+  delta->closed_order_ids_.clear();
+
+  // Holdings, kept entry for entry: a symbol held at 0 is not a missing one
+  for (auto &entry : current.my_portfolio_) {
+    auto before = base.my_portfolio_.find(entry.first);
+    if (before == base.my_portfolio_.end() || before->second != entry.second) {
+      delta->positions_[entry.first] = entry.second;
+    }
+  }
+  for (auto &entry : base.my_portfolio_) {
+    if (current.my_portfolio_.count(entry.first) == 0) {
+      delta->removed_symbols_.push_back(entry.first);
+    }
+  }
+
+  // Orders
+  std::unordered_map<std::string, const Order *> base_orders;
+  base_orders.reserve(base.outstanding_orders_.size());
+  for (auto &order : base.outstanding_orders_) {
+    base_orders[order.order_id_] = &order;
+  }
+  for (auto &order : current.outstanding_orders_) {
+    auto before = base_orders.find(order.order_id_);
+    if (before == base_orders.end()) {
+      delta->orders_.push_back(order);
+      continue;
+    }
+    if (OrderChanged(*before->second, order)) delta->orders_.push_back(order);
+    base_orders.erase(before);
+  }
+  // What is left was outstanding at the base only; keep the base's order
+  for (auto &order : base.outstanding_orders_) {
+    if (base_orders.count(order.order_id_) != 0) {
+      delta->closed_order_ids_.push_back(order.order_id_);
+    }
+  }
+}
+
+bool ApplyClientInformationDelta(const ClientInformationDelta &delta,
+                                 ClientInformationSnapshot *snapshot) {
+  if (snapshot->client_id_ != delta.client_id_ ||
+      snapshot->global_serial_num_ != delta.base_global_serial_num_ ||
+      snapshot->order_serial_num_ != delta.base_order_serial_num_) {
+    return false;
+  }
+  for (auto &entry : delta.positions_) {
+    snapshot->my_portfolio_[entry.first] = entry.second;
+  }
+  for (auto &symbol : delta.removed_symbols_) {
+    snapshot->my_portfolio_.erase(symbol);
+  }
+
+  // Update orders in place and drop the closed ones, keeping book order
+  std::set<std::string> closed(delta.closed_order_ids_.begin(),
+                               delta.closed_order_ids_.end());
+  std::unordered_map<std::string, const Order *> updates;
+  updates.reserve(delta.orders_.size());
+  for (auto &order : delta.orders_) {
+    updates[order.order_id_] = &order;
+  }
+  std::vector<Order> &orders = snapshot->outstanding_orders_;
+  size_t kept = 0;
+  for (size_t i = 0; i < orders.size(); i++) {
+    if (closed.count(orders[i].order_id_) != 0) continue;
+    auto update = updates.find(orders[i].order_id_);
+    if (update != updates.end()) {
+      orders[kept] = *update->second;
+      updates.erase(update);
+    } else if (kept != i) {
+      orders[kept] = std::move(orders[i]);
+    }
+    kept++;
+  }
+  orders.resize(kept);
+  for (auto &order : delta.orders_) {
+    if (updates.count(order.order_id_) != 0) orders.push_back(order);
+  }
+
+  snapshot->global_serial_num_ = delta.global_serial_num_;
+  snapshot->order_serial_num_ = delta.order_serial_num_;
+  return true;
+}
+
+void EncodeClientInformationDelta(const ClientInformationDelta &delta,
+                                  std::string *message) {
+  message->clear();
+  PutString(message, delta.client_id_);
+  PutFixed<uint64_t>(message, delta.base_global_serial_num_);
+  PutFixed<uint64_t>(message, delta.base_order_serial_num_);
+  PutFixed<uint64_t>(message, delta.global_serial_num_);
+  PutFixed<uint64_t>(message, delta.order_serial_num_);
+  PutFixed<uint32_t>(message, static_cast<uint32_t>(delta.positions_.size()));
+  for (auto &entry : delta.positions_) {
+    PutString(message, entry.first);
+    PutFixed<int32_t>(message, entry.second);
+  }
+  PutFixed<uint32_t>(message,
+                     static_cast<uint32_t>(delta.removed_symbols_.size()));
+  for (auto &symbol : delta.removed_symbols_) {
+    PutString(message, symbol);
+  }
+  PutFixed<uint32_t>(message, static_cast<uint32_t>(delta.orders_.size()));
+  std::string record;
+  for (auto &order : delta.orders_) {
+    // Text for the rare order too long for the binary encoding
+    if (!EncodeOrder(order, RecordEncoding::binary, &record)) {
+      EncodeOrder(order, RecordEncoding::text, &record);
+    }
+    PutString(message, record);
+  }
+  PutFixed<uint32_t>(message,
+                     static_cast<uint32_t>(delta.closed_order_ids_.size()));
+  for (auto &order_id : delta.closed_order_ids_) {
+    PutString(message, order_id);
+  }
+}
+
+bool DecodeClientInformationDelta(const char *data, size_t len,
+                                  ClientInformationDelta *delta) {
+  MessageReader reader(data, len);
+  delta->positions_.clear();
+  delta->removed_symbols_.clear();
+  delta->orders_.clear();
+  delta->closed_order_ids_.clear();
+  uint32_t count;
+  if (!reader.GetString(&delta->client_id_) ||
+      !reader.GetFixed(&delta->base_global_serial_num_) ||
+      !reader.GetFixed(&delta->base_order_serial_num_) ||
+      !reader.GetFixed(&delta->global_serial_num_) ||
+      !reader.GetFixed(&delta->order_serial_num_) || !reader.GetFixed(&count)) {
+    return false;
+  }
+  std::string value;
+  for (uint32_t i = 0; i < count; i++) {
+    int32_t shares;
+    if (!reader.GetString(&value) || !reader.GetFixed(&shares)) return false;
+    delta->positions_[value] = shares;
+  }
+  if (!reader.GetFixed(&count)) return false;
+  for (uint32_t i = 0; i < count; i++) {
+    if (!reader.GetString(&value)) return false;
+    delta->removed_symbols_.push_back(value);
+  }
+  if (!reader.GetFixed(&count)) return false;
+  for (uint32_t i = 0; i < count; i++) {
+    Order order;
+    // Only binary records are valid here
+    if (!reader.GetString(&value) || value.empty() ||
+        value[0] != BINARY_RECORD_MAGIC ||
+        !DecodeOrder(value.data(), value.size(), &order)) {
+      return false;
+    }
+    delta->orders_.push_back(std::move(order));
+  }
+  if (!reader.GetFixed(&count)) return false;
+  for (uint32_t i = 0; i < count; i++) {
+    if (!reader.GetString(&value)) return false;
+    delta->closed_order_ids_.push_back(value);
+  }
+  return reader.done();
+}
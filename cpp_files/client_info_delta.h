@@ -0,0 +1,59 @@
+#ifndef COMMON_CLIENT_INFO_DELTA_H_
+#define COMMON_CLIENT_INFO_DELTA_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "common/message_types.h"
+
+// Changes to a client's ClientInformationSnapshot between two points,
+// keyed on the snapshot serials: a delta from base (global, order) serials
+// applies only to a snapshot at exactly those serials, and leaves it at the
+// delta's serials. Fills move the global trade serial and new orders and
+// cancels move the client's order serial, so equal serials mean nothing
+// changed. A delta carries only the holdings and orders that changed.
+class ClientInformationDelta {
+ public:
+  std::string client_id_;
+  uint64_t base_global_serial_num_ = 0;
+  uint64_t base_order_serial_num_ = 0;
+  uint64_t global_serial_num_ = 0;
+  uint64_t order_serial_num_ = 0;
+  // New holdings of the symbols added to the portfolio or whose holdings
+  // changed, 0 included
+  std::map<std::string, int> positions_;
+  // Symbols that left the portfolio
+  std::vector<std::string> removed_symbols_;
+  // Outstanding orders that are new or were partially filled since the base
+  std::vector<Order> orders_;
+  // Orders outstanding at the base that have since been filled or cancelled
+  std::vector<std::string> closed_order_ids_;
+
+  bool empty() const {
+    return positions_.empty() && removed_symbols_.empty() && orders_.empty() &&
+           closed_order_ids_.empty();
+  }
+};
+
+// Changes that turn base into current
+void DiffClientInformation(const ClientInformationSnapshot &base,
+                           const ClientInformationSnapshot &current,
+                           ClientInformationDelta *delta);
+
+// Apply delta to snapshot. Returns false, leaving snapshot unchanged, if
+// snapshot is not at the delta's base serials or belongs to another client.
+bool ApplyClientInformationDelta(const ClientInformationDelta &delta,
+                                 ClientInformationSnapshot *snapshot);
+
+// Wire encoding of a delta: fixed-width fields in host byte order, orders in
+// the binary record encoding (see record_codec.h). Decode returns false on a
+// truncated or malformed message.
+void EncodeClientInformationDelta(const ClientInformationDelta &delta,
+                                  std::string *message);
+bool DecodeClientInformationDelta(const char *data, size_t len,
+                                  ClientInformationDelta *delta);
+
+#endif  // COMMON_CLIENT_INFO_DELTA_H_
@@ -0,0 +1,140 @@
+#include "common/client_info_delta.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+Order MakeOrder(const std::string &order_id, int num_shares) {
+  Order order;
+  order.symbol_ = "AA";
+  order.order_id_ = order_id;
+  order.cancel_id_ = "NULL";
+  order.client_id_ = "C3";
+  order.num_shares_ = num_shares;
+  order.limit_price_ = 100;
+  return order;
+}
+
+ClientInformationSnapshot MakeSnapshot(uint64_t global_serial_num,
+                                       uint64_t order_serial_num) {
+  ClientInformationSnapshot snapshot;
+  snapshot.client_id_ = "C3";
+  snapshot.global_serial_num_ = global_serial_num;
+  snapshot.order_serial_num_ = order_serial_num;
+  return snapshot;
+}
+
+std::vector<std::string> OrderIds(const ClientInformationSnapshot &snapshot) {
+  std::vector<std::string> ids;
+  for (auto &order : snapshot.outstanding_orders_) {
+    ids.push_back(order.order_id_);
+  }
+  return ids;
+}
+
+// Diff base against current, send the delta over the wire and apply it to
+// base, which must then match current
+void ExpectRoundTrip(const ClientInformationSnapshot &base,
+                     const ClientInformationSnapshot &current) {
+  ClientInformationDelta delta;
+  DiffClientInformation(base, current, &delta);
+  std::string message;
+  EncodeClientInformationDelta(delta, &message);
+  ClientInformationDelta decoded;
+  ASSERT_TRUE(
+      DecodeClientInformationDelta(message.data(), message.size(), &decoded));
+  ClientInformationSnapshot applied = base;
+  ASSERT_TRUE(ApplyClientInformationDelta(decoded, &applied));
+  EXPECT_EQ(applied.global_serial_num_, current.global_serial_num_);
+  EXPECT_EQ(applied.order_serial_num_, current.order_serial_num_);
+  EXPECT_EQ(applied.my_portfolio_, current.my_portfolio_);
+  ASSERT_EQ(OrderIds(applied), OrderIds(current));
+  for (size_t i = 0; i < applied.outstanding_orders_.size(); i++) {
+    EXPECT_EQ(applied.outstanding_orders_[i].num_shares_,
+              current.outstanding_orders_[i].num_shares_);
+  }
+}
+
+TEST(ClientInformationDeltaTest, RoundTripsHoldingsAndOrders) {
+  ClientInformationSnapshot base = MakeSnapshot(10, 4);
+  base.my_portfolio_ = {{"AA", 100}, {"AB", -50}, {"AC", 30}};
+  base.outstanding_orders_ = {MakeOrder("G1_C3_1", 100),
+                              MakeOrder("G1_C3_2", 200),
+                              MakeOrder("G1_C3_3", 300)};
+  ClientInformationSnapshot current = MakeSnapshot(12, 6);
+  // AA changed, AB untouched, AC left, AD new
+  current.my_portfolio_ = {{"AA", 150}, {"AB", -50}, {"AD", 10}};
+  // 1 filled, 2 partially filled, 4 new
+  current.outstanding_orders_ = {MakeOrder("G1_C3_2", 150),
+                                 MakeOrder("G1_C3_3", 300),
+                                 MakeOrder("G1_C3_4", 400)};
+  ExpectRoundTrip(base, current);
+
+  ClientInformationDelta delta;
+  DiffClientInformation(base, current, &delta);
+  EXPECT_EQ(delta.positions_.size(), 2u);
+  EXPECT_EQ(delta.removed_symbols_, std::vector<std::string>({"AC"}));
+  EXPECT_EQ(delta.orders_.size(), 2u);
+  EXPECT_EQ(delta.closed_order_ids_, std::vector<std::string>({"G1_C3_1"}));
+}
+
+TEST(ClientInformationDeltaTest, ZeroHoldingIsNotARemovedOne) {
+  ClientInformationSnapshot base = MakeSnapshot(1, 1);
+  base.my_portfolio_ = {{"AA", 100}, {"AB", 0}, {"AC", 20}};
+  ClientInformationSnapshot current = MakeSnapshot(2, 1);
+  // AA sold out but still listed, AB listed at 0 and then dropped, AC and
+  // AD appearing at 0
+  current.my_portfolio_ = {{"AA", 0}, {"AC", 0}, {"AD", 0}};
+  ExpectRoundTrip(base, current);
+  ExpectRoundTrip(current, base);
+}
+
+TEST(ClientInformationDeltaTest, EqualSnapshotsGiveAnEmptyDelta) {
+  ClientInformationSnapshot base = MakeSnapshot(5, 5);
+  base.my_portfolio_ = {{"AA", 0}};
+  base.outstanding_orders_ = {MakeOrder("G1_C3_1", 100)};
+  ClientInformationDelta delta;
+  DiffClientInformation(base, base, &delta);
+  EXPECT_TRUE(delta.empty());
+  ExpectRoundTrip(base, base);
+}
+
+TEST(ClientInformationDeltaTest, RefusesTheWrongBase) {
+  ClientInformationSnapshot base = MakeSnapshot(10, 4);
+  ClientInformationSnapshot current = MakeSnapshot(11, 4);
+  current.my_portfolio_ = {{"AA", 100}};
+  ClientInformationDelta delta;
+  DiffClientInformation(base, current, &delta);
+
+  ClientInformationSnapshot stale = MakeSnapshot(9, 4);
+  EXPECT_FALSE(ApplyClientInformationDelta(delta, &stale));
+  EXPECT_TRUE(stale.my_portfolio_.empty());
+  ClientInformationSnapshot other = base;
+  other.client_id_ = "C4";
+  EXPECT_FALSE(ApplyClientInformationDelta(delta, &other));
+}
+
+TEST(ClientInformationDeltaTest, DecodeRejectsTruncatedMessages) {
+  ClientInformationSnapshot base = MakeSnapshot(1, 1);
+  ClientInformationSnapshot current = MakeSnapshot(2, 2);
+  current.my_portfolio_ = {{"AA", 100}};
+  current.outstanding_orders_ = {MakeOrder("G1_C3_1", 100)};
+  base.my_portfolio_ = {{"AB", 5}};
+  ClientInformationDelta delta;
+  DiffClientInformation(base, current, &delta);
+  std::string message;
+  EncodeClientInformationDelta(delta, &message);
+  ClientInformationDelta decoded;
+  for (size_t len = 0; len < message.size(); len++) {
+    EXPECT_FALSE(DecodeClientInformationDelta(message.data(), len, &decoded))
+        << len;
+  }
+  message.push_back('\0');
+  EXPECT_FALSE(DecodeClientInformationDelta(message.data(), message.size(),
+                                            &decoded));
+}
+
+}  // namespace
@@ -0,0 +1,74 @@
+#include "common/clock.h"
+
+#include <unistd.h>
+
+#include "common/utils.h"
+
+uint64_t RealClock::Now() { return utils::GetMicrosecondTimestamp(); }
+
+void RealClock::SleepUntil(uint64_t timestamp) {
+  uint64_t now = Now();
+  while (now < timestamp) {
+    usleep(timestamp - now);
+    now = Now();
+  }
+}
+
+Clock *RealTimeClock() {
+  static RealClock *clock = new RealClock();
+  return clock;
+}
+
+void SimulatedClock::AdvanceTo(uint64_t timestamp) {
+  uint64_t now = now_.load(std::memory_order_relaxed);
+  while (now < timestamp &&
+         !now_.compare_exchange_weak(now, timestamp,
+                                     std::memory_order_acq_rel)) {
+  }
+}
+
+void EventClock::SleepUntil(uint64_t timestamp) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (closed_ || now_.load(std::memory_order_relaxed) >= timestamp) return;
+  auto deadline = deadlines_.insert(timestamp);
+  idle_cond_.notify_all();
+  wake_cond_.wait(lock, [this, timestamp]() {
+    return closed_ || now_.load(std::memory_order_relaxed) >= timestamp;
+  });
+  deadlines_.erase(deadline);
+}
+
+void EventClock::AddParticipant() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  participants_++;
+}
+
+void EventClock::RemoveParticipant() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  participants_--;
+  idle_cond_.notify_all();
+}
+
+bool EventClock::Idle() const {
+  if (closed_) return true;
+  if (static_cast<int>(deadlines_.size()) < participants_) return false;
+  return deadlines_.empty() ||
+         *deadlines_.begin() > now_.load(std::memory_order_relaxed);
+}
+
+void EventClock::AdvanceTo(uint64_t timestamp) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  // Let participants that are still running from the last advance settle
+  idle_cond_.wait(lock, [this]() { return Idle(); });
+  if (timestamp <= now_.load(std::memory_order_relaxed)) return;
+  now_.store(timestamp, std::memory_order_release);
+  wake_cond_.notify_all();
+  idle_cond_.wait(lock, [this]() { return Idle(); });
+}
+
+void EventClock::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  closed_ = true;
+  wake_cond_.notify_all();
+  idle_cond_.notify_all();
+}
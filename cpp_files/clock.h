@@ -0,0 +1,98 @@
+#ifndef COMMON_CLOCK_H_
+#define COMMON_CLOCK_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+
+// Source of time for the trader library and strategies, in microseconds since
+// the epoch. Code that reads the time or waits through a Clock runs
+// unchanged against wall-clock time, simulated time or the timestamps of
+// replayed market data.
+class Clock {
+ public:
+  virtual ~Clock() {}
+
+  virtual uint64_t Now() = 0;
+
+  // Return once Now() >= timestamp
+  virtual void SleepUntil(uint64_t timestamp) = 0;
+
+  void SleepFor(uint64_t duration) { SleepUntil(Now() + duration); }
+
+  // Threads that wait on the clock in a loop (such as the strategy runner)
+  // register for the duration of the loop. Event-driven clocks wait for
+  // registered threads to catch up before advancing; others ignore this.
+  virtual void AddParticipant() {}
+  virtual void RemoveParticipant() {}
+};
+
+// Wall-clock time
+class RealClock : public Clock {
+ public:
+  uint64_t Now() override;
+  void SleepUntil(uint64_t timestamp) override;
+};
+
+// Process-wide RealClock, the default clock everywhere
+Clock *RealTimeClock();
+
+// Time that only moves when told to. SleepUntil() moves it forward to the
+// requested timestamp and returns at once, so a loop of waits runs as fast
+// as the work between them.
+class SimulatedClock : public Clock {
+ public:
+  explicit SimulatedClock(uint64_t start_timestamp = 0)
+      : now_(start_timestamp) {}
+
+  uint64_t Now() override { return now_.load(std::memory_order_acquire); }
+  void SleepUntil(uint64_t timestamp) override { AdvanceTo(timestamp); }
+
+  // Move time forward to timestamp (never backwards)
+  void AdvanceTo(uint64_t timestamp);
+  void Advance(uint64_t duration) { AdvanceTo(Now() + duration); }
+
+ private:
+  std::atomic<uint64_t> now_;
+};
+
+// Time driven by a stream of events, e.g. the receive timestamps of a
+// replayed journal. SleepUntil() blocks until the events reach the requested
+// timestamp. AdvanceTo() does not return until every participant woken by
+// the new time has gone back to sleep, so each tick sees exactly the events
+// received before it, however fast the stream is fed.
+class EventClock : public Clock {
+ public:
+  explicit EventClock(uint64_t start_timestamp = 0)
+      : now_(start_timestamp) {}
+
+  uint64_t Now() override { return now_.load(std::memory_order_acquire); }
+  void SleepUntil(uint64_t timestamp) override;
+
+  void AddParticipant() override;
+  void RemoveParticipant() override;
+
+  // Move event time forward to timestamp (never backwards)
+  void AdvanceTo(uint64_t timestamp);
+
+  // Release all sleepers and stop waiting for participants, at the end of
+  // the event stream
+  void Close();
+
+ private:
+  // True once no participant is awake and no sleeper is due
+  bool Idle() const;
+
+  std::atomic<uint64_t> now_;
+  std::mutex mutex_;
+  std::condition_variable wake_cond_;
+  std::condition_variable idle_cond_;
+  std::multiset<uint64_t> deadlines_;
+  int participants_ = 0;
+  bool closed_ = false;
+};
+
+#endif  // COMMON_CLOCK_H_
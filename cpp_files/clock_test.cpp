@@ -0,0 +1,87 @@
+#include "common/clock.h"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+TEST(ClockTest, SimulatedClockOnlyMovesForward) {
+  SimulatedClock clock(100);
+  clock.SleepUntil(250);
+  EXPECT_EQ(clock.Now(), 250u);
+  clock.AdvanceTo(200);
+  EXPECT_EQ(clock.Now(), 250u);
+  clock.SleepFor(50);
+  EXPECT_EQ(clock.Now(), 300u);
+}
+
+TEST(ClockTest, EventClockTicksSeeOnlyEarlierEvents) {
+  EventClock clock;
+  std::atomic<int> delivered(0);
+  std::vector<int> seen;
+  // Registered before the thread starts, so the first advance waits for it
+  clock.AddParticipant();
+  std::thread participant([&]() {
+    for (uint64_t tick = 100; tick <= 500; tick += 100) {
+      clock.SleepUntil(tick);
+      seen.push_back(delivered.load());
+    }
+    clock.RemoveParticipant();
+  });
+  // Events at 50, 150, ..., 550, each handed over after the advance
+  for (uint64_t timestamp = 50; timestamp <= 550; timestamp += 100) {
+    clock.AdvanceTo(timestamp);
+    delivered++;
+  }
+  participant.join();
+  EXPECT_EQ(seen, std::vector<int>({1, 2, 3, 4, 5}));
+}
+
+TEST(ClockTest, EventClockAdvanceWaitsForRunningParticipants) {
+  EventClock clock;
+  std::atomic<bool> finished(false);
+  clock.AddParticipant();
+  std::thread participant([&]() {
+    // Busy, never sleeping on the clock
+    usleep(20000);
+    finished = true;
+    clock.RemoveParticipant();
+  });
+  clock.AdvanceTo(10);
+  EXPECT_TRUE(finished.load());
+  EXPECT_EQ(clock.Now(), 10u);
+  participant.join();
+
+  // Never backwards, and no participants left to wait for
+  clock.AdvanceTo(5);
+  EXPECT_EQ(clock.Now(), 10u);
+}
+
+TEST(ClockTest, EventClockCloseReleasesSleepers) {
+  EventClock clock(100);
+  // Already due
+  clock.SleepUntil(100);
+  clock.AddParticipant();
+  std::atomic<bool> woken(false);
+  std::thread participant([&]() {
+    clock.SleepUntil(1000);
+    woken = true;
+  });
+  // Moves time but not up to the sleeper's deadline
+  clock.AdvanceTo(500);
+  EXPECT_FALSE(woken.load());
+  clock.Close();
+  participant.join();
+  EXPECT_TRUE(woken.load());
+  EXPECT_EQ(clock.Now(), 500u);
+  // Nothing waits once closed
+  clock.SleepUntil(2000);
+  clock.AdvanceTo(600);
+  EXPECT_EQ(clock.Now(), 600u);
+}
+
+}  // namespace
@@ -0,0 +1,129 @@
+#include "trader/columnar.h"
+
+#include "common/utils.h"
+
+void TradeColumns::Reserve(size_t size) {
+  symbol_.reserve(size);
+  buyer_serial_num_.reserve(size);
+  seller_serial_num_.reserve(size);
+  buyer_order_id_.reserve(size);
+  seller_order_id_.reserve(size);
+  buyer_client_id_.reserve(size);
+  seller_client_id_.reserve(size);
+  exec_price_.reserve(size);
+  cash_traded_.reserve(size);
+  shares_traded_.reserve(size);
+  creation_timestamp_.reserve(size);
+  release_timestamp_.reserve(size);
+  trade_serial_num_.reserve(size);
+}
+
+void TradeColumns::Resize(size_t size) {
+  symbol_.resize(size);
+  buyer_serial_num_.resize(size);
+  seller_serial_num_.resize(size);
+  buyer_order_id_.resize(size);
+  seller_order_id_.resize(size);
+  buyer_client_id_.resize(size);
+  seller_client_id_.resize(size);
+  exec_price_.resize(size);
+  cash_traded_.resize(size);
+  shares_traded_.resize(size);
+  creation_timestamp_.resize(size);
+  release_timestamp_.resize(size);
+  trade_serial_num_.resize(size);
+}
+
+bool TradeColumns::Append(const Trade &trade) {
+  CompactTrade compact;
+  if (!ToCompact(trade, &order_ids_, &compact)) {
+    LOG(ERROR) << "Trade " << trade.trade_serial_num_
+               << " Has No Compact Form";
+    return false;
+  }
+  symbol_.push_back(compact.symbol_);
+  buyer_serial_num_.push_back(compact.buyer_serial_num_);
+  seller_serial_num_.push_back(compact.seller_serial_num_);
+  buyer_order_id_.push_back(compact.buyer_order_id_);
+  seller_order_id_.push_back(compact.seller_order_id_);
+  buyer_client_id_.push_back(compact.buyer_client_id_);
+  seller_client_id_.push_back(compact.seller_client_id_);
+  exec_price_.push_back(compact.exec_price_);
+  cash_traded_.push_back(compact.cash_traded_);
+  shares_traded_.push_back(compact.shares_traded_);
+  creation_timestamp_.push_back(compact.creation_timestamp_);
+  release_timestamp_.push_back(trade.release_timestamp_);
+  trade_serial_num_.push_back(compact.trade_serial_num_);
+  return true;
+}
+
+void BookColumns::Reserve(size_t size) {
+  symbol_.reserve(size);
+  creation_timestamp_.reserve(size);
+  num_buy_levels_.reserve(size);
+  num_sell_levels_.reserve(size);
+  buy_prices_.reserve(size * TOP_OF_BOOK_DEPTH);
+  buy_shares_.reserve(size * TOP_OF_BOOK_DEPTH);
+  sell_prices_.reserve(size * TOP_OF_BOOK_DEPTH);
+  sell_shares_.reserve(size * TOP_OF_BOOK_DEPTH);
+}
+
+void BookColumns::Resize(size_t size) {
+  symbol_.resize(size);
+  creation_timestamp_.resize(size);
+  num_buy_levels_.resize(size);
+  num_sell_levels_.resize(size);
+  buy_prices_.resize(size * TOP_OF_BOOK_DEPTH);
+  buy_shares_.resize(size * TOP_OF_BOOK_DEPTH);
+  sell_prices_.resize(size * TOP_OF_BOOK_DEPTH);
+  sell_shares_.resize(size * TOP_OF_BOOK_DEPTH);
+}
+
+void BookColumns::Append(uint16_t symbol, const TopOfBook &depth) {
+  symbol_.push_back(symbol);
+  creation_timestamp_.push_back(depth.creation_timestamp_);
+  num_buy_levels_.push_back(depth.num_buy_levels_);
+  num_sell_levels_.push_back(depth.num_sell_levels_);
+  for (int i = 0; i < TOP_OF_BOOK_DEPTH; i++) {
+    bool buy_level = i < depth.num_buy_levels_;
+    bool sell_level = i < depth.num_sell_levels_;
+    buy_prices_.push_back(buy_level ? depth.buy_prices_[i] : 0);
+    buy_shares_.push_back(buy_level ? depth.buy_shares_[i] : 0);
+    sell_prices_.push_back(sell_level ? depth.sell_prices_[i] : 0);
+    sell_shares_.push_back(sell_level ? depth.sell_shares_[i] : 0);
+  }
+}
+
+bool ToColumns(const std::vector<Trade> &trades, TradeColumns *columns) {
+  size_t begin = columns->size();
+  columns->Reserve(begin + trades.size());
+  for (auto &trade : trades) {
+    if (!columns->Append(trade)) {
+      columns->Resize(begin);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ToColumns(const MarketTape &tape, BookColumns *columns) {
+  std::vector<uint16_t> symbols(tape.symbols_.size(), 0);
+  for (size_t i = 0; i < tape.symbols_.size(); i++) {
+    if (!SymbolTable()->Intern(tape.symbols_[i], &symbols[i])) {
+      LOG(ERROR) << "Symbol Table Full: " << tape.symbols_[i];
+      return false;
+    }
+  }
+  for (auto &event : tape.events_) {
+    if (event.symbol_index_ < 0 ||
+        event.symbol_index_ >= static_cast<int>(symbols.size())) {
+      LOG(ERROR) << "Book of Unknown Symbol: " << event.symbol_index_;
+      return false;
+    }
+  }
+  columns->Reserve(columns->size() + tape.events_.size());
+  for (auto &event : tape.events_) {
+    columns->Append(symbols[event.symbol_index_], event.depth_);
+  }
+  return true;
+}
@@ -0,0 +1,75 @@
+#ifndef TRADER_COLUMNAR_H_
+#define TRADER_COLUMNAR_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/compact_types.h"
+#include "common/message_types.h"
+#include "trader/backtest.h"
+#include "trader/top_of_book.h"
+
+// Column-per-field form of a sequence of trades, for handing to analysis
+// code without a per-trade object. Append converts each trade to its
+// CompactTrade form (see compact_types.h) and splits that into the columns:
+// symbols and client ids are SymbolTable()/ClientTable() codes, and order
+// ids, which are unique to a trade or two, are codes of order_ids_ (also for
+// rows read by TickArchiveReader).
+class TradeColumns {
+ public:
+  std::vector<uint16_t> symbol_;
+  std::vector<uint64_t> buyer_serial_num_;
+  std::vector<uint64_t> seller_serial_num_;
+  std::vector<uint32_t> buyer_order_id_;
+  std::vector<uint32_t> seller_order_id_;
+  std::vector<uint16_t> buyer_client_id_;
+  std::vector<uint16_t> seller_client_id_;
+  std::vector<int32_t> exec_price_;
+  std::vector<int32_t> cash_traded_;
+  std::vector<int32_t> shares_traded_;
+  std::vector<uint64_t> creation_timestamp_;
+  std::vector<uint64_t> release_timestamp_;
+  std::vector<uint64_t> trade_serial_num_;
+
+  // Order ids of the appended trades
+  OrderIdDictionary order_ids_;
+
+  size_t size() const { return exec_price_.size(); }
+  void Reserve(size_t size);
+  void Resize(size_t size);
+  // Returns false, appending nothing, if the trade has no compact form (see
+  // ToCompact)
+  bool Append(const Trade &trade);
+};
+
+// Column-per-field form of a sequence of top-of-book summaries. The level
+// columns are row-major [size() x TOP_OF_BOOK_DEPTH]; missing levels hold 0.
+class BookColumns {
+ public:
+  std::vector<uint16_t> symbol_;
+  std::vector<uint64_t> creation_timestamp_;
+  std::vector<int32_t> num_buy_levels_;
+  std::vector<int32_t> num_sell_levels_;
+  std::vector<int32_t> buy_prices_;
+  std::vector<int32_t> buy_shares_;
+  std::vector<int32_t> sell_prices_;
+  std::vector<int32_t> sell_shares_;
+
+  size_t size() const { return creation_timestamp_.size(); }
+  void Reserve(size_t size);
+  void Resize(size_t size);
+  void Append(uint16_t symbol, const TopOfBook &depth);
+};
+
+// Append trades to columns. On failure columns is left as it was.
+bool ToColumns(const std::vector<Trade> &trades, TradeColumns *columns);
+
+// Append the columns of every book of tape, with symbol codes from
+// SymbolTable(). Returns false, appending nothing, if a symbol cannot be
+// interned or a book has no symbol.
+bool ToColumns(const MarketTape &tape, BookColumns *columns);
+
+#endif  // TRADER_COLUMNAR_H_
@@ -0,0 +1,61 @@
+#include "trader/columnar.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+TapeEvent MakeEvent(int symbol_index, uint64_t timestamp, int price) {
+  TapeEvent event{};
+  event.symbol_index_ = symbol_index;
+  event.depth_.creation_timestamp_ = timestamp;
+  event.depth_.num_buy_levels_ = 1;
+  event.depth_.buy_prices_[0] = price;
+  event.depth_.buy_shares_[0] = 100;
+  return event;
+}
+
+TEST(ColumnarTest, TapeBooksBecomeColumns) {
+  MarketTape tape;
+  tape.symbols_ = {"CA", "CB"};
+  tape.events_ = {MakeEvent(0, 10, 50), MakeEvent(1, 20, 70)};
+  BookColumns columns;
+  ASSERT_TRUE(ToColumns(tape, &columns));
+  ASSERT_EQ(columns.size(), 2u);
+  ASSERT_NE(SymbolTable()->Lookup(columns.symbol_[1]), nullptr);
+  EXPECT_EQ(*SymbolTable()->Lookup(columns.symbol_[1]), "CB");
+  EXPECT_EQ(columns.creation_timestamp_[1], 20u);
+  EXPECT_EQ(columns.buy_prices_[TOP_OF_BOOK_DEPTH], 70);
+  // Missing levels hold 0
+  EXPECT_EQ(columns.num_sell_levels_[0], 0);
+  EXPECT_EQ(columns.sell_prices_[0], 0);
+  EXPECT_EQ(columns.buy_prices_[1], 0);
+}
+
+TEST(ColumnarTest, TapeConversionFailsWithoutChangingColumns) {
+  MarketTape tape;
+  tape.symbols_ = {"CA"};
+  tape.events_ = {MakeEvent(0, 10, 50)};
+  BookColumns columns;
+  ASSERT_TRUE(ToColumns(tape, &columns));
+
+  MarketTape bad_index = tape;
+  bad_index.events_.push_back(MakeEvent(1, 20, 60));
+  EXPECT_FALSE(ToColumns(bad_index, &columns));
+  EXPECT_EQ(columns.size(), 1u);
+
+  // Fill the symbol table, then ask for one more symbol
+  uint16_t code;
+  for (size_t i = SymbolTable()->size(); i <= UINT16_MAX; i++) {
+    ASSERT_TRUE(SymbolTable()->Intern("FILL" + std::to_string(i), &code));
+  }
+  MarketTape full = tape;
+  full.symbols_.push_back("CZ");
+  EXPECT_FALSE(ToColumns(full, &columns));
+  EXPECT_EQ(columns.size(), 1u);
+  EXPECT_EQ(columns.buy_prices_.size(), TOP_OF_BOOK_DEPTH);
+}
+
+}  // namespace
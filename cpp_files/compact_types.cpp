@@ -0,0 +1,146 @@
+#include "common/compact_types.h"
+
+namespace {
+
+#define UNSET_OFFSET (UINT32_MAX)
+
+// Offset of timestamp from base, UNSET_OFFSET for an unset (0) timestamp.
+// Returns false if the offset does not fit.
+bool ToOffset(uint64_t base, uint64_t timestamp, uint32_t *offset) {
+  if (timestamp == 0) {
+    *offset = UNSET_OFFSET;
+    return true;
+  }
+  if (timestamp < base || timestamp - base >= UNSET_OFFSET) return false;
+  *offset = static_cast<uint32_t>(timestamp - base);
+  return true;
+}
+
+uint64_t FromOffset(uint64_t base, uint32_t offset) {
+  return offset == UNSET_OFFSET ? 0 : base + offset;
+}
+
+}  // namespace
+
+InternTable<uint16_t> *SymbolTable() {
+  static InternTable<uint16_t> *table = new InternTable<uint16_t>();
+  return table;
+}
+
+InternTable<uint16_t> *ClientTable() {
+  static InternTable<uint16_t> *table = new InternTable<uint16_t>();
+  return table;
+}
+
+uint32_t OrderIdDictionary::Code(const std::string &order_id) {
+  if (order_id == "NULL") return 0;
+  auto inserted = codes_.emplace(order_id, order_ids_.size());
+  if (inserted.second) {
+    order_ids_.push_back(order_id);
+  }
+  return inserted.first->second;
+}
+
+bool ToCompact(const Order &order, OrderIdDictionary *order_ids,
+               CompactOrder *compact) {
+  *compact = CompactOrder();
+  compact->order_id_ = order_ids->Code(order.order_id_);
+  compact->cancel_id_ = order_ids->Code(order.cancel_id_);
+  compact->genesis_timestamp_ = order.genesis_timestamp_;
+  compact->gateway_timestamp_ = order.gateway_timestamp_;
+  compact->order_serial_num_ = order.order_serial_num_;
+  compact->num_shares_ = order.num_shares_;
+  compact->limit_price_ = order.limit_price_;
+  compact->action_ = static_cast<uint8_t>(order.action_);
+  compact->type_ = static_cast<uint8_t>(order.type_);
+  compact->result_ = static_cast<uint8_t>(order.result_);
+  return ToOffset(order.gateway_timestamp_, order.enqueue_timestamp_,
+                  &compact->enqueue_offset_) &&
+         ToOffset(order.gateway_timestamp_, order.dequeue_timestamp_,
+                  &compact->dequeue_offset_) &&
+         SymbolTable()->Intern(order.symbol_, &compact->symbol_) &&
+         ClientTable()->Intern(order.client_id_, &compact->client_id_);
+}
+
+bool ToCompact(const Trade &trade, OrderIdDictionary *order_ids,
+               CompactTrade *compact) {
+  *compact = CompactTrade();
+  compact->buyer_order_id_ = order_ids->Code(trade.buyer_order_id_);
+  compact->seller_order_id_ = order_ids->Code(trade.seller_order_id_);
+  compact->creation_timestamp_ = trade.creation_timestamp_;
+  compact->trade_serial_num_ = trade.trade_serial_num_;
+  compact->buyer_serial_num_ = trade.buyer_serial_num_;
+  compact->seller_serial_num_ = trade.seller_serial_num_;
+  compact->exec_price_ = trade.exec_price_;
+  compact->cash_traded_ = trade.cash_traded_;
+  compact->shares_traded_ = trade.shares_traded_;
+  return ToOffset(trade.creation_timestamp_, trade.release_timestamp_,
+                  &compact->release_offset_) &&
+         SymbolTable()->Intern(trade.symbol_, &compact->symbol_) &&
+         ClientTable()->Intern(trade.buyer_client_id_,
+                               &compact->buyer_client_id_) &&
+         ClientTable()->Intern(trade.seller_client_id_,
+                               &compact->seller_client_id_);
+}
+
+bool FromCompact(const CompactOrder &compact,
+                 const OrderIdDictionary &order_ids, Order *order) {
+  const std::string *symbol = SymbolTable()->Lookup(compact.symbol_);
+  const std::string *order_id = order_ids.Lookup(compact.order_id_);
+  const std::string *cancel_id = order_ids.Lookup(compact.cancel_id_);
+  const std::string *client_id = ClientTable()->Lookup(compact.client_id_);
+  if (symbol == nullptr || order_id == nullptr || cancel_id == nullptr ||
+      client_id == nullptr) {
+    return false;
+  }
+  order->symbol_ = *symbol;
+  order->order_id_ = *order_id;
+  order->cancel_id_ = *cancel_id;
+  order->client_id_ = *client_id;
+  order->action_ = static_cast<OrderAction>(compact.action_);
+  order->type_ = static_cast<OrderType>(compact.type_);
+  order->result_ = static_cast<OrderResult>(compact.result_);
+  order->num_shares_ = compact.num_shares_;
+  order->limit_price_ = compact.limit_price_;
+  order->genesis_timestamp_ = compact.genesis_timestamp_;
+  order->gateway_timestamp_ = compact.gateway_timestamp_;
+  order->enqueue_timestamp_ =
+      FromOffset(compact.gateway_timestamp_, compact.enqueue_offset_);
+  order->dequeue_timestamp_ =
+      FromOffset(compact.gateway_timestamp_, compact.dequeue_offset_);
+  order->order_serial_num_ = compact.order_serial_num_;
+  return true;
+}
+
+bool FromCompact(const CompactTrade &compact,
+                 const OrderIdDictionary &order_ids, Trade *trade) {
+  const std::string *symbol = SymbolTable()->Lookup(compact.symbol_);
+  const std::string *buyer_order_id =
+      order_ids.Lookup(compact.buyer_order_id_);
+  const std::string *seller_order_id =
+      order_ids.Lookup(compact.seller_order_id_);
+  const std::string *buyer_client_id =
+      ClientTable()->Lookup(compact.buyer_client_id_);
+  const std::string *seller_client_id =
+      ClientTable()->Lookup(compact.seller_client_id_);
+  if (symbol == nullptr || buyer_order_id == nullptr ||
+      seller_order_id == nullptr || buyer_client_id == nullptr ||
+      seller_client_id == nullptr) {
+    return false;
+  }
+  trade->symbol_ = *symbol;
+  trade->buyer_order_id_ = *buyer_order_id;
+  trade->seller_order_id_ = *seller_order_id;
+  trade->buyer_client_id_ = *buyer_client_id;
+  trade->seller_client_id_ = *seller_client_id;
+  trade->buyer_serial_num_ = compact.buyer_serial_num_;
+  trade->seller_serial_num_ = compact.seller_serial_num_;
+  trade->exec_price_ = compact.exec_price_;
+  trade->cash_traded_ = compact.cash_traded_;
+  trade->shares_traded_ = compact.shares_traded_;
+  trade->creation_timestamp_ = compact.creation_timestamp_;
+  trade->release_timestamp_ =
+      FromOffset(compact.creation_timestamp_, compact.release_offset_);
+  trade->trade_serial_num_ = compact.trade_serial_num_;
+  return true;
+}
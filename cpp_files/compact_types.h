@@ -0,0 +1,171 @@
+#ifndef COMMON_COMPACT_TYPES_H_
+#define COMMON_COMPACT_TYPES_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/message_types.h"
+
+// Process-wide table assigning dense ids to strings. Interning takes a lock,
+// but looking an id back up is lock-free and returns a pointer that stays
+// valid for the life of the process, so hot paths can carry ids and turn them
+// back into strings without allocating.
+template <typename Id>
+class InternTable {
+ public:
+  InternTable() {
+    for (auto &chunk : chunks_) chunk.store(nullptr);
+  }
+  ~InternTable() {
+    for (auto &chunk : chunks_) delete[] chunk.load();
+  }
+
+  // Returns the id of value, assigning the next free one if needed. Returns
+  // false if the table is full.
+  bool Intern(const std::string &value, Id *id);
+
+  // Returns the id of value if it has been interned
+  bool Find(const std::string &value, Id *id) const;
+
+  // String of an id returned by Intern, or nullptr for any other id
+  const std::string *Lookup(Id id) const {
+    if (id >= size_.load(std::memory_order_acquire)) return nullptr;
+    return &chunks_[id / kChunkSize].load(
+        std::memory_order_acquire)[id % kChunkSize];
+  }
+
+  size_t size() const { return size_.load(std::memory_order_acquire); }
+
+ private:
+  static const size_t kChunkSize = 1024;
+  static const size_t kNumChunks = 4096;
+
+  std::atomic<std::string *> chunks_[kNumChunks];
+  std::atomic<size_t> size_{0};
+  std::unordered_map<std::string, Id> ids_;
+  mutable std::mutex mutex_;
+};
+
+template <typename Id>
+bool InternTable<Id>::Intern(const std::string &value, Id *id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = ids_.find(value);
+  if (it != ids_.end()) {
+    *id = it->second;
+    return true;
+  }
+  size_t next = size_.load(std::memory_order_relaxed);
+  if (next >= kChunkSize * kNumChunks ||
+      next > static_cast<size_t>(static_cast<Id>(~Id(0)))) {
+    return false;
+  }
+  std::string *chunk = chunks_[next / kChunkSize].load();
+  if (chunk == nullptr) {
+    chunk = new std::string[kChunkSize];
+    chunks_[next / kChunkSize].store(chunk, std::memory_order_release);
+  }
+  chunk[next % kChunkSize] = value;
+  ids_[value] = next;
+  size_.store(next + 1, std::memory_order_release);
+  *id = next;
+  return true;
+}
+
+template <typename Id>
+bool InternTable<Id>::Find(const std::string &value, Id *id) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = ids_.find(value);
+  if (it == ids_.end()) return false;
+  *id = it->second;
+  return true;
+}
+
+// Process-wide tables for symbols and client ids. Both are small, fixed
+// sets over the life of a process, which is what an InternTable is for.
+InternTable<uint16_t> *SymbolTable();
+InternTable<uint16_t> *ClientTable();
+
+// Dense codes for the order ids of one owner (a batch of compact records, a
+// file, a session). Order ids are unique to an order, so there is no bound
+// on them over the life of a process and they are never interned in a
+// process-wide table: each owner keeps its own dictionary and frees it with
+// its records. Code 0 is the "NULL" order id. Not thread safe.
+class OrderIdDictionary {
+ public:
+  OrderIdDictionary() : order_ids_(1, "NULL") {}
+
+  // Code of order_id, assigning the next free one if needed
+  uint32_t Code(const std::string &order_id);
+
+  // Order id of code, or nullptr if code was never assigned
+  const std::string *Lookup(uint32_t code) const {
+    return code < order_ids_.size() ? &order_ids_[code] : nullptr;
+  }
+  size_t size() const { return order_ids_.size(); }
+
+ private:
+  std::vector<std::string> order_ids_;
+  std::unordered_map<std::string, uint32_t> codes_;
+};
+
+// Cache-line-sized plain-old-data form of Order. The symbol and client id
+// are replaced by intern table ids and the order ids by codes of an
+// OrderIdDictionary; the enqueue/dequeue timestamps are stored as
+// microsecond offsets from the gateway timestamp (UINT32_MAX when unset).
+struct alignas(64) CompactOrder {
+  uint32_t order_id_;
+  uint32_t cancel_id_;
+  uint64_t genesis_timestamp_;
+  uint64_t gateway_timestamp_;
+  uint64_t order_serial_num_;
+  uint32_t enqueue_offset_;
+  uint32_t dequeue_offset_;
+  int32_t num_shares_;
+  int32_t limit_price_;
+  uint16_t symbol_;
+  uint16_t client_id_;
+  uint8_t action_;
+  uint8_t type_;
+  uint8_t result_;
+};
+static_assert(sizeof(CompactOrder) == 64, "CompactOrder must fit a cache line");
+
+// Cache-line-sized plain-old-data form of Trade. The release timestamp is a
+// microsecond offset from the creation timestamp.
+struct alignas(64) CompactTrade {
+  uint32_t buyer_order_id_;
+  uint32_t seller_order_id_;
+  uint64_t creation_timestamp_;
+  uint64_t trade_serial_num_;
+  uint64_t buyer_serial_num_;
+  uint64_t seller_serial_num_;
+  uint32_t release_offset_;
+  int32_t exec_price_;
+  int32_t cash_traded_;
+  int32_t shares_traded_;
+  uint16_t symbol_;
+  uint16_t buyer_client_id_;
+  uint16_t seller_client_id_;
+};
+static_assert(sizeof(CompactTrade) == 64, "CompactTrade must fit a cache line");
+
+// Conversions at the edges, with the order ids coded in order_ids.
+// ToCompact interns any new symbol or client id. It returns false if an
+// intern table is full, or if a secondary timestamp is before its base or
+// too far after it for a 32 bit offset. FromCompact returns false if an id
+// or code is unknown.
+bool ToCompact(const Order &order, OrderIdDictionary *order_ids,
+               CompactOrder *compact);
+bool ToCompact(const Trade &trade, OrderIdDictionary *order_ids,
+               CompactTrade *compact);
+bool FromCompact(const CompactOrder &compact,
+                 const OrderIdDictionary &order_ids, Order *order);
+bool FromCompact(const CompactTrade &compact,
+                 const OrderIdDictionary &order_ids, Trade *trade);
+
+#endif  // COMMON_COMPACT_TYPES_H_
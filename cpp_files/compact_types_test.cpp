@@ -0,0 +1,154 @@
+#include "common/compact_types.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace {
+
+Order MakeOrder() {
+  Order order;
+  order.symbol_ = "AA";
+  order.order_id_ = "G1_C3_1602182726927431";
+  order.cancel_id_ = "NULL";
+  order.client_id_ = "C3";
+  order.type_ = OrderType::limit;
+  order.action_ = OrderAction::sell;
+  order.genesis_timestamp_ = 1602182726927431ULL;
+  order.gateway_timestamp_ = 1602182726934577ULL;
+  order.enqueue_timestamp_ = 1602182726934784ULL;
+  order.dequeue_timestamp_ = 0;
+  order.order_serial_num_ = 7;
+  order.limit_price_ = -50;
+  order.result_ = OrderResult::valid;
+  order.num_shares_ = 100;
+  return order;
+}
+
+Trade MakeTrade() {
+  Trade trade;
+  trade.symbol_ = "AB";
+  // Past 32 bits
+  trade.buyer_serial_num_ = 5000000000ULL;
+  trade.seller_serial_num_ = (1ULL << 63) + 5;
+  trade.buyer_order_id_ = "G1_C3_12";
+  trade.seller_order_id_ = "G1_C4_13";
+  trade.buyer_client_id_ = "C3";
+  trade.seller_client_id_ = "C4";
+  trade.exec_price_ = 50;
+  trade.cash_traded_ = 5000;
+  trade.shares_traded_ = 100;
+  trade.creation_timestamp_ = 1602182417783908ULL;
+  trade.release_timestamp_ = 1602182417784258ULL;
+  trade.trade_serial_num_ = 10003;
+  return trade;
+}
+
+TEST(CompactTypesTest, OrderRoundTrips) {
+  OrderIdDictionary order_ids;
+  Order order = MakeOrder();
+  CompactOrder compact;
+  ASSERT_TRUE(ToCompact(order, &order_ids, &compact));
+  EXPECT_EQ(compact.cancel_id_, 0u);
+  Order decoded;
+  ASSERT_TRUE(FromCompact(compact, order_ids, &decoded));
+  EXPECT_EQ(decoded.symbol_, order.symbol_);
+  EXPECT_EQ(decoded.order_id_, order.order_id_);
+  EXPECT_EQ(decoded.cancel_id_, order.cancel_id_);
+  EXPECT_EQ(decoded.client_id_, order.client_id_);
+  EXPECT_EQ(decoded.type_, order.type_);
+  EXPECT_EQ(decoded.action_, order.action_);
+  EXPECT_EQ(decoded.result_, order.result_);
+  EXPECT_EQ(decoded.genesis_timestamp_, order.genesis_timestamp_);
+  EXPECT_EQ(decoded.gateway_timestamp_, order.gateway_timestamp_);
+  EXPECT_EQ(decoded.enqueue_timestamp_, order.enqueue_timestamp_);
+  EXPECT_EQ(decoded.dequeue_timestamp_, 0u);
+  EXPECT_EQ(decoded.order_serial_num_, order.order_serial_num_);
+  EXPECT_EQ(decoded.limit_price_, order.limit_price_);
+  EXPECT_EQ(decoded.num_shares_, order.num_shares_);
+}
+
+TEST(CompactTypesTest, TradeRoundTripsWithWideSerials) {
+  OrderIdDictionary order_ids;
+  Trade trade = MakeTrade();
+  CompactTrade compact;
+  ASSERT_TRUE(ToCompact(trade, &order_ids, &compact));
+  Trade decoded;
+  ASSERT_TRUE(FromCompact(compact, order_ids, &decoded));
+  EXPECT_EQ(decoded.symbol_, trade.symbol_);
+  EXPECT_EQ(decoded.buyer_serial_num_, trade.buyer_serial_num_);
+  EXPECT_EQ(decoded.seller_serial_num_, trade.seller_serial_num_);
+  EXPECT_EQ(decoded.buyer_order_id_, trade.buyer_order_id_);
+  EXPECT_EQ(decoded.seller_order_id_, trade.seller_order_id_);
+  EXPECT_EQ(decoded.buyer_client_id_, trade.buyer_client_id_);
+  EXPECT_EQ(decoded.seller_client_id_, trade.seller_client_id_);
+  EXPECT_EQ(decoded.exec_price_, trade.exec_price_);
+  EXPECT_EQ(decoded.cash_traded_, trade.cash_traded_);
+  EXPECT_EQ(decoded.shares_traded_, trade.shares_traded_);
+  EXPECT_EQ(decoded.creation_timestamp_, trade.creation_timestamp_);
+  EXPECT_EQ(decoded.release_timestamp_, trade.release_timestamp_);
+  EXPECT_EQ(decoded.trade_serial_num_, trade.trade_serial_num_);
+}
+
+TEST(CompactTypesTest, OffsetsThatDoNotFitAreRejected) {
+  OrderIdDictionary order_ids;
+  CompactOrder compact_order;
+  Order order = MakeOrder();
+  order.enqueue_timestamp_ = order.gateway_timestamp_ - 1;
+  EXPECT_FALSE(ToCompact(order, &order_ids, &compact_order));
+  order = MakeOrder();
+  order.dequeue_timestamp_ = order.gateway_timestamp_ + UINT32_MAX;
+  EXPECT_FALSE(ToCompact(order, &order_ids, &compact_order));
+  order.dequeue_timestamp_ = order.gateway_timestamp_ + UINT32_MAX - 1;
+  EXPECT_TRUE(ToCompact(order, &order_ids, &compact_order));
+
+  CompactTrade compact_trade;
+  Trade trade = MakeTrade();
+  trade.release_timestamp_ = trade.creation_timestamp_ + (1ULL << 40);
+  EXPECT_FALSE(ToCompact(trade, &order_ids, &compact_trade));
+}
+
+TEST(CompactTypesTest, UnknownIdsAreRejected) {
+  OrderIdDictionary order_ids;
+  CompactOrder compact;
+  ASSERT_TRUE(ToCompact(MakeOrder(), &order_ids, &compact));
+  Order order;
+  // A code of another dictionary
+  OrderIdDictionary other;
+  EXPECT_FALSE(FromCompact(compact, other, &order));
+  EXPECT_EQ(other.Lookup(1), nullptr);
+  ASSERT_NE(other.Lookup(0), nullptr);
+  EXPECT_EQ(*other.Lookup(0), "NULL");
+
+  // An id never interned, past the first chunk and in it
+  EXPECT_EQ(SymbolTable()->Lookup(60000), nullptr);
+  EXPECT_EQ(ClientTable()->Lookup(ClientTable()->size()), nullptr);
+  compact.symbol_ = SymbolTable()->size();
+  EXPECT_FALSE(FromCompact(compact, order_ids, &order));
+}
+
+TEST(CompactTypesTest, InternTableFillsUp) {
+  InternTable<uint8_t> table;
+  uint8_t id = 0;
+  for (int i = 0; i < 256; i++) {
+    ASSERT_TRUE(table.Intern("S" + std::to_string(i), &id));
+    EXPECT_EQ(id, i);
+  }
+  EXPECT_FALSE(table.Intern("S256", &id));
+  // Known values still resolve
+  ASSERT_TRUE(table.Intern("S17", &id));
+  EXPECT_EQ(id, 17);
+  ASSERT_NE(table.Lookup(255), nullptr);
+  EXPECT_EQ(*table.Lookup(255), "S255");
+}
+
+TEST(CompactTypesTest, EmptyOrderIdIsNotNull) {
+  OrderIdDictionary order_ids;
+  EXPECT_EQ(order_ids.Code("NULL"), 0u);
+  uint32_t code = order_ids.Code("");
+  EXPECT_NE(code, 0u);
+  ASSERT_NE(order_ids.Lookup(code), nullptr);
+  EXPECT_EQ(*order_ids.Lookup(code), "");
+}
+
+}  // namespace
@@ -0,0 +1,94 @@
+#include "common/cpu_affinity.h"
+
+#include <dirent.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <sstream>
+
+#include "common/utils.h"
+
+// set_mempolicy modes (linux/mempolicy.h), without a libnuma dependency
+#define AFFINITY_MPOL_PREFERRED 1
+#define AFFINITY_MAX_NUMA_NODES 64
+
+bool PinThread(pthread_t thread, int core) {
+  if (core < 0 || core >= CPU_SETSIZE) return false;
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(core, &cpus);
+  int error = pthread_setaffinity_np(thread, sizeof(cpus), &cpus);
+  if (error != 0) {
+    LOG(ERROR) << "Failed to Pin Thread to Core " << core << ": "
+               << strerror(error);
+    return false;
+  }
+  return true;
+}
+
+bool PinCurrentThread(int core) {
+  if (!PinThread(pthread_self(), core)) return false;
+  int node = NumaNodeOfCore(core);
+  if (node < 0 || node >= AFFINITY_MAX_NUMA_NODES) return true;
+  unsigned long node_mask = 1UL << node;
+  if (syscall(SYS_set_mempolicy, AFFINITY_MPOL_PREFERRED, &node_mask,
+              AFFINITY_MAX_NUMA_NODES) != 0) {
+    // Still pinned; first-touch allocation keeps most memory local anyway
+    VLOG(1) << "Failed to Prefer NUMA Node " << node << " for Core " << core;
+  }
+  return true;
+}
+
+bool ThreadPlacement::Pin(std::thread *thread, int core) {
+  uint64_t pins = (placement_.load() >> 32) + 1;
+  placement_.store(pins << 32 | static_cast<uint32_t>(core));
+  return thread == nullptr || PinThread(thread, core);
+}
+
+void ThreadPlacement::ApplySlow(uint64_t placement) {
+  applied_ = placement;
+  PinCurrentThread(static_cast<int32_t>(placement & 0xffffffff));
+}
+
+int NumaNodeOfCore(int core) {
+  std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(core);
+  DIR *dir = opendir(path.c_str());
+  if (dir == nullptr) return -1;
+  int node = -1;
+  while (struct dirent *entry = readdir(dir)) {
+    if (strncmp(entry->d_name, "node", 4) == 0 &&
+        entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+      node = atoi(entry->d_name + 4);
+      break;
+    }
+  }
+  closedir(dir);
+  return node;
+}
+
+bool ParseCoreList(const std::string &list, std::vector<int> *cores) {
+  cores->clear();
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (item.empty()) continue;
+    char *end;
+    long first = strtol(item.c_str(), &end, 10);
+    long last = first;
+    if (*end == '-' && end != item.c_str()) {
+      last = strtol(end + 1, &end, 10);
+    }
+    // A lone -1 stands for no core
+    if (*end != '\0' || first < -1 || last < first ||
+        (first == -1 && last != -1)) {
+      return false;
+    }
+    for (long core = first; core <= last; core++) {
+      cores->push_back(core);
+    }
+  }
+  return true;
+}
@@ -0,0 +1,56 @@
+#ifndef COMMON_CPU_AFFINITY_H_
+#define COMMON_CPU_AFFINITY_H_
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Pin thread to core, so the scheduler never migrates it and its caches
+// stay warm. Returns false if the core does not exist or is not allowed.
+bool PinThread(pthread_t thread, int core);
+inline bool PinThread(std::thread *thread, int core) {
+  return thread != nullptr && PinThread(thread->native_handle(), core);
+}
+
+// Pin the calling thread to core and have its future allocations prefer
+// the core's NUMA node. Memory the thread touches first (pools, buffers)
+// then lives next to it; memory allocated before the call stays where it is.
+bool PinCurrentThread(int core);
+
+// Placement of a thread created elsewhere, such as a Trader's ingest
+// thread. Pin sets the affinity at once if the thread exists, but a NUMA
+// memory policy can only be set by the thread itself, so the thread calls
+// Apply from its loop: a relaxed load unless Pin was called since, when it
+// pins itself with PinCurrentThread. A thread started after Pin picks the
+// placement up on its first Apply.
+class ThreadPlacement {
+ public:
+  // Returns false if thread exists and could not be pinned
+  bool Pin(std::thread *thread, int core);
+  // Called by the placed thread only
+  void Apply() {
+    uint64_t placement = placement_.load(std::memory_order_relaxed);
+    if (placement != applied_) ApplySlow(placement);
+  }
+
+ private:
+  void ApplySlow(uint64_t placement);
+
+  // Pin count in the high half, core in the low half
+  std::atomic<uint64_t> placement_{0};
+  uint64_t applied_ = 0;
+};
+
+// NUMA node of core, or -1 if it cannot be read (e.g. a single node machine
+// without NUMA sysfs entries)
+int NumaNodeOfCore(int core);
+
+// Parse a core list such as "2,4-7" or "2,-1,3" (empty gives no cores, -1
+// stands for no core). Returns false if malformed.
+bool ParseCoreList(const std::string &list, std::vector<int> *cores);
+
+#endif  // COMMON_CPU_AFFINITY_H_
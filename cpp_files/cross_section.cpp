@@ -0,0 +1,273 @@
+#include "trader/cross_section.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define CROSS_SECTION_HAVE_AVX2 1
+#endif
+
+namespace {
+
+const double kNaN = std::numeric_limits<double>::quiet_NaN();
+
+// Kernels over the n symbols, scalar and AVX2 as in indicators.cpp
+
+// Replace row with prices, moving the rolling sums of the prices centred
+// on anchors along
+void ScalarPush(const double *prices, const double *anchors, size_t begin,
+                size_t n, double *row, double *sums, double *squares) {
+  for (size_t i = begin; i < n; i++) {
+    double added = prices[i] - anchors[i];
+    double removed = row[i] - anchors[i];
+    sums[i] += added - removed;
+    squares[i] += added * added - removed * removed;
+    row[i] = prices[i];
+  }
+}
+
+void ScalarReversion(const double *prices, const double *anchors,
+                     const double *sums, const double *squares,
+                     double inv_window, size_t begin, size_t n,
+                     double *out) {
+  for (size_t i = begin; i < n; i++) {
+    double mean = sums[i] * inv_window;
+    double var = squares[i] * inv_window - mean * mean;
+    double std = sqrt(std::max(var, 0.0));
+    out[i] = std > 0 ? (mean - (prices[i] - anchors[i])) / std : kNaN;
+  }
+}
+
+void ScalarMomentum(const double *prices, const double *oldest, size_t begin,
+                    size_t n, double *out) {
+  for (size_t i = begin; i < n; i++) {
+    out[i] = oldest[i] > 0 ? 100 * (prices[i] - oldest[i]) / oldest[i] : kNaN;
+  }
+}
+
+#ifdef CROSS_SECTION_HAVE_AVX2
+
+__attribute__((target("avx2"))) void Avx2Push(const double *prices,
+                                              const double *anchors,
+                                              size_t begin, size_t n,
+                                              double *row, double *sums,
+                                              double *squares) {
+  size_t i = begin;
+  for (; i + 4 <= n; i += 4) {
+    __m256d p = _mm256_loadu_pd(prices + i);
+    __m256d anchor = _mm256_loadu_pd(anchors + i);
+    __m256d added = _mm256_sub_pd(p, anchor);
+    __m256d removed = _mm256_sub_pd(_mm256_loadu_pd(row + i), anchor);
+    __m256d sum = _mm256_add_pd(_mm256_loadu_pd(sums + i),
+                                _mm256_sub_pd(added, removed));
+    __m256d square = _mm256_add_pd(
+        _mm256_loadu_pd(squares + i),
+        _mm256_sub_pd(_mm256_mul_pd(added, added),
+                      _mm256_mul_pd(removed, removed)));
+    _mm256_storeu_pd(sums + i, sum);
+    _mm256_storeu_pd(squares + i, square);
+    _mm256_storeu_pd(row + i, p);
+  }
+  ScalarPush(prices, anchors, i, n, row, sums, squares);
+}
+
+__attribute__((target("avx2"))) void Avx2Reversion(const double *prices,
+                                                   const double *anchors,
+                                                   const double *sums,
+                                                   const double *squares,
+                                                   double inv_window,
+                                                   size_t begin, size_t n,
+                                                   double *out) {
+  const __m256d scale = _mm256_set1_pd(inv_window);
+  const __m256d zero = _mm256_setzero_pd();
+  const __m256d nan = _mm256_set1_pd(kNaN);
+  size_t i = begin;
+  for (; i + 4 <= n; i += 4) {
+    __m256d mean = _mm256_mul_pd(_mm256_loadu_pd(sums + i), scale);
+    __m256d var = _mm256_sub_pd(
+        _mm256_mul_pd(_mm256_loadu_pd(squares + i), scale),
+        _mm256_mul_pd(mean, mean));
+    __m256d std = _mm256_sqrt_pd(_mm256_max_pd(var, zero));
+    __m256d centred = _mm256_sub_pd(_mm256_loadu_pd(prices + i),
+                                    _mm256_loadu_pd(anchors + i));
+    __m256d z = _mm256_div_pd(_mm256_sub_pd(mean, centred), std);
+    // Flat or gapped windows (std 0 or NaN) have no score
+    __m256d valid = _mm256_cmp_pd(std, zero, _CMP_GT_OQ);
+    _mm256_storeu_pd(out + i, _mm256_blendv_pd(nan, z, valid));
+  }
+  ScalarReversion(prices, anchors, sums, squares, inv_window, i, n, out);
+}
+
+__attribute__((target("avx2"))) void Avx2Momentum(const double *prices,
+                                                  const double *oldest,
+                                                  size_t begin, size_t n,
+                                                  double *out) {
+  const __m256d hundred = _mm256_set1_pd(100);
+  const __m256d zero = _mm256_setzero_pd();
+  const __m256d nan = _mm256_set1_pd(kNaN);
+  size_t i = begin;
+  for (; i + 4 <= n; i += 4) {
+    __m256d p = _mm256_loadu_pd(prices + i);
+    __m256d old = _mm256_loadu_pd(oldest + i);
+    __m256d change = _mm256_div_pd(
+        _mm256_mul_pd(hundred, _mm256_sub_pd(p, old)), old);
+    __m256d valid = _mm256_cmp_pd(old, zero, _CMP_GT_OQ);
+    _mm256_storeu_pd(out + i, _mm256_blendv_pd(nan, change, valid));
+  }
+  ScalarMomentum(prices, oldest, i, n, out);
+}
+
+#endif
+
+struct Kernels {
+  void (*push)(const double *, const double *, size_t, size_t, double *,
+               double *, double *);
+  void (*reversion)(const double *, const double *, const double *,
+                    const double *, double, size_t, size_t, double *);
+  void (*momentum)(const double *, const double *, size_t, size_t, double *);
+};
+
+const Kernels kScalarKernels = {ScalarPush, ScalarReversion, ScalarMomentum};
+
+#ifdef CROSS_SECTION_HAVE_AVX2
+const Kernels kAvx2Kernels = {Avx2Push, Avx2Reversion, Avx2Momentum};
+#endif
+
+const Kernels *SelectKernels() {
+#ifdef CROSS_SECTION_HAVE_AVX2
+  if (__builtin_cpu_supports("avx2")) return &kAvx2Kernels;
+#endif
+  return &kScalarKernels;
+}
+
+const Kernels *active_kernels = SelectKernels();
+
+}  // namespace
+
+CrossSectionEngine::CrossSectionEngine(size_t num_symbols, size_t window,
+                                       CrossSectionSignal signal)
+    : num_symbols_(num_symbols),
+      window_(std::max<size_t>(window, 2)),
+      signal_(signal),
+      history_(window_ * num_symbols, kNaN),
+      anchors_(num_symbols, 0),
+      last_gaps_(num_symbols, 0),
+      sums_(num_symbols, kNaN),
+      squares_(num_symbols, kNaN),
+      scores_(num_symbols, kNaN) {}
+
+void CrossSectionEngine::Update(const double *prices) {
+  double *row = &history_[next_ * num_symbols_];
+  count_++;
+  bool gap_left = false;
+  for (size_t i = 0; i < num_symbols_; i++) {
+    if (std::isnan(prices[i])) last_gaps_[i] = count_;
+    gap_left |= last_gaps_[i] != 0 && last_gaps_[i] + window_ == count_;
+  }
+  active_kernels->push(prices, anchors_.data(), 0, num_symbols_, row,
+                       sums_.data(), squares_.data());
+  next_ = (next_ + 1) % window_;
+  if (next_ == 0 || gap_left) Recompute();
+
+  if (signal_ == CrossSectionSignal::reversion) {
+    active_kernels->reversion(prices, anchors_.data(), sums_.data(),
+                              squares_.data(), 1.0 / window_, 0, num_symbols_,
+                              scores_.data());
+  } else {
+    // The row written next is the oldest still in the window
+    const double *oldest = &history_[next_ * num_symbols_];
+    active_kernels->momentum(prices, oldest, 0, num_symbols_,
+                             scores_.data());
+  }
+}
+
+void CrossSectionEngine::Recompute() {
+  // Centre on the newest prices
+  const double *newest =
+      &history_[(next_ + window_ - 1) % window_ * num_symbols_];
+  for (size_t i = 0; i < num_symbols_; i++) {
+    if (!std::isnan(newest[i])) anchors_[i] = newest[i];
+  }
+  std::fill(sums_.begin(), sums_.end(), 0);
+  std::fill(squares_.begin(), squares_.end(), 0);
+  for (size_t r = 0; r < window_; r++) {
+    const double *row = &history_[r * num_symbols_];
+    for (size_t i = 0; i < num_symbols_; i++) {
+      double centred = row[i] - anchors_[i];
+      sums_[i] += centred;
+      squares_[i] += centred * centred;
+    }
+  }
+}
+
+void CrossSectionEngine::Rank(size_t k, double threshold,
+                              std::vector<CrossSectionTarget> *targets) {
+  targets->clear();
+  const double *scores = scores_.data();
+  // Buy candidates, strongest first
+  order_.clear();
+  for (size_t i = 0; i < num_symbols_; i++) {
+    if (scores[i] > threshold) order_.push_back(i);
+  }
+  auto higher = [scores](int a, int b) { return scores[a] > scores[b]; };
+  size_t num_buys = std::min(k, order_.size());
+  std::nth_element(order_.begin(), order_.begin() + num_buys, order_.end(),
+                   higher);
+  std::sort(order_.begin(), order_.begin() + num_buys, higher);
+  for (size_t i = 0; i < num_buys; i++) {
+    targets->push_back({order_[i], OrderAction::buy, scores[order_[i]]});
+  }
+  // Sell candidates, strongest first
+  order_.clear();
+  for (size_t i = 0; i < num_symbols_; i++) {
+    if (scores[i] < -threshold) order_.push_back(i);
+  }
+  auto lower = [scores](int a, int b) { return scores[a] < scores[b]; };
+  size_t num_sells = std::min(k, order_.size());
+  std::nth_element(order_.begin(), order_.begin() + num_sells, order_.end(),
+                   lower);
+  std::sort(order_.begin(), order_.begin() + num_sells, lower);
+  for (size_t i = 0; i < num_sells; i++) {
+    targets->push_back({order_[i], OrderAction::sell, scores[order_[i]]});
+  }
+}
+
+void CrossSectionEngine::Save(CheckpointWriter *writer) const {
+  writer->Put<uint64_t>(num_symbols_);
+  writer->Put<uint64_t>(window_);
+  writer->Put<uint64_t>(next_);
+  writer->Put<uint64_t>(count_);
+  writer->PutDoubles(history_);
+}
+
+bool CrossSectionEngine::Load(CheckpointReader *reader) {
+  uint64_t num_symbols;
+  uint64_t window;
+  uint64_t next;
+  uint64_t count;
+  std::vector<double> history;
+  if (!reader->Get(&num_symbols) || !reader->Get(&window) ||
+      !reader->Get(&next) || !reader->Get(&count) ||
+      !reader->GetDoubles(&history) || num_symbols != num_symbols_ ||
+      window != window_ || next >= window_ ||
+      history.size() != history_.size()) {
+    return false;
+  }
+  next_ = next;
+  count_ = count;
+  history_.swap(history);
+  // Update of each gap still in the window, counting back from the newest
+  std::fill(last_gaps_.begin(), last_gaps_.end(), 0);
+  for (uint64_t age = std::min<uint64_t>(count_, window_); age-- > 0;) {
+    const double *row =
+        &history_[(next_ + window_ - 1 - age) % window_ * num_symbols_];
+    for (size_t i = 0; i < num_symbols_; i++) {
+      if (std::isnan(row[i])) last_gaps_[i] = count_ - age;
+    }
+  }
+  Recompute();
+  return true;
+}
@@ -0,0 +1,86 @@
+#ifndef TRADER_CROSS_SECTION_H_
+#define TRADER_CROSS_SECTION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "common/message_primitives.h"
+#include "trader/checkpoint.h"
+
+// Signed signal of each symbol; positive means buy
+enum class CrossSectionSignal {
+  reversion,  // Minus the z-score of the price against its rolling mean
+  momentum    // Return over the window, in percent
+};
+
+// An order the ranking asks for
+class CrossSectionTarget {
+ public:
+  int symbol_;  // Index into the engine's symbols
+  OrderAction action_;
+  double score_;
+};
+
+// Scores every symbol of a universe against its own recent history and
+// ranks them, for strategies that trade the extremes of the cross section.
+// Features are kept as structure of arrays: the window holds one row of
+// prices per update, contiguous across symbols, and the rolling sums are
+// one array each, so an update and the scoring are a few passes of
+// vectorized arithmetic over the universe (AVX2 when the CPU has it, as in
+// indicators.h). Ranking picks the top and bottom k with nth_element, which
+// is linear in the number of symbols.
+//
+// Prices are centred on a recent price of each symbol before the sums are
+// taken, as in pair_matrix.h, and the sums are rebuilt from the window once
+// per window, so rounding does not build up. Missing prices are passed as
+// NaN. A symbol scores NaN, and is left out of the ranking, while a price
+// its score needs is missing: any in the window for reversion (the sums are
+// rebuilt as soon as a gap has left it), the newest or the oldest for
+// momentum.
+class CrossSectionEngine {
+ public:
+  CrossSectionEngine(size_t num_symbols, size_t window,
+                     CrossSectionSignal signal);
+
+  // Add the prices of one period, one per symbol, and rescore
+  void Update(const double *prices);
+
+  // Scores of the last update; NaN for symbols that cannot be scored
+  const double *scores() const { return scores_.data(); }
+  size_t size() const { return num_symbols_; }
+  bool ready() const { return count_ >= window_; }
+
+  // Up to k of the highest scoring symbols (buy) and k of the lowest
+  // (sell), strongest first. Only scores above threshold are bought and
+  // only scores below -threshold are sold.
+  void Rank(size_t k, double threshold,
+            std::vector<CrossSectionTarget> *targets);
+
+  void Save(CheckpointWriter *writer) const;
+  bool Load(CheckpointReader *reader);
+
+ private:
+  // Centre on the newest prices and rebuild the rolling sums from the
+  // window, dropping drift and letting symbols whose gaps have left the
+  // window score again
+  void Recompute();
+
+  size_t num_symbols_;
+  size_t window_;
+  CrossSectionSignal signal_;
+  std::vector<double> history_;  // window_ rows of num_symbols_ prices
+  size_t next_ = 0;              // Row the next update overwrites
+  uint64_t count_ = 0;
+  std::vector<double> anchors_;     // Centring offset of each symbol
+  std::vector<uint64_t> last_gaps_;  // Update of each symbol's newest gap
+  // Of the centred prices in the window
+  std::vector<double> sums_;
+  std::vector<double> squares_;
+  std::vector<double> scores_;
+  std::vector<int> order_;  // Scratch for Rank
+};
+
+#endif  // TRADER_CROSS_SECTION_H_
@@ -0,0 +1,90 @@
+#ifndef TRADER_CROSS_SECTIONAL_STRATEGY_H_
+#define TRADER_CROSS_SECTIONAL_STRATEGY_H_
+
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "common/async_log.h"
+#include "trader/cross_section.h"
+#include "trader/strategy.h"
+
+// Ranks a whole universe of symbols every run by signal strength (see
+// CrossSectionEngine) and trades the extremes: buys the k strongest buy
+// signals and sells the k strongest sell signals, each for base_shares.
+// Meant for every symbol of Trader::GetSymbols(); one instance replaces a
+// strategy per symbol.
+class CrossSectionalStrategy : public Strategy<CrossSectionalStrategy> {
+ public:
+  CrossSectionalStrategy(const std::vector<std::string> &symbols,
+                         uint32_t moving_window_size, uint32_t tick_length,
+                         CrossSectionSignal signal, size_t k,
+                         double threshold, int base_shares)
+      : Strategy(symbols, tick_length),
+        k_(k),
+        threshold_(threshold),
+        base_shares_(base_shares),
+        engine_(symbols.size(), moving_window_size, signal),
+        prices_(symbols.size(), std::numeric_limits<double>::quiet_NaN()) {}
+
+  template <typename Executor>
+  void OnTick(const MarketView &view, Executor *executor) {
+    // Highest buy price of each symbol's latest book; symbols without a
+    // usable book keep their last price, or NaN until they have one
+    for (size_t i = 0; i < prices_.size(); i++) {
+      const BookTop &top = view.top(symbol_index(i));
+      if (top.creation_timestamp_ != 0 &&
+          top.highest_buy_price_ > LOWEST_BUY_PRICE) {
+        prices_[i] = top.highest_buy_price_;
+      }
+    }
+    engine_.Update(prices_.data());
+    if (!engine_.ready()) return;
+    engine_.Rank(k_, threshold_, &targets_);
+    Order ord;
+    for (auto &target : targets_) {
+      const std::string &symbol = symbols()[target.symbol_];
+      const BookTop &top = view.top(symbol_index(target.symbol_));
+      // A side is traded only if its price is on the book now; the score
+      // may come from an older price
+      if (target.action_ == OrderAction::buy) {
+        if (top.highest_buy_price_ <= LOWEST_BUY_PRICE) continue;
+        ASYNC_LOG(ERROR, "{}: Cross Section Buy: {}\t{}\t Score{}",
+                  view.timestamp(), symbol, base_shares_, target.score_);
+        Submit(executor, symbol, OrderAction::buy, base_shares_,
+               top.highest_buy_price_ + 1, &ord);
+      } else if (top.lowest_sell_price_ < HIGHEST_SELL_PRICE) {
+        ASYNC_LOG(ERROR, "{}: Cross Section Sell: {}\t{}\t Score{}",
+                  view.timestamp(), symbol, base_shares_, target.score_);
+        Submit(executor, symbol, OrderAction::sell, base_shares_,
+               top.lowest_sell_price_ - 1, &ord);
+      }
+    }
+  }
+
+  // Warm-restart state (see Strategy::SaveState)
+  void SaveState(CheckpointWriter *writer) const {
+    Strategy::SaveState(writer);
+    engine_.Save(writer);
+    writer->PutDoubles(prices_);
+  }
+  bool LoadState(CheckpointReader *reader) {
+    std::vector<double> prices;
+    if (!Strategy::LoadState(reader) || !engine_.Load(reader) ||
+        !reader->GetDoubles(&prices) || prices.size() != prices_.size()) {
+      return false;
+    }
+    prices_.swap(prices);
+    return true;
+  }
+
+ private:
+  size_t k_;
+  double threshold_;
+  int base_shares_;
+  CrossSectionEngine engine_;
+  std::vector<double> prices_;
+  std::vector<CrossSectionTarget> targets_;
+};
+
+#endif  // TRADER_CROSS_SECTIONAL_STRATEGY_H_
@@ -0,0 +1,147 @@
+#include "trader/cross_sectional_strategy.h"
+
+#include <gtest/gtest.h>
+#include <math.h>
+
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const double kNaN = std::numeric_limits<double>::quiet_NaN();
+
+// Two-pass z-score of the newest price against the window's mean
+double ExactReversion(const std::vector<std::vector<double> > &rows,
+                      size_t end, size_t window, size_t symbol) {
+  double mean = 0;
+  for (size_t r = end - window; r < end; r++) mean += rows[r][symbol];
+  mean /= window;
+  double variance = 0;
+  for (size_t r = end - window; r < end; r++) {
+    double deviation = rows[r][symbol] - mean;
+    variance += deviation * deviation;
+  }
+  return (mean - rows[end - 1][symbol]) / sqrt(variance / window);
+}
+
+TEST(CrossSectionEngineTest, ReversionIsExactFarFromZero) {
+  // Small moves on a large price, where uncentred sums lose the variance
+  const size_t num_symbols = 7;
+  const size_t window = 20;
+  std::mt19937_64 rng(5);
+  std::uniform_real_distribution<double> move(-0.01, 0.01);
+  std::vector<std::vector<double> > rows;
+  std::vector<double> prices(num_symbols, 1e7);
+  CrossSectionEngine engine(num_symbols, window,
+                            CrossSectionSignal::reversion);
+  for (size_t t = 0; t < 5000; t++) {
+    for (auto &price : prices) price += move(rng);
+    rows.push_back(prices);
+    engine.Update(prices.data());
+    if (!engine.ready()) continue;
+    for (size_t i = 0; i < num_symbols; i++) {
+      ASSERT_NEAR(engine.scores()[i],
+                  ExactReversion(rows, rows.size(), window, i), 1e-6)
+          << t << " " << i;
+    }
+  }
+}
+
+TEST(CrossSectionEngineTest, SymbolScoresAgainOnceItsGapLeaves) {
+  const size_t window = 5;
+  CrossSectionEngine engine(2, window, CrossSectionSignal::reversion);
+  for (int t = 1; t <= 13; t++) {
+    double prices[2] = {100.0 + t % 3, t == 7 ? kNaN : 50.0 + t % 2};
+    engine.Update(prices);
+    if (t < 7) continue;
+    EXPECT_FALSE(std::isnan(engine.scores()[0])) << t;
+    // Updates 7 to 11 hold the gap; the sums are rebuilt at 12, not 15
+    EXPECT_EQ(std::isnan(engine.scores()[1]), t < 12) << t;
+  }
+
+  // The rebuilt state survives a checkpoint, gaps included
+  CrossSectionEngine gapped(2, window, CrossSectionSignal::reversion);
+  for (int t = 1; t <= 8; t++) {
+    double prices[2] = {100.0 + t % 3, t == 7 ? kNaN : 50.0 + t % 2};
+    gapped.Update(prices);
+  }
+  CheckpointWriter writer;
+  gapped.Save(&writer);
+  CrossSectionEngine loaded(2, window, CrossSectionSignal::reversion);
+  CheckpointReader reader(writer.data());
+  ASSERT_TRUE(loaded.Load(&reader));
+  for (int t = 9; t <= 12; t++) {
+    double prices[2] = {100.0 + t % 3, 50.0 + t % 2};
+    loaded.Update(prices);
+    EXPECT_EQ(std::isnan(loaded.scores()[1]), t < 12) << t;
+  }
+}
+
+// Records the orders a strategy sends
+class RecordingExecutor {
+ public:
+  class Sent {
+   public:
+    std::string symbol_;
+    OrderAction action_;
+    int limit_price_;
+  };
+
+  OrderResult Submit(const std::string &symbol, OrderAction action,
+                     int num_shares, int limit_price, Order *order) {
+    sent_.push_back({symbol, action, limit_price});
+    order->order_id_ = "NULL";
+    return OrderResult::valid;
+  }
+  OrderResult Cancel(const std::string &order_id) {
+    return OrderResult::valid;
+  }
+
+  std::vector<Sent> sent_;
+};
+
+void SetTop(MarketView *view, const std::string &symbol, double bid,
+            double ask) {
+  BookTop *top = view->mutable_top(view->SymbolIndex(symbol));
+  top->highest_buy_price_ = bid;
+  top->lowest_sell_price_ = ask;
+  top->creation_timestamp_ = 1;
+}
+
+TEST(CrossSectionalStrategyTest, TradesOnlySidesOnTheBook) {
+  std::vector<std::string> symbols = {"AA", "AB", "AC"};
+  CrossSectionalStrategy strategy(symbols, 3, 1,
+                                  CrossSectionSignal::momentum, 1, 1, 100);
+  MarketView view;
+  strategy.Bind(&view, 1);
+  RecordingExecutor executor;
+  for (auto &symbol : symbols) SetTop(&view, symbol, 100, 101);
+  strategy.Tick(view, &executor);
+  SetTop(&view, "AA", 110, 111);
+  strategy.Tick(view, &executor);
+  EXPECT_TRUE(executor.sent_.empty());
+
+  // AA up 10% and AB down 10% over the window, but AA's bid is gone: the
+  // buy is skipped though AA still scores on its last price
+  SetTop(&view, "AA", LOWEST_BUY_PRICE, 111);
+  SetTop(&view, "AB", 90, 91);
+  strategy.Tick(view, &executor);
+  ASSERT_EQ(executor.sent_.size(), 1u);
+  EXPECT_EQ(executor.sent_[0].symbol_, "AB");
+  EXPECT_EQ(executor.sent_[0].action_, OrderAction::sell);
+  EXPECT_EQ(executor.sent_[0].limit_price_, 90);
+
+  // With its bid back AA is bought, one above it
+  executor.sent_.clear();
+  SetTop(&view, "AA", 121, 122);
+  SetTop(&view, "AB", 90, HIGHEST_SELL_PRICE);
+  strategy.Tick(view, &executor);
+  ASSERT_EQ(executor.sent_.size(), 1u);
+  EXPECT_EQ(executor.sent_[0].symbol_, "AA");
+  EXPECT_EQ(executor.sent_[0].action_, OrderAction::buy);
+  EXPECT_EQ(executor.sent_[0].limit_price_, 122);
+}
+
+}  // namespace
@@ -0,0 +1,356 @@
+#include "trader/gateway_router.h"
+
+namespace {
+
+// Failures that point at the connection or gateway, not at the order
+bool IsGatewayFailure(OrderResult result) {
+  return result == OrderResult::error || result == OrderResult::network_error;
+}
+
+}  // namespace
+
+GatewayRouter::GatewayRouter(const std::vector<Trader *> &traders)
+    : traders_(traders), gateways_(new Gateway[traders.size()]) {
+  CHECK(!traders_.empty()) << "GatewayRouter Needs a Trader";
+  num_symbols_ = traders_[0]->GetSymbols().size();
+  market_data_gateways_.reset(new std::atomic<int>[num_symbols_]);
+  for (size_t i = 0; i < num_symbols_; i++) {
+    market_data_gateways_[i].store(0);
+  }
+  gateway_symbols_.resize(traders_.size());
+  for (size_t i = 0; i < traders_.size(); i++) {
+    throttles_.emplace_back(new OrderThrottle(clock(), throttle_config_));
+  }
+  rebalance_thread_ = std::thread(&GatewayRouter::RebalanceFunc, this);
+}
+
+GatewayRouter::~GatewayRouter() {
+  {
+    std::lock_guard<std::mutex> lock(rebalance_request_mutex_);
+    stop_ = true;
+  }
+  rebalance_requested_.notify_one();
+  rebalance_thread_.join();
+}
+
+void GatewayRouter::ConfigThrottle(const ThrottleConfig &config) {
+  std::lock_guard<std::mutex> lock(throttle_mutex_);
+  throttle_config_ = config;
+  for (auto &throttle : throttles_) {
+    throttle->Reset(clock(), config);
+  }
+}
+
+bool GatewayRouter::SetRoute(const std::string &symbol, size_t gateway) {
+  if (gateway >= traders_.size()) {
+    LOG(ERROR) << "No Gateway " << gateway << " for " << symbol;
+    return false;
+  }
+  routes_[symbol] = gateway;
+  return true;
+}
+
+size_t GatewayRouter::HomeGateway(const std::string &symbol) const {
+  auto it = routes_.find(symbol);
+  if (it != routes_.end()) return it->second;
+  // FNV-1a, so every process maps a symbol to the same gateway
+  uint64_t hash = 14695981039346656037ULL;
+  for (char c : symbol) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ULL;
+  }
+  return hash % traders_.size();
+}
+
+bool GatewayRouter::Healthy(size_t gateway, uint64_t now) const {
+  return gateways_[gateway].down_until_.load(std::memory_order_relaxed) <=
+         now;
+}
+
+size_t GatewayRouter::Route(const std::string &symbol) {
+  size_t home = HomeGateway(symbol);
+  uint64_t now = clock()->Now();
+  for (size_t i = 0; i < traders_.size(); i++) {
+    size_t gateway = (home + i) % traders_.size();
+    if (Healthy(gateway, now)) return gateway;
+  }
+  // Every gateway is down; keep trying the home one
+  return home;
+}
+
+bool GatewayRouter::Report(size_t gateway, OrderResult result) {
+  Gateway &state = gateways_[gateway];
+  state.orders_.fetch_add(1, std::memory_order_relaxed);
+  uint64_t now = clock()->Now();
+  if (!IsGatewayFailure(result)) {
+    state.consecutive_errors_.store(0, std::memory_order_relaxed);
+    if (state.down_until_.exchange(0) == 0) return false;
+    LOG(INFO) << "Gateway " << gateway << " Back in Rotation";
+    return true;
+  }
+  state.errors_.fetch_add(1, std::memory_order_relaxed);
+  // A gateway past its retry interval goes back out on its first failure
+  if (state.consecutive_errors_.fetch_add(1) + 1 < ROUTER_MAX_ERRORS ||
+      !Healthy(gateway, now)) {
+    return false;
+  }
+  state.down_until_.store(now + ROUTER_RETRY_INTERVAL);
+  state.failovers_.fetch_add(1, std::memory_order_relaxed);
+  LOG(ERROR) << "Gateway " << gateway << " Out of Rotation After "
+             << state.consecutive_errors_.load() << " Failed Requests";
+  return true;
+}
+
+OrderResult GatewayRouter::SubmitOrder(const std::string &symbol,
+                                       Order *order, OrderType type,
+                                       OrderAction action, int num_shares,
+                                       int limit_price) {
+  size_t gateway = Route(symbol);
+  // A newer order on the same side of the symbol replaces a waiting one
+  std::string key = symbol;
+  key += SerializeAction(action);
+  if (!throttles_[gateway]->Acquire(ThrottlePriority::order, key)) {
+    return OrderResult::window_exceeed;
+  }
+  OrderResult result = traders_[gateway]->SubmitOrder(
+      symbol, order, type, action, num_shares, limit_price);
+  throttles_[gateway]->OnResult(result);
+  if (Report(gateway, result)) RequestRebalance();
+  if (result == OrderResult::valid && !order->order_id_.empty()) {
+    std::lock_guard<std::mutex> lock(orders_mutex_);
+    if (order_gateways_.emplace(order->order_id_, gateway).second) {
+      tracked_orders_.push_back(order->order_id_);
+    }
+    if (tracked_orders_.size() > ROUTER_TRACKED_ORDERS) {
+      order_gateways_.erase(tracked_orders_.front());
+      tracked_orders_.pop_front();
+    }
+  }
+  return result;
+}
+
+OrderResult GatewayRouter::SubmitCancel(const std::string &order_id) {
+  size_t first = 0;
+  {
+    std::lock_guard<std::mutex> lock(orders_mutex_);
+    auto it = order_gateways_.find(order_id);
+    if (it != order_gateways_.end()) first = it->second;
+  }
+  uint64_t now = clock()->Now();
+  OrderResult result = OrderResult::error;
+  for (size_t i = 0; i < traders_.size(); i++) {
+    size_t gateway = (first + i) % traders_.size();
+    // Down gateways are skipped unless all of them are down
+    if (!Healthy(gateway, now) && i + 1 < traders_.size()) continue;
+    // Cancels are never dropped, only delayed, so the result is always true
+    throttles_[gateway]->Acquire(ThrottlePriority::cancel, order_id);
+    result = traders_[gateway]->SubmitCancel(order_id);
+    throttles_[gateway]->OnResult(result);
+    if (Report(gateway, result)) RequestRebalance();
+    if (!IsGatewayFailure(result)) break;
+  }
+  return result;
+}
+
+bool GatewayRouter::ConfigActiveSymbols(
+    std::vector<std::string> active_symbols) {
+  for (auto &symbol : active_symbols) {
+    if (GetSymbolIndex(symbol) < 0) {
+      LOG(ERROR) << "Invalid Symbol: " << symbol;
+      return false;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(rebalance_mutex_);
+    active_symbols_ = active_symbols;
+  }
+  return Rebalance();
+}
+
+bool GatewayRouter::Rebalance() {
+  std::lock_guard<std::mutex> lock(rebalance_mutex_);
+  std::vector<std::vector<std::string> > gateway_symbols(traders_.size());
+  std::vector<size_t> targets;
+  for (auto &symbol : active_symbols_) {
+    targets.push_back(Route(symbol));
+    gateway_symbols[targets.back()].push_back(symbol);
+  }
+  bool ok = true;
+  for (size_t gateway = 0; gateway < traders_.size(); gateway++) {
+    if (gateway_symbols[gateway] == gateway_symbols_[gateway]) continue;
+    if (!traders_[gateway]->ConfigActiveSymbols(gateway_symbols[gateway])) {
+      LOG(ERROR) << "Failed to Configure Active Symbols on Gateway "
+                 << gateway;
+      ok = false;
+    }
+    gateway_symbols_[gateway] = gateway_symbols[gateway];
+    PinGatewayThreads(gateway);
+  }
+  for (size_t i = 0; i < active_symbols_.size(); i++) {
+    market_data_gateways_[GetSymbolIndex(active_symbols_[i])].store(
+        targets[i], std::memory_order_release);
+  }
+  return ok;
+}
+
+void GatewayRouter::RequestRebalance() {
+  {
+    std::lock_guard<std::mutex> lock(rebalance_request_mutex_);
+    rebalance_pending_ = true;
+  }
+  rebalance_requested_.notify_one();
+}
+
+void GatewayRouter::RebalanceFunc() {
+  std::unique_lock<std::mutex> lock(rebalance_request_mutex_);
+  while (true) {
+    rebalance_requested_.wait(
+        lock, [this]() { return stop_ || rebalance_pending_; });
+    if (stop_) break;
+    // Requests arriving meanwhile are covered by the next pass
+    rebalance_pending_ = false;
+    lock.unlock();
+    Rebalance();
+    lock.lock();
+  }
+}
+
+bool GatewayRouter::PinThreads(const std::vector<int> &cores) {
+  std::lock_guard<std::mutex> lock(rebalance_mutex_);
+  thread_cores_ = cores;
+  bool ok = true;
+  for (size_t gateway = 0; gateway < traders_.size(); gateway++) {
+    ok &= PinGatewayThreads(gateway);
+  }
+  return ok;
+}
+
+bool GatewayRouter::PinGatewayThreads(size_t gateway) {
+  auto core = [this, gateway](size_t thread) {
+    size_t i = gateway * 3 + thread;
+    return i < thread_cores_.size() ? thread_cores_[i] : -1;
+  };
+  return traders_[gateway]->PinThreads(core(0), core(1), core(2));
+}
+
+int GatewayRouter::GetSymbolIndex(const std::string &symbol) {
+  return traders_[0]->GetSymbolIndex(symbol);
+}
+
+Trader *GatewayRouter::MarketDataTrader(const std::string &symbol) {
+  int index = GetSymbolIndex(symbol);
+  if (index < 0) return traders_[HomeGateway(symbol)];
+  return traders_[market_data_gateways_[index].load(
+      std::memory_order_acquire)];
+}
+
+bool GatewayRouter::GetTopOfBook(const std::string &symbol, TopOfBook *top) {
+  return GetTopOfBook(GetSymbolIndex(symbol), top);
+}
+
+bool GatewayRouter::GetTopOfBook(int symbol_index, TopOfBook *top) {
+  if (symbol_index < 0 || symbol_index >= static_cast<int>(num_symbols_)) {
+    return false;
+  }
+  Trader *trader = traders_[market_data_gateways_[symbol_index].load(
+      std::memory_order_acquire)];
+  return trader->GetTopOfBook(symbol_index, top);
+}
+
+bool GatewayRouter::GetRecentLOBs(std::string symbol,
+                                  std::vector<LimitOrderBook> *ans_lob,
+                                  uint64_t start_timestamp) {
+  return MarketDataTrader(symbol)->GetRecentLOBs(symbol, ans_lob,
+                                                 start_timestamp);
+}
+
+bool GatewayRouter::GetRecentTrades(std::string symbol,
+                                    std::vector<Trade> *ans_trades,
+                                    uint64_t start_timestamp) {
+  return MarketDataTrader(symbol)->GetRecentTrades(symbol, ans_trades,
+                                                   start_timestamp);
+}
+
+void GatewayRouter::AdvanceBars(uint64_t timestamp) {
+  for (Trader *trader : traders_) {
+    trader->AdvanceBars(timestamp);
+  }
+}
+
+bool GatewayRouter::SaveState(CheckpointWriter *writer, size_t max_entries) {
+  writer->Put<uint32_t>(traders_.size());
+  CheckpointWriter state;
+  for (Trader *trader : traders_) {
+    state.Clear();
+    if (!trader->SaveState(&state, max_entries)) return false;
+    writer->PutString(state.data());
+  }
+  return true;
+}
+
+bool GatewayRouter::RestoreState(CheckpointReader *reader,
+                                 StateReconciliation *reconciliation) {
+  uint32_t num_states;
+  if (!reader->Get(&num_states)) return false;
+  std::vector<std::string> states(num_states);
+  for (auto &state : states) {
+    if (!reader->GetString(&state)) return false;
+  }
+  if (traders_.empty()) return num_states == 0;
+  // Each Trader replays only the symbols it carries now, from every state,
+  // since symbols may have moved between gateways
+  std::map<std::string, Order> saved_orders;
+  std::map<std::string, int> saved_portfolio;
+  for (auto &state : states) {
+    CheckpointReader state_reader(state);
+    for (Trader *trader : traders_) {
+      state_reader = CheckpointReader(state);
+      if (!trader->RestoreMarketData(&state_reader)) return false;
+    }
+    if (!Trader::ReadClientState(&state_reader, &saved_orders,
+                                 &saved_portfolio)) {
+      return false;
+    }
+  }
+  // The client information is shared by all, so it is pulled and
+  // reconciled once
+  if (!traders_[0]->Reconcile(saved_orders, saved_portfolio,
+                              reconciliation)) {
+    return false;
+  }
+  for (size_t i = 1; i < traders_.size(); i++) {
+    traders_[i]->SetClientInformation(reconciliation->snapshot_);
+  }
+  return true;
+}
+
+void GatewayRouter::SetClock(Clock *clock) {
+  std::lock_guard<std::mutex> lock(throttle_mutex_);
+  for (Trader *trader : traders_) {
+    trader->SetClock(clock);
+  }
+  for (auto &throttle : throttles_) {
+    throttle->Reset(clock, throttle_config_);
+  }
+}
+
+void GatewayRouter::SetJournal(JournalWriter *journal) {
+  for (Trader *trader : traders_) {
+    trader->SetJournal(journal);
+  }
+}
+
+GatewayStats GatewayRouter::GetGatewayStats(size_t gateway) {
+  GatewayStats stats;
+  Gateway &state = gateways_[gateway];
+  stats.healthy_ = Healthy(gateway, clock()->Now());
+  stats.orders_ = state.orders_.load();
+  stats.errors_ = state.errors_.load();
+  stats.failovers_ = state.failovers_.load();
+  std::lock_guard<std::mutex> lock(rebalance_mutex_);
+  stats.num_symbols_ = gateway_symbols_[gateway].size();
+  return stats;
+}
+
+ThrottleStats GatewayRouter::GetThrottleStats(size_t gateway) {
+  return throttles_[gateway]->stats();
+}
@@ -0,0 +1,178 @@
+#ifndef TRADER_GATEWAY_ROUTER_H_
+#define TRADER_GATEWAY_ROUTER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "trader/checkpoint.h"
+#include "trader/order_throttle.h"
+#include "trader/trader_api.h"
+
+// Consecutive failed requests after which a gateway is taken out of rotation
+#define ROUTER_MAX_ERRORS 3
+// Time (microseconds) a failed gateway stays out before it is tried again
+#define ROUTER_RETRY_INTERVAL (5 * 1000 * 1000)
+// Orders whose gateway is remembered for cancellation
+#define ROUTER_TRACKED_ORDERS (1 << 16)
+
+// Health and request counts of one gateway
+class GatewayStats {
+ public:
+  bool healthy_ = true;
+  uint64_t orders_ = 0;     // Orders and cancels sent
+  uint64_t errors_ = 0;     // Of those, failed with a timeout or network error
+  uint64_t failovers_ = 0;  // Times the gateway was taken out of rotation
+  size_t num_symbols_ = 0;  // Active symbols whose market data it carries
+};
+
+// Spreads order flow and market data over one Trader per gateway. Each
+// symbol has a home gateway, configured with SetRoute or else picked by a
+// hash of the symbol, that carries its orders and its market data
+// subscription, so every connection and Trader lock serves only a share of
+// the symbols. A gateway whose requests fail ROUTER_MAX_ERRORS times in a
+// row is taken out of rotation for ROUTER_RETRY_INTERVAL; its symbols move
+// to the next healthy gateway, market data included, and move back once it
+// answers again. Orders go to the new gateway at once; the market data
+// subscriptions move on a background thread, off the order path. Orders
+// that fail are not resent, since the gateway may have processed them;
+// cancels are retried on another gateway.
+//
+// Requests to each gateway pass an OrderThrottle that learns the gateway's
+// rate window from its answers. Orders the throttle drops are answered
+// window_exceeed without a round trip.
+//
+// Has the Trader methods the strategy runner and executor use, so it runs
+// strategies in place of a Trader (see BasicStrategyRunner). All Traders
+// must belong to the same client and exchange, so symbol indices agree.
+class GatewayRouter {
+ public:
+  // Traders are not owned and must outlive the router
+  explicit GatewayRouter(const std::vector<Trader *> &traders);
+  ~GatewayRouter();
+
+  // Send symbol to gateway instead of its hashed one. Must be called before
+  // ConfigActiveSymbols.
+  bool SetRoute(const std::string &symbol, size_t gateway);
+
+  // Gateway that currently carries symbol
+  size_t Route(const std::string &symbol);
+
+  OrderResult SubmitOrder(const std::string &symbol, Order *order,
+                          OrderType type, OrderAction action, int num_shares,
+                          int limit_price);
+  // Sent to the gateway that took the order, or to the next healthy one if
+  // that is down, unknown or fails
+  OrderResult SubmitCancel(const std::string &order_id);
+
+  // Activate each symbol on its gateway
+  bool ConfigActiveSymbols(std::vector<std::string> active_symbols);
+
+  int GetSymbolIndex(const std::string &symbol);
+  bool GetTopOfBook(const std::string &symbol, TopOfBook *top);
+  bool GetTopOfBook(int symbol_index, TopOfBook *top);
+  bool GetRecentLOBs(std::string symbol, std::vector<LimitOrderBook> *ans_lob,
+                     uint64_t start_timestamp);
+  bool GetRecentTrades(std::string symbol, std::vector<Trade> *ans_trades,
+                       uint64_t start_timestamp);
+  // Advance the bars of every Trader (see Trader::AdvanceBars)
+  void AdvanceBars(uint64_t timestamp);
+
+  // Warm restart of every Trader (see Trader::SaveState). The market data
+  // of each saved state is fed to every Trader, so symbols may have moved
+  // between gateways; the saved orders and portfolios are merged and
+  // reconciled against one pull of the client information.
+  bool SaveState(CheckpointWriter *writer, size_t max_entries);
+  bool RestoreState(CheckpointReader *reader,
+                    StateReconciliation *reconciliation);
+
+  // Pin the threads of the Traders (see Trader::PinThreads): cores holds an
+  // ingest, trade confirmation and order confirmation core for each
+  // gateway in turn, -1 for none. Call before ConfigActiveSymbols; reapplied
+  // whenever a rebalance restarts a Trader's ingest thread.
+  bool PinThreads(const std::vector<int> &cores);
+
+  // Reconfigure the throttles of all gateways, forgetting what they learned
+  void ConfigThrottle(const ThrottleConfig &config);
+
+  // Sets the clock of every Trader and throttle; Traders' clocks must be
+  // set here once the router exists
+  void SetClock(Clock *clock);
+  Clock *clock() const { return traders_[0]->clock(); }
+
+  // Sets the journal of every Trader (see Trader::SetJournal)
+  void SetJournal(JournalWriter *journal);
+
+  size_t num_gateways() const { return traders_.size(); }
+  Trader *trader(size_t gateway) const { return traders_[gateway]; }
+  // Trader carrying the market data of symbol, for the remaining getters
+  Trader *MarketDataTrader(const std::string &symbol);
+
+  GatewayStats GetGatewayStats(size_t gateway);
+  ThrottleStats GetThrottleStats(size_t gateway);
+
+ private:
+  class Gateway {
+   public:
+    std::atomic<int> consecutive_errors_{0};
+    std::atomic<uint64_t> down_until_{0};  // Out of rotation until then
+    std::atomic<uint64_t> orders_{0};
+    std::atomic<uint64_t> errors_{0};
+    std::atomic<uint64_t> failovers_{0};
+  };
+
+  // Home gateway of symbol, ignoring health
+  size_t HomeGateway(const std::string &symbol) const;
+  bool Healthy(size_t gateway, uint64_t now) const;
+  // Count the outcome of a request sent to gateway. Returns true if the
+  // gateway's health changed.
+  bool Report(size_t gateway, OrderResult result);
+  // Move the market data of active symbols to their current gateways,
+  // reconfiguring only the Traders whose symbols changed
+  bool Rebalance();
+  // Have the rebalance thread run Rebalance
+  void RequestRebalance();
+  void RebalanceFunc();
+  // Apply thread_cores_ to the Trader of gateway. Needs rebalance_mutex_.
+  bool PinGatewayThreads(size_t gateway);
+
+  std::vector<Trader *> traders_;
+  std::unique_ptr<Gateway[]> gateways_;
+  std::map<std::string, size_t> routes_;  // Set by SetRoute
+  // One per gateway, created with the router and reconfigured in place
+  std::vector<std::unique_ptr<OrderThrottle> > throttles_;
+  ThrottleConfig throttle_config_;
+  std::mutex throttle_mutex_;  // Serializes ConfigThrottle and SetClock
+
+  // Active symbols and the gateway carrying each one's market data, by
+  // symbol index
+  std::vector<std::string> active_symbols_;
+  std::unique_ptr<std::atomic<int>[]> market_data_gateways_;
+  size_t num_symbols_ = 0;
+  // Symbols each Trader was last configured with
+  std::vector<std::vector<std::string> > gateway_symbols_;
+  std::vector<int> thread_cores_;  // Set by PinThreads
+  std::mutex rebalance_mutex_;
+
+  std::thread rebalance_thread_;
+  std::mutex rebalance_request_mutex_;
+  std::condition_variable rebalance_requested_;
+  bool rebalance_pending_ = false;
+  bool stop_ = false;
+
+  // Gateway of each recent order, by order id
+  std::unordered_map<std::string, size_t> order_gateways_;
+  std::deque<std::string> tracked_orders_;
+  std::mutex orders_mutex_;
+};
+
+#endif  // TRADER_GATEWAY_ROUTER_H_
@@ -0,0 +1,430 @@
+#include "trader/indicators.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define INDICATORS_HAVE_AVX2 1
+#endif
+
+namespace indicators {
+namespace {
+
+const double kNaN = std::numeric_limits<double>::quiet_NaN();
+
+// Element-wise kernels. Each has a scalar version and, on x86-64, an AVX2
+// version compiled with a target attribute so the rest of the library does
+// not need -mavx2. The AVX2 versions fall back to the scalar loop for the
+// tail that does not fill a whole register.
+
+void ScalarReturns(const double *p, size_t begin, size_t n, double *out) {
+  for (size_t i = begin; i < n; i++) {
+    out[i] = (p[i] - p[i - 1]) / p[i - 1];
+  }
+}
+
+void ScalarMomentum(const double *p, size_t begin, size_t n, double p1,
+                    double p2, double *out) {
+  for (size_t i = begin; i < n; i++) {
+    out[i] = 100 * (p1 * (p[i - 1] - p[i]) / p[i] +
+                    p2 * (p[i - 2] - p[i - 1]) / p[i - 1]);
+  }
+}
+
+void ScalarWindowMean(const double *sums, size_t begin, size_t n,
+                      size_t window, double shift, double *out) {
+  for (size_t i = begin; i < n; i++) {
+    out[i] = shift + (sums[i + 1] - sums[i + 1 - window]) / window;
+  }
+}
+
+void ScalarWindowStd(const double *sums, const double *squares, size_t begin,
+                     size_t n, size_t window, double *out) {
+  for (size_t i = begin; i < n; i++) {
+    double mean = (sums[i + 1] - sums[i + 1 - window]) / window;
+    double var =
+        (squares[i + 1] - squares[i + 1 - window]) / window - mean * mean;
+    out[i] = sqrt(std::max(var, 0.0));
+  }
+}
+
+void ScalarRatio(const double *a, const double *b, size_t begin, size_t n,
+                 double *out) {
+  for (size_t i = begin; i < n; i++) {
+    out[i] = b[i] > 0 ? a[i] / b[i] : kNaN;
+  }
+}
+
+#ifdef INDICATORS_HAVE_AVX2
+__attribute__((target("avx2"))) void Avx2Returns(const double *p,
+                                                 size_t begin, size_t n,
+                                                 double *out) {
+  size_t i = begin;
+  for (; i + 4 <= n; i += 4) {
+    __m256d cur = _mm256_loadu_pd(p + i);
+    __m256d prev = _mm256_loadu_pd(p + i - 1);
+    _mm256_storeu_pd(out + i, _mm256_div_pd(_mm256_sub_pd(cur, prev), prev));
+  }
+  ScalarReturns(p, i, n, out);
+}
+
+__attribute__((target("avx2"))) void Avx2Momentum(const double *p,
+                                                  size_t begin, size_t n,
+                                                  double p1, double p2,
+                                                  double *out) {
+  const __m256d w1 = _mm256_set1_pd(p1);
+  const __m256d w2 = _mm256_set1_pd(p2);
+  const __m256d hundred = _mm256_set1_pd(100);
+  size_t i = begin;
+  for (; i + 4 <= n; i += 4) {
+    __m256d cur = _mm256_loadu_pd(p + i);
+    __m256d prev = _mm256_loadu_pd(p + i - 1);
+    __m256d prev2 = _mm256_loadu_pd(p + i - 2);
+    __m256d m1 = _mm256_div_pd(_mm256_sub_pd(prev, cur), cur);
+    __m256d m2 = _mm256_div_pd(_mm256_sub_pd(prev2, prev), prev);
+    __m256d agg = _mm256_add_pd(_mm256_mul_pd(w1, m1), _mm256_mul_pd(w2, m2));
+    _mm256_storeu_pd(out + i, _mm256_mul_pd(hundred, agg));
+  }
+  ScalarMomentum(p, i, n, p1, p2, out);
+}
+
+__attribute__((target("avx2"))) void Avx2WindowMean(const double *sums,
+                                                    size_t begin, size_t n,
+                                                    size_t window,
+                                                    double shift,
+                                                    double *out) {
+  const __m256d inv = _mm256_set1_pd(1.0 / window);
+  const __m256d offset = _mm256_set1_pd(shift);
+  size_t i = begin;
+  for (; i + 4 <= n; i += 4) {
+    __m256d diff = _mm256_sub_pd(_mm256_loadu_pd(sums + i + 1),
+                                 _mm256_loadu_pd(sums + i + 1 - window));
+    _mm256_storeu_pd(out + i, _mm256_add_pd(offset, _mm256_mul_pd(diff, inv)));
+  }
+  ScalarWindowMean(sums, i, n, window, shift, out);
+}
+
+__attribute__((target("avx2"))) void Avx2WindowStd(const double *sums,
+                                                   const double *squares,
+                                                   size_t begin, size_t n,
+                                                   size_t window,
+                                                   double *out) {
+  const __m256d inv = _mm256_set1_pd(1.0 / window);
+  const __m256d zero = _mm256_setzero_pd();
+  size_t i = begin;
+  for (; i + 4 <= n; i += 4) {
+    __m256d mean = _mm256_mul_pd(
+        _mm256_sub_pd(_mm256_loadu_pd(sums + i + 1),
+                      _mm256_loadu_pd(sums + i + 1 - window)),
+        inv);
+    __m256d sq = _mm256_mul_pd(
+        _mm256_sub_pd(_mm256_loadu_pd(squares + i + 1),
+                      _mm256_loadu_pd(squares + i + 1 - window)),
+        inv);
+    __m256d var = _mm256_max_pd(_mm256_sub_pd(sq, _mm256_mul_pd(mean, mean)),
+                                zero);
+    _mm256_storeu_pd(out + i, _mm256_sqrt_pd(var));
+  }
+  ScalarWindowStd(sums, squares, i, n, window, out);
+}
+
+__attribute__((target("avx2"))) void Avx2Ratio(const double *a,
+                                               const double *b, size_t begin,
+                                               size_t n, double *out) {
+  const __m256d zero = _mm256_setzero_pd();
+  const __m256d nan = _mm256_set1_pd(kNaN);
+  size_t i = begin;
+  for (; i + 4 <= n; i += 4) {
+    __m256d den = _mm256_loadu_pd(b + i);
+    __m256d ratio = _mm256_div_pd(_mm256_loadu_pd(a + i), den);
+    __m256d positive = _mm256_cmp_pd(den, zero, _CMP_GT_OQ);
+    _mm256_storeu_pd(out + i, _mm256_blendv_pd(nan, ratio, positive));
+  }
+  ScalarRatio(a, b, i, n, out);
+}
+#endif  // INDICATORS_HAVE_AVX2
+
+// Kernel table, selected once on first use
+struct Kernels {
+  void (*returns)(const double *, size_t, size_t, double *);
+  void (*momentum)(const double *, size_t, size_t, double, double, double *);
+  void (*window_mean)(const double *, size_t, size_t, size_t, double,
+                      double *);
+  void (*window_std)(const double *, const double *, size_t, size_t, size_t,
+                     double *);
+  void (*ratio)(const double *, const double *, size_t, size_t, double *);
+};
+
+const Kernels kScalarKernels = {ScalarReturns, ScalarMomentum,
+                                ScalarWindowMean, ScalarWindowStd,
+                                ScalarRatio};
+
+#ifdef INDICATORS_HAVE_AVX2
+const Kernels kAvx2Kernels = {Avx2Returns, Avx2Momentum, Avx2WindowMean,
+                              Avx2WindowStd, Avx2Ratio};
+#endif
+
+const Kernels *SelectKernels() {
+#ifdef INDICATORS_HAVE_AVX2
+  if (__builtin_cpu_supports("avx2")) return &kAvx2Kernels;
+#endif
+  return &kScalarKernels;
+}
+
+const Kernels *active_kernels = SelectKernels();
+
+void FillNaN(double *out, size_t n) { std::fill(out, out + n, kNaN); }
+
+// Prefix sums of (p - shift) and (p - shift)^2, with a leading zero. Shifting
+// by the first price keeps the sums small over long series.
+void PrefixSums(const double *prices, size_t n, double shift,
+                std::vector<double> *sums, std::vector<double> *squares) {
+  sums->resize(n + 1);
+  (*sums)[0] = 0;
+  if (squares != nullptr) {
+    squares->resize(n + 1);
+    (*squares)[0] = 0;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double x = prices[i] - shift;
+    (*sums)[i + 1] = (*sums)[i] + x;
+    if (squares != nullptr) {
+      (*squares)[i + 1] = (*squares)[i] + x * x;
+    }
+  }
+}
+
+}  // namespace
+
+bool UsingAvx2() { return active_kernels != &kScalarKernels; }
+
+void DisableAvx2() { active_kernels = &kScalarKernels; }
+
+void Returns(const double *prices, size_t n, double *out) {
+  if (n == 0) return;
+  out[0] = kNaN;
+  active_kernels->returns(prices, 1, n, out);
+}
+
+void Momentum(const double *prices, size_t n, double p1, double p2,
+              double *out) {
+  FillNaN(out, std::min<size_t>(n, 2));
+  if (n > 2) {
+    active_kernels->momentum(prices, 2, n, p1, p2, out);
+  }
+}
+
+void SMA(const double *prices, size_t n, size_t window, double *out) {
+  if (window == 0 || n < window) {
+    FillNaN(out, n);
+    return;
+  }
+  FillNaN(out, window - 1);
+  std::vector<double> sums;
+  PrefixSums(prices, n, prices[0], &sums, nullptr);
+  active_kernels->window_mean(sums.data(), window - 1, n, window, prices[0],
+                              out);
+}
+
+void RollingStd(const double *prices, size_t n, size_t window, double *out) {
+  if (window == 0 || n < window) {
+    FillNaN(out, n);
+    return;
+  }
+  FillNaN(out, window - 1);
+  std::vector<double> sums, squares;
+  PrefixSums(prices, n, prices[0], &sums, &squares);
+  active_kernels->window_std(sums.data(), squares.data(), window - 1, n,
+                             window, out);
+}
+
+void Bollinger(const double *prices, size_t n, size_t window, double num_std,
+               double *middle, double *upper, double *lower) {
+  SMA(prices, n, window, middle);
+  RollingStd(prices, n, window, upper);
+  for (size_t i = 0; i < n; i++) {
+    double band = num_std * upper[i];
+    upper[i] = middle[i] + band;
+    lower[i] = middle[i] - band;
+  }
+}
+
+void EMA(const double *prices, size_t n, double alpha, double *out) {
+  // A recurrence, so it stays scalar
+  StreamingEMA ema(alpha);
+  for (size_t i = 0; i < n; i++) {
+    out[i] = ema.Add(prices[i]);
+  }
+}
+
+void RSI(const double *prices, size_t n, size_t period, double *out) {
+  // A recurrence, so it stays scalar
+  StreamingRSI rsi(period);
+  for (size_t i = 0; i < n; i++) {
+    out[i] = rsi.Add(prices[i]);
+  }
+}
+
+void VWAP(const double *prices, const double *volumes, size_t n,
+          double *out) {
+  std::vector<double> cash(n), volume(n);
+  double cash_sum = 0, volume_sum = 0;
+  for (size_t i = 0; i < n; i++) {
+    cash_sum += prices[i] * volumes[i];
+    volume_sum += volumes[i];
+    cash[i] = cash_sum;
+    volume[i] = volume_sum;
+  }
+  active_kernels->ratio(cash.data(), volume.data(), 0, n, out);
+}
+
+void VWAP(const int *prices, const int *volumes, size_t n, double *out) {
+  std::vector<double> price_vec(prices, prices + n);
+  std::vector<double> volume_vec(volumes, volumes + n);
+  VWAP(price_vec.data(), volume_vec.data(), n, out);
+}
+
+StreamingEMA::StreamingEMA(double alpha)
+    : alpha_(alpha), value_(kNaN), count_(0) {}
+
+double StreamingEMA::Add(double price) {
+  value_ = count_++ == 0 ? price : alpha_ * price + (1 - alpha_) * value_;
+  return value_;
+}
+
+StreamingRollingWindow::StreamingRollingWindow(size_t window)
+    : window_(std::max<size_t>(window, 1), 0),
+      next_(0),
+      count_(0),
+      shift_(0),
+      sum_(0),
+      sum_squares_(0) {}
+
+void StreamingRollingWindow::Add(double price) {
+  if (count_ == 0) shift_ = price;
+  if (count_ >= window_.size()) {
+    double old = window_[next_] - shift_;
+    sum_ -= old;
+    sum_squares_ -= old * old;
+  }
+  window_[next_] = price;
+  next_ = (next_ + 1) % window_.size();
+  double x = price - shift_;
+  sum_ += x;
+  sum_squares_ += x * x;
+  count_++;
+  // Once per window, so neither rounding drift nor a price that wandered
+  // away from the shift builds up
+  if (next_ == 0) Resum(price);
+}
+
+void StreamingRollingWindow::Resum(double shift) {
+  shift_ = shift;
+  sum_ = 0;
+  sum_squares_ = 0;
+  for (size_t i = 0; i < std::min<uint64_t>(count_, window_.size()); i++) {
+    double x = window_[i] - shift_;
+    sum_ += x;
+    sum_squares_ += x * x;
+  }
+}
+
+double StreamingRollingWindow::Mean() const {
+  if (!ready()) return kNaN;
+  return shift_ + sum_ / window_.size();
+}
+
+double StreamingRollingWindow::Std() const {
+  if (!ready()) return kNaN;
+  double mean = sum_ / window_.size();
+  return sqrt(std::max(sum_squares_ / window_.size() - mean * mean, 0.0));
+}
+
+void StreamingRollingWindow::Save(CheckpointWriter *writer) const {
+  writer->PutDoubles(window_);
+  writer->Put<uint64_t>(next_);
+  writer->Put<uint64_t>(count_);
+}
+
+bool StreamingRollingWindow::Load(CheckpointReader *reader) {
+  std::vector<double> window;
+  uint64_t next;
+  uint64_t count;
+  if (!reader->GetDoubles(&window) || !reader->Get(&next) ||
+      !reader->Get(&count) || window.size() != window_.size() ||
+      next >= window.size()) {
+    return false;
+  }
+  window_ = window;
+  next_ = next;
+  count_ = count;
+  // Recomputed rather than restored, so the sums carry no drift
+  Resum(count_ > 0 ? window_[0] : 0);
+  return true;
+}
+
+StreamingRSI::StreamingRSI(size_t period)
+    : period_(std::max<size_t>(period, 1)),
+      count_(0),
+      last_price_(0),
+      avg_gain_(0),
+      avg_loss_(0),
+      value_(kNaN) {}
+
+double StreamingRSI::Add(double price) {
+  if (count_++ > 0) {
+    double change = price - last_price_;
+    double gain = std::max(change, 0.0);
+    double loss = std::max(-change, 0.0);
+    if (count_ <= period_ + 1) {
+      // Seed the averages with a simple mean of the first period changes
+      avg_gain_ += gain / period_;
+      avg_loss_ += loss / period_;
+    } else {
+      avg_gain_ = (avg_gain_ * (period_ - 1) + gain) / period_;
+      avg_loss_ = (avg_loss_ * (period_ - 1) + loss) / period_;
+    }
+    if (ready()) {
+      value_ = avg_loss_ == 0 ? 100 : 100 - 100 / (1 + avg_gain_ / avg_loss_);
+    }
+  }
+  last_price_ = price;
+  return value_;
+}
+
+StreamingVWAP::StreamingVWAP() : cash_(0), volume_(0) {}
+
+double StreamingVWAP::Add(double price, double volume) {
+  cash_ += price * volume;
+  volume_ += volume;
+  return value();
+}
+
+StreamingMomentum::StreamingMomentum(double p1, double p2)
+    : p1_(p1), p2_(p2), prices_{0, 0, 0}, count_(0) {}
+
+double StreamingMomentum::Add(double price) {
+  prices_[2] = prices_[1];
+  prices_[1] = prices_[0];
+  prices_[0] = price;
+  if (++count_ < 3) return kNaN;
+  return 100 * (p1_ * (prices_[1] - prices_[0]) / prices_[0] +
+                p2_ * (prices_[2] - prices_[1]) / prices_[1]);
+}
+
+void StreamingMomentum::Save(CheckpointWriter *writer) const {
+  for (double price : prices_) {
+    writer->Put(price);
+  }
+  writer->Put<uint64_t>(count_);
+}
+
+bool StreamingMomentum::Load(CheckpointReader *reader) {
+  return reader->Get(&prices_[0]) && reader->Get(&prices_[1]) &&
+         reader->Get(&prices_[2]) && reader->Get(&count_);
+}
+
+}  // namespace indicators
@@ -0,0 +1,147 @@
+#ifndef TRADER_INDICATORS_H_
+#define TRADER_INDICATORS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "trader/checkpoint.h"
+
+// Technical indicators over contiguous price / volume series.
+//
+// Batch functions take whole series and write one output per input point.
+// Points that do not have enough history yet are written as NaN. The inner
+// loops run AVX2 kernels when the CPU supports them and a scalar fallback
+// otherwise; both produce the same results up to floating point rounding.
+// EMA and RSI are recurrences and always run scalar.
+//
+// Streaming classes keep O(1) state and take one point at a time, for the
+// live strategies. Fed the same series, they match the batch functions.
+namespace indicators {
+
+// Whether the AVX2 kernels are in use on this machine
+bool UsingAvx2();
+
+// Force the scalar kernels (for testing and benchmarking the fallback)
+void DisableAvx2();
+
+// Simple returns: out[i] = (p[i] - p[i-1]) / p[i-1]
+void Returns(const double *prices, size_t n, double *out);
+
+// Momentum as computed by the momentum trader, in percent:
+//   out[i] = 100 * (p1 * (p[i-1] - p[i]) / p[i] + p2 * (p[i-2] - p[i-1]) /
+//            p[i-1])
+void Momentum(const double *prices, size_t n, double p1, double p2,
+              double *out);
+
+// Rolling mean over the last window points
+void SMA(const double *prices, size_t n, size_t window, double *out);
+
+// Rolling population standard deviation over the last window points
+void RollingStd(const double *prices, size_t n, size_t window, double *out);
+
+// Bollinger bands: mean and mean +/- num_std rolling standard deviations
+void Bollinger(const double *prices, size_t n, size_t window, double num_std,
+               double *middle, double *upper, double *lower);
+
+// Exponential moving average, seeded with the first price
+void EMA(const double *prices, size_t n, double alpha, double *out);
+
+// Relative strength index with Wilder smoothing over period points
+void RSI(const double *prices, size_t n, size_t period, double *out);
+
+// Cumulative volume weighted average price
+void VWAP(const double *prices, const double *volumes, size_t n, double *out);
+void VWAP(const int *prices, const int *volumes, size_t n, double *out);
+
+// Streaming EMA
+class StreamingEMA {
+ public:
+  explicit StreamingEMA(double alpha);
+  double Add(double price);
+  double value() const { return value_; }
+  bool ready() const { return count_ > 0; }
+
+ private:
+  double alpha_;
+  double value_;
+  uint64_t count_;
+};
+
+// Streaming rolling mean / standard deviation / Bollinger bands. The sums are
+// kept relative to a recent price and recomputed once per window, like the
+// shifted prefix sums of the batch functions, so the variance does not lose
+// its digits to prices far from zero.
+class StreamingRollingWindow {
+ public:
+  explicit StreamingRollingWindow(size_t window);
+  void Add(double price);
+  double Mean() const;
+  double Std() const;
+  bool ready() const { return count_ >= window_.size(); }
+
+  // Checkpoint the window. Load fails if the window length differs.
+  void Save(CheckpointWriter *writer) const;
+  bool Load(CheckpointReader *reader);
+
+ private:
+  // Recompute the sums over the window relative to shift
+  void Resum(double shift);
+
+  std::vector<double> window_;  // Ring buffer of the last window points
+  size_t next_;
+  uint64_t count_;
+  double shift_;        // Subtracted from every point in the sums
+  double sum_;          // Sum of (point - shift_)
+  double sum_squares_;  // Sum of (point - shift_)^2
+};
+
+// Streaming RSI with Wilder smoothing
+class StreamingRSI {
+ public:
+  explicit StreamingRSI(size_t period);
+  double Add(double price);
+  bool ready() const { return count_ > period_; }
+
+ private:
+  size_t period_;
+  uint64_t count_;
+  double last_price_;
+  double avg_gain_;
+  double avg_loss_;
+  double value_;
+};
+
+// Streaming cumulative VWAP
+class StreamingVWAP {
+ public:
+  StreamingVWAP();
+  double Add(double price, double volume);
+  double value() const { return volume_ > 0 ? cash_ / volume_ : 0; }
+
+ private:
+  double cash_;
+  double volume_;
+};
+
+// Streaming momentum, same definition as Momentum()
+class StreamingMomentum {
+ public:
+  StreamingMomentum(double p1, double p2);
+  double Add(double price);
+  bool ready() const { return count_ >= 3; }
+
+  void Save(CheckpointWriter *writer) const;
+  bool Load(CheckpointReader *reader);
+
+ private:
+  double p1_;
+  double p2_;
+  double prices_[3];  // Last three prices, newest at index 0
+  uint64_t count_;
+};
+
+}  // namespace indicators
+
+#endif  // TRADER_INDICATORS_H_
@@ -0,0 +1,95 @@
+#include "trader/indicators.h"
+
+#include <gtest/gtest.h>
+#include <math.h>
+
+#include <random>
+#include <vector>
+
+namespace indicators {
+namespace {
+
+// A random walk of small steps far from zero, where E[x^2] - mean^2 on raw
+// sums would cancel most of the variance's digits
+std::vector<double> Walk(size_t n, double start, double step) {
+  std::mt19937_64 rng(3);
+  std::uniform_real_distribution<double> move(-step, step);
+  std::vector<double> prices(n);
+  double price = start;
+  for (size_t i = 0; i < n; i++) {
+    price += move(rng);
+    prices[i] = price;
+  }
+  return prices;
+}
+
+// Two-pass population standard deviation of prices[end - window, end)
+double ExactStd(const std::vector<double> &prices, size_t end,
+                size_t window) {
+  double mean = 0;
+  for (size_t i = end - window; i < end; i++) mean += prices[i];
+  mean /= window;
+  double variance = 0;
+  for (size_t i = end - window; i < end; i++) {
+    variance += (prices[i] - mean) * (prices[i] - mean);
+  }
+  return sqrt(variance / window);
+}
+
+TEST(IndicatorsTest, StreamingWindowMatchesBatchOverLongSeries) {
+  const size_t n = 1000000;
+  const size_t window = 50;
+  std::vector<double> prices = Walk(n, 1e7, 0.01);
+  std::vector<double> mean(n), std(n);
+  SMA(prices.data(), n, window, mean.data());
+  RollingStd(prices.data(), n, window, std.data());
+
+  StreamingRollingWindow stream(window);
+  for (size_t i = 0; i < n; i++) {
+    stream.Add(prices[i]);
+    if (i + 1 < window) {
+      EXPECT_FALSE(stream.ready());
+      continue;
+    }
+    ASSERT_NEAR(stream.Mean(), mean[i], 1e-6) << i;
+    ASSERT_NEAR(stream.Std(), std[i], 1e-6) << i;
+    if (i % 9973 == 0) {
+      double exact = ExactStd(prices, i + 1, window);
+      ASSERT_NEAR(stream.Std(), exact, 1e-6 + 1e-6 * exact) << i;
+    }
+  }
+}
+
+TEST(IndicatorsTest, StreamingWindowFollowsAPriceLevelShift) {
+  // A jump far from the first price, then a flat window
+  StreamingRollingWindow stream(8);
+  for (int i = 0; i < 100; i++) stream.Add(1e9 + (i % 3));
+  for (int i = 0; i < 13; i++) stream.Add(0.25);
+  EXPECT_DOUBLE_EQ(stream.Mean(), 0.25);
+  EXPECT_EQ(stream.Std(), 0);
+}
+
+TEST(IndicatorsTest, StreamingWindowCheckpoint) {
+  std::vector<double> prices = Walk(1000, 5e6, 1);
+  StreamingRollingWindow stream(30);
+  for (size_t i = 0; i < 517; i++) stream.Add(prices[i]);
+  CheckpointWriter writer;
+  stream.Save(&writer);
+
+  StreamingRollingWindow loaded(30);
+  CheckpointReader reader(writer.data());
+  ASSERT_TRUE(loaded.Load(&reader));
+  for (size_t i = 517; i < prices.size(); i++) {
+    stream.Add(prices[i]);
+    loaded.Add(prices[i]);
+    ASSERT_NEAR(loaded.Mean(), stream.Mean(), 1e-7);
+    ASSERT_NEAR(loaded.Std(), stream.Std(), 1e-7);
+  }
+
+  StreamingRollingWindow other_length(31);
+  CheckpointReader other_reader(writer.data());
+  EXPECT_FALSE(other_length.Load(&other_reader));
+}
+
+}  // namespace
+}  // namespace indicators
@@ -0,0 +1,207 @@
+#include "trader/journal.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <zmq.h>
+
+#include <map>
+#include <set>
+
+#include "common/utils.h"
+
+JournalWriter::JournalWriter(const std::string &path,
+                             size_t max_pending_bytes)
+    : file_(fopen(path.c_str(), "ab")),
+      max_pending_bytes_(max_pending_bytes) {
+  if (file_ == nullptr) {
+    LOG(ERROR) << "Failed to Open Journal: " << path;
+    return;
+  }
+  if (ftell(file_) == 0) {
+    fwrite(JOURNAL_MAGIC, 1, JOURNAL_MAGIC_SIZE, file_);
+  }
+  writer_thread_ = std::thread(&JournalWriter::WriterFunc, this);
+}
+
+JournalWriter::~JournalWriter() {
+  if (file_ == nullptr) return;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cond_.notify_one();
+  writer_thread_.join();
+  fclose(file_);
+  LOG(INFO) << "Journal Closed: " << records_written_ << " Records Written, "
+            << records_dropped_ << " Dropped";
+}
+
+void JournalWriter::Record(JournalChannel channel, uint16_t port,
+                           const char *data, size_t length, bool more,
+                           uint64_t receive_timestamp) {
+  if (file_ == nullptr) return;
+  char header[JOURNAL_RECORD_HEADER_SIZE];
+  uint32_t payload_length = length;
+  uint8_t channel_byte = static_cast<uint8_t>(channel);
+  uint8_t flags = more ? JOURNAL_FLAG_MORE : 0;
+  memcpy(header, &payload_length, 4);
+  memcpy(header + 4, &receive_timestamp, 8);
+  memcpy(header + 12, &port, 2);
+  memcpy(header + 14, &channel_byte, 1);
+  memcpy(header + 15, &flags, 1);
+
+  bool notify;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_.size() + sizeof(header) + length > max_pending_bytes_) {
+      records_dropped_++;
+      return;
+    }
+    notify = pending_.empty();
+    pending_.append(header, sizeof(header));
+    pending_.append(data, length);
+    pending_records_++;
+  }
+  if (notify) cond_.notify_one();
+}
+
+void JournalWriter::WriterFunc() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    cond_.wait(lock, [this]() { return stop_ || !pending_.empty(); });
+    if (pending_.empty() && stop_) break;
+    writing_.swap(pending_);
+    uint64_t num_records = pending_records_;
+    pending_records_ = 0;
+    lock.unlock();
+
+    if (fwrite(writing_.data(), 1, writing_.size(), file_) !=
+        writing_.size()) {
+      LOG(ERROR) << "Failed to Write " << num_records << " Journal Records";
+      records_dropped_ += num_records;
+    } else {
+      records_written_ += num_records;
+    }
+    fflush(file_);
+    writing_.clear();
+
+    lock.lock();
+  }
+}
+
+JournalReader::JournalReader(const std::string &path)
+    : file_(fopen(path.c_str(), "rb")) {
+  if (file_ == nullptr) {
+    LOG(ERROR) << "Failed to Open Journal: " << path;
+    return;
+  }
+  char magic[JOURNAL_MAGIC_SIZE];
+  if (fread(magic, 1, JOURNAL_MAGIC_SIZE, file_) != JOURNAL_MAGIC_SIZE ||
+      memcmp(magic, JOURNAL_MAGIC, JOURNAL_MAGIC_SIZE) != 0) {
+    LOG(ERROR) << "Not a Journal: " << path;
+    fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+JournalReader::~JournalReader() {
+  if (file_ != nullptr) fclose(file_);
+}
+
+bool JournalReader::Next(JournalRecord *record) {
+  if (file_ == nullptr) return false;
+  char header[JOURNAL_RECORD_HEADER_SIZE];
+  if (fread(header, 1, sizeof(header), file_) != sizeof(header)) {
+    return false;
+  }
+  uint32_t payload_length;
+  uint8_t channel_byte;
+  uint8_t flags;
+  memcpy(&payload_length, header, 4);
+  memcpy(&record->receive_timestamp_, header + 4, 8);
+  memcpy(&record->port_, header + 12, 2);
+  memcpy(&channel_byte, header + 14, 1);
+  memcpy(&flags, header + 15, 1);
+  record->channel_ = static_cast<JournalChannel>(channel_byte);
+  record->more_ = flags & JOURNAL_FLAG_MORE;
+  record->payload_.resize(payload_length);
+  return fread(&record->payload_[0], 1, payload_length, file_) ==
+         payload_length;
+}
+
+JournalReplayer::JournalReplayer(const std::string &path, double speed,
+                                 Clock *clock)
+    : path_(path), speed_(speed), clock_(clock) {}
+
+int64_t JournalReplayer::Replay(
+    const std::function<void(const JournalRecord &)> &callback,
+    volatile bool *run) {
+  JournalReader reader(path_);
+  if (!reader.ok()) return -1;
+  JournalRecord record;
+  int64_t num_records = 0;
+  uint64_t first_record_timestamp = 0;
+  uint64_t start_timestamp = clock_->Now();
+  while (*run && reader.Next(&record)) {
+    if (num_records == 0) {
+      first_record_timestamp = record.receive_timestamp_;
+    }
+    if (speed_ > 0 && record.receive_timestamp_ > first_record_timestamp) {
+      clock_->SleepUntil(
+          start_timestamp +
+          (record.receive_timestamp_ - first_record_timestamp) / speed_);
+    }
+    if (event_clock_ != nullptr) {
+      event_clock_->AdvanceTo(record.receive_timestamp_);
+    }
+    callback(record);
+    num_records++;
+  }
+  if (event_clock_ != nullptr) event_clock_->Close();
+  return num_records;
+}
+
+int64_t JournalReplayer::Publish(const std::string &bind_ip,
+                                 uint64_t warmup_ms, volatile bool *run) {
+  std::set<uint16_t> ports;
+  {
+    JournalReader reader(path_);
+    if (!reader.ok()) return -1;
+    JournalRecord record;
+    while (reader.Next(&record)) {
+      if (record.port_ != JOURNAL_DECODED_PORT) ports.insert(record.port_);
+    }
+  }
+
+  void *context = zmq_ctx_new();
+  std::map<uint16_t, void *> publishers;
+  int unlimited = 0;
+  for (uint16_t port : ports) {
+    void *publisher = zmq_socket(context, ZMQ_PUB);
+    zmq_setsockopt(publisher, ZMQ_SNDHWM, &unlimited, sizeof(unlimited));
+    std::string address = "tcp://" + bind_ip + ":" + std::to_string(port);
+    if (zmq_bind(publisher, address.c_str()) != 0) {
+      LOG(ERROR) << "Failed to Bind Replay Publisher: " << address;
+      zmq_close(publisher);
+      continue;
+    }
+    publishers[port] = publisher;
+  }
+  // Subscribers connect in wall-clock time, whatever the replay clock
+  usleep(warmup_ms * 1000);
+
+  int64_t num_records = Replay(
+      [&publishers](const JournalRecord &record) {
+        auto it = publishers.find(record.port_);
+        if (it == publishers.end()) return;
+        zmq_send(it->second, record.payload_.data(), record.payload_.size(),
+                 record.more_ ? ZMQ_SNDMORE : 0);
+      },
+      run);
+
+  for (auto &publisher : publishers) {
+    zmq_close(publisher.second);
+  }
+  zmq_ctx_destroy(context);
+  return num_records;
+}
@@ -0,0 +1,152 @@
+#ifndef TRADER_JOURNAL_H_
+#define TRADER_JOURNAL_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "common/clock.h"
+
+// A journal is an append-only file of the raw ZMQ frames received by the
+// market data API objects of one session. The file starts with
+// JOURNAL_MAGIC, followed by records of
+//
+//   uint32_t  payload length
+//   uint64_t  receive timestamp (microseconds)
+//   uint16_t  port the frame was received on
+//   uint8_t   JournalChannel
+//   uint8_t   flags (JOURNAL_FLAG_MORE if more frames of the message follow)
+//   char[]    payload
+//
+// in host byte order.
+//
+// A Trader given a journal (Trader::SetJournal) records the books and trade
+// reports it stores rather than the raw frames: their SerializeBook and
+// SerializeTrade text, under port JOURNAL_DECODED_PORT. Publish has no port
+// to send those on and skips them; Replay hands them over like any other.
+#define JOURNAL_MAGIC "CXJRNL01"
+#define JOURNAL_MAGIC_SIZE 8
+#define JOURNAL_RECORD_HEADER_SIZE 16
+#define JOURNAL_FLAG_MORE 0x01
+#define JOURNAL_DECODED_PORT 0
+
+// Bytes that may wait for the writer thread before new records are dropped
+#define JOURNAL_MAX_PENDING_BYTES (256 * 1024 * 1024)
+
+// Market data API class a frame was received by
+enum class JournalChannel : uint8_t {
+  limit_book = 0,
+  trade_report = 1,
+  order_confirmation = 2,
+  trade_confirmation = 3
+};
+
+class JournalRecord {
+ public:
+  uint64_t receive_timestamp_;
+  uint16_t port_;
+  JournalChannel channel_;
+  bool more_;  // More frames of the same ZMQ message follow
+  std::string payload_;
+};
+
+// Records frames from any number of receive threads. Record() only copies
+// the frame into a pending buffer; a dedicated thread writes the buffer out,
+// so the receive path never waits on the disk. If the writer falls more than
+// max_pending_bytes behind, new records are dropped and counted.
+class JournalWriter {
+ public:
+  explicit JournalWriter(const std::string &path,
+                         size_t max_pending_bytes = JOURNAL_MAX_PENDING_BYTES);
+
+  // Writes out all pending records, closes the file and logs the counts
+  ~JournalWriter();
+
+  // False if the journal file could not be opened
+  bool ok() const { return file_ != nullptr; }
+
+  void Record(JournalChannel channel, uint16_t port, const char *data,
+              size_t length, bool more, uint64_t receive_timestamp);
+
+  uint64_t records_written() const { return records_written_; }
+  uint64_t records_dropped() const { return records_dropped_; }
+
+ private:
+  void WriterFunc();
+
+  FILE *file_;
+  size_t max_pending_bytes_;
+
+  // Records not yet handed to the writer thread, and the buffer it is
+  // writing. The two are swapped, so both keep their capacity.
+  std::string pending_;
+  uint64_t pending_records_ = 0;
+  std::string writing_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool stop_ = false;
+  std::atomic<uint64_t> records_written_{0};
+  std::atomic<uint64_t> records_dropped_{0};
+  std::thread writer_thread_;
+};
+
+// Reads the records of a journal in order
+class JournalReader {
+ public:
+  explicit JournalReader(const std::string &path);
+  ~JournalReader();
+
+  // False if the file could not be opened or is not a journal
+  bool ok() const { return file_ != nullptr; }
+
+  // Read the next record. Returns false at the end of the journal (a
+  // truncated last record, as left by a crash, also ends the journal).
+  bool Next(JournalRecord *record);
+
+ private:
+  FILE *file_;
+};
+
+// Plays a journal back with the original spacing between records divided by
+// speed, or as fast as possible if speed is 0. Pacing waits go through
+// clock, so a SimulatedClock replays at any speed without sleeping.
+class JournalReplayer {
+ public:
+  JournalReplayer(const std::string &path, double speed,
+                  Clock *clock = RealTimeClock());
+
+  // Drive event_clock with the journal: before each record is handed over,
+  // the clock is advanced to its receive timestamp, and it is closed when
+  // the replay ends. Strategies run on the clock in the same process then
+  // tick in recorded time, each tick seeing exactly the records received
+  // before it. The clock must outlive the replays.
+  void SetEventClock(EventClock *event_clock) { event_clock_ = event_clock; }
+
+  // Hand every record to callback at the replay speed until the journal ends
+  // or *run becomes false. Returns the number of records replayed, or -1 if
+  // the journal cannot be read.
+  int64_t Replay(const std::function<void(const JournalRecord &)> &callback,
+                 volatile bool *run);
+
+  // Publish every frame on a ZMQ PUB socket bound to its original port on
+  // bind_ip, so API objects constructed with bind_ip as the gateway receive
+  // the recorded stream. The journal is scanned once to bind all ports, then
+  // subscribers get warmup_ms to connect before the first frame is sent.
+  int64_t Publish(const std::string &bind_ip, uint64_t warmup_ms,
+                  volatile bool *run);
+
+ private:
+  std::string path_;
+  double speed_;
+  Clock *clock_;
+  EventClock *event_clock_ = nullptr;
+};
+
+#endif  // TRADER_JOURNAL_H_
@@ -0,0 +1,62 @@
+#include <signal.h>
+
+#include <map>
+
+#include "trader/journal.h"
+
+// Google Command Flags
+DEFINE_string(journal_path, "/root/market_data.journal",
+              "Journal to replay (see journal.h)");
+DEFINE_double(speed, 1,
+              "Replay speed as a multiple of the recorded pace, or 0 to "
+              "replay as fast as possible");
+DEFINE_bool(publish, true,
+            "Publish the recorded frames on their original ports; otherwise "
+            "only read them and print per-channel counts");
+DEFINE_string(bind_ip, "127.0.0.1",
+              "Address to publish on. Point the trader's gateway_ip here.");
+DEFINE_uint64(warmup_ms, 2000,
+              "Time given to subscribers to connect before replay starts");
+
+// Continuous Execution Indicator
+static volatile bool run = true;
+
+// Catch CTRL-C Exception and Stop Execution
+void SignalHandler(int signal) { run = false; }
+
+int main(int argc, char **argv) {
+  // GFLAGS and GLOG Parsing
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = 1;
+  signal(SIGINT, SignalHandler);
+
+  Clock *clock = RealTimeClock();
+  JournalReplayer replayer(FLAGS_journal_path, FLAGS_speed, clock);
+  uint64_t start_timestamp = clock->Now();
+  std::map<int, std::pair<uint64_t, uint64_t> > channel_counts;
+  int64_t num_records;
+  if (FLAGS_publish) {
+    num_records = replayer.Publish(FLAGS_bind_ip, FLAGS_warmup_ms, &run);
+    start_timestamp += FLAGS_warmup_ms * 1000;
+  } else {
+    num_records = replayer.Replay(
+        [&channel_counts](const JournalRecord &record) {
+          auto &counts = channel_counts[static_cast<int>(record.channel_)];
+          counts.first++;
+          counts.second += record.payload_.size();
+        },
+        &run);
+  }
+  if (num_records < 0) {
+    return -1;
+  }
+
+  uint64_t elapsed = clock->Now() - start_timestamp;
+  LOG(INFO) << "Replayed " << num_records << " Records in " << elapsed
+            << " us";
+  for (auto &counts : channel_counts) {
+    LOG(INFO) << "Channel " << counts.first << ": " << counts.second.first
+              << " Records, " << counts.second.second << " Bytes";
+  }
+}
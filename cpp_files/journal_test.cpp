@@ -0,0 +1,111 @@
+#include "trader/journal.h"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+class JournalTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = "/tmp/journal_test_" + std::to_string(getpid());
+    unlink(path_.c_str());
+  }
+  void TearDown() override { unlink(path_.c_str()); }
+
+  std::vector<JournalRecord> ReadAll() {
+    std::vector<JournalRecord> records;
+    JournalReader reader(path_);
+    EXPECT_TRUE(reader.ok());
+    JournalRecord record;
+    while (reader.Next(&record)) records.push_back(record);
+    return records;
+  }
+
+  std::string path_;
+};
+
+TEST_F(JournalTest, WriterRecordsReadBack) {
+  std::string book = "AA|1602182726927431|1602182726927481|0|0";
+  std::string big(100000, 'x');
+  {
+    JournalWriter writer(path_);
+    ASSERT_TRUE(writer.ok());
+    writer.Record(JournalChannel::limit_book, JOURNAL_DECODED_PORT,
+                  book.data(), book.size(), false, 1000);
+    writer.Record(JournalChannel::trade_report, 5556, "", 0, true, 1001);
+    writer.Record(JournalChannel::order_confirmation, 65535, big.data(),
+                  big.size(), false, 1002);
+  }
+  std::vector<JournalRecord> records = ReadAll();
+  ASSERT_EQ(records.size(), 3u);
+  EXPECT_EQ(records[0].channel_, JournalChannel::limit_book);
+  EXPECT_EQ(records[0].port_, JOURNAL_DECODED_PORT);
+  EXPECT_EQ(records[0].receive_timestamp_, 1000u);
+  EXPECT_FALSE(records[0].more_);
+  EXPECT_EQ(records[0].payload_, book);
+  EXPECT_EQ(records[1].channel_, JournalChannel::trade_report);
+  EXPECT_EQ(records[1].port_, 5556);
+  EXPECT_TRUE(records[1].more_);
+  EXPECT_TRUE(records[1].payload_.empty());
+  EXPECT_EQ(records[2].port_, 65535);
+  EXPECT_EQ(records[2].payload_, big);
+
+  // Reopening appends after the existing records
+  {
+    JournalWriter writer(path_);
+    writer.Record(JournalChannel::trade_confirmation, 1, "y", 1, false, 1003);
+  }
+  records = ReadAll();
+  ASSERT_EQ(records.size(), 4u);
+  EXPECT_EQ(records[3].channel_, JournalChannel::trade_confirmation);
+  EXPECT_EQ(records[3].payload_, "y");
+}
+
+TEST_F(JournalTest, TruncatedLastRecordEndsTheJournal) {
+  {
+    JournalWriter writer(path_);
+    writer.Record(JournalChannel::limit_book, 1, "abc", 3, false, 1);
+    writer.Record(JournalChannel::limit_book, 1, "defg", 4, false, 2);
+  }
+  ASSERT_EQ(truncate(path_.c_str(), JOURNAL_MAGIC_SIZE +
+                                        2 * JOURNAL_RECORD_HEADER_SIZE + 5),
+            0);
+  std::vector<JournalRecord> records = ReadAll();
+  ASSERT_EQ(records.size(), 1u);
+  EXPECT_EQ(records[0].payload_, "abc");
+}
+
+TEST_F(JournalTest, ReplayAdvancesTheEventClock) {
+  {
+    JournalWriter writer(path_);
+    for (uint64_t timestamp = 100; timestamp <= 500; timestamp += 100) {
+      writer.Record(JournalChannel::limit_book, 1, "a", 1, false, timestamp);
+    }
+  }
+  SimulatedClock clock;
+  EventClock event_clock;
+  JournalReplayer replayer(path_, 1, &clock);
+  replayer.SetEventClock(&event_clock);
+  std::vector<uint64_t> seen;
+  volatile bool run = true;
+  EXPECT_EQ(replayer.Replay(
+                [&](const JournalRecord &record) {
+                  // Advanced before the record is handed over
+                  EXPECT_EQ(event_clock.Now(), record.receive_timestamp_);
+                  seen.push_back(record.receive_timestamp_);
+                },
+                &run),
+            5);
+  EXPECT_EQ(seen, std::vector<uint64_t>({100, 200, 300, 400, 500}));
+  // Paced at the recorded spacing without sleeping
+  EXPECT_EQ(clock.Now(), 400u);
+
+  JournalReplayer missing(path_ + "_missing", 0);
+  EXPECT_EQ(missing.Replay([](const JournalRecord &) {}, &run), -1);
+}
+
+}  // namespace
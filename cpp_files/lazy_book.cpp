@@ -0,0 +1,173 @@
+#include "common/lazy_book.h"
+
+#include <algorithm>
+
+#include "common/text_parser.h"
+
+// Limit price field of an order; the result and the shares follow it
+#define LAZY_BOOK_PRICE_FIELD 11
+
+bool LazyLimitOrderBook::Assign(const char *data, size_t len) {
+  raw_.assign(data, len);
+  return ParseHeader();
+}
+
+bool LazyLimitOrderBook::Assign(std::string &&serialized_book) {
+  raw_ = std::move(serialized_book);
+  return ParseHeader();
+}
+
+bool LazyLimitOrderBook::ParseHeader() {
+  const char *data = raw_.data();
+  size_t len = raw_.size();
+  // Fields past the end of a short message begin at len + 1
+  size_t begins[LAZY_BOOK_HEADER_FIELDS + 1];
+  begins[0] = 0;
+  for (int i = 0; i < LAZY_BOOK_HEADER_FIELDS; i++) {
+    begins[i + 1] = begins[i] > len
+                        ? len + 1
+                        : SkipTextFields(data, len, begins[i], 1);
+  }
+  uint64_t num_buys, num_sells;
+  // Field i is data[begins[i], begins[i + 1] - 1)
+  if (begins[LAZY_BOOK_HEADER_FIELDS - 1] > len ||
+      !ParseTextUint(data + begins[1], begins[2] - 1 - begins[1],
+                     &creation_timestamp_) ||
+      !ParseTextUint(data + begins[2], begins[3] - 1 - begins[2],
+                     &release_timestamp_) ||
+      !ParseTextUint(data + begins[3], begins[4] - 1 - begins[3],
+                     &num_buys) ||
+      !ParseTextUint(data + begins[4], begins[5] - 1 - begins[4],
+                     &num_sells)) {
+    Reset(&buys_, 0);
+    Reset(&sells_, 0);
+    return false;
+  }
+  symbol_.assign(data, begins[1] - 1);
+  Reset(&buys_, num_buys);
+  buys_.begin_ = buys_.next_ = begins[LAZY_BOOK_HEADER_FIELDS];
+  Reset(&sells_, num_sells);
+  if (!TextBookLayoutValid() || !IndexLevels()) ParseFull();
+  return true;
+}
+
+bool LazyLimitOrderBook::IndexLevels() {
+  const char *data = raw_.data();
+  size_t len = raw_.size();
+  size_t next = buys_.begin_;
+  for (OrderAction side : {OrderAction::buy, OrderAction::sell}) {
+    Side &queue = Queue(side);
+    queue.begin_ = queue.next_ = next;
+    for (size_t i = 0; i < queue.num_orders_; i++) {
+      if (next > len) return false;
+      size_t price = SkipTextFields(data, len, next, LAZY_BOOK_PRICE_FIELD);
+      size_t result = SkipTextFields(data, len, price, 1);
+      size_t shares = SkipTextFields(data, len, result, 1);
+      next = SkipTextFields(data, len, shares, 1);
+      int64_t limit_price, num_shares;
+      if (next > len + 1 ||
+          !ParseTextInt(data + price, result - 1 - price, &limit_price) ||
+          !ParseTextInt(data + shares, next - 1 - shares, &num_shares) ||
+          limit_price < INT32_MIN || limit_price > INT32_MAX ||
+          num_shares < INT32_MIN || num_shares > INT32_MAX) {
+        return false;
+      }
+      AddToLevels(side, limit_price, num_shares);
+    }
+  }
+  // The last order ends the message
+  return next == len + 1;
+}
+
+void LazyLimitOrderBook::Reset(Side *queue, size_t num_orders) const {
+  queue->begin_ = std::string::npos;
+  queue->next_ = std::string::npos;
+  queue->num_orders_ = num_orders;
+  queue->num_parsed_ = 0;
+  queue->failed_ = false;
+  queue->levels_.clear();
+}
+
+bool LazyLimitOrderBook::ParseNext(OrderAction side) const {
+  Side &queue = Queue(side);
+  if (queue.done()) return false;
+  // IndexLevels has found where every order starts and that the orders
+  // fill the message; the last one ends at its end rather than at a
+  // delimiter, either way one before the next field
+  size_t end = SkipTextFields(raw_.data(), raw_.size(), queue.next_,
+                              TEXT_ORDER_FIELDS);
+  if (queue.orders_.size() == queue.num_parsed_) queue.orders_.emplace_back();
+  Order &order = queue.orders_[queue.num_parsed_];
+  if (!ParseOrder(raw_.data() + queue.next_, end - 1 - queue.next_,
+                  &order)) {
+    queue.failed_ = true;
+    return false;
+  }
+  queue.next_ = end;
+  queue.num_parsed_++;
+  return true;
+}
+
+void LazyLimitOrderBook::AddToLevels(OrderAction side, int32_t price,
+                                     int32_t shares) const {
+  auto &levels = Queue(side).levels_;
+  bool buy = side == OrderAction::buy;
+  // First level not better than price
+  auto it = std::lower_bound(
+      levels.begin(), levels.end(), price,
+      [buy](const std::pair<int32_t, int32_t> &level, int32_t value) {
+        return buy ? level.first > value : level.first < value;
+      });
+  if (it != levels.end() && it->first == price) {
+    it->second += shares;
+  } else {
+    levels.emplace(it, price, shares);
+  }
+}
+
+void LazyLimitOrderBook::ParseUntil(OrderAction side, size_t n) const {
+  Side &queue = Queue(side);
+  while (queue.num_parsed_ < n && ParseNext(side)) {
+  }
+  if (queue.failed_) ParseFull();
+}
+
+void LazyLimitOrderBook::ParseFull() const {
+  ParseLimitOrderBookOrConstruct(raw_.data(), raw_.size(), &full_);
+  // The header as the constructor read it, if the layout does not match
+  symbol_ = full_.symbol_;
+  creation_timestamp_ = full_.creation_timestamp_;
+  release_timestamp_ = full_.release_timestamp_;
+  for (OrderAction side : {OrderAction::buy, OrderAction::sell}) {
+    const std::map<std::string, Order> &source =
+        side == OrderAction::buy ? full_.buy_queue_ : full_.sell_queue_;
+    Side &queue = Queue(side);
+    Reset(&queue, source.size());
+    if (queue.orders_.size() < source.size()) {
+      queue.orders_.resize(source.size());
+    }
+    for (auto &entry : source) {
+      queue.orders_[queue.num_parsed_++] = entry.second;
+      AddToLevels(side, entry.second.limit_price_, entry.second.num_shares_);
+    }
+  }
+}
+
+bool LazyLimitOrderBook::Level(OrderAction side, size_t i, int32_t *price,
+                               int32_t *shares) const {
+  const Side &queue = Queue(side);
+  if (i >= queue.levels_.size()) return false;
+  *price = queue.levels_[i].first;
+  *shares = queue.levels_[i].second;
+  return true;
+}
+
+const Order *LazyLimitOrderBook::order(OrderAction side, size_t i) const {
+  Side &queue = Queue(side);
+  ParseUntil(side, i + 1);
+  return i < queue.num_parsed_ ? &queue.orders_[i] : nullptr;
+}
+
+void LazyLimitOrderBook::Materialize(LimitOrderBook *book) const {
+  ParseLimitOrderBookOrConstruct(raw_.data(), raw_.size(), book);
+}
@@ -0,0 +1,111 @@
+#ifndef COMMON_LAZY_BOOK_H_
+#define COMMON_LAZY_BOOK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/message_types.h"
+
+// Fields before the first order of a serialized book: symbol, creation and
+// release timestamps, number of buy orders, number of sell orders
+#define LAZY_BOOK_HEADER_FIELDS 5
+
+// A serialized LimitOrderBook (text_parser.h layout) kept as received and
+// parsed on demand. Assign indexes the price levels of both sides, reading
+// only the price and shares of each order and skipping its other fields by
+// counting delimiters, so the top of the book and every level behind it
+// are ready as soon as the book is assigned. Orders are parsed only when
+// asked for, and only as far as needed.
+//
+// The text layout is used only once text_parser.h has checked it
+// (TextBookLayoutValid). Until then, or if the orders do not fit the
+// layout, the whole book is parsed as ParseLimitOrderBookOrConstruct would
+// at Assign, and read from that instead. The same happens later if an
+// order the index read fails to parse in full; only then can the levels
+// change.
+//
+// Accessors parse into caches, so a LazyLimitOrderBook must not be read
+// from several threads at once. Reusing one for every message allocates
+// nothing once its buffers have grown to size.
+class LazyLimitOrderBook {
+ public:
+  // Keep a copy of the serialized book, or take it over. Returns false,
+  // leaving both sides empty, if the header does not match the layout; the
+  // book can then only be read through Materialize.
+  bool Assign(const char *data, size_t len);
+  bool Assign(std::string &&serialized_book);
+
+  const std::string &raw() const { return raw_; }
+  const std::string &symbol() const { return symbol_; }
+  uint64_t creation_timestamp() const { return creation_timestamp_; }
+  uint64_t release_timestamp() const { return release_timestamp_; }
+  size_t num_orders(OrderAction side) const {
+    return Queue(side).num_orders_;
+  }
+
+  // Price and total shares of price level i of side (buy or sell), 0 being
+  // the best, from the index Assign built. Returns false past the last
+  // level.
+  bool Level(OrderAction side, size_t i, int32_t *price,
+             int32_t *shares) const;
+  bool BestLevel(OrderAction side, int32_t *price, int32_t *shares) const {
+    return Level(side, 0, price, shares);
+  }
+
+  // Order i of side in queue order, or nullptr past the end. Valid until
+  // the next Assign.
+  const Order *order(OrderAction side, size_t i) const;
+
+  // Parse all of it, as ParseLimitOrderBookOrConstruct
+  void Materialize(LimitOrderBook *book) const;
+
+ private:
+  class Side {
+   public:
+    size_t begin_ = 0;       // Offset of the first order, or npos
+    size_t next_ = 0;        // Offset of the first order not yet parsed
+    size_t num_orders_ = 0;  // From the header
+    size_t num_parsed_ = 0;
+    bool failed_ = false;  // An order did not parse
+    // Parsed orders; may hold more than num_parsed_, left from earlier
+    // books so their strings are reused
+    std::vector<Order> orders_;
+    // Levels of all the orders, best first
+    std::vector<std::pair<int32_t, int32_t> > levels_;
+
+    bool done() const { return failed_ || num_parsed_ == num_orders_; }
+  };
+
+  Side &Queue(OrderAction side) const {
+    return side == OrderAction::buy ? buys_ : sells_;
+  }
+  bool ParseHeader();
+  // Build the levels of both sides and find where each side's orders
+  // start. Returns false if the orders do not fill the message as the
+  // header counts them.
+  bool IndexLevels();
+  void Reset(Side *queue, size_t num_orders) const;
+  // Parse the next order of side; false at the end
+  bool ParseNext(OrderAction side) const;
+  // Parse orders of side until n are parsed or it ends, falling back to
+  // ParseFull if one does not parse
+  void ParseUntil(OrderAction side, size_t n) const;
+  // Parse the whole book into full_ and read both sides from it
+  void ParseFull() const;
+  void AddToLevels(OrderAction side, int32_t price, int32_t shares) const;
+
+  std::string raw_;
+  // Header fields, replaced by those of full_ when it is parsed
+  mutable std::string symbol_;
+  mutable uint64_t creation_timestamp_ = 0;
+  mutable uint64_t release_timestamp_ = 0;
+  mutable Side buys_;
+  mutable Side sells_;
+  mutable LimitOrderBook full_;
+};
+
+#endif  // COMMON_LAZY_BOOK_H_
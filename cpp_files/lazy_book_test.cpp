@@ -0,0 +1,192 @@
+#include "common/lazy_book.h"
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/text_parser.h"
+#include "trader/top_of_book.h"
+
+namespace {
+
+typedef std::vector<std::pair<int32_t, int32_t> > Levels;
+
+// A book whose order ids do not follow price priority, with several orders
+// at some prices
+LimitOrderBook MakeBook(std::mt19937_64 *rng, int num_buys, int num_sells) {
+  LimitOrderBook book;
+  book.symbol_ = "AA";
+  book.creation_timestamp_ = 1602182726927431ULL + (*rng)() % 1000;
+  book.release_timestamp_ = book.creation_timestamp_ + 50;
+  for (int i = 0; i < num_buys + num_sells; i++) {
+    bool buy = i < num_buys;
+    Order order;
+    order.symbol_ = "AA";
+    order.order_id_ = "G1_C" + std::to_string((*rng)() % 5) + "_" +
+                      std::to_string(100000 + (*rng)() % 900000);
+    order.cancel_id_ = "NULL";
+    order.client_id_ = "C1";
+    order.type_ = OrderType::limit;
+    order.action_ = buy ? OrderAction::buy : OrderAction::sell;
+    order.genesis_timestamp_ = book.creation_timestamp_ - 100 + i;
+    order.gateway_timestamp_ = order.genesis_timestamp_ + 3;
+    order.enqueue_timestamp_ = order.genesis_timestamp_ + 5;
+    order.dequeue_timestamp_ = order.genesis_timestamp_ + 7;
+    order.order_serial_num_ = i;
+    order.limit_price_ = buy ? 9990 - static_cast<int32_t>((*rng)() % 8)
+                             : 10010 + static_cast<int32_t>((*rng)() % 8);
+    order.result_ = OrderResult::valid;
+    order.num_shares_ = 100 + static_cast<int32_t>((*rng)() % 50);
+    (buy ? book.buy_queue_ : book.sell_queue_)[order.order_id_] = order;
+  }
+  return book;
+}
+
+// Levels of a fully parsed queue, best first
+Levels QueueLevels(const std::map<std::string, Order> &queue, bool buy) {
+  std::map<int32_t, int32_t, std::function<bool(int32_t, int32_t)> > levels(
+      [buy](int32_t a, int32_t b) { return buy ? a > b : a < b; });
+  for (auto &entry : queue) {
+    levels[entry.second.limit_price_] += entry.second.num_shares_;
+  }
+  return Levels(levels.begin(), levels.end());
+}
+
+Levels LazyLevels(const LazyLimitOrderBook &lazy, OrderAction side) {
+  Levels levels;
+  std::pair<int32_t, int32_t> level;
+  while (lazy.Level(side, levels.size(), &level.first, &level.second)) {
+    levels.push_back(level);
+  }
+  return levels;
+}
+
+// The lazy book reads as the full parse it falls back to
+void ExpectSameAsFullParse(const std::string &text) {
+  LimitOrderBook full;
+  ParseLimitOrderBookOrConstruct(text.data(), text.size(), &full);
+  LazyLimitOrderBook lazy;
+  lazy.Assign(text.data(), text.size());
+  EXPECT_EQ(lazy.symbol(), full.symbol_);
+  EXPECT_EQ(lazy.creation_timestamp(), full.creation_timestamp_);
+  EXPECT_EQ(LazyLevels(lazy, OrderAction::buy),
+            QueueLevels(full.buy_queue_, true));
+  EXPECT_EQ(LazyLevels(lazy, OrderAction::sell),
+            QueueLevels(full.sell_queue_, false));
+  size_t i = 0;
+  for (auto &entry : full.sell_queue_) {
+    const Order *order = lazy.order(OrderAction::sell, i++);
+    ASSERT_NE(order, nullptr);
+    EXPECT_EQ(order->order_id_, entry.first);
+    EXPECT_EQ(order->num_shares_, entry.second.num_shares_);
+  }
+  EXPECT_EQ(lazy.order(OrderAction::sell, i), nullptr);
+}
+
+class LazyBookTest : public ::testing::Test {
+ protected:
+  // The lazy parser is used only once the layout has been checked against
+  // a book of the real serializer
+  void SetUp() override {
+    LimitOrderBook sample = MakeBook(&rng_, 3, 3);
+    std::string text = sample.SerializeBook();
+    LimitOrderBook parsed;
+    ParseLimitOrderBookOrConstruct(text.data(), text.size(), &parsed);
+    ASSERT_TRUE(TextBookLayoutValid());
+  }
+
+  std::mt19937_64 rng_{7};
+};
+
+TEST_F(LazyBookTest, LevelsMatchTheFullParse) {
+  LazyLimitOrderBook lazy;
+  for (int trial = 0; trial < 200; trial++) {
+    int num_buys = rng_() % 30;
+    int num_sells = rng_() % 30;
+    std::string text = MakeBook(&rng_, num_buys, num_sells).SerializeBook();
+    LimitOrderBook full;
+    ASSERT_TRUE(ParseLimitOrderBook(text.data(), text.size(), &full));
+    // One lazy book reused for every message
+    ASSERT_TRUE(lazy.Assign(text.data(), text.size()));
+    EXPECT_EQ(lazy.num_orders(OrderAction::buy), full.buy_queue_.size());
+    EXPECT_EQ(lazy.num_orders(OrderAction::sell), full.sell_queue_.size());
+    // Sells first, so the buys are skipped over
+    EXPECT_EQ(LazyLevels(lazy, OrderAction::sell),
+              QueueLevels(full.sell_queue_, false));
+    EXPECT_EQ(LazyLevels(lazy, OrderAction::buy),
+              QueueLevels(full.buy_queue_, true));
+
+    TopOfBook expected, top;
+    expected.Build(full);
+    top.Build(lazy);
+    EXPECT_EQ(top.num_buy_levels_, expected.num_buy_levels_);
+    EXPECT_EQ(top.num_sell_levels_, expected.num_sell_levels_);
+    for (int i = 0; i < expected.num_buy_levels_; i++) {
+      EXPECT_EQ(top.buy_prices_[i], expected.buy_prices_[i]);
+      EXPECT_EQ(top.buy_shares_[i], expected.buy_shares_[i]);
+    }
+    for (int i = 0; i < expected.num_sell_levels_; i++) {
+      EXPECT_EQ(top.sell_prices_[i], expected.sell_prices_[i]);
+      EXPECT_EQ(top.sell_shares_[i], expected.sell_shares_[i]);
+    }
+  }
+}
+
+TEST_F(LazyBookTest, OrdersInQueueOrder) {
+  LimitOrderBook book = MakeBook(&rng_, 12, 9);
+  std::string text = book.SerializeBook();
+  LazyLimitOrderBook lazy;
+  ASSERT_TRUE(lazy.Assign(std::string(text)));
+  EXPECT_EQ(lazy.raw(), text);
+  // Out of order, and the sells before the buys are parsed
+  const Order *order = lazy.order(OrderAction::sell, 4);
+  ASSERT_NE(order, nullptr);
+  EXPECT_EQ(order->order_id_, std::next(book.sell_queue_.begin(), 4)->first);
+  size_t i = 0;
+  for (auto &entry : book.buy_queue_) {
+    order = lazy.order(OrderAction::buy, i++);
+    ASSERT_NE(order, nullptr);
+    EXPECT_EQ(order->order_id_, entry.first);
+    EXPECT_EQ(order->limit_price_, entry.second.limit_price_);
+    EXPECT_EQ(order->enqueue_timestamp_, entry.second.enqueue_timestamp_);
+  }
+  EXPECT_EQ(lazy.order(OrderAction::buy, i), nullptr);
+}
+
+TEST_F(LazyBookTest, ShortHeaders) {
+  LazyLimitOrderBook lazy;
+  int32_t price, shares;
+  for (std::string text : {"", "AA", "AA|1|2", "AA|1|2|3", "AA|1|2|x|0"}) {
+    EXPECT_FALSE(lazy.Assign(text.data(), text.size())) << text;
+    EXPECT_EQ(lazy.num_orders(OrderAction::buy), 0u);
+    EXPECT_FALSE(lazy.BestLevel(OrderAction::buy, &price, &shares));
+    EXPECT_FALSE(lazy.BestLevel(OrderAction::sell, &price, &shares));
+    EXPECT_EQ(lazy.order(OrderAction::sell, 0), nullptr);
+  }
+  std::string empty = "AA|1|2|0|0";
+  EXPECT_TRUE(lazy.Assign(empty.data(), empty.size()));
+  EXPECT_FALSE(lazy.BestLevel(OrderAction::buy, &price, &shares));
+}
+
+TEST_F(LazyBookTest, MalformedOrdersFallBackToTheFullParse) {
+  LimitOrderBook book = MakeBook(&rng_, 10, 10);
+  std::string text = book.SerializeBook();
+  // A sign the text parser rejects, in the shares of a buy order in the
+  // middle
+  std::string bad_shares = text;
+  size_t order_begin =
+      bad_shares.find(std::next(book.buy_queue_.begin(), 5)->first) - 3;
+  bad_shares.insert(SkipTextFields(bad_shares.data(), bad_shares.size(),
+                                   order_begin, TEXT_ORDER_FIELDS - 1),
+                    "+");
+  ExpectSameAsFullParse(bad_shares);
+  // An order more than the header counts
+  ExpectSameAsFullParse(text + "|" + text.substr(text.find("|AA|") + 1));
+}
+
+}  // namespace
@@ -0,0 +1,326 @@
+#include "common/metrics.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "common/utils.h"
+
+namespace {
+
+// HTTP endpoint: how often the accept loop checks for Stop, and how long a
+// client gets to send its request
+#define METRICS_POLL_MS 200
+#define METRICS_REQUEST_TIMEOUT_MS 1000
+
+thread_local std::atomic<uint64_t> *thread_slots = nullptr;
+
+void AppendNumber(double value, std::string *out) {
+  char number[32];
+  snprintf(number, sizeof(number), "%.17g", value);
+  out->append(number);
+}
+
+// name{labels} or name{labels,extra}
+std::string Sample(const std::string &name, const std::string &labels,
+                   const std::string &extra = "") {
+  std::string sample = name;
+  if (!labels.empty() || !extra.empty()) {
+    sample += '{';
+    sample += labels;
+    if (!labels.empty() && !extra.empty()) sample += ',';
+    sample += extra;
+    sample += '}';
+  }
+  sample += ' ';
+  return sample;
+}
+
+}  // namespace
+
+std::string MetricLabels(
+    const std::vector<std::pair<std::string, std::string> > &labels) {
+  std::string out;
+  for (auto &label : labels) {
+    if (!out.empty()) out += ',';
+    out += label.first;
+    out += "=\"";
+    for (char c : label.second) {
+      if (c == '\\' || c == '"') out += '\\';
+      if (c == '\n') {
+        out += "\\n";
+        continue;
+      }
+      out += c;
+    }
+    out += '"';
+  }
+  return out;
+}
+
+MetricsWriter::Family *MetricsWriter::GetFamily(const std::string &name,
+                                                const std::string &help,
+                                                const char *type) {
+  Family &family = families_[name];
+  if (family.samples_.empty()) {
+    family.help_ = help;
+    family.type_ = type;
+  }
+  return &family;
+}
+
+void MetricsWriter::Counter(const std::string &name, const std::string &help,
+                            const std::string &labels, double value) {
+  std::string sample = Sample(name, labels);
+  AppendNumber(value, &sample);
+  GetFamily(name, help, "counter")->samples_.push_back(sample);
+}
+
+void MetricsWriter::Gauge(const std::string &name, const std::string &help,
+                          const std::string &labels, double value) {
+  std::string sample = Sample(name, labels);
+  AppendNumber(value, &sample);
+  GetFamily(name, help, "gauge")->samples_.push_back(sample);
+}
+
+void MetricsWriter::Histogram(const std::string &name,
+                              const std::string &help,
+                              const std::string &labels,
+                              const uint64_t *buckets, uint64_t sum) {
+  Family *family = GetFamily(name, help, "histogram");
+  uint64_t count = 0;
+  uint64_t bound = 1;
+  for (int i = 0; i <= METRICS_HISTOGRAM_BUCKETS; i++) {
+    count += buckets[i];
+    std::string le = i < METRICS_HISTOGRAM_BUCKETS
+                         ? "le=\"" + std::to_string(bound) + "\""
+                         : "le=\"+Inf\"";
+    family->samples_.push_back(Sample(name + "_bucket", labels, le) +
+                               std::to_string(count));
+    bound *= 4;
+  }
+  family->samples_.push_back(Sample(name + "_sum", labels) +
+                             std::to_string(sum));
+  family->samples_.push_back(Sample(name + "_count", labels) +
+                             std::to_string(count));
+}
+
+void MetricsWriter::Write(std::string *out) const {
+  for (auto &entry : families_) {
+    const Family &family = entry.second;
+    *out += "# HELP " + entry.first + " " + family.help_ + "\n";
+    *out += "# TYPE " + entry.first + " " + family.type_ + "\n";
+    for (auto &sample : family.samples_) {
+      *out += sample;
+      *out += '\n';
+    }
+  }
+}
+
+MetricsRegistry *MetricsRegistry::Get() {
+  static MetricsRegistry *registry = new MetricsRegistry();
+  return registry;
+}
+
+int MetricsRegistry::AddCounter(const std::string &name,
+                                const std::string &help,
+                                const std::string &labels) {
+  return Register(name, help, labels, false);
+}
+
+int MetricsRegistry::AddHistogram(const std::string &name,
+                                  const std::string &help,
+                                  const std::string &labels) {
+  return Register(name, help, labels, true);
+}
+
+int MetricsRegistry::Register(const std::string &name,
+                              const std::string &help,
+                              const std::string &labels, bool histogram) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::string key = name + "{" + labels + "}";
+  auto it = metric_ids_.find(key);
+  if (it != metric_ids_.end()) return metrics_[it->second].slot_;
+  // Buckets, +Inf and the sum
+  int size = histogram ? METRICS_HISTOGRAM_BUCKETS + 2 : 1;
+  if (num_slots_ + size > METRICS_MAX_SLOTS) {
+    LOG(ERROR) << "Out of Metric Slots for " << key;
+    return -1;
+  }
+  metrics_.push_back({name, help, labels, histogram, num_slots_});
+  metric_ids_[key] = metrics_.size() - 1;
+  num_slots_ += size;
+  return metrics_.back().slot_;
+}
+
+std::atomic<uint64_t> *MetricsRegistry::ThreadSlots() {
+  if (thread_slots == nullptr) {
+    std::unique_ptr<std::atomic<uint64_t>[]> slots(
+        new std::atomic<uint64_t>[METRICS_MAX_SLOTS]);
+    for (int i = 0; i < METRICS_MAX_SLOTS; i++) {
+      slots[i].store(0, std::memory_order_relaxed);
+    }
+    thread_slots = slots.get();
+    // Kept after the thread exits, so its counts stay in the totals
+    std::lock_guard<std::mutex> lock(thread_slots_mutex_);
+    thread_slots_.push_back(std::move(slots));
+  }
+  return thread_slots;
+}
+
+uint64_t MetricsRegistry::Total(int slot) const {
+  uint64_t total = 0;
+  for (auto &slots : thread_slots_) {
+    total += slots[slot].load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+int MetricsRegistry::AddCollector(
+    std::function<void(MetricsWriter *)> collector) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  collectors_[next_collector_id_] = std::move(collector);
+  return next_collector_id_++;
+}
+
+void MetricsRegistry::RemoveCollector(int collector_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  collectors_.erase(collector_id);
+}
+
+void MetricsRegistry::WritePrometheus(std::string *out) {
+  MetricsWriter writer;
+  std::lock_guard<std::mutex> lock(mutex_);
+  {
+    std::lock_guard<std::mutex> slots_lock(thread_slots_mutex_);
+    uint64_t buckets[METRICS_HISTOGRAM_BUCKETS + 1];
+    for (auto &metric : metrics_) {
+      if (!metric.histogram_) {
+        writer.Counter(metric.name_, metric.help_, metric.labels_,
+                       Total(metric.slot_));
+        continue;
+      }
+      for (int i = 0; i <= METRICS_HISTOGRAM_BUCKETS; i++) {
+        buckets[i] = Total(metric.slot_ + i);
+      }
+      writer.Histogram(metric.name_, metric.help_, metric.labels_, buckets,
+                       Total(metric.slot_ + METRICS_HISTOGRAM_BUCKETS + 1));
+    }
+  }
+  for (auto &entry : collectors_) {
+    entry.second(&writer);
+  }
+  out->clear();
+  writer.Write(out);
+}
+
+bool MetricsRegistry::WriteFile(const std::string &path) {
+  std::string text;
+  WritePrometheus(&text);
+  std::string temporary = path + ".tmp";
+  FILE *file = fopen(temporary.c_str(), "w");
+  if (file == nullptr) {
+    LOG(ERROR) << "Failed to Open Metrics File " << temporary;
+    return false;
+  }
+  bool ok = fwrite(text.data(), 1, text.size(), file) == text.size();
+  ok &= fclose(file) == 0;
+  if (!ok || rename(temporary.c_str(), path.c_str()) != 0) {
+    LOG(ERROR) << "Failed to Write Metrics File " << path;
+    return false;
+  }
+  return true;
+}
+
+bool MetricsRegistry::StartHttp(int port, const std::string &address) {
+  if (export_thread_.joinable()) return false;
+  sockaddr_in listen_address = {};
+  listen_address.sin_family = AF_INET;
+  listen_address.sin_port = htons(port);
+  if (inet_pton(AF_INET, address.c_str(), &listen_address.sin_addr) != 1) {
+    LOG(ERROR) << "Invalid Metrics Address: " << address;
+    return false;
+  }
+  int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (listen_fd < 0) {
+    LOG(ERROR) << "Failed to Open Metrics Socket";
+    return false;
+  }
+  int reuse = 1;
+  setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  if (bind(listen_fd, reinterpret_cast<sockaddr *>(&listen_address),
+           sizeof(listen_address)) != 0 ||
+      listen(listen_fd, 16) != 0) {
+    LOG(ERROR) << "Failed to Listen for Metrics on " << address << ":"
+               << port;
+    close(listen_fd);
+    return false;
+  }
+  stop_ = false;
+  export_thread_ = std::thread(&MetricsRegistry::HttpFunc, this, listen_fd);
+  return true;
+}
+
+bool MetricsRegistry::StartFileExport(const std::string &path,
+                                      uint64_t interval_ms) {
+  if (export_thread_.joinable() || interval_ms == 0) return false;
+  stop_ = false;
+  export_thread_ =
+      std::thread(&MetricsRegistry::FileFunc, this, path, interval_ms);
+  return true;
+}
+
+void MetricsRegistry::Stop() {
+  if (!export_thread_.joinable()) return;
+  stop_ = true;
+  export_thread_.join();
+}
+
+void MetricsRegistry::HttpFunc(int listen_fd) {
+  std::string body;
+  char request[1024];
+  while (!stop_) {
+    pollfd listener = {listen_fd, POLLIN, 0};
+    if (poll(&listener, 1, METRICS_POLL_MS) <= 0) continue;
+    int client_fd = accept(listen_fd, nullptr, nullptr);
+    if (client_fd < 0) continue;
+    // Any request gets the metrics; read it only so the client sees its
+    // request consumed
+    pollfd client = {client_fd, POLLIN, 0};
+    if (poll(&client, 1, METRICS_REQUEST_TIMEOUT_MS) > 0) {
+      recv(client_fd, request, sizeof(request), 0);
+    }
+    WritePrometheus(&body);
+    std::string response =
+        "HTTP/1.0 200 OK\r\n"
+        "Content-Type: text/plain; version=0.0.4\r\n"
+        "Content-Length: " +
+        std::to_string(body.size()) + "\r\n\r\n" + body;
+    size_t sent = 0;
+    while (sent < response.size()) {
+      ssize_t n = send(client_fd, response.data() + sent,
+                       response.size() - sent, MSG_NOSIGNAL);
+      if (n <= 0) break;
+      sent += n;
+    }
+    close(client_fd);
+  }
+  close(listen_fd);
+}
+
+void MetricsRegistry::FileFunc(std::string path, uint64_t interval_ms) {
+  while (!stop_) {
+    WriteFile(path);
+    for (uint64_t waited = 0; waited < interval_ms && !stop_;
+         waited += METRICS_POLL_MS) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(
+          std::min<uint64_t>(METRICS_POLL_MS, interval_ms - waited)));
+    }
+  }
+  WriteFile(path);
+}
@@ -0,0 +1,207 @@
+#ifndef COMMON_METRICS_H_
+#define COMMON_METRICS_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Counter slots per thread; registration fails (id -1) once they run out
+#define METRICS_MAX_SLOTS 8192
+// Histogram buckets: upper bounds 4^0 .. 4^(METRICS_HISTOGRAM_BUCKETS - 1)
+// in the metric's unit, then +Inf
+#define METRICS_HISTOGRAM_BUCKETS 13
+// Port and address of the HTTP endpoint when none is given; the address
+// keeps it to this host
+#define METRICS_DEFAULT_PORT 9464
+#define METRICS_DEFAULT_ADDRESS "127.0.0.1"
+
+// Monotonic time for latency metrics, unaffected by the trading Clock
+inline uint64_t MetricsNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Label set in Prometheus syntax, e.g. MetricLabels({{"symbol", "AA"}})
+// gives symbol="AA"
+std::string MetricLabels(
+    const std::vector<std::pair<std::string, std::string> > &labels);
+
+// Collects samples for one export, grouped into metric families
+class MetricsWriter {
+ public:
+  void Counter(const std::string &name, const std::string &help,
+               const std::string &labels, double value);
+  void Gauge(const std::string &name, const std::string &help,
+             const std::string &labels, double value);
+  // Cumulative counts of the METRICS_HISTOGRAM_BUCKETS + 1 buckets
+  void Histogram(const std::string &name, const std::string &help,
+                 const std::string &labels, const uint64_t *buckets,
+                 uint64_t sum);
+
+  // Prometheus text exposition format
+  void Write(std::string *out) const;
+
+ private:
+  class Family {
+   public:
+    std::string help_;
+    const char *type_;
+    std::vector<std::string> samples_;
+  };
+  Family *GetFamily(const std::string &name, const std::string &help,
+                    const char *type);
+  std::map<std::string, Family> families_;
+};
+
+// Process-wide metrics. Counters and histograms are registered once, by
+// name and label set, and then updated through their id: every thread adds
+// to its own array of slots, created on first use, with relaxed atomic
+// stores that no other thread writes, so an update takes no lock and no
+// locked instruction. An export sums the slots of all threads. Values that
+// are cheaper to read when asked for (pool occupancy, queue depths) come
+// from collectors, called at every export.
+//
+//   static int sent = MetricsRegistry::Get()->AddCounter(
+//       "orders_sent_total", "Orders sent", MetricLabels({{"side", "buy"}}));
+//   MetricsRegistry::Get()->Add(sent);
+//
+// Export as Prometheus text with WritePrometheus, to a file for the node
+// exporter's textfile collector (StartFileExport) or over HTTP (StartHttp).
+class MetricsRegistry {
+ public:
+  static MetricsRegistry *Get();
+
+  // Id of the counter or histogram with this name and label set,
+  // registering it on first use. Returns -1 once the slots run out; updates
+  // through -1 are ignored.
+  int AddCounter(const std::string &name, const std::string &help,
+                 const std::string &labels = "");
+  int AddHistogram(const std::string &name, const std::string &help,
+                   const std::string &labels = "");
+
+  void Add(int counter, uint64_t value = 1) {
+    if (counter < 0) return;
+    std::atomic<uint64_t> &slot = ThreadSlots()[counter];
+    slot.store(slot.load(std::memory_order_relaxed) + value,
+               std::memory_order_relaxed);
+  }
+  void Observe(int histogram, uint64_t value) {
+    if (histogram < 0) return;
+    std::atomic<uint64_t> *slots = ThreadSlots() + histogram;
+    int bucket = 0;
+    if (value > 1) {
+      // Smallest b with value <= 4^b
+      bucket = (64 - __builtin_clzll(value - 1) + 1) / 2;
+      if (bucket > METRICS_HISTOGRAM_BUCKETS) {
+        bucket = METRICS_HISTOGRAM_BUCKETS;
+      }
+    }
+    slots[bucket].store(slots[bucket].load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+    std::atomic<uint64_t> &sum = slots[METRICS_HISTOGRAM_BUCKETS + 1];
+    sum.store(sum.load(std::memory_order_relaxed) + value,
+              std::memory_order_relaxed);
+  }
+
+  // Collectors add their samples to every export until removed. Removal
+  // waits for an export in progress.
+  int AddCollector(std::function<void(MetricsWriter *)> collector);
+  void RemoveCollector(int collector_id);
+
+  void WritePrometheus(std::string *out);
+  // Write atomically (through a temporary file and rename)
+  bool WriteFile(const std::string &path);
+
+  // Serve the metrics to GET requests on port of the IPv4 address (only
+  // this host by default; "0.0.0.0" for all interfaces), or rewrite path
+  // every interval_ms, from a background thread. Stop ends either.
+  bool StartHttp(int port = METRICS_DEFAULT_PORT,
+                 const std::string &address = METRICS_DEFAULT_ADDRESS);
+  bool StartFileExport(const std::string &path, uint64_t interval_ms);
+  void Stop();
+
+ private:
+  MetricsRegistry() = default;
+
+  class Metric {
+   public:
+    std::string name_;
+    std::string help_;
+    std::string labels_;
+    bool histogram_;
+    int slot_;
+  };
+
+  int Register(const std::string &name, const std::string &help,
+               const std::string &labels, bool histogram);
+  // Slots of the calling thread, created on first use
+  std::atomic<uint64_t> *ThreadSlots();
+  // Sum of slot over all threads
+  uint64_t Total(int slot) const;
+  void HttpFunc(int listen_fd);
+  void FileFunc(std::string path, uint64_t interval_ms);
+
+  std::mutex mutex_;  // Registration, collectors and exports
+  std::vector<Metric> metrics_;
+  std::map<std::string, int> metric_ids_;  // By name and labels
+  int num_slots_ = 0;
+  std::map<int, std::function<void(MetricsWriter *)> > collectors_;
+  int next_collector_id_ = 0;
+
+  std::vector<std::unique_ptr<std::atomic<uint64_t>[]> > thread_slots_;
+  mutable std::mutex thread_slots_mutex_;
+
+  std::thread export_thread_;
+  std::atomic<bool> stop_{false};
+};
+
+// Removes a collector when destroyed, for collectors that capture an object
+class MetricsCollectorHandle {
+ public:
+  MetricsCollectorHandle() = default;
+  ~MetricsCollectorHandle() { Reset(); }
+  MetricsCollectorHandle(const MetricsCollectorHandle &) = delete;
+  MetricsCollectorHandle &operator=(const MetricsCollectorHandle &) = delete;
+
+  void Reset(int collector_id = -1) {
+    if (collector_id_ >= 0) {
+      MetricsRegistry::Get()->RemoveCollector(collector_id_);
+    }
+    collector_id_ = collector_id;
+  }
+
+ private:
+  int collector_id_ = -1;
+};
+
+// Lock guard that records in a histogram how long it waited, in
+// nanoseconds, when the mutex was contended. An uncontended lock costs one
+// try_lock and records nothing, so the histogram count is the number of
+// contended acquisitions.
+template <typename Mutex>
+class MeteredLockGuard {
+ public:
+  MeteredLockGuard(Mutex &mutex, int histogram) : mutex_(mutex) {
+    if (mutex_.try_lock()) return;
+    uint64_t start = MetricsNowNs();
+    mutex_.lock();
+    MetricsRegistry::Get()->Observe(histogram, MetricsNowNs() - start);
+  }
+  ~MeteredLockGuard() { mutex_.unlock(); }
+  MeteredLockGuard(const MeteredLockGuard &) = delete;
+  MeteredLockGuard &operator=(const MeteredLockGuard &) = delete;
+
+ private:
+  Mutex &mutex_;
+};
+
+#endif  // COMMON_METRICS_H_
@@ -0,0 +1,106 @@
+#ifndef TRADER_MOMENTUM_STRATEGY_H_
+#define TRADER_MOMENTUM_STRATEGY_H_
+
+#include <string>
+
+#include "common/async_log.h"
+#include "trader/indicators.h"
+#include "trader/strategy.h"
+
+// Buys when the p1/p2 weighted momentum of the last two price changes exceeds
+// threshold percent and sells when it falls below -threshold percent.
+class MomentumStrategy : public Strategy<MomentumStrategy> {
+ public:
+  MomentumStrategy(const std::string &target_symbol,
+                   uint32_t moving_window_size, uint32_t tick_length,
+                   double threshold, int base_shares, double p1, double p2)
+      : Strategy({target_symbol}, tick_length),
+        target_symbol_(target_symbol),
+        threshold_(threshold),
+        base_shares_(base_shares),
+        stock_prices_(moving_window_size),
+        momentum_(p1, p2) {}
+
+  template <typename Executor>
+  void OnTick(const MarketView &view, Executor *executor) {
+    const BookTop &top = view.top(symbol_index(0));
+    if (top.creation_timestamp_ <= last_seen_timestamp_) {
+      VLOG(1) << target_symbol_ << " LOB Empty";
+      PushPrice(latest_stock_price_);
+      return;
+    }
+    last_seen_timestamp_ = top.creation_timestamp_;
+    // Take the highest buy price in the most recent lob as the stock price
+    double current_stock_price = top.highest_buy_price_;
+    if (current_stock_price <= LOWEST_BUY_PRICE) {
+      // currently the lob is empty, so use the latest stock price (>0) as the
+      // current stock price
+      VLOG(1) << target_symbol_ << "Order Empty in this LOB";
+      PushPrice(latest_stock_price_);
+      return;
+    }
+    if (stock_prices_.ready() && momentum_.ready()) {
+      double average_price = stock_prices_.Mean();
+      VLOG(1) << "agg_momentum=" << agg_momentum_;
+      Order ord;
+      if (agg_momentum_ < -threshold_ &&
+          top.lowest_sell_price_ < HIGHEST_SELL_PRICE) {
+        int num_shares = static_cast<int>(current_stock_price /
+                                          average_price * base_shares_);
+        ASYNC_LOG(ERROR,
+                  "{}: Sell Triggered: {}\t{}\t Current Price{}\t AvgPrice{}",
+                  view.timestamp(), target_symbol_, num_shares,
+                  current_stock_price, average_price);
+        Submit(executor, target_symbol_, OrderAction::sell, num_shares,
+               top.lowest_sell_price_ - 1, &ord);
+        ASYNC_LOG(ERROR, "Submitted selling Order {}", ord);
+      } else if (agg_momentum_ > threshold_) {
+        int num_shares = static_cast<int>(average_price /
+                                          current_stock_price * base_shares_);
+        ASYNC_LOG(ERROR,
+                  "{}: Buy Triggered: {}\t{}\t Current Price{}\t AvgPrice{}",
+                  view.timestamp(), target_symbol_, num_shares,
+                  current_stock_price, average_price);
+        Submit(executor, target_symbol_, OrderAction::buy, num_shares,
+               top.highest_buy_price_ + 1, &ord);
+        ASYNC_LOG(ERROR, "Submitted buying Order {}", ord);
+      }
+    }
+    PushPrice(current_stock_price);
+    latest_stock_price_ = current_stock_price;
+  }
+
+  // Warm-restart state (see Strategy::SaveState)
+  void SaveState(CheckpointWriter *writer) const {
+    Strategy::SaveState(writer);
+    stock_prices_.Save(writer);
+    momentum_.Save(writer);
+    writer->Put(agg_momentum_);
+    writer->Put(latest_stock_price_);
+    writer->Put(last_seen_timestamp_);
+  }
+  bool LoadState(CheckpointReader *reader) {
+    return Strategy::LoadState(reader) && stock_prices_.Load(reader) &&
+           momentum_.Load(reader) && reader->Get(&agg_momentum_) &&
+           reader->Get(&latest_stock_price_) &&
+           reader->Get(&last_seen_timestamp_);
+  }
+
+ private:
+  // Record one price point of the moving window
+  void PushPrice(double price) {
+    stock_prices_.Add(price);
+    agg_momentum_ = momentum_.Add(price);
+  }
+
+  std::string target_symbol_;
+  double threshold_;
+  int base_shares_;
+  indicators::StreamingRollingWindow stock_prices_;
+  indicators::StreamingMomentum momentum_;
+  double agg_momentum_ = 0;
+  double latest_stock_price_ = 1;
+  uint64_t last_seen_timestamp_ = 1;
+};
+
+#endif  // TRADER_MOMENTUM_STRATEGY_H_
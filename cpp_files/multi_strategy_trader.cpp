@@ -0,0 +1,275 @@
+#include <signal.h>
+
+#include <algorithm>
+
+#include "common/metrics.h"
+#include "trader/cross_sectional_strategy.h"
+#include "trader/gateway_router.h"
+#include "trader/mean_reversion_strategy.h"
+#include "trader/momentum_strategy.h"
+#include "trader/pairs_strategy.h"
+#include "trader/strategy_runner.h"
+#include "trader/trader_config.h"
+
+// Google Command Flags
+/* Setup and identity flags */
+
+DEFINE_string(configuration_path, "/root/vm_config.json",
+              "Read your configuration file from this path");
+DEFINE_string(gateway_ips, "",
+              "Comma separated gateways to spread symbols and orders over "
+              "(default: the gateway in the configuration file)");
+DEFINE_string(gateway_routes, "",
+              "Comma separated symbol:gateway pairs pinning symbols to a "
+              "gateway, by position in gateway_ips; other symbols are "
+              "hashed");
+DEFINE_double(max_order_rate, THROTTLE_MAX_RATE,
+              "Upper bound of the learned order rate per gateway "
+              "(requests per second)");
+DEFINE_string(trader_cores, "",
+              "Low latency: cores to pin the market data, trade confirmation "
+              "and order confirmation threads of each gateway to, in turn "
+              "(e.g. 2-4 for one gateway; -1 leaves a thread unpinned)");
+DEFINE_int32(strategy_core, -1,
+             "Low latency: core to pin the strategy thread to");
+DEFINE_string(journal_path, "",
+              "Record the books and trade reports received to this journal "
+              "(see journal_replayer)");
+DEFINE_string(checkpoint_path, "",
+              "Warm-restart checkpoint: restored on start if present, then "
+              "rewritten every checkpoint_interval seconds");
+DEFINE_int32(checkpoint_interval, 10, "Seconds between checkpoints");
+DEFINE_int32(tick_length, 1,
+             "The basic time unit for moving window (seconds), that means, "
+             "after how much time should we record one point of stock price");
+
+/* Mean reversion flags */
+DEFINE_string(mean_reversion_symbols, "AA",
+              "Comma separated symbols to run mean reversion on");
+DEFINE_int32(mean_reversion_base_shares, 5000,
+             "The base shares for mean reversion traders");
+DEFINE_int32(mean_reversion_moving_window, 5,
+             "The window length (seconds) (for mean reversion)");
+DEFINE_double(mean_reversion_threshold, 5,
+              "The threshold (for mean reversion)");
+
+/* Momentum flags */
+DEFINE_string(momentum_symbols, "",
+              "Comma separated symbols to run momentum on");
+DEFINE_int32(momentum_base_shares, 5000,
+             "The base shares for momentum traders");
+DEFINE_int32(momentum_moving_window, 5,
+             "The window length (seconds) (for momentum)");
+DEFINE_double(momentum_threshold, 2,
+              "The threshold as a percent (for momentum)");
+DEFINE_double(p1, .5, "Weight for previous timestep for momentum traders");
+DEFINE_double(p2, .5, "Weight for two timesteps ago for momentum traders");
+
+/* Pairs trading flags */
+DEFINE_string(pairs, "",
+              "Comma separated target:baseline pairs for pairs trading");
+DEFINE_int32(pairs_base_shares, 5000, "The base shares for pairs traders");
+DEFINE_int32(pairs_moving_window, 5,
+             "The window length in seconds (for pairs trading)");
+DEFINE_double(pairs_threshold, 5, "The threshold (for pairs trading)");
+
+/* Cross-sectional flags */
+DEFINE_int32(cross_section_k, 0,
+             "Buy the k strongest and sell the k weakest of all tradable "
+             "symbols every tick (0 disables)");
+DEFINE_string(cross_section_signal, "reversion",
+              "Cross-sectional score: reversion (z-score against the moving "
+              "average) or momentum (percent return over the window)");
+DEFINE_int32(cross_section_moving_window, 20,
+             "The window length in ticks (for cross-sectional ranking)");
+DEFINE_double(cross_section_threshold, 1,
+              "Smallest absolute score traded (for cross-sectional ranking)");
+DEFINE_int32(cross_section_base_shares, 1000,
+             "The shares per order for cross-sectional ranking");
+
+/* Metrics flags */
+DEFINE_int32(metrics_port, 0,
+             "Serve Prometheus metrics over HTTP on this port (0 disables)");
+DEFINE_string(metrics_address, METRICS_DEFAULT_ADDRESS,
+              "Address --metrics_port listens on (0.0.0.0 for all "
+              "interfaces)");
+DEFINE_string(metrics_file, "",
+              "Write Prometheus metrics to this file instead, for the node "
+              "exporter's textfile collector");
+DEFINE_int32(metrics_interval_ms, 5000,
+             "How often --metrics_file is rewritten (milliseconds)");
+
+// Continuous Execution Indicator
+static volatile bool run = true;
+
+// Catch CTRL-C Exception and Stop Execution
+void SignalHandler(int signal) { run = false; }
+
+int main(int argc, char **argv) {
+  // GFLAGS and GLOG Parsing
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = 1;
+  signal(SIGINT, SignalHandler);
+
+  // Getting VM and CLoudEX config.
+  TraderConfig config;
+  if (!LoadTraderConfig(FLAGS_configuration_path, &config)) {
+    return -1;
+  }
+
+  std::vector<int> trader_cores;
+  if (!ParseCoreList(FLAGS_trader_cores, &trader_cores)) {
+    LOG(ERROR) << "Malformed Core List: " << FLAGS_trader_cores;
+    return -1;
+  }
+
+  // Start redis and flushall before trade object construction.
+  ResetLocalRedis();
+
+  // Outlives the traders that record into it
+  std::unique_ptr<JournalWriter> journal;
+  if (!FLAGS_journal_path.empty()) {
+    journal.reset(new JournalWriter(FLAGS_journal_path));
+    if (!journal->ok()) {
+      return -1;
+    }
+  }
+
+  std::unique_ptr<CheckpointFile> checkpoint;
+  if (!FLAGS_checkpoint_path.empty()) {
+    checkpoint.reset(new CheckpointFile(FLAGS_checkpoint_path));
+    if (!checkpoint->ok()) {
+      return -1;
+    }
+  }
+
+  // One Trader per gateway, with symbols and their order flow spread over
+  // them, and one set of subscriptions for every strategy
+  std::vector<std::string> gateway_ips = SplitFlag(FLAGS_gateway_ips, ',');
+  if (gateway_ips.empty()) gateway_ips.push_back(config.gateway_ip_);
+  std::vector<std::unique_ptr<Trader> > traders;
+  std::vector<Trader *> trader_apis;
+  for (auto &gateway_ip : gateway_ips) {
+    traders.emplace_back(
+        new Trader(gateway_ip, config.client_id_, config.client_token_));
+    trader_apis.push_back(traders.back().get());
+  }
+  GatewayRouter router(trader_apis);
+  for (auto &route : SplitFlag(FLAGS_gateway_routes, ',')) {
+    std::vector<std::string> items = SplitFlag(route, ':');
+    if (items.size() != 2 ||
+        !router.SetRoute(items[0], atoi(items[1].c_str()))) {
+      LOG(ERROR) << "Malformed Gateway Route: " << route;
+      return -1;
+    }
+  }
+
+  router.SetJournal(journal.get());
+
+  ThrottleConfig throttle_config;
+  throttle_config.max_rate_ = FLAGS_max_order_rate;
+  throttle_config.initial_rate_ =
+      std::min(throttle_config.initial_rate_, FLAGS_max_order_rate);
+  router.ConfigThrottle(throttle_config);
+
+  BasicStrategyRunner<GatewayRouter, MeanReversionStrategy, MomentumStrategy,
+                      PairsStrategy, CrossSectionalStrategy>
+      runner(&router);
+  for (auto &symbol : SplitFlag(FLAGS_mean_reversion_symbols, ',')) {
+    runner.Add(MeanReversionStrategy(
+        symbol, FLAGS_mean_reversion_moving_window, FLAGS_tick_length,
+        FLAGS_mean_reversion_threshold, FLAGS_mean_reversion_base_shares));
+  }
+  for (auto &symbol : SplitFlag(FLAGS_momentum_symbols, ',')) {
+    runner.Add(MomentumStrategy(symbol, FLAGS_momentum_moving_window,
+                                FLAGS_tick_length, FLAGS_momentum_threshold,
+                                FLAGS_momentum_base_shares, FLAGS_p1,
+                                FLAGS_p2));
+  }
+  for (auto &pair : SplitFlag(FLAGS_pairs, ',')) {
+    std::vector<std::string> symbols = SplitFlag(pair, ':');
+    if (symbols.size() != 2) {
+      LOG(ERROR) << "Malformed Pair: " << pair;
+      return -1;
+    }
+    runner.Add(PairsStrategy(symbols[0], symbols[1], FLAGS_pairs_moving_window,
+                             FLAGS_tick_length, FLAGS_pairs_threshold,
+                             FLAGS_pairs_base_shares));
+  }
+  if (FLAGS_cross_section_k > 0) {
+    CrossSectionSignal signal;
+    if (FLAGS_cross_section_signal == "reversion") {
+      signal = CrossSectionSignal::reversion;
+    } else if (FLAGS_cross_section_signal == "momentum") {
+      signal = CrossSectionSignal::momentum;
+    } else {
+      LOG(ERROR) << "Unknown Cross Section Signal: "
+                 << FLAGS_cross_section_signal;
+      return -1;
+    }
+    runner.Add(CrossSectionalStrategy(
+        trader_apis[0]->GetSymbols(), FLAGS_cross_section_moving_window,
+        FLAGS_tick_length, signal, FLAGS_cross_section_k,
+        FLAGS_cross_section_threshold, FLAGS_cross_section_base_shares));
+  }
+  // Before Start, so the ingest threads it starts are placed from their
+  // first message on
+  if (!trader_cores.empty() && !router.PinThreads(trader_cores)) {
+    LOG(ERROR) << "Failed to Pin Trader Threads";
+  }
+  // Order logs are formatted off the trading thread, stamped in trading time
+  AsyncLogger::Get()->SetClock(router.clock());
+  AsyncLogger::Get()->Start();
+  if (!runner.Start()) {
+    LOG(ERROR) << "Failed to Configure Active Symbols";
+    AsyncLogger::Get()->Stop();
+    return -1;
+  }
+  // Right after the ingest thread starts; saved books and trades older than
+  // the live ones already received are dropped
+  if (checkpoint) {
+    StateReconciliation reconciliation;
+    if (runner.RestoreCheckpoint(checkpoint.get(), &reconciliation)) {
+      for (auto &change : reconciliation.position_changes_) {
+        LOG(INFO) << "Position of " << change.first << " Changed by "
+                  << change.second << " Since Checkpoint";
+      }
+    }
+    runner.SetCheckpoint(checkpoint.get(), FLAGS_checkpoint_interval);
+  }
+  if (!FLAGS_metrics_file.empty()) {
+    MetricsRegistry::Get()->StartFileExport(FLAGS_metrics_file,
+                                            FLAGS_metrics_interval_ms);
+  } else if (FLAGS_metrics_port > 0 &&
+             !MetricsRegistry::Get()->StartHttp(FLAGS_metrics_port,
+                                                FLAGS_metrics_address)) {
+    LOG(ERROR) << "Failed to Start Metrics Endpoint";
+  }
+  // Last, so the helper threads started above do not inherit the core
+  if (FLAGS_strategy_core >= 0 && !PinCurrentThread(FLAGS_strategy_core)) {
+    LOG(ERROR) << "Failed to Pin Strategy Thread";
+  }
+  runner.Run(&run);
+  if (checkpoint) {
+    runner.SaveCheckpoint(checkpoint.get());
+  }
+  MetricsRegistry::Get()->Stop();
+  AsyncLogger::Get()->Stop();
+  for (size_t i = 0; i < router.num_gateways(); i++) {
+    GatewayStats stats = router.GetGatewayStats(i);
+    LOG(INFO) << "Gateway " << gateway_ips[i] << ": " << stats.num_symbols_
+              << " Symbols, " << stats.orders_ << " Requests, "
+              << stats.errors_ << " Errors, " << stats.failovers_
+              << " Failovers";
+    ThrottleStats throttle = router.GetThrottleStats(i);
+    LOG(INFO) << "Gateway " << gateway_ips[i] << " Throttle: Rate "
+              << throttle.rate_ << "/s, Learned Window "
+              << throttle.learned_limit_ << "/s, "
+              << throttle.window_exceeded_ << " Window Exceeded, "
+              << throttle.dropped_ << " Dropped, " << throttle.superseded_
+              << " Superseded";
+  }
+
+  traders.clear();
+}
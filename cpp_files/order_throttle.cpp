@@ -0,0 +1,113 @@
+#include "trader/order_throttle.h"
+
+#include <algorithm>
+
+OrderThrottle::OrderThrottle(Clock *clock, const ThrottleConfig &config)
+    : clock_(clock),
+      config_(config),
+      rate_(config.initial_rate_),
+      tokens_(config.burst_),
+      last_refill_(clock->Now()) {}
+
+void OrderThrottle::Refill(uint64_t now) {
+  if (now > last_refill_) {
+    tokens_ = std::min(config_.burst_,
+                       tokens_ + (now - last_refill_) * rate_ / 1e6);
+  }
+  last_refill_ = std::max(last_refill_, now);
+}
+
+bool OrderThrottle::Acquire(ThrottlePriority priority,
+                            const std::string &key) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  bool cancel = priority == ThrottlePriority::cancel;
+  uint64_t ticket = ++next_ticket_;
+  if (cancel) {
+    waiting_cancels_++;
+  } else {
+    waiting_orders_[key] = ticket;
+  }
+  uint64_t start = clock_->Now();
+  bool acquired = false;
+  while (true) {
+    uint64_t now = clock_->Now();
+    Refill(now);
+    if (!cancel && waiting_orders_[key] != ticket) {
+      stats_.superseded_++;
+      break;
+    }
+    if (tokens_ >= 1 && (cancel || waiting_cancels_ == 0)) {
+      tokens_ -= 1;
+      stats_.sent_++;
+      acquired = true;
+      break;
+    }
+    // Until the next token, or a token's time while cancels go first
+    uint64_t wait = static_cast<uint64_t>(
+        std::max(1 - tokens_, 1e-3) / rate_ * 1e6) + 1;
+    if (!cancel && now + wait - start > config_.max_order_wait_) {
+      stats_.dropped_++;
+      break;
+    }
+    // Reset may switch clocks while the lock is released
+    Clock *clock = clock_;
+    lock.unlock();
+    clock->SleepUntil(now + wait);
+    lock.lock();
+  }
+  stats_.wait_time_ += std::max(clock_->Now(), start) - start;
+  if (cancel) {
+    waiting_cancels_--;
+  } else if (waiting_orders_[key] == ticket) {
+    waiting_orders_.erase(key);
+  }
+  return acquired;
+}
+
+void OrderThrottle::OnResult(OrderResult result) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  switch (result) {
+    case OrderResult::window_exceeed:
+      stats_.window_exceeded_++;
+      stats_.learned_limit_ = stats_.learned_limit_ == 0
+                                  ? rate_
+                                  : (stats_.learned_limit_ + rate_) / 2;
+      rate_ = std::max(config_.min_rate_, rate_ * THROTTLE_DECREASE);
+      tokens_ = 0;
+      break;
+    case OrderResult::in_gateway:
+      rate_ = std::max(config_.min_rate_,
+                       rate_ * THROTTLE_CONGESTION_DECREASE);
+      break;
+    case OrderResult::error:
+    case OrderResult::network_error:
+      // Says nothing about the window
+      break;
+    default: {
+      double increase = config_.additive_increase_ / rate_;
+      if (stats_.learned_limit_ > 0 &&
+          rate_ >= 0.9 * stats_.learned_limit_) {
+        increase /= 10;
+      }
+      rate_ = std::min(config_.max_rate_, rate_ + increase);
+      break;
+    }
+  }
+}
+
+void OrderThrottle::Reset(Clock *clock, const ThrottleConfig &config) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  clock_ = clock;
+  config_ = config;
+  rate_ = config.initial_rate_;
+  tokens_ = config.burst_;
+  last_refill_ = clock->Now();
+  stats_ = ThrottleStats();
+}
+
+ThrottleStats OrderThrottle::stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ThrottleStats stats = stats_;
+  stats.rate_ = rate_;
+  return stats;
+}
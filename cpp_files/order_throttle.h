@@ -0,0 +1,98 @@
+#ifndef TRADER_ORDER_THROTTLE_H_
+#define TRADER_ORDER_THROTTLE_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "common/clock.h"
+#include "common/message_primitives.h"
+
+// Defaults of ThrottleConfig, in requests per second unless noted
+#define THROTTLE_INITIAL_RATE 50
+#define THROTTLE_MIN_RATE 1
+#define THROTTLE_MAX_RATE 10000
+#define THROTTLE_BURST 10             // Requests
+#define THROTTLE_MAX_ORDER_WAIT 50000  // Microseconds
+// Rate gained per second's worth of accepted requests
+#define THROTTLE_ADDITIVE_INCREASE 20
+// Rate multipliers on a window_exceeed and an in_gateway result
+#define THROTTLE_DECREASE 0.5
+#define THROTTLE_CONGESTION_DECREASE 0.9
+
+enum class ThrottlePriority { cancel, order };
+
+class ThrottleConfig {
+ public:
+  double initial_rate_ = THROTTLE_INITIAL_RATE;
+  double min_rate_ = THROTTLE_MIN_RATE;
+  double max_rate_ = THROTTLE_MAX_RATE;
+  double burst_ = THROTTLE_BURST;
+  double additive_increase_ = THROTTLE_ADDITIVE_INCREASE;
+  // An order that would wait longer is dropped without being sent
+  uint64_t max_order_wait_ = THROTTLE_MAX_ORDER_WAIT;
+};
+
+class ThrottleStats {
+ public:
+  double rate_ = 0;           // Current allowed rate
+  double learned_limit_ = 0;  // Estimated gateway window, 0 until rejected
+  uint64_t sent_ = 0;
+  uint64_t window_exceeded_ = 0;  // Rejected by the gateway for rate
+  uint64_t dropped_ = 0;          // Orders not sent, waiting too long
+  uint64_t superseded_ = 0;       // Orders replaced by a newer one
+  uint64_t wait_time_ = 0;        // Total microseconds spent waiting
+};
+
+// Client-side rate limit of the requests sent to one gateway: a token
+// bucket whose rate follows additive increase, multiplicative decrease.
+// Every accepted request raises the rate a little; a window_exceeed halves
+// it and empties the bucket, and an in_gateway (the gateway queueing)
+// lowers it gently. The rates at which the gateway rejected are averaged
+// into learned_limit_, and near it the rate grows ten times slower, so it
+// settles just under the gateway's window instead of oscillating across it.
+//
+// Cancels come first: no order takes a token while a cancel waits, and
+// cancels always wait for one. An order that would wait longer than
+// max_order_wait_ is dropped instead of spending a round trip on a likely
+// rejection, and an order still waiting when a newer one with the same key
+// (say, symbol and side) arrives is dropped in favour of the newer one.
+// Waits go through the clock, so simulated clocks do not block.
+class OrderThrottle {
+ public:
+  explicit OrderThrottle(Clock *clock,
+                         const ThrottleConfig &config = ThrottleConfig());
+
+  // Wait until a request may be sent. Returns false if an order was
+  // dropped; it must not be sent.
+  bool Acquire(ThrottlePriority priority, const std::string &key);
+
+  // Adjust the rate to the gateway's answer to a sent request
+  void OnResult(OrderResult result);
+
+  // Switch to clock and config and start learning the window afresh.
+  // Requests already waiting keep their place.
+  void Reset(Clock *clock, const ThrottleConfig &config);
+
+  ThrottleStats stats();
+
+ private:
+  // Add the tokens accrued since the last refill
+  void Refill(uint64_t now);
+
+  Clock *clock_;
+  ThrottleConfig config_;
+  std::mutex mutex_;
+  double rate_;
+  double tokens_;
+  uint64_t last_refill_;
+  int waiting_cancels_ = 0;
+  // Newest waiting order of each key
+  std::map<std::string, uint64_t> waiting_orders_;
+  uint64_t next_ticket_ = 0;
+  ThrottleStats stats_;
+};
+
+#endif  // TRADER_ORDER_THROTTLE_H_
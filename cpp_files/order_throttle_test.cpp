@@ -0,0 +1,147 @@
+#include "trader/order_throttle.h"
+
+#include <gtest/gtest.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// A SimulatedClock whose sleepers wait for the test to move time, so the
+// order in which waiting requests are served is up to the throttle alone
+class SteppedClock : public SimulatedClock {
+ public:
+  void SleepUntil(uint64_t timestamp) override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    sleepers_++;
+    cond_.notify_all();
+    cond_.wait(lock, [&]() { return Now() >= timestamp; });
+    sleepers_--;
+  }
+
+  void WaitForSleepers(int count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [&]() { return sleepers_ >= count; });
+  }
+
+  void Step(uint64_t timestamp) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      AdvanceTo(timestamp);
+    }
+    cond_.notify_all();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  int sleepers_ = 0;
+};
+
+// One token, then one every 100ms
+ThrottleConfig SlowConfig() {
+  ThrottleConfig config;
+  config.initial_rate_ = 10;
+  config.burst_ = 1;
+  config.max_order_wait_ = 1000000;
+  return config;
+}
+
+TEST(OrderThrottleTest, WaitsForTokensAndDropsLongWaits) {
+  SimulatedClock clock;
+  ThrottleConfig config = SlowConfig();
+  config.max_order_wait_ = 50000;
+  OrderThrottle throttle(&clock, config);
+  EXPECT_TRUE(throttle.Acquire(ThrottlePriority::order, "AAB"));
+  EXPECT_EQ(clock.Now(), 0u);
+  // The next token is 100ms away, past the longest order wait
+  EXPECT_FALSE(throttle.Acquire(ThrottlePriority::order, "AAB"));
+  EXPECT_EQ(clock.Now(), 0u);
+  // Cancels wait as long as it takes
+  EXPECT_TRUE(throttle.Acquire(ThrottlePriority::cancel, "G1_C3_1"));
+  EXPECT_GE(clock.Now(), 100000u);
+  ThrottleStats stats = throttle.stats();
+  EXPECT_EQ(stats.sent_, 2u);
+  EXPECT_EQ(stats.dropped_, 1u);
+  EXPECT_EQ(stats.wait_time_, clock.Now());
+}
+
+TEST(OrderThrottleTest, RateFollowsGatewayAnswers) {
+  SimulatedClock clock;
+  OrderThrottle throttle(&clock, SlowConfig());
+  throttle.OnResult(OrderResult::window_exceeed);
+  ThrottleStats stats = throttle.stats();
+  EXPECT_DOUBLE_EQ(stats.rate_, 5);
+  EXPECT_DOUBLE_EQ(stats.learned_limit_, 10);
+  EXPECT_EQ(stats.window_exceeded_, 1u);
+  throttle.OnResult(OrderResult::valid);
+  EXPECT_GT(throttle.stats().rate_, 5);
+  // Failures say nothing about the window
+  double rate = throttle.stats().rate_;
+  throttle.OnResult(OrderResult::network_error);
+  EXPECT_EQ(throttle.stats().rate_, rate);
+
+  throttle.Reset(&clock, SlowConfig());
+  stats = throttle.stats();
+  EXPECT_DOUBLE_EQ(stats.rate_, 10);
+  EXPECT_EQ(stats.learned_limit_, 0);
+  EXPECT_EQ(stats.window_exceeded_, 0u);
+}
+
+TEST(OrderThrottleTest, WaitingCancelGoesBeforeOrders) {
+  SteppedClock clock;
+  OrderThrottle throttle(&clock, SlowConfig());
+  ASSERT_TRUE(throttle.Acquire(ThrottlePriority::order, "AAB"));
+
+  std::mutex done_mutex;
+  std::vector<std::string> done;
+  auto acquire = [&](ThrottlePriority priority, const std::string &key) {
+    EXPECT_TRUE(throttle.Acquire(priority, key));
+    std::lock_guard<std::mutex> lock(done_mutex);
+    done.push_back(key);
+  };
+  std::thread cancel(acquire, ThrottlePriority::cancel, "G1_C3_1");
+  clock.WaitForSleepers(1);
+  std::thread order(acquire, ThrottlePriority::order, "ABS");
+  clock.WaitForSleepers(2);
+
+  // One token: the cancel's, though the order waits for it too
+  clock.Step(100001);
+  cancel.join();
+  {
+    std::lock_guard<std::mutex> lock(done_mutex);
+    EXPECT_EQ(done, std::vector<std::string>({"G1_C3_1"}));
+  }
+  clock.Step(300000);
+  order.join();
+  EXPECT_EQ(done, std::vector<std::string>({"G1_C3_1", "ABS"}));
+  EXPECT_EQ(throttle.stats().sent_, 3u);
+}
+
+TEST(OrderThrottleTest, NewerOrderOfSameKeyReplacesWaitingOne) {
+  SteppedClock clock;
+  OrderThrottle throttle(&clock, SlowConfig());
+  ASSERT_TRUE(throttle.Acquire(ThrottlePriority::order, "AAB"));
+
+  bool older_sent = true;
+  bool newer_sent = false;
+  std::thread older(
+      [&]() { older_sent = throttle.Acquire(ThrottlePriority::order, "AAB"); });
+  clock.WaitForSleepers(1);
+  std::thread newer(
+      [&]() { newer_sent = throttle.Acquire(ThrottlePriority::order, "AAB"); });
+  clock.WaitForSleepers(2);
+  clock.Step(100001);
+  older.join();
+  newer.join();
+  EXPECT_FALSE(older_sent);
+  EXPECT_TRUE(newer_sent);
+  ThrottleStats stats = throttle.stats();
+  EXPECT_EQ(stats.superseded_, 1u);
+  EXPECT_EQ(stats.sent_, 2u);
+}
+
+}  // namespace
@@ -0,0 +1,327 @@
+#include "trader/pair_matrix.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define PAIR_MATRIX_HAVE_AVX2 1
+#endif
+
+namespace {
+
+const double kNaN = std::numeric_limits<double>::quiet_NaN();
+
+// Row kernels over the columns [0, n), n a multiple of 4, scalar and AVX2
+// as in indicators.cpp
+
+// row += a * x
+void ScalarAxpy(double *row, double a, const double *x, size_t n) {
+  for (size_t j = 0; j < n; j++) {
+    row[j] += a * x[j];
+  }
+}
+
+// Correlation and spread z-score of symbol i against every column, from the
+// cross-product sums row of i
+void ScalarDerive(const double *row, double inv_window, double mean_i,
+                  double var_i, double added_i, const double *means,
+                  const double *variances, const double *added, size_t n,
+                  double *correlations, double *zscores) {
+  for (size_t j = 0; j < n; j++) {
+    double cov = row[j] * inv_window - mean_i * means[j];
+    double var_product = var_i * variances[j];
+    correlations[j] = var_product > 0 ? cov / sqrt(var_product) : kNaN;
+    double spread_var = var_i + variances[j] - 2 * cov;
+    zscores[j] = spread_var > 0 ? ((added_i - added[j]) - (mean_i - means[j])) /
+                                      sqrt(spread_var)
+                                : kNaN;
+  }
+}
+
+#ifdef PAIR_MATRIX_HAVE_AVX2
+
+__attribute__((target("avx2"))) void Avx2Axpy(double *row, double a,
+                                              const double *x, size_t n) {
+  const __m256d scale = _mm256_set1_pd(a);
+  for (size_t j = 0; j < n; j += 4) {
+    __m256d sum = _mm256_add_pd(_mm256_loadu_pd(row + j),
+                                _mm256_mul_pd(scale, _mm256_loadu_pd(x + j)));
+    _mm256_storeu_pd(row + j, sum);
+  }
+}
+
+__attribute__((target("avx2"))) void Avx2Derive(
+    const double *row, double inv_window, double mean_i, double var_i,
+    double added_i, const double *means, const double *variances,
+    const double *added, size_t n, double *correlations, double *zscores) {
+  const __m256d scale = _mm256_set1_pd(inv_window);
+  const __m256d mean = _mm256_set1_pd(mean_i);
+  const __m256d var = _mm256_set1_pd(var_i);
+  const __m256d price = _mm256_set1_pd(added_i);
+  const __m256d two = _mm256_set1_pd(2);
+  const __m256d zero = _mm256_setzero_pd();
+  const __m256d nan = _mm256_set1_pd(kNaN);
+  for (size_t j = 0; j < n; j += 4) {
+    __m256d means_j = _mm256_loadu_pd(means + j);
+    __m256d vars_j = _mm256_loadu_pd(variances + j);
+    __m256d cov = _mm256_sub_pd(_mm256_mul_pd(_mm256_loadu_pd(row + j), scale),
+                                _mm256_mul_pd(mean, means_j));
+    __m256d var_product = _mm256_mul_pd(var, vars_j);
+    __m256d correlation =
+        _mm256_div_pd(cov, _mm256_sqrt_pd(_mm256_max_pd(var_product, zero)));
+    _mm256_storeu_pd(correlations + j,
+                     _mm256_blendv_pd(nan, correlation,
+                                      _mm256_cmp_pd(var_product, zero,
+                                                    _CMP_GT_OQ)));
+    __m256d spread_var = _mm256_sub_pd(_mm256_add_pd(var, vars_j),
+                                       _mm256_mul_pd(two, cov));
+    __m256d deviation = _mm256_sub_pd(
+        _mm256_sub_pd(price, _mm256_loadu_pd(added + j)),
+        _mm256_sub_pd(mean, means_j));
+    __m256d zscore = _mm256_div_pd(
+        deviation, _mm256_sqrt_pd(_mm256_max_pd(spread_var, zero)));
+    _mm256_storeu_pd(zscores + j,
+                     _mm256_blendv_pd(nan, zscore,
+                                      _mm256_cmp_pd(spread_var, zero,
+                                                    _CMP_GT_OQ)));
+  }
+}
+
+#endif
+
+struct Kernels {
+  void (*axpy)(double *, double, const double *, size_t);
+  void (*derive)(const double *, double, double, double, double,
+                 const double *, const double *, const double *, size_t,
+                 double *, double *);
+};
+
+const Kernels kScalarKernels = {ScalarAxpy, ScalarDerive};
+
+#ifdef PAIR_MATRIX_HAVE_AVX2
+const Kernels kAvx2Kernels = {Avx2Axpy, Avx2Derive};
+#endif
+
+const Kernels *SelectKernels() {
+#ifdef PAIR_MATRIX_HAVE_AVX2
+  if (__builtin_cpu_supports("avx2")) return &kAvx2Kernels;
+#endif
+  return &kScalarKernels;
+}
+
+const Kernels *active_kernels = SelectKernels();
+
+}  // namespace
+
+PairMatrixEngine::PairMatrixEngine(size_t num_symbols, size_t window,
+                                   int num_threads)
+    : num_symbols_(num_symbols),
+      stride_((num_symbols + 3) & ~static_cast<size_t>(3)),
+      window_(std::max<size_t>(window, 2)),
+      history_(window_ * stride_, 0),
+      anchors_(stride_, 0),
+      added_(stride_, 0),
+      removed_(stride_, 0),
+      sums_(stride_, 0),
+      means_(stride_, 0),
+      variances_(stride_, 0),
+      last_gaps_(num_symbols, 0),
+      cross_sums_(num_symbols * stride_, kNaN),
+      correlations_(num_symbols * stride_, kNaN),
+      zscores_(num_symbols * stride_, kNaN) {
+  // Gaps until the window has filled once
+  for (size_t r = 0; r < window_; r++) {
+    std::fill_n(&history_[r * stride_], num_symbols_, kNaN);
+  }
+  for (int i = 1; i < num_threads; i++) {
+    workers_.emplace_back(&PairMatrixEngine::WorkerFunc, this);
+  }
+}
+
+PairMatrixEngine::~PairMatrixEngine() {
+  {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    stop_ = true;
+  }
+  work_ready_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+void PairMatrixEngine::Update(const double *prices) {
+  double *row = &history_[next_ * stride_];
+  count_++;
+  bool gap_left = false;
+  for (size_t i = 0; i < num_symbols_; i++) {
+    double price = prices[i] > 0 ? log(prices[i]) : kNaN;
+    removed_[i] = row[i] - anchors_[i];
+    added_[i] = price - anchors_[i];
+    row[i] = price;
+    if (std::isnan(price)) last_gaps_[i] = count_;
+    gap_left |= last_gaps_[i] != 0 && last_gaps_[i] + window_ == count_;
+  }
+  next_ = (next_ + 1) % window_;
+
+  double inv_window = 1.0 / window_;
+  if (next_ != 0 && !gap_left) {
+    // The diagonal of the cross sums gives the variances; update it here
+    // exactly as UpdateRows will, so every row sees the new variances
+    for (size_t i = 0; i < num_symbols_; i++) {
+      double square = cross_sums_[i * stride_ + i] + added_[i] * added_[i] -
+                      removed_[i] * removed_[i];
+      sums_[i] += added_[i] - removed_[i];
+      means_[i] = sums_[i] * inv_window;
+      variances_[i] = square * inv_window - means_[i] * means_[i];
+    }
+    RunBlocks(Task::update);
+    return;
+  }
+
+  // Once per window, or once a gap has left it: centre on the newest prices
+  // and rebuild the sums
+  for (size_t i = 0; i < num_symbols_; i++) {
+    if (!std::isnan(row[i])) anchors_[i] = row[i];
+    added_[i] = row[i] - anchors_[i];
+  }
+  std::fill(sums_.begin(), sums_.end(), 0);
+  std::fill(variances_.begin(), variances_.end(), 0);
+  for (size_t r = 0; r < window_; r++) {
+    double *centred = &history_[r * stride_];
+    for (size_t i = 0; i < num_symbols_; i++) {
+      centred[i] -= anchors_[i];
+      sums_[i] += centred[i];
+      variances_[i] += centred[i] * centred[i];
+    }
+  }
+  for (size_t i = 0; i < num_symbols_; i++) {
+    means_[i] = sums_[i] * inv_window;
+    variances_[i] = variances_[i] * inv_window - means_[i] * means_[i];
+  }
+  RunBlocks(Task::recompute);
+  // History holds log prices again
+  for (size_t r = 0; r < window_; r++) {
+    double *centred = &history_[r * stride_];
+    for (size_t i = 0; i < num_symbols_; i++) {
+      centred[i] += anchors_[i];
+    }
+  }
+}
+
+void PairMatrixEngine::RunBlocks(Task task) {
+  if (workers_.empty()) {
+    next_block_.store(0);
+    ProcessBlocks(task);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    task_ = task;
+    next_block_.store(0);
+    workers_done_ = 0;
+    generation_++;
+  }
+  work_ready_.notify_all();
+  ProcessBlocks(task);
+  std::unique_lock<std::mutex> lock(pool_mutex_);
+  work_done_.wait(lock, [this]() {
+    return workers_done_ == static_cast<int>(workers_.size());
+  });
+}
+
+void PairMatrixEngine::ProcessBlocks(Task task) {
+  size_t num_blocks =
+      (num_symbols_ + PAIR_MATRIX_BLOCK_ROWS - 1) / PAIR_MATRIX_BLOCK_ROWS;
+  for (size_t block = next_block_++; block < num_blocks;
+       block = next_block_++) {
+    size_t begin = block * PAIR_MATRIX_BLOCK_ROWS;
+    size_t end = std::min(begin + PAIR_MATRIX_BLOCK_ROWS, num_symbols_);
+    if (task == Task::update) {
+      UpdateRows(begin, end);
+    } else {
+      RecomputeRows(begin, end);
+    }
+  }
+}
+
+void PairMatrixEngine::WorkerFunc() {
+  uint64_t seen = 0;
+  while (true) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(pool_mutex_);
+      work_ready_.wait(lock,
+                       [this, seen]() { return stop_ || generation_ != seen; });
+      if (stop_) return;
+      seen = generation_;
+      task = task_;
+    }
+    ProcessBlocks(task);
+    {
+      std::lock_guard<std::mutex> lock(pool_mutex_);
+      workers_done_++;
+    }
+    work_done_.notify_one();
+  }
+}
+
+void PairMatrixEngine::UpdateRows(size_t begin, size_t end) {
+  for (size_t i = begin; i < end; i++) {
+    double *row = &cross_sums_[i * stride_];
+    active_kernels->axpy(row, added_[i], added_.data(), stride_);
+    active_kernels->axpy(row, -removed_[i], removed_.data(), stride_);
+    DeriveRow(i);
+  }
+}
+
+void PairMatrixEngine::RecomputeRows(size_t begin, size_t end) {
+  for (size_t i = begin; i < end; i++) {
+    double *row = &cross_sums_[i * stride_];
+    std::fill_n(row, stride_, 0);
+    for (size_t r = 0; r < window_; r++) {
+      const double *centred = &history_[r * stride_];
+      active_kernels->axpy(row, centred[i], centred, stride_);
+    }
+    DeriveRow(i);
+  }
+}
+
+void PairMatrixEngine::DeriveRow(size_t i) {
+  active_kernels->derive(&cross_sums_[i * stride_], 1.0 / window_, means_[i],
+                         variances_[i], added_[i], means_.data(),
+                         variances_.data(), added_.data(), stride_,
+                         &correlations_[i * stride_], &zscores_[i * stride_]);
+}
+
+double PairMatrixEngine::covariance(size_t i, size_t j) const {
+  return cross_sums_[i * stride_ + j] / window_ - means_[i] * means_[j];
+}
+
+void PairMatrixEngine::TopPairs(size_t k, double min_correlation,
+                                double min_zscore,
+                                std::vector<PairScore> *pairs) const {
+  pairs->clear();
+  for (size_t i = 0; i < num_symbols_; i++) {
+    const double *correlations = &correlations_[i * stride_];
+    const double *zscores = &zscores_[i * stride_];
+    for (size_t j = i + 1; j < num_symbols_; j++) {
+      // NaN fails both comparisons
+      if (correlations[j] >= min_correlation &&
+          fabs(zscores[j]) >= min_zscore) {
+        pairs->push_back({static_cast<int>(i), static_cast<int>(j),
+                          correlations[j], zscores[j]});
+      }
+    }
+  }
+  auto stronger = [](const PairScore &a, const PairScore &b) {
+    return fabs(a.zscore_) > fabs(b.zscore_);
+  };
+  size_t num_pairs = std::min(k, pairs->size());
+  std::nth_element(pairs->begin(), pairs->begin() + num_pairs, pairs->end(),
+                   stronger);
+  pairs->resize(num_pairs);
+  std::sort(pairs->begin(), pairs->end(), stronger);
+}
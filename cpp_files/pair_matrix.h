@@ -0,0 +1,114 @@
+#ifndef TRADER_PAIR_MATRIX_H_
+#define TRADER_PAIR_MATRIX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Rows of the pair matrices handed to a thread at a time
+#define PAIR_MATRIX_BLOCK_ROWS 16
+
+// Statistics of one pair, on log prices over the window
+class PairScore {
+ public:
+  int first_;  // Symbol indices, first_ < second_
+  int second_;
+  double correlation_;
+  // z-score of the spread log(first) - log(second) against its rolling
+  // mean; positive when first is rich relative to second
+  double zscore_;
+};
+
+// Rolling covariance, correlation and spread z-score of every pair of a
+// universe of symbols, on log prices over the last window updates. All of
+// them follow from the per-symbol sums and the matrix of cross-product sums
+// over the window, so an update changes that matrix by the newest row of
+// prices minus the one leaving the window, a rank-2 update, and rederives
+// each pair's statistics in the same pass: O(N^2) per update instead of
+// O(W N^2) for recomputing the pairs. The matrices are processed in blocks
+// of PAIR_MATRIX_BLOCK_ROWS rows, shared out among num_threads threads
+// (the caller's plus a pool kept for the engine's lifetime), and each row
+// runs AVX2 kernels when the CPU has them, as in indicators.h.
+//
+// Prices are centred on a recent price of each symbol before the sums are
+// taken, and the sums are rebuilt from the window once per window, so
+// rounding does not build up. Missing prices are passed as NaN; pairs with
+// a gap in the window have NaN statistics and are never selected, and the
+// sums are rebuilt as soon as the gap has left the window.
+class PairMatrixEngine {
+ public:
+  PairMatrixEngine(size_t num_symbols, size_t window, int num_threads = 1);
+  ~PairMatrixEngine();
+
+  // Add the prices of one period, one per symbol, and update every pair
+  void Update(const double *prices);
+
+  size_t size() const { return num_symbols_; }
+  bool ready() const { return count_ >= window_; }
+
+  double covariance(size_t i, size_t j) const;
+  double correlation(size_t i, size_t j) const {
+    return correlations_[i * stride_ + j];
+  }
+  double zscore(size_t i, size_t j) const { return zscores_[i * stride_ + j]; }
+
+  // Up to k pairs with correlation of at least min_correlation and an
+  // absolute spread z-score of at least min_zscore, largest |z| first
+  void TopPairs(size_t k, double min_correlation, double min_zscore,
+                std::vector<PairScore> *pairs) const;
+
+ private:
+  enum class Task { update, recompute };
+
+  // Run task over all row blocks on the caller and the pool
+  void RunBlocks(Task task);
+  // Claim and process blocks until none are left
+  void ProcessBlocks(Task task);
+  void UpdateRows(size_t begin, size_t end);
+  void RecomputeRows(size_t begin, size_t end);
+  // Derive the correlation and z-score row i from the sums
+  void DeriveRow(size_t i);
+  void WorkerFunc();
+
+  size_t num_symbols_;
+  size_t stride_;  // Row length of the matrices, a multiple of 4
+  size_t window_;
+  std::vector<double> history_;  // window_ rows of log prices
+  size_t next_ = 0;              // Row the next update overwrites
+  uint64_t count_ = 0;
+
+  // Per symbol, over stride_ entries: centring offset, centred newest
+  // price (added) and price leaving the window (removed), sums, means and
+  // variances
+  std::vector<double> anchors_;
+  std::vector<double> added_;
+  std::vector<double> removed_;
+  std::vector<double> sums_;
+  std::vector<double> means_;
+  std::vector<double> variances_;
+  std::vector<uint64_t> last_gaps_;  // Update count of each one's last NaN
+
+  // num_symbols_ rows of stride_: cross-product sums and derived statistics
+  std::vector<double> cross_sums_;
+  std::vector<double> correlations_;
+  std::vector<double> zscores_;
+
+  // Worker pool. Each RunBlocks bumps generation_; workers claim blocks
+  // through next_block_ and count themselves out in workers_done_.
+  std::vector<std::thread> workers_;
+  std::mutex pool_mutex_;
+  std::condition_variable work_ready_;
+  std::condition_variable work_done_;
+  uint64_t generation_ = 0;
+  int workers_done_ = 0;
+  bool stop_ = false;
+  Task task_ = Task::update;
+  std::atomic<size_t> next_block_{0};
+};
+
+#endif  // TRADER_PAIR_MATRIX_H_
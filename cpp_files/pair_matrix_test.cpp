@@ -0,0 +1,110 @@
+#include "trader/pair_matrix.h"
+
+#include <gtest/gtest.h>
+#include <math.h>
+
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+
+const double kNaN = std::numeric_limits<double>::quiet_NaN();
+
+// Statistics of a pair recomputed from the window of log prices
+class BruteForcePair {
+ public:
+  BruteForcePair(const std::vector<std::vector<double> > &rows, size_t end,
+                 size_t window, size_t i, size_t j) {
+    double mean_i = 0, mean_j = 0, mean_spread = 0;
+    for (size_t r = end - window; r < end; r++) {
+      mean_i += log(rows[r][i]);
+      mean_j += log(rows[r][j]);
+    }
+    mean_i /= window;
+    mean_j /= window;
+    mean_spread = mean_i - mean_j;
+    double var_i = 0, var_j = 0, cov = 0, var_spread = 0;
+    for (size_t r = end - window; r < end; r++) {
+      double x = log(rows[r][i]) - mean_i;
+      double y = log(rows[r][j]) - mean_j;
+      var_i += x * x;
+      var_j += y * y;
+      cov += x * y;
+      var_spread += (x - y) * (x - y);
+    }
+    correlation_ = cov / sqrt(var_i * var_j);
+    double spread = log(rows[end - 1][i]) - log(rows[end - 1][j]);
+    zscore_ = (spread - mean_spread) / sqrt(var_spread / window);
+  }
+
+  double correlation_;
+  double zscore_;
+};
+
+// Correlated random walks on prices far apart in level
+std::vector<std::vector<double> > Walks(size_t num_symbols, size_t n) {
+  std::mt19937_64 rng(11);
+  std::normal_distribution<double> market(0, 0.002);
+  std::normal_distribution<double> own(0, 0.001);
+  std::vector<std::vector<double> > rows;
+  std::vector<double> prices(num_symbols);
+  for (size_t i = 0; i < num_symbols; i++) prices[i] = 10.0 * (i + 1);
+  for (size_t t = 0; t < n; t++) {
+    double common = market(rng);
+    for (auto &price : prices) price *= exp(common + own(rng));
+    rows.push_back(prices);
+  }
+  return rows;
+}
+
+void ExpectMatchesBruteForce(int num_threads) {
+  // Not a multiple of the AVX2 width nor of the block rows
+  const size_t num_symbols = 37;
+  const size_t window = 15;
+  std::vector<std::vector<double> > rows = Walks(num_symbols, 400);
+  PairMatrixEngine engine(num_symbols, window, num_threads);
+  for (size_t t = 0; t < rows.size(); t++) {
+    engine.Update(rows[t].data());
+    if (!engine.ready()) continue;
+    for (size_t i = 0; i < num_symbols; i++) {
+      for (size_t j = i + 1; j < num_symbols; j++) {
+        BruteForcePair exact(rows, t + 1, window, i, j);
+        ASSERT_NEAR(engine.correlation(i, j), exact.correlation_, 1e-6)
+            << t << " " << i << " " << j;
+        ASSERT_NEAR(engine.zscore(i, j), exact.zscore_, 1e-5)
+            << t << " " << i << " " << j;
+      }
+    }
+  }
+}
+
+TEST(PairMatrixEngineTest, IncrementalMatchesBruteForce) {
+  ExpectMatchesBruteForce(1);
+}
+
+TEST(PairMatrixEngineTest, IncrementalMatchesBruteForceOnThreads) {
+  ExpectMatchesBruteForce(3);
+}
+
+TEST(PairMatrixEngineTest, GapsHideOnlyTheirPairsUntilTheyLeave) {
+  const size_t window = 6;
+  std::vector<std::vector<double> > rows = Walks(3, 30);
+  PairMatrixEngine engine(3, window);
+  for (size_t t = 0; t < rows.size(); t++) {
+    std::vector<double> prices = rows[t];
+    if (t == 10) prices[2] = kNaN;
+    engine.Update(prices.data());
+    if (!engine.ready()) continue;
+    bool gap = t >= 10 && t < 10 + window;
+    EXPECT_EQ(std::isnan(engine.correlation(0, 2)), gap) << t;
+    EXPECT_EQ(std::isnan(engine.zscore(1, 2)), gap) << t;
+    EXPECT_FALSE(std::isnan(engine.correlation(0, 1))) << t;
+    if (!gap) {
+      BruteForcePair exact(rows, t + 1, window, 0, 2);
+      EXPECT_NEAR(engine.correlation(0, 2), exact.correlation_, 1e-6) << t;
+    }
+  }
+}
+
+}  // namespace
@@ -0,0 +1,165 @@
+#ifndef TRADER_PAIR_SELECTION_STRATEGY_H_
+#define TRADER_PAIR_SELECTION_STRATEGY_H_
+
+#include <math.h>
+
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/async_log.h"
+#include "trader/pair_matrix.h"
+#include "trader/strategy.h"
+
+// Pairs trading over a whole universe instead of one fixed pair: every run
+// scores all pairs of the universe (see PairMatrixEngine) and trades the
+// most stretched spreads among the pairs correlated at least
+// min_correlation. A spread entry_zscore or more above its mean sells the
+// rich first symbol and buys the second, one below buys the first and
+// sells the second, each leg for base_shares. A pair holds one position at
+// a time, unwound by the opposite trade once its spread is back at its
+// mean, and at most num_pairs positions are open, so exposure stays
+// bounded however long a spread stays stretched.
+class PairSelectionStrategy : public Strategy<PairSelectionStrategy> {
+ public:
+  PairSelectionStrategy(const std::vector<std::string> &symbols,
+                        uint32_t moving_window_size, uint32_t tick_length,
+                        size_t num_pairs, double min_correlation,
+                        double entry_zscore, int base_shares,
+                        int num_threads = 1)
+      : Strategy(symbols, tick_length),
+        num_pairs_(num_pairs),
+        min_correlation_(min_correlation),
+        entry_zscore_(entry_zscore),
+        base_shares_(base_shares),
+        engine_(new PairMatrixEngine(symbols.size(), moving_window_size,
+                                    num_threads)),
+        prices_(symbols.size(), std::numeric_limits<double>::quiet_NaN()) {}
+
+  template <typename Executor>
+  void OnTick(const MarketView &view, Executor *executor) {
+    // Highest buy price of each symbol's latest book; symbols without a
+    // usable book keep their last price, or NaN until they have one
+    for (size_t i = 0; i < prices_.size(); i++) {
+      const BookTop &top = view.top(symbol_index(i));
+      if (top.creation_timestamp_ != 0 &&
+          top.highest_buy_price_ > LOWEST_BUY_PRICE) {
+        prices_[i] = top.highest_buy_price_;
+      }
+    }
+    engine_->Update(prices_.data());
+    if (!engine_->ready()) return;
+    // Unwind the positions whose spread has crossed back to its mean
+    for (auto it = positions_.begin(); it != positions_.end();) {
+      int first = it->first.first;
+      int second = it->first.second;
+      double zscore = engine_->zscore(first, second);
+      bool unwind = !std::isnan(zscore) && zscore * it->second >= 0;
+      // Short first (sold when rich) is bought back, and so on
+      if (unwind && (it->second < 0 ? Trade(view, executor, second, first)
+                                    : Trade(view, executor, first, second))) {
+        ASYNC_LOG(ERROR, "{}: Pair {}/{} Unwound: Z{}", view.timestamp(),
+                  symbols()[first], symbols()[second], zscore);
+        it = positions_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    engine_->TopPairs(num_pairs_, min_correlation_, entry_zscore_, &pairs_);
+    for (auto &pair : pairs_) {
+      if (positions_.size() >= num_pairs_) break;
+      std::pair<int, int> key(pair.first_, pair.second_);
+      if (positions_.count(key) > 0) continue;
+      // The rich leg is sold and the cheap one bought
+      bool first_rich = pair.zscore_ > 0;
+      int rich = first_rich ? pair.first_ : pair.second_;
+      int cheap = first_rich ? pair.second_ : pair.first_;
+      ASYNC_LOG(ERROR, "{}: Pair {}/{}: Corr{}\t Z{}", view.timestamp(),
+                symbols()[pair.first_], symbols()[pair.second_],
+                pair.correlation_, pair.zscore_);
+      if (Trade(view, executor, rich, cheap)) {
+        positions_[key] = first_rich ? -1 : 1;
+      }
+    }
+  }
+
+  // Warm-restart state (see Strategy::SaveState). The pair window is not
+  // kept; it refills within moving_window_size runs.
+  void SaveState(CheckpointWriter *writer) const {
+    Strategy::SaveState(writer);
+    writer->PutDoubles(prices_);
+    writer->Put<uint32_t>(positions_.size());
+    for (auto &position : positions_) {
+      writer->Put<int32_t>(position.first.first);
+      writer->Put<int32_t>(position.first.second);
+      writer->Put<int32_t>(position.second);
+    }
+  }
+  bool LoadState(CheckpointReader *reader) {
+    std::vector<double> prices;
+    uint32_t num_positions;
+    if (!Strategy::LoadState(reader) || !reader->GetDoubles(&prices) ||
+        prices.size() != prices_.size() || !reader->Get(&num_positions)) {
+      return false;
+    }
+    std::map<std::pair<int, int>, int> positions;
+    for (uint32_t i = 0; i < num_positions; i++) {
+      int32_t first;
+      int32_t second;
+      int32_t position;
+      if (!reader->Get(&first) || !reader->Get(&second) ||
+          !reader->Get(&position) || first < 0 || first >= second ||
+          second >= static_cast<int32_t>(prices_.size())) {
+        return false;
+      }
+      positions[std::make_pair(first, second)] = position;
+    }
+    prices_.swap(prices);
+    positions_.swap(positions);
+    return true;
+  }
+
+  // Open positions: -1 short the first leg and long the second, 1 the
+  // reverse, by symbol indices (first, second)
+  const std::map<std::pair<int, int>, int> &positions() const {
+    return positions_;
+  }
+
+ private:
+  // Sell base_shares of sell_leg and buy base_shares of buy_leg, both or
+  // neither, each priced off the book now. Returns false if a side is
+  // missing.
+  template <typename Executor>
+  bool Trade(const MarketView &view, Executor *executor, int sell_leg,
+             int buy_leg) {
+    const BookTop &sell_top = view.top(symbol_index(sell_leg));
+    const BookTop &buy_top = view.top(symbol_index(buy_leg));
+    if (sell_top.lowest_sell_price_ >= HIGHEST_SELL_PRICE ||
+        buy_top.highest_buy_price_ <= LOWEST_BUY_PRICE) {
+      return false;
+    }
+    ASYNC_LOG(ERROR, "{}: Pair Trade: sell {} buy {}\t{}", view.timestamp(),
+              symbols()[sell_leg], symbols()[buy_leg], base_shares_);
+    Order ord;
+    Submit(executor, symbols()[sell_leg], OrderAction::sell, base_shares_,
+           sell_top.lowest_sell_price_ - 1, &ord);
+    Submit(executor, symbols()[buy_leg], OrderAction::buy, base_shares_,
+           buy_top.highest_buy_price_ + 1, &ord);
+    return true;
+  }
+
+  size_t num_pairs_;
+  double min_correlation_;
+  double entry_zscore_;
+  int base_shares_;
+  // Owns threads, so held by pointer to keep the strategy movable
+  std::unique_ptr<PairMatrixEngine> engine_;
+  std::vector<double> prices_;
+  std::vector<PairScore> pairs_;
+  std::map<std::pair<int, int>, int> positions_;
+};
+
+#endif  // TRADER_PAIR_SELECTION_STRATEGY_H_
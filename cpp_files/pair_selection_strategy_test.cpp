@@ -0,0 +1,117 @@
+#include "trader/pair_selection_strategy.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+// Records the orders a strategy sends
+class RecordingExecutor {
+ public:
+  class Sent {
+   public:
+    std::string symbol_;
+    OrderAction action_;
+    int limit_price_;
+  };
+
+  OrderResult Submit(const std::string &symbol, OrderAction action,
+                     int num_shares, int limit_price, Order *order) {
+    sent_.push_back({symbol, action, limit_price});
+    order->order_id_ = "NULL";
+    return OrderResult::valid;
+  }
+  OrderResult Cancel(const std::string &order_id) {
+    return OrderResult::valid;
+  }
+
+  std::vector<Sent> sent_;
+};
+
+void SetTop(MarketView *view, const std::string &symbol, double bid,
+            double ask) {
+  BookTop *top = view->mutable_top(view->SymbolIndex(symbol));
+  top->highest_buy_price_ = bid;
+  top->lowest_sell_price_ = ask;
+  top->creation_timestamp_ = 1;
+}
+
+class PairSelectionStrategyTest : public ::testing::Test {
+ protected:
+  PairSelectionStrategyTest()
+      : strategy_({"AA", "AB"}, 10, 1, 1, 0.5, 2, 100) {
+    strategy_.Bind(&view_, 1);
+  }
+
+  // Two symbols moving together, their spread wobbling a little, until the
+  // last tick moves AA well above AB
+  void Run(double ab_bid) {
+    for (int t = 0; t < 10; t++) {
+      double price = 1000 + (t % 4) * 20;
+      SetTop(&view_, "AA", price + (t % 2), price + 5);
+      SetTop(&view_, "AB", price, price + 5);
+      strategy_.Tick(view_, &executor_);
+    }
+    EXPECT_TRUE(executor_.sent_.empty());
+    SetTop(&view_, "AA", 1070, 1075);
+    SetTop(&view_, "AB", ab_bid, 1005);
+    strategy_.Tick(view_, &executor_);
+  }
+
+  PairSelectionStrategy strategy_;
+  MarketView view_;
+  RecordingExecutor executor_;
+};
+
+TEST_F(PairSelectionStrategyTest, SellsTheRichLegAndBuysTheCheapOne) {
+  Run(1000);
+  ASSERT_EQ(executor_.sent_.size(), 2u);
+  EXPECT_EQ(executor_.sent_[0].symbol_, "AA");
+  EXPECT_EQ(executor_.sent_[0].action_, OrderAction::sell);
+  EXPECT_EQ(executor_.sent_[0].limit_price_, 1074);
+  EXPECT_EQ(executor_.sent_[1].symbol_, "AB");
+  EXPECT_EQ(executor_.sent_[1].action_, OrderAction::buy);
+  EXPECT_EQ(executor_.sent_[1].limit_price_, 1001);
+}
+
+TEST_F(PairSelectionStrategyTest, HoldsOnePositionUntilTheSpreadReverts) {
+  Run(1000);
+  ASSERT_EQ(executor_.sent_.size(), 2u);
+  EXPECT_EQ(strategy_.positions().size(), 1u);
+  // Still stretched: no second entry
+  executor_.sent_.clear();
+  strategy_.Tick(view_, &executor_);
+  EXPECT_TRUE(executor_.sent_.empty());
+
+  // Back level, below the spread's mean: AA is bought back, AB sold
+  SetTop(&view_, "AA", 1000, 1005);
+  SetTop(&view_, "AB", 1000, 1005);
+  strategy_.Tick(view_, &executor_);
+  ASSERT_EQ(executor_.sent_.size(), 2u);
+  EXPECT_EQ(executor_.sent_[0].symbol_, "AB");
+  EXPECT_EQ(executor_.sent_[0].action_, OrderAction::sell);
+  EXPECT_EQ(executor_.sent_[1].symbol_, "AA");
+  EXPECT_EQ(executor_.sent_[1].action_, OrderAction::buy);
+  EXPECT_TRUE(strategy_.positions().empty());
+}
+
+TEST_F(PairSelectionStrategyTest, PositionsSurviveACheckpoint) {
+  Run(1000);
+  CheckpointWriter writer;
+  strategy_.SaveState(&writer);
+  PairSelectionStrategy loaded({"AA", "AB"}, 10, 1, 1, 0.5, 2, 100);
+  CheckpointReader reader(writer.data());
+  ASSERT_TRUE(loaded.LoadState(&reader));
+  EXPECT_EQ(loaded.positions(), strategy_.positions());
+}
+
+TEST_F(PairSelectionStrategyTest, SkipsThePairWithoutABidForTheCheapLeg) {
+  // AB keeps scoring on its last bid, but cannot be bought now
+  Run(LOWEST_BUY_PRICE);
+  EXPECT_TRUE(executor_.sent_.empty());
+  EXPECT_TRUE(strategy_.positions().empty());
+}
+
+}  // namespace
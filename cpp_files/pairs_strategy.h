@@ -0,0 +1,126 @@
+#ifndef TRADER_PAIRS_STRATEGY_H_
+#define TRADER_PAIRS_STRATEGY_H_
+
+#include <string>
+
+#include "common/async_log.h"
+#include "trader/indicators.h"
+#include "trader/strategy.h"
+
+// Trades target_symbol when its price moves threshold percent away from the
+// average price difference to baseline_symbol over the moving window.
+class PairsStrategy : public Strategy<PairsStrategy> {
+ public:
+  PairsStrategy(const std::string &target_symbol,
+                const std::string &baseline_symbol,
+                uint32_t moving_window_size, uint32_t tick_length,
+                double threshold, int base_shares)
+      : Strategy({target_symbol, baseline_symbol}, tick_length),
+        target_symbol_(target_symbol),
+        baseline_symbol_(baseline_symbol),
+        threshold_(threshold),
+        base_shares_(base_shares),
+        target_stock_prices_(moving_window_size),
+        baseline_stock_prices_(moving_window_size) {}
+
+  template <typename Executor>
+  void OnTick(const MarketView &view, Executor *executor) {
+    const BookTop &target_top = view.top(symbol_index(0));
+    const BookTop &baseline_top = view.top(symbol_index(1));
+    if (target_top.creation_timestamp_ <= target_last_seen_timestamp_ ||
+        baseline_top.creation_timestamp_ == 0) {
+      return;
+    }
+    target_last_seen_timestamp_ = target_top.creation_timestamp_;
+    // Take the highest buy price in the most recent lob as the stock price
+    double target_current_stock_price = target_top.highest_buy_price_;
+    double baseline_current_stock_price = baseline_top.highest_buy_price_;
+    VLOG(1) << "target_highest_buy_price=" << target_top.highest_buy_price_
+            << "\t"
+            << "target_lowest_sell_price=" << target_top.lowest_sell_price_
+            << "\t"
+            << "baseline_highest_buy_price=" << baseline_top.highest_buy_price_;
+
+    if (target_current_stock_price > LOWEST_BUY_PRICE &&
+        target_stock_prices_.ready() && baseline_stock_prices_.ready()) {
+      // Pairs Trading Strategy
+      double average_diff_price =
+          target_stock_prices_.Mean() - baseline_stock_prices_.Mean();
+      double buy_cutoff = (1.0 - threshold_ / 100.0) * average_diff_price;
+      double sell_cutoff = (1.0 + threshold_ / 100.0) * average_diff_price;
+      VLOG(1) << "average_diff_price= " << average_diff_price
+              << "\t buy_cutoff=" << buy_cutoff
+              << "\tsell_cutoff=" << sell_cutoff
+              << "\ttarget_current_stock_price=" << target_current_stock_price;
+      Order ord;
+      if (target_current_stock_price <= buy_cutoff) {
+        // Place a buy order for target symbol
+        int num_shares = static_cast<int>(
+            buy_cutoff / target_current_stock_price * base_shares_);
+        if (num_shares < 0) {
+          num_shares = base_shares_;
+        }
+        // If I really want to buy, I should buy higher than anyone else
+        Submit(executor, target_symbol_, OrderAction::buy, num_shares,
+               target_top.highest_buy_price_ + 1, &ord);
+        ASYNC_LOG(ERROR, "Submitted Buying Order {}", ord);
+      } else if (target_current_stock_price >= sell_cutoff &&
+                 target_top.lowest_sell_price_ < HIGHEST_SELL_PRICE) {
+        // Place a sell order for target symbol
+        int num_shares = static_cast<int>(target_current_stock_price /
+                                          sell_cutoff * base_shares_);
+        if (num_shares < 0) {
+          num_shares = base_shares_;
+        }
+        // If I really want to sell, I should sell lower than anyone
+        Submit(executor, target_symbol_, OrderAction::sell, num_shares,
+               target_top.lowest_sell_price_ - 1, &ord);
+        ASYNC_LOG(ERROR, "Submitted Selling Order {}", ord);
+      }
+    }
+
+    // Update history records. If a lob is empty, use the latest stock price
+    // (>0) as the current stock price
+    if (target_current_stock_price > 0) {
+      target_latest_stock_price_ = target_current_stock_price;
+    }
+    target_stock_prices_.Add(target_latest_stock_price_);
+    if (baseline_current_stock_price > 0) {
+      baseline_latest_stock_price_ = baseline_current_stock_price;
+    }
+    baseline_stock_prices_.Add(baseline_latest_stock_price_);
+  }
+
+  // Warm-restart state (see Strategy::SaveState)
+  void SaveState(CheckpointWriter *writer) const {
+    Strategy::SaveState(writer);
+    target_stock_prices_.Save(writer);
+    baseline_stock_prices_.Save(writer);
+    writer->Put(target_latest_stock_price_);
+    writer->Put(baseline_latest_stock_price_);
+    writer->Put(target_last_seen_timestamp_);
+  }
+  bool LoadState(CheckpointReader *reader) {
+    return Strategy::LoadState(reader) && target_stock_prices_.Load(reader) &&
+           baseline_stock_prices_.Load(reader) &&
+           reader->Get(&target_latest_stock_price_) &&
+           reader->Get(&baseline_latest_stock_price_) &&
+           reader->Get(&target_last_seen_timestamp_);
+  }
+
+  const std::string &target_symbol() const { return target_symbol_; }
+  const std::string &baseline_symbol() const { return baseline_symbol_; }
+
+ private:
+  std::string target_symbol_;
+  std::string baseline_symbol_;
+  double threshold_;
+  int base_shares_;
+  indicators::StreamingRollingWindow target_stock_prices_;
+  indicators::StreamingRollingWindow baseline_stock_prices_;
+  double target_latest_stock_price_ = 1;
+  double baseline_latest_stock_price_ = 1;
+  uint64_t target_last_seen_timestamp_ = 1;
+};
+
+#endif  // TRADER_PAIRS_STRATEGY_H_
@@ -0,0 +1,217 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <thread>
+
+#include "common/cpu_affinity.h"
+#include "trader/backtest.h"
+#include "trader/trader_config.h"
+
+// Google Command Flags
+/* Data flags */
+DEFINE_string(configuration_path, "/root/vm_config.json",
+              "Read your configuration file from this path");
+DEFINE_string(tape_path, "",
+              "Local market tape. Loaded instead of Bigtable if it exists, "
+              "written after a Bigtable load otherwise.");
+DEFINE_string(market_data_column, "book",
+              "Bigtable column holding the serialized books");
+DEFINE_uint64(start_time_ms, 0, "Start of the historical window");
+DEFINE_uint64(end_time_ms, 9000000000000000, "End of the historical window");
+
+/* Sweep flags: every combination of the comma separated values is run */
+DEFINE_string(strategy, "mean_reversion",
+              "One of mean_reversion, momentum, pairs");
+DEFINE_string(symbols, "AA",
+              "Comma separated symbols, or target:baseline pairs for pairs");
+DEFINE_string(moving_windows, "5", "Moving window lengths (seconds)");
+DEFINE_string(tick_lengths, "1", "Tick lengths (seconds)");
+DEFINE_string(thresholds, "5", "Thresholds (percent)");
+DEFINE_string(base_shares, "5000", "Base share counts");
+DEFINE_string(p1s, ".5", "Momentum weights of the previous timestep");
+DEFINE_string(p2s, ".5", "Momentum weights of two timesteps ago");
+
+/* Output flags */
+DEFINE_int32(num_threads, 0, "Worker threads (0 for one per core)");
+DEFINE_string(cpu_cores, "",
+              "Cores to pin the workers to, one each in turn (e.g. 0-7); "
+              "empty leaves them to the scheduler");
+DEFINE_string(output_path, "sweep_results.csv",
+              "Ranked results table, best PnL first");
+
+// One point of the sweep
+class SweepConfig {
+ public:
+  StrategyParams params_;
+  BacktestResult result_;
+};
+
+// Parse the comma separated numbers of a flag. With max_count > 0 each must
+// be a whole number in [1, max_count]. Logs and returns false otherwise.
+bool SplitNumbers(const std::string &name, const std::string &value,
+                  double max_count, std::vector<double> *numbers) {
+  numbers->clear();
+  for (auto &item : SplitFlag(value, ',')) {
+    char *end;
+    double number = strtod(item.c_str(), &end);
+    bool ok = !item.empty() && *end == '\0' && std::isfinite(number);
+    if (ok && max_count > 0) {
+      ok = number >= 1 && number <= max_count && number == floor(number);
+    }
+    if (!ok) {
+      LOG(ERROR) << "Invalid Value of --" << name << ": " << item;
+      return false;
+    }
+    numbers->push_back(number);
+  }
+  return true;
+}
+
+bool BuildSweep(std::vector<SweepConfig> *configs) {
+  bool momentum = FLAGS_strategy == "momentum";
+  std::vector<double> p1s{0}, p2s{0};
+  std::vector<double> moving_windows, tick_lengths, thresholds, base_shares;
+  if ((momentum && (!SplitNumbers("p1s", FLAGS_p1s, 0, &p1s) ||
+                    !SplitNumbers("p2s", FLAGS_p2s, 0, &p2s))) ||
+      !SplitNumbers("moving_windows", FLAGS_moving_windows, UINT32_MAX,
+                    &moving_windows) ||
+      !SplitNumbers("tick_lengths", FLAGS_tick_lengths, UINT32_MAX,
+                    &tick_lengths) ||
+      !SplitNumbers("thresholds", FLAGS_thresholds, 0, &thresholds) ||
+      !SplitNumbers("base_shares", FLAGS_base_shares, INT32_MAX,
+                    &base_shares)) {
+    return false;
+  }
+  for (auto &symbols : SplitFlag(FLAGS_symbols, ',')) {
+    for (double moving_window : moving_windows) {
+      for (double tick_length : tick_lengths) {
+        for (double threshold : thresholds) {
+          for (double shares : base_shares) {
+            for (double p1 : p1s) {
+              for (double p2 : p2s) {
+                SweepConfig config;
+                config.params_.strategy_ = FLAGS_strategy;
+                config.params_.symbols_ = SplitFlag(symbols, ':');
+                config.params_.moving_window_ = moving_window;
+                config.params_.tick_length_ = tick_length;
+                config.params_.threshold_ = threshold;
+                config.params_.base_shares_ = shares;
+                config.params_.p1_ = p1;
+                config.params_.p2_ = p2;
+                configs->push_back(config);
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+
+bool LoadTape(MarketTape *tape, const std::vector<SweepConfig> &configs) {
+  if (!FLAGS_tape_path.empty() && std::ifstream(FLAGS_tape_path).good()) {
+    return LoadMarketTapeFile(FLAGS_tape_path, tape);
+  }
+  TraderConfig config;
+  if (!LoadTraderConfig(FLAGS_configuration_path, &config)) {
+    return false;
+  }
+  std::vector<std::string> symbols;
+  for (auto &sweep_config : configs) {
+    for (auto &symbol : sweep_config.params_.symbols_) {
+      if (std::find(symbols.begin(), symbols.end(), symbol) == symbols.end()) {
+        symbols.push_back(symbol);
+      }
+    }
+  }
+  if (!LoadMarketTape(config, symbols, FLAGS_market_data_column,
+                      FLAGS_start_time_ms, FLAGS_end_time_ms, tape)) {
+    return false;
+  }
+  return FLAGS_tape_path.empty() || SaveMarketTapeFile(*tape, FLAGS_tape_path);
+}
+
+int main(int argc, char **argv) {
+  // GFLAGS and GLOG Parsing
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = 1;
+
+  std::vector<SweepConfig> configs;
+  if (!BuildSweep(&configs)) {
+    return -1;
+  }
+
+  // A run over an empty tape checks the strategy and symbols up front
+  BacktestResult result;
+  for (auto &config : configs) {
+    if (!RunStrategyBacktest(MarketTape(), config.params_, &result)) {
+      LOG(ERROR) << "Unknown Strategy or Malformed Symbols: "
+                 << FLAGS_strategy << " " << FLAGS_symbols;
+      return -1;
+    }
+  }
+
+  // Loaded once, shared read-only by every worker
+  MarketTape tape;
+  if (configs.empty() || !LoadTape(&tape, configs)) {
+    return -1;
+  }
+  LOG(INFO) << "Loaded " << tape.events_.size() << " Books, Running "
+            << configs.size() << " Configurations";
+
+  // The strategies log every order; keep the workers quiet
+  FLAGS_minloglevel = google::FATAL;
+  int num_threads = FLAGS_num_threads > 0
+                        ? FLAGS_num_threads
+                        : std::max(1u, std::thread::hardware_concurrency());
+  std::vector<int> cores;
+  if (!ParseCoreList(FLAGS_cpu_cores, &cores)) {
+    LOG(ERROR) << "Malformed Core List: " << FLAGS_cpu_cores;
+    return -1;
+  }
+  std::atomic<size_t> next_config(0);
+  std::vector<std::thread> workers;
+  for (int i = 0; i < num_threads; i++) {
+    int core = cores.empty() ? -1 : cores[i % cores.size()];
+    workers.emplace_back([&tape, &configs, &next_config, core]() {
+      if (core >= 0) PinCurrentThread(core);
+      for (size_t index = next_config++; index < configs.size();
+           index = next_config++) {
+        RunStrategyBacktest(tape, configs[index].params_,
+                            &configs[index].result_);
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  FLAGS_minloglevel = google::INFO;
+
+  std::sort(configs.begin(), configs.end(),
+            [](const SweepConfig &a, const SweepConfig &b) {
+              return a.result_.pnl_ > b.result_.pnl_;
+            });
+  std::ofstream output(FLAGS_output_path);
+  output << "rank,strategy,symbols,moving_window,tick_length,threshold,"
+            "base_shares,p1,p2,pnl,max_drawdown,num_orders,num_fills,"
+            "shares_traded\n";
+  for (size_t i = 0; i < configs.size(); i++) {
+    const StrategyParams &params = configs[i].params_;
+    const BacktestResult &result = configs[i].result_;
+    std::string symbols = params.symbols_[0];
+    if (params.symbols_.size() > 1) symbols += ":" + params.symbols_[1];
+    output << i + 1 << "," << params.strategy_ << "," << symbols << ","
+           << params.moving_window_ << "," << params.tick_length_ << ","
+           << params.threshold_ << "," << params.base_shares_ << ","
+           << params.p1_ << "," << params.p2_ << "," << result.pnl_ << ","
+           << result.max_drawdown_ << "," << result.num_orders_ << ","
+           << result.num_fills_ << "," << result.shares_traded_ << "\n";
+  }
+  LOG(INFO) << "Wrote " << configs.size() << " Results to "
+            << FLAGS_output_path;
+}
@@ -0,0 +1,154 @@
+#include "common/record_codec.h"
+
+#include <string.h>
+
+#include "common/text_parser.h"
+
+namespace {
+
+// Fixed-width fields are stored in host byte order; records never leave the
+// machine that wrote them (local redis).
+template <typename T>
+void PutFixed(std::string *record, T value) {
+  record->append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+bool PutString(std::string *record, const std::string &value) {
+  if (value.size() > BINARY_RECORD_MAX_STRING) return false;
+  PutFixed<uint16_t>(record, static_cast<uint16_t>(value.size()));
+  record->append(value);
+  return true;
+}
+
+class RecordReader {
+ public:
+  RecordReader(const char *data, size_t len) : data_(data), left_(len) {}
+
+  template <typename T>
+  bool GetFixed(T *value) {
+    if (left_ < sizeof(T)) return false;
+    memcpy(value, data_, sizeof(T));
+    data_ += sizeof(T);
+    left_ -= sizeof(T);
+    return true;
+  }
+
+  bool GetString(std::string *value) {
+    uint16_t len;
+    if (!GetFixed(&len) || left_ < len) return false;
+    value->assign(data_, len);
+    data_ += len;
+    left_ -= len;
+    return true;
+  }
+
+ private:
+  const char *data_;
+  size_t left_;
+};
+
+}  // namespace
+
+bool EncodeOrder(const Order &order, RecordEncoding encoding,
+                 std::string *record) {
+  if (encoding == RecordEncoding::text) {
+    *record = order.SerializeOrder();
+    return true;
+  }
+  record->clear();
+  record->push_back(BINARY_RECORD_MAGIC);
+  record->push_back(SerializeAction(order.action_));
+  record->push_back(SerializeType(order.type_));
+  record->push_back(SerializeResult(order.result_));
+  PutFixed<int32_t>(record, order.num_shares_);
+  PutFixed<int32_t>(record, order.limit_price_);
+  PutFixed<uint64_t>(record, order.genesis_timestamp_);
+  PutFixed<uint64_t>(record, order.gateway_timestamp_);
+  PutFixed<uint64_t>(record, order.enqueue_timestamp_);
+  PutFixed<uint64_t>(record, order.dequeue_timestamp_);
+  PutFixed<uint64_t>(record, order.order_serial_num_);
+  return PutString(record, order.symbol_) &&
+         PutString(record, order.order_id_) &&
+         PutString(record, order.cancel_id_) &&
+         PutString(record, order.client_id_);
+}
+
+bool EncodeTrade(const Trade &trade, RecordEncoding encoding,
+                 std::string *record) {
+  if (encoding == RecordEncoding::text) {
+    *record = trade.SerializeTrade();
+    return true;
+  }
+  record->clear();
+  record->push_back(BINARY_RECORD_MAGIC);
+  PutFixed<int32_t>(record, trade.exec_price_);
+  PutFixed<int32_t>(record, trade.cash_traded_);
+  PutFixed<int32_t>(record, trade.shares_traded_);
+  PutFixed<uint64_t>(record, trade.buyer_serial_num_);
+  PutFixed<uint64_t>(record, trade.seller_serial_num_);
+  PutFixed<uint64_t>(record, trade.creation_timestamp_);
+  PutFixed<uint64_t>(record, trade.release_timestamp_);
+  PutFixed<uint64_t>(record, trade.trade_serial_num_);
+  return PutString(record, trade.symbol_) &&
+         PutString(record, trade.buyer_order_id_) &&
+         PutString(record, trade.seller_order_id_) &&
+         PutString(record, trade.buyer_client_id_) &&
+         PutString(record, trade.seller_client_id_);
+}
+
+bool DecodeOrder(const char *data, size_t len, Order *order) {
+  if (len == 0 || data[0] != BINARY_RECORD_MAGIC) {
+    ParseOrderOrConstruct(data, len, order);
+    return true;
+  }
+  RecordReader reader(data + 1, len - 1);
+  char action, type, result;
+  int32_t num_shares, limit_price;
+  if (!reader.GetFixed(&action) || !reader.GetFixed(&type) ||
+      !reader.GetFixed(&result) || !reader.GetFixed(&num_shares) ||
+      !reader.GetFixed(&limit_price) ||
+      !reader.GetFixed(&order->genesis_timestamp_) ||
+      !reader.GetFixed(&order->gateway_timestamp_) ||
+      !reader.GetFixed(&order->enqueue_timestamp_) ||
+      !reader.GetFixed(&order->dequeue_timestamp_) ||
+      !reader.GetFixed(&order->order_serial_num_) ||
+      !reader.GetString(&order->symbol_) ||
+      !reader.GetString(&order->order_id_) ||
+      !reader.GetString(&order->cancel_id_) ||
+      !reader.GetString(&order->client_id_)) {
+    return false;
+  }
+  order->action_ = DeserializeAction(action);
+  order->type_ = DeserializeType(type);
+  order->result_ = DeserializeResult(result);
+  order->num_shares_ = num_shares;
+  order->limit_price_ = limit_price;
+  return true;
+}
+
+bool DecodeTrade(const char *data, size_t len, Trade *trade) {
+  if (len == 0 || data[0] != BINARY_RECORD_MAGIC) {
+    ParseTradeOrConstruct(data, len, trade);
+    return true;
+  }
+  RecordReader reader(data + 1, len - 1);
+  int32_t exec_price, cash_traded, shares_traded;
+  if (!reader.GetFixed(&exec_price) || !reader.GetFixed(&cash_traded) ||
+      !reader.GetFixed(&shares_traded) ||
+      !reader.GetFixed(&trade->buyer_serial_num_) ||
+      !reader.GetFixed(&trade->seller_serial_num_) ||
+      !reader.GetFixed(&trade->creation_timestamp_) ||
+      !reader.GetFixed(&trade->release_timestamp_) ||
+      !reader.GetFixed(&trade->trade_serial_num_) ||
+      !reader.GetString(&trade->symbol_) ||
+      !reader.GetString(&trade->buyer_order_id_) ||
+      !reader.GetString(&trade->seller_order_id_) ||
+      !reader.GetString(&trade->buyer_client_id_) ||
+      !reader.GetString(&trade->seller_client_id_)) {
+    return false;
+  }
+  trade->exec_price_ = exec_price;
+  trade->cash_traded_ = cash_traded;
+  trade->shares_traded_ = shares_traded;
+  return true;
+}
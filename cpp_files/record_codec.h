@@ -0,0 +1,37 @@
+#ifndef COMMON_RECORD_CODEC_H_
+#define COMMON_RECORD_CODEC_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "common/message_types.h"
+
+// Storage encoding for Order and Trade records kept outside the process (i.e.
+// checkpoints and client information deltas). Text is the
+// SerializeOrder/SerializeTrade format, binary is a compact fixed-layout
+// encoding that skips all number formatting. The redis history lists are
+// written in text by REDISDataStructures; the decoders read either.
+enum class RecordEncoding { text, binary };
+
+// First byte of every binary record. Text records always start with a symbol
+// character, so the two encodings can be mixed in one list.
+#define BINARY_RECORD_MAGIC ('\x01')
+
+// Binary strings carry a 16 bit length
+#define BINARY_RECORD_MAX_STRING (0xffff)
+
+// Encode an Order / Trade in the requested encoding, replacing *record.
+// Returns false if a string field is longer than BINARY_RECORD_MAX_STRING in
+// the binary encoding; the text encoding has no such limit.
+bool EncodeOrder(const Order &order, RecordEncoding encoding,
+                 std::string *record);
+bool EncodeTrade(const Trade &trade, RecordEncoding encoding,
+                 std::string *record);
+
+// Decode a record produced by EncodeOrder / EncodeTrade. The encoding is
+// detected from the first byte. Returns false on a truncated binary record.
+bool DecodeOrder(const char *data, size_t len, Order *order);
+bool DecodeTrade(const char *data, size_t len, Trade *trade);
+
+#endif  // COMMON_RECORD_CODEC_H_
@@ -0,0 +1,148 @@
+#include "common/record_codec.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace {
+
+Order MakeOrder() {
+  Order order;
+  order.symbol_ = "AA";
+  order.order_id_ = "G1_C3_1602182726927431";
+  order.cancel_id_ = "NULL";
+  order.client_id_ = "C3";
+  order.type_ = OrderType::limit;
+  order.action_ = OrderAction::sell;
+  order.genesis_timestamp_ = 1602182726927431ULL;
+  order.gateway_timestamp_ = 1602182726934577ULL;
+  order.enqueue_timestamp_ = 1602182726934784ULL;
+  order.dequeue_timestamp_ = 1602182726934928ULL;
+  order.order_serial_num_ = 7;
+  order.limit_price_ = -50;
+  order.result_ = OrderResult::duplicate;
+  order.num_shares_ = 100;
+  return order;
+}
+
+Trade MakeTrade() {
+  Trade trade;
+  trade.symbol_ = "AB";
+  trade.buyer_serial_num_ = 4;
+  trade.seller_serial_num_ = 5;
+  trade.buyer_order_id_ = "G1_C3_12";
+  trade.seller_order_id_ = "G1_C4_13";
+  trade.buyer_client_id_ = "C3";
+  trade.seller_client_id_ = "C4";
+  trade.exec_price_ = 50;
+  trade.cash_traded_ = 5000;
+  trade.shares_traded_ = 100;
+  trade.creation_timestamp_ = 1602182417783908ULL;
+  trade.release_timestamp_ = 1602182417784258ULL;
+  trade.trade_serial_num_ = 10003;
+  return trade;
+}
+
+void ExpectSameOrder(const Order &a, const Order &b) {
+  EXPECT_EQ(a.symbol_, b.symbol_);
+  EXPECT_EQ(a.order_id_, b.order_id_);
+  EXPECT_EQ(a.cancel_id_, b.cancel_id_);
+  EXPECT_EQ(a.client_id_, b.client_id_);
+  EXPECT_EQ(a.type_, b.type_);
+  EXPECT_EQ(a.action_, b.action_);
+  EXPECT_EQ(a.genesis_timestamp_, b.genesis_timestamp_);
+  EXPECT_EQ(a.gateway_timestamp_, b.gateway_timestamp_);
+  EXPECT_EQ(a.enqueue_timestamp_, b.enqueue_timestamp_);
+  EXPECT_EQ(a.dequeue_timestamp_, b.dequeue_timestamp_);
+  EXPECT_EQ(a.order_serial_num_, b.order_serial_num_);
+  EXPECT_EQ(a.limit_price_, b.limit_price_);
+  EXPECT_EQ(a.result_, b.result_);
+  EXPECT_EQ(a.num_shares_, b.num_shares_);
+}
+
+void ExpectSameTrade(const Trade &a, const Trade &b) {
+  EXPECT_EQ(a.symbol_, b.symbol_);
+  EXPECT_EQ(a.buyer_serial_num_, b.buyer_serial_num_);
+  EXPECT_EQ(a.seller_serial_num_, b.seller_serial_num_);
+  EXPECT_EQ(a.buyer_order_id_, b.buyer_order_id_);
+  EXPECT_EQ(a.seller_order_id_, b.seller_order_id_);
+  EXPECT_EQ(a.buyer_client_id_, b.buyer_client_id_);
+  EXPECT_EQ(a.seller_client_id_, b.seller_client_id_);
+  EXPECT_EQ(a.exec_price_, b.exec_price_);
+  EXPECT_EQ(a.cash_traded_, b.cash_traded_);
+  EXPECT_EQ(a.shares_traded_, b.shares_traded_);
+  EXPECT_EQ(a.creation_timestamp_, b.creation_timestamp_);
+  EXPECT_EQ(a.release_timestamp_, b.release_timestamp_);
+  EXPECT_EQ(a.trade_serial_num_, b.trade_serial_num_);
+}
+
+TEST(RecordCodecTest, OrderRoundTrips) {
+  Order order = MakeOrder();
+  std::string record;
+  for (RecordEncoding encoding :
+       {RecordEncoding::binary, RecordEncoding::text}) {
+    ASSERT_TRUE(EncodeOrder(order, encoding, &record));
+    EXPECT_EQ(record[0] == BINARY_RECORD_MAGIC,
+              encoding == RecordEncoding::binary);
+    Order decoded;
+    ASSERT_TRUE(DecodeOrder(record.data(), record.size(), &decoded));
+    ExpectSameOrder(decoded, order);
+  }
+}
+
+TEST(RecordCodecTest, TradeRoundTrips) {
+  Trade trade = MakeTrade();
+  std::string record;
+  for (RecordEncoding encoding :
+       {RecordEncoding::binary, RecordEncoding::text}) {
+    ASSERT_TRUE(EncodeTrade(trade, encoding, &record));
+    Trade decoded;
+    ASSERT_TRUE(DecodeTrade(record.data(), record.size(), &decoded));
+    ExpectSameTrade(decoded, trade);
+  }
+}
+
+TEST(RecordCodecTest, BinaryKeepsLongAndEmptyStrings) {
+  Order order = MakeOrder();
+  order.order_id_ = std::string(1000, 'x');
+  order.cancel_id_ = "";
+  std::string record;
+  EncodeOrder(order, RecordEncoding::binary, &record);
+  Order decoded;
+  ASSERT_TRUE(DecodeOrder(record.data(), record.size(), &decoded));
+  ExpectSameOrder(decoded, order);
+}
+
+TEST(RecordCodecTest, OversizeStringsAreRejected) {
+  Order order = MakeOrder();
+  order.order_id_ = std::string(BINARY_RECORD_MAX_STRING + 1, 'x');
+  std::string record;
+  EXPECT_FALSE(EncodeOrder(order, RecordEncoding::binary, &record));
+  // The text encoding has no limit
+  ASSERT_TRUE(EncodeOrder(order, RecordEncoding::text, &record));
+  Order decoded;
+  ASSERT_TRUE(DecodeOrder(record.data(), record.size(), &decoded));
+  EXPECT_EQ(decoded.order_id_, order.order_id_);
+
+  Trade trade = MakeTrade();
+  trade.seller_client_id_ = std::string(BINARY_RECORD_MAX_STRING, 'y');
+  ASSERT_TRUE(EncodeTrade(trade, RecordEncoding::binary, &record));
+  trade.seller_client_id_ += "y";
+  EXPECT_FALSE(EncodeTrade(trade, RecordEncoding::binary, &record));
+}
+
+TEST(RecordCodecTest, TruncatedBinaryRecordsAreRejected) {
+  std::string record;
+  EncodeOrder(MakeOrder(), RecordEncoding::binary, &record);
+  Order order;
+  for (size_t len = 1; len < record.size(); len++) {
+    EXPECT_FALSE(DecodeOrder(record.data(), len, &order)) << len;
+  }
+  EncodeTrade(MakeTrade(), RecordEncoding::binary, &record);
+  Trade trade;
+  for (size_t len = 1; len < record.size(); len++) {
+    EXPECT_FALSE(DecodeTrade(record.data(), len, &trade)) << len;
+  }
+}
+
+}  // namespace
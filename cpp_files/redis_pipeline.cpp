@@ -0,0 +1,95 @@
+#include "common/redis_pipeline.h"
+
+#include <glog/logging.h>
+
+REDISPipeline::REDISPipeline(const std::string &host, int port)
+    : host_(host), port_(port), context_(nullptr) {}
+
+REDISPipeline::~REDISPipeline() {
+  if (context_ != nullptr) {
+    redisFree(context_);
+  }
+}
+
+bool REDISPipeline::EnsureConnected() {
+  if (context_ != nullptr && context_->err == 0) {
+    return true;
+  }
+  if (context_ != nullptr) {
+    LOG(ERROR) << "Redis Pipeline Connection Broken: " << context_->errstr;
+    redisFree(context_);
+  }
+  context_ = redisConnect(host_.c_str(), port_);
+  if (context_ == nullptr || context_->err) {
+    LOG(ERROR) << "Redis Pipeline Failed to Connect to " << host_ << ":"
+               << port_;
+    if (context_ != nullptr) {
+      redisFree(context_);
+      context_ = nullptr;
+    }
+    return false;
+  }
+  return true;
+}
+
+bool REDISPipeline::CollectReplies(
+    int num_replies, const std::function<bool(redisReply *)> &handle_reply) {
+  // Every queued reply must be drained even after a failure, otherwise the
+  // next pipeline on this connection would read stale replies. Error replies
+  // are drained like any other; a failed read leaves the rest unreadable, so
+  // the connection is dropped and the next call reconnects.
+  bool success = true;
+  for (int i = 0; i < num_replies; i++) {
+    void *reply = nullptr;
+    if (redisGetReply(context_, &reply) != REDIS_OK || reply == nullptr) {
+      LOG(ERROR) << "Redis Pipeline Reply Error: " << context_->errstr;
+      redisFree(context_);
+      context_ = nullptr;
+      return false;
+    }
+    redisReply *r = static_cast<redisReply *>(reply);
+    if (r->type == REDIS_REPLY_ERROR || !handle_reply(r)) {
+      success = false;
+    }
+    freeReplyObject(reply);
+  }
+  return success;
+}
+
+bool REDISPipeline::FetchList(const std::string &key,
+                              std::vector<std::string> *values,
+                              int batch_size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  values->clear();
+  if (!EnsureConnected()) return false;
+
+  redisReply *len_reply = static_cast<redisReply *>(
+      redisCommand(context_, "LLEN %b", key.data(), key.size()));
+  if (len_reply == nullptr) return false;
+  if (len_reply->type != REDIS_REPLY_INTEGER) {
+    // i.e. WRONGTYPE, the key holds something other than a list
+    LOG(ERROR) << "Redis LLEN " << key << " Failed: "
+               << (len_reply->type == REDIS_REPLY_ERROR ? len_reply->str
+                                                        : "not an integer");
+    freeReplyObject(len_reply);
+    return false;
+  }
+  long long len = len_reply->integer;
+  freeReplyObject(len_reply);
+  if (len == 0) return true;
+
+  int num_batches = 0;
+  for (long long start = 0; start < len; start += batch_size) {
+    redisAppendCommand(context_, "LRANGE %b %lld %lld", key.data(), key.size(),
+                       start, start + batch_size - 1);
+    num_batches++;
+  }
+  values->reserve(len);
+  return CollectReplies(num_batches, [values](redisReply *r) {
+    if (r->type != REDIS_REPLY_ARRAY) return false;
+    for (size_t i = 0; i < r->elements; i++) {
+      values->emplace_back(r->element[i]->str, r->element[i]->len);
+    }
+    return true;
+  });
+}
@@ -0,0 +1,75 @@
+#ifndef COMMON_REDIS_PIPELINE_H_
+#define COMMON_REDIS_PIPELINE_H_
+
+#include <hiredis/hiredis.h>
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define REDIS_PIPELINE_BATCH_SIZE (1000)
+
+// Bulk access to redis lists. Where REDISDataStructures issues one
+// command per record, every method here queues all of its commands on the
+// connection first and only then collects the replies, so a full history read
+// costs one round trip per pipeline instead of one per record.
+class REDISPipeline {
+ public:
+  REDISPipeline(const std::string &host = "127.0.0.1", int port = 6379);
+  ~REDISPipeline();
+
+  // Read the whole list stored at key, issuing one LRANGE per batch_size
+  // elements in a single pipeline.
+  bool FetchList(const std::string &key, std::vector<std::string> *values,
+                 int batch_size = REDIS_PIPELINE_BATCH_SIZE);
+
+ private:
+  // (Re)connect if the context is missing or broken. Caller holds mutex_.
+  bool EnsureConnected();
+
+  // Collect num_replies pipelined replies, passing each one to handle_reply.
+  bool CollectReplies(int num_replies,
+                      const std::function<bool(redisReply *)> &handle_reply);
+
+  std::string host_;
+  int port_;
+  redisContext *context_;
+
+  // A redis context is not thread safe
+  std::mutex mutex_;
+};
+
+// Decode records into (*out)[i] in parallel. The output vector is sized up
+// front and every worker owns a contiguous range of it, so no synchronisation
+// is needed beyond the final join. Returns false if any record failed.
+template <typename T>
+bool ParallelDecode(const std::vector<std::string> &records,
+                    bool (*decode)(const char *, size_t, T *),
+                    int num_threads, std::vector<T> *out) {
+  out->resize(records.size());
+  if (num_threads < 1) num_threads = 1;
+  size_t chunk = (records.size() + num_threads - 1) / num_threads;
+  std::vector<std::thread> workers;
+  std::vector<char> ok(num_threads, 1);
+  for (int t = 0; t < num_threads; t++) {
+    size_t begin = t * chunk;
+    size_t end = std::min(records.size(), begin + chunk);
+    if (begin >= end) break;
+    workers.emplace_back([&, t, begin, end]() {
+      for (size_t i = begin; i < end; i++) {
+        if (!decode(records[i].data(), records[i].size(), &(*out)[i])) {
+          ok[t] = 0;
+        }
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  return std::find(ok.begin(), ok.end(), 0) == ok.end();
+}
+
+#endif  // COMMON_REDIS_PIPELINE_H_
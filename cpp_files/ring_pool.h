@@ -0,0 +1,126 @@
+#ifndef COMMON_RING_POOL_H_
+#define COMMON_RING_POOL_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Usage statistics of a RingPool
+class PoolStats {
+ public:
+  size_t capacity_ = 0;   // Number of preallocated slots
+  size_t size_ = 0;       // Slots currently holding an entry
+  uint64_t puts_ = 0;     // Entries stored since creation
+  uint64_t overwrites_ = 0;  // Entries overwritten before being evicted
+  uint64_t reallocations_ = 0;  // Puts into a slot still held by a view
+};
+
+// Fixed-capacity ring of preallocated T slots for the market data history of
+// one symbol. All slots are constructed up front and Put() copy-assigns into
+// the oldest one, so a slot keeps its nested map nodes and string buffers
+// from one entry to the next instead of freeing and reallocating them. Once
+// the slots have grown to the usual book depth, storing an entry does not
+// touch the allocator. Not thread safe; the Trader guards each pool with the
+// symbol's mutex.
+//
+// Entries can also be handed out as immutable, reference-counted views. A
+// slot still referenced by a view when its turn comes is left to the view
+// and replaced by a fresh allocation, so views never change under a reader.
+//
+// T must have a uint64_t creation_timestamp_ member (LimitOrderBook, Trade).
+template <typename T>
+class RingPool {
+ public:
+  explicit RingPool(size_t capacity) : slots_(capacity > 0 ? capacity : 1) {
+    for (auto &slot : slots_) {
+      slot = std::make_shared<T>();
+    }
+    stats_.capacity_ = slots_.size();
+  }
+
+  // Store value in the next slot, overwriting the oldest entry when full
+  void Put(const T &value) {
+    if (stats_.size_ == slots_.size()) {
+      stats_.overwrites_++;
+    } else {
+      stats_.size_++;
+    }
+    std::shared_ptr<T> &slot = slots_[stats_.puts_ % slots_.size()];
+    if (slot.use_count() == 1) {
+      // Pairs with the release of the last view, so its reads finish first
+      std::atomic_thread_fence(std::memory_order_acquire);
+      *slot = value;
+    } else {
+      slot = std::make_shared<T>(value);
+      stats_.reallocations_++;
+    }
+    stats_.puts_++;
+  }
+
+  // Newest entry, or nullptr if empty
+  const T *Newest() const {
+    if (stats_.size_ == 0) return nullptr;
+    return Slot(0).get();
+  }
+
+  // View of the newest entry, or an empty pointer if empty
+  std::shared_ptr<const T> NewestView() const {
+    if (stats_.size_ == 0) return nullptr;
+    return Slot(0);
+  }
+
+  // Copy the entries created after start_timestamp into *out, most
+  // recent first. Existing elements of *out are assigned over, so a caller
+  // that reuses its vector reuses their buffers too.
+  void CopyRecent(uint64_t start_timestamp, std::vector<T> *out) const {
+    size_t count = 0;
+    for (size_t i = 0; i < stats_.size_; i++) {
+      const T &entry = *Slot(i);
+      if (entry.creation_timestamp_ <= start_timestamp) break;
+      if (count < out->size()) {
+        (*out)[count] = entry;
+      } else {
+        out->push_back(entry);
+      }
+      count++;
+    }
+    out->resize(count);
+  }
+
+  // Same as CopyRecent, handing out views instead of copies
+  void ViewRecent(uint64_t start_timestamp,
+                  std::vector<std::shared_ptr<const T> > *out) const {
+    out->clear();
+    for (size_t i = 0; i < stats_.size_; i++) {
+      const std::shared_ptr<T> &slot = Slot(i);
+      if (slot->creation_timestamp_ <= start_timestamp) break;
+      out->push_back(slot);
+    }
+  }
+
+  // Entries are numbered from 1 in the order they were Put. The pool holds
+  // sequence numbers first_sequence() to last_sequence(); if it is empty,
+  // first_sequence() is last_sequence() + 1.
+  uint64_t first_sequence() const { return stats_.puts_ - stats_.size_ + 1; }
+  uint64_t last_sequence() const { return stats_.puts_; }
+
+  // View of the entry with the given sequence number, which must be held
+  std::shared_ptr<const T> View(uint64_t sequence) const {
+    return Slot(stats_.puts_ - sequence);
+  }
+
+  const PoolStats &stats() const { return stats_; }
+
+ private:
+  // Slot of the i-th most recent entry
+  const std::shared_ptr<T> &Slot(size_t i) const {
+    return slots_[(stats_.puts_ - 1 - i) % slots_.size()];
+  }
+
+  std::vector<std::shared_ptr<T> > slots_;
+  PoolStats stats_;
+};
+
+#endif  // COMMON_RING_POOL_H_
@@ -0,0 +1,74 @@
+#ifndef COMMON_SEQLOCK_H_
+#define COMMON_SEQLOCK_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <type_traits>
+
+// Single-writer, multi-reader sequence lock around a small trivially copyable
+// value. The writer never blocks and readers never write shared state, so
+// any number of reader threads can poll the value without cache line
+// ping-pong between them. Readers retry if they overlap a write.
+//
+// The value is stored as relaxed atomic words, so concurrent reads and writes
+// are well defined.
+template <typename T>
+class SeqLock {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SeqLock requires a trivially copyable type");
+
+ public:
+  SeqLock() : sequence_(0) {
+    T value{};
+    Store(value);
+    sequence_.store(0, std::memory_order_relaxed);
+  }
+
+  // Publish a new value. Must only be called from one thread at a time.
+  void Store(const T &value) {
+    uint64_t words[kNumWords] = {};
+    memcpy(words, &value, sizeof(T));
+    uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < kNumWords; i++) {
+      words_[i].store(words[i], std::memory_order_relaxed);
+    }
+    sequence_.store(sequence + 2, std::memory_order_release);
+  }
+
+  // Copy out a consistent value, retrying while a write is in progress.
+  void Load(T *value) const {
+    while (!TryLoad(value)) {
+    }
+  }
+
+  // Copy out the value once. Returns false if it overlapped a write.
+  bool TryLoad(T *value) const {
+    uint64_t words[kNumWords];
+    uint64_t before = sequence_.load(std::memory_order_acquire);
+    if (before & 1) return false;
+    for (size_t i = 0; i < kNumWords; i++) {
+      words[i] = words_[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence_.load(std::memory_order_relaxed) != before) return false;
+    memcpy(value, words, sizeof(T));
+    return true;
+  }
+
+  // Number of completed Store() calls
+  uint64_t version() const {
+    return sequence_.load(std::memory_order_acquire) / 2;
+  }
+
+ private:
+  static const size_t kNumWords = (sizeof(T) + 7) / 8;
+
+  alignas(64) std::atomic<uint64_t> sequence_;
+  std::atomic<uint64_t> words_[kNumWords];
+};
+
+#endif  // COMMON_SEQLOCK_H_
@@ -0,0 +1,296 @@
+#ifndef TRADER_STRATEGY_H_
+#define TRADER_STRATEGY_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "common/metrics.h"
+#include "trader/book_utils.h"
+#include "trader/checkpoint.h"
+#include "trader/top_of_book.h"
+#include "trader/trader_api.h"
+
+// Once this many orders are tracked, the oldest CANCEL_BATCH_SIZE are
+// cancelled to free cash
+#define MAX_TRACKED_ORDERS 30
+#define CANCEL_BATCH_SIZE 10
+
+// Best prices of the most recent book received for one symbol
+class BookTop {
+ public:
+  double highest_buy_price_ = LOWEST_BUY_PRICE;
+  double lowest_sell_price_ = HIGHEST_SELL_PRICE;
+  uint64_t creation_timestamp_ = 0;  // 0 until a book has been received
+};
+
+// Market state of one tick, shared by every strategy in the process. Symbols
+// are resolved to dense indices once, so strategies never look up strings on
+// the tick path.
+class MarketView {
+ public:
+  // Register symbol (idempotent) and return its index
+  int AddSymbol(const std::string &symbol);
+
+  // Index of symbol, or -1 if it was never added
+  int SymbolIndex(const std::string &symbol) const;
+
+  const std::string &symbol(int index) const { return symbols_[index]; }
+  const std::vector<std::string> &symbols() const { return symbols_; }
+  size_t size() const { return symbols_.size(); }
+
+  const BookTop &top(int index) const { return tops_[index]; }
+  BookTop *mutable_top(int index) { return &tops_[index]; }
+
+  // Best TOP_OF_BOOK_DEPTH levels of the same book
+  const TopOfBook &depth(int index) const { return depths_[index]; }
+  TopOfBook *mutable_depth(int index) { return &depths_[index]; }
+
+  // Set top(index) from the best levels of depth(index)
+  void UpdateTop(int index);
+
+  // Timestamp at which this tick started
+  uint64_t timestamp() const { return timestamp_; }
+  void set_timestamp(uint64_t timestamp) { timestamp_ = timestamp; }
+
+ private:
+  std::vector<std::string> symbols_;
+  std::vector<BookTop> tops_;
+  std::vector<TopOfBook> depths_;
+  std::map<std::string, int> symbol_indices_;
+  uint64_t timestamp_ = 0;
+};
+
+inline int MarketView::AddSymbol(const std::string &symbol) {
+  auto it = symbol_indices_.find(symbol);
+  if (it != symbol_indices_.end()) return it->second;
+  int index = symbols_.size();
+  symbols_.push_back(symbol);
+  tops_.emplace_back();
+  depths_.push_back(TopOfBook());
+  symbol_indices_[symbol] = index;
+  return index;
+}
+
+inline void MarketView::UpdateTop(int index) {
+  const TopOfBook &depth = depths_[index];
+  BookTop &top = tops_[index];
+  top.highest_buy_price_ =
+      depth.num_buy_levels_ > 0 ? depth.buy_prices_[0] : LOWEST_BUY_PRICE;
+  top.lowest_sell_price_ =
+      depth.num_sell_levels_ > 0 ? depth.sell_prices_[0] : HIGHEST_SELL_PRICE;
+  top.creation_timestamp_ = depth.creation_timestamp_;
+}
+
+inline int MarketView::SymbolIndex(const std::string &symbol) const {
+  auto it = symbol_indices_.find(symbol);
+  return it == symbol_indices_.end() ? -1 : it->second;
+}
+
+#define NUM_ORDER_RESULTS (static_cast<int>(OrderResult::unknown) + 1)
+
+// Metric ids of the orders sent by executors: round-trip time to the
+// gateway's reply and the count of each result, for buys, sells and cancels
+class OrderMetrics {
+ public:
+  static const OrderMetrics &Get() {
+    static const OrderMetrics metrics;
+    return metrics;
+  }
+
+  void Record(OrderAction action, OrderResult result,
+              uint64_t start_ns) const {
+    MetricsRegistry *registry = MetricsRegistry::Get();
+    int kind = action == OrderAction::buy ? 0 : 2;
+    if (action == OrderAction::sell) kind = 1;
+    registry->Observe(round_trips_[kind], (MetricsNowNs() - start_ns) / 1000);
+    registry->Add(results_[kind][static_cast<int>(result)]);
+  }
+
+ private:
+  OrderMetrics() {
+    static const char *kActions[] = {"buy", "sell", "cancel"};
+    static const char *kResults[NUM_ORDER_RESULTS] = {
+        "valid", "invalid", "malformed", "duplicate", "error", "flushed",
+        "authorization_error", "network_error", "window_exceeed",
+        "in_gateway", "in_sequencer", "me_shut", "unknown"};
+    MetricsRegistry *registry = MetricsRegistry::Get();
+    for (int kind = 0; kind < 3; kind++) {
+      round_trips_[kind] = registry->AddHistogram(
+          "trader_order_round_trip_us",
+          "Time from sending an order to the gateway's reply",
+          MetricLabels({{"action", kActions[kind]}}));
+      for (int result = 0; result < NUM_ORDER_RESULTS; result++) {
+        results_[kind][result] = registry->AddCounter(
+            "trader_order_results_total", "Gateway replies by result",
+            MetricLabels(
+                {{"action", kActions[kind]}, {"result", kResults[result]}}));
+      }
+    }
+  }
+
+  int round_trips_[3];
+  int results_[3][NUM_ORDER_RESULTS];
+};
+
+// Sends strategy orders to a live Trader, or to anything with the same
+// SubmitOrder and SubmitCancel (such as a GatewayRouter). Strategies are
+// templated on the executor, so the same strategy code can run against a
+// simulated one. Every order is recorded in OrderMetrics.
+template <typename TraderType>
+class BasicTraderExecutor {
+ public:
+  explicit BasicTraderExecutor(TraderType *trader) : trader_(trader) {}
+
+  OrderResult Submit(const std::string &symbol, OrderAction action,
+                     int num_shares, int limit_price, Order *order) {
+    uint64_t start = MetricsNowNs();
+    OrderResult result = trader_->SubmitOrder(
+        symbol, order, OrderType::limit, action, num_shares, limit_price);
+    OrderMetrics::Get().Record(action, result, start);
+    return result;
+  }
+
+  OrderResult Cancel(const std::string &order_id) {
+    uint64_t start = MetricsNowNs();
+    OrderResult result = trader_->SubmitCancel(order_id);
+    OrderMetrics::Get().Record(OrderAction::cancel, result, start);
+    return result;
+  }
+
+  TraderType *trader() const { return trader_; }
+
+ private:
+  TraderType *trader_;
+};
+
+typedef BasicTraderExecutor<Trader> TraderExecutor;
+
+// Keeps the ids of the orders a strategy submitted and cancels the oldest
+// ones once too many are outstanding. Only the id strings are kept, and a
+// cancelled id is moved out rather than copied.
+class OrderTracker {
+ public:
+  // Remember order if the gateway assigned it an id
+  void Track(const Order &order) {
+    if (order.order_id_ != "NULL" && !order.order_id_.empty()) {
+      previous_orders_.push(order.order_id_);
+    }
+  }
+
+  template <typename Executor>
+  void CancelStale(Executor *executor) {
+    if (previous_orders_.size() < MAX_TRACKED_ORDERS) return;
+    for (int i = 0; i < CANCEL_BATCH_SIZE; i++) {
+      std::string order_id = std::move(previous_orders_.front());
+      previous_orders_.pop();
+      executor->Cancel(order_id);
+      VLOG(1) << "i= " << i << "\tCancel " << order_id;
+    }
+  }
+
+  size_t size() const { return previous_orders_.size(); }
+
+  void Save(CheckpointWriter *writer) const {
+    std::queue<std::string> orders = previous_orders_;
+    writer->Put<uint32_t>(orders.size());
+    for (; !orders.empty(); orders.pop()) {
+      writer->PutString(orders.front());
+    }
+  }
+  bool Load(CheckpointReader *reader) {
+    uint32_t size;
+    if (!reader->Get(&size)) return false;
+    std::queue<std::string> orders;
+    std::string order_id;
+    for (uint32_t i = 0; i < size; i++) {
+      if (!reader->GetString(&order_id)) return false;
+      orders.push(std::move(order_id));
+    }
+    previous_orders_.swap(orders);
+    return true;
+  }
+
+ private:
+  std::queue<std::string> previous_orders_;
+};
+
+// Base class of all strategies, dispatched at compile time (CRTP). Derived
+// must provide
+//
+//   template <typename Executor>
+//   void OnTick(const MarketView &view, Executor *executor);
+//
+// which is called every tick_length seconds. Orders placed through Submit()
+// are tracked and cancelled by the shared cancel logic. Strategies with state
+// that should survive a restart also define SaveState/LoadState, calling the
+// base versions first.
+template <typename Derived>
+class Strategy {
+ public:
+  Strategy(const std::vector<std::string> &symbols, uint32_t tick_length)
+      : symbols_(symbols), tick_length_(tick_length) {}
+
+  const std::vector<std::string> &symbols() const { return symbols_; }
+  uint32_t tick_length() const { return tick_length_; }
+
+  // Resolve symbol indices against the view and set how many runner ticks
+  // make one strategy tick. Called once by the runner before the first tick.
+  void Bind(MarketView *view, uint32_t runner_tick_length) {
+    symbol_indices_.clear();
+    for (auto &symbol : symbols_) {
+      symbol_indices_.push_back(view->AddSymbol(symbol));
+    }
+    ticks_per_run_ = runner_tick_length == 0
+                         ? 1
+                         : std::max<uint32_t>(
+                               1, tick_length_ / runner_tick_length);
+    tick_count_ = 0;
+  }
+
+  template <typename Executor>
+  void Tick(const MarketView &view, Executor *executor) {
+    if (++tick_count_ < ticks_per_run_) return;
+    tick_count_ = 0;
+    static_cast<Derived *>(this)->OnTick(view, executor);
+    tracker_.CancelStale(executor);
+  }
+
+  // Checkpoint of the state built up across ticks (see
+  // StrategyRunner::SaveCheckpoint)
+  void SaveState(CheckpointWriter *writer) const {
+    writer->Put<uint32_t>(tick_count_);
+    tracker_.Save(writer);
+  }
+  bool LoadState(CheckpointReader *reader) {
+    return reader->Get(&tick_count_) && tracker_.Load(reader);
+  }
+
+ protected:
+  // Index into the view of the i-th symbol given at construction
+  int symbol_index(size_t i) const { return symbol_indices_[i]; }
+
+  // Submit a limit order and track it for cancellation
+  template <typename Executor>
+  OrderResult Submit(Executor *executor, const std::string &symbol,
+                     OrderAction action, int num_shares, int limit_price,
+                     Order *order) {
+    OrderResult result =
+        executor->Submit(symbol, action, num_shares, limit_price, order);
+    tracker_.Track(*order);
+    return result;
+  }
+
+ private:
+  std::vector<std::string> symbols_;
+  std::vector<int> symbol_indices_;
+  uint32_t tick_length_;
+  uint32_t ticks_per_run_ = 1;
+  uint32_t tick_count_ = 0;
+  OrderTracker tracker_;
+};
+
+#endif  // TRADER_STRATEGY_H_
@@ -0,0 +1,251 @@
+#ifndef TRADER_STRATEGY_RUNNER_H_
+#define TRADER_STRATEGY_RUNNER_H_
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "trader/checkpoint.h"
+#include "trader/strategy.h"
+
+// Version of the runner checkpoint layout
+#define RUNNER_CHECKPOINT_VERSION 1
+// Books and trades of each symbol kept in a checkpoint
+#define CHECKPOINT_MARKET_DATA_LIMIT 256
+
+// Runs any number of strategy instances of the types Strategies... in one
+// thread, on one Trader (or GatewayRouter, or anything else with the Trader
+// methods used below) and one set of market data subscriptions. Every tick
+// the runner refreshes the MarketView once per symbol and then calls each
+// strategy; the calls are resolved at compile time, so each strategy's
+// OnTick can be inlined into the loop. Ticks follow the Trader's clock, so
+// under a simulated or event clock they run as fast as the data allows.
+template <typename TraderType, typename... Strategies>
+class BasicStrategyRunner {
+ public:
+  explicit BasicStrategyRunner(TraderType *trader)
+      : trader_(trader), executor_(trader) {}
+
+  // Add a strategy instance. Must be called before Start().
+  template <typename S>
+  void Add(S strategy) {
+    std::get<std::vector<S> >(strategies_).push_back(std::move(strategy));
+  }
+
+  // Subscribe to the union of all strategy symbols and bind the strategies.
+  // The runner ticks at the greatest common divisor of the tick lengths.
+  bool Start() {
+    tick_length_ = 0;
+    ForEachStrategy([this](auto &strategy) {
+      tick_length_ = Gcd(tick_length_, strategy.tick_length());
+      for (auto &symbol : strategy.symbols()) {
+        view_.AddSymbol(symbol);
+      }
+    });
+    if (tick_length_ == 0) tick_length_ = 1;
+    ForEachStrategy(
+        [this](auto &strategy) { strategy.Bind(&view_, tick_length_); });
+    trader_symbol_indices_.clear();
+    for (auto &symbol : view_.symbols()) {
+      trader_symbol_indices_.push_back(trader_->GetSymbolIndex(symbol));
+    }
+    return trader_->ConfigActiveSymbols(view_.symbols());
+  }
+
+  // Tick until *run becomes false
+  void Run(volatile bool *run) {
+    Clock *clock = trader_->clock();
+    clock->AddParticipant();
+    uint64_t start_timestamp = clock->Now();
+    uint64_t last_checkpoint = start_timestamp;
+    while (*run) {
+      clock->SleepUntil(start_timestamp +
+                        static_cast<uint64_t>(tick_length_) * 1000 * 1000);
+      start_timestamp = clock->Now();
+      VLOG(1) << "New Loop StartTimestamp = " << start_timestamp;
+      view_.set_timestamp(start_timestamp);
+      // Time bars of symbols without trades close on the tick
+      trader_->AdvanceBars(start_timestamp);
+      RefreshView();
+      ForEachStrategy(
+          [this](auto &strategy) { strategy.Tick(view_, &executor_); });
+      if (checkpoint_file_ != nullptr &&
+          start_timestamp - last_checkpoint >= checkpoint_interval_) {
+        SaveCheckpoint(checkpoint_file_);
+        last_checkpoint = start_timestamp;
+      }
+    }
+    clock->RemoveParticipant();
+  }
+
+  // Save the Trader's and every strategy's state to file from Run() every
+  // interval_seconds of clock time (nullptr to stop). Saving runs on the
+  // tick thread, between ticks, so strategies need no locking.
+  void SetCheckpoint(CheckpointFile *file, uint32_t interval_seconds) {
+    checkpoint_file_ = file;
+    checkpoint_interval_ = static_cast<uint64_t>(interval_seconds) * 1000 *
+                           1000;
+  }
+
+  bool SaveCheckpoint(CheckpointFile *file) {
+    CheckpointWriter trader_state;
+    if (!trader_->SaveState(&trader_state, CHECKPOINT_MARKET_DATA_LIMIT)) {
+      return false;
+    }
+    CheckpointWriter writer;
+    writer.Put<uint32_t>(RUNNER_CHECKPOINT_VERSION);
+    writer.Put<uint64_t>(trader_->clock()->Now());
+    writer.PutString(trader_state.data());
+    std::vector<std::pair<std::string, std::string> > states;
+    CheckpointWriter state;
+    ForEachStrategyKeyed([&](auto &strategy, const std::string &key) {
+      state.Clear();
+      strategy.SaveState(&state);
+      states.emplace_back(key, state.data());
+    });
+    writer.Put<uint32_t>(states.size());
+    for (auto &entry : states) {
+      writer.PutString(entry.first);
+      writer.PutString(entry.second);
+    }
+    return file->Save(writer.data());
+  }
+
+  // Restore the newest checkpoint in file. Call after Start() and before
+  // Run(). Strategies are matched to saved states by type, position and
+  // symbols; any without a matching, loadable state start fresh. Returns
+  // false if there is no usable checkpoint or reconciliation fails.
+  bool RestoreCheckpoint(CheckpointFile *file,
+                         StateReconciliation *reconciliation) {
+    std::string data;
+    if (!file->Load(&data)) {
+      LOG(INFO) << "No Checkpoint to Restore";
+      return false;
+    }
+    CheckpointReader reader(data);
+    uint32_t version;
+    std::string trader_state;
+    uint32_t num_states;
+    if (!reader.Get(&version) || version != RUNNER_CHECKPOINT_VERSION ||
+        !reader.Get(&reconciliation->checkpoint_timestamp_) ||
+        !reader.GetString(&trader_state)) {
+      LOG(ERROR) << "Unreadable Checkpoint";
+      return false;
+    }
+    std::map<std::string, std::string> states;
+    std::string key;
+    std::string state;
+    if (reader.Get(&num_states)) {
+      for (uint32_t i = 0; i < num_states; i++) {
+        if (!reader.GetString(&key) || !reader.GetString(&state)) break;
+        states[key] = state;
+      }
+    }
+
+    // The Trader first, so a failed restore leaves every strategy fresh
+    CheckpointReader trader_reader(trader_state);
+    if (!trader_->RestoreState(&trader_reader, reconciliation)) {
+      return false;
+    }
+    int restored = 0;
+    ForEachStrategyKeyed([&](auto &strategy, const std::string &key) {
+      auto it = states.find(key);
+      if (it == states.end()) return;
+      // Loaded into a copy so a failed load leaves the strategy fresh
+      auto loaded = strategy;
+      CheckpointReader state_reader(it->second);
+      if (loaded.LoadState(&state_reader)) {
+        strategy = loaded;
+        restored++;
+      }
+    });
+    LOG(INFO) << "Restored Checkpoint of "
+              << reconciliation->checkpoint_timestamp_ << ": " << restored
+              << " Strategies, "
+              << reconciliation->closed_orders_.size()
+              << " Orders Closed and " << reconciliation->new_orders_.size()
+              << " Opened Since";
+    return true;
+  }
+
+  const MarketView &view() const { return view_; }
+
+ private:
+  // Read the newest top-of-book of every symbol, without copying books
+  void RefreshView() {
+    for (size_t i = 0; i < view_.size(); i++) {
+      if (trader_->GetTopOfBook(trader_symbol_indices_[i],
+                                view_.mutable_depth(i))) {
+        view_.UpdateTop(i);
+      }
+    }
+  }
+
+  template <typename F>
+  void ForEachStrategy(F f) {
+    ForEachStrategy(f, std::index_sequence_for<Strategies...>());
+  }
+
+  template <typename F, size_t... I>
+  void ForEachStrategy(F &f, std::index_sequence<I...>) {
+    int expand[] = {0, (ForEachIn(&std::get<I>(strategies_), f), 0)...};
+    (void)expand;
+  }
+
+  template <typename S, typename F>
+  static void ForEachIn(std::vector<S> *strategies, F &f) {
+    for (auto &strategy : *strategies) {
+      f(strategy);
+    }
+  }
+
+  // Call f(strategy, key) for every strategy, where key identifies the
+  // strategy across restarts of the same configuration
+  template <typename F>
+  void ForEachStrategyKeyed(F f) {
+    ForEachStrategyKeyed(f, std::index_sequence_for<Strategies...>());
+  }
+
+  template <typename F, size_t... I>
+  void ForEachStrategyKeyed(F &f, std::index_sequence<I...>) {
+    int expand[] = {0, (ForEachKeyedIn(I, &std::get<I>(strategies_), f), 0)...};
+    (void)expand;
+  }
+
+  template <typename S, typename F>
+  static void ForEachKeyedIn(size_t type_index, std::vector<S> *strategies,
+                             F &f) {
+    for (size_t i = 0; i < strategies->size(); i++) {
+      std::string key = std::to_string(type_index) + ":" + std::to_string(i);
+      for (auto &symbol : (*strategies)[i].symbols()) {
+        key += ":" + symbol;
+      }
+      f((*strategies)[i], key);
+    }
+  }
+
+  static uint32_t Gcd(uint32_t a, uint32_t b) {
+    while (b != 0) {
+      uint32_t t = a % b;
+      a = b;
+      b = t;
+    }
+    return a;
+  }
+
+  TraderType *trader_;
+  BasicTraderExecutor<TraderType> executor_;
+  std::tuple<std::vector<Strategies>...> strategies_;
+  MarketView view_;
+  std::vector<int> trader_symbol_indices_;
+  uint32_t tick_length_ = 1;
+  CheckpointFile *checkpoint_file_ = nullptr;
+  uint64_t checkpoint_interval_ = 0;
+};
+
+template <typename... Strategies>
+using StrategyRunner = BasicStrategyRunner<Trader, Strategies...>;
+
+#endif  // TRADER_STRATEGY_RUNNER_H_
@@ -0,0 +1,138 @@
+#ifndef TRADER_SUBSCRIPTION_H_
+#define TRADER_SUBSCRIPTION_H_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/ring_pool.h"
+
+// How a subscription hands over the entries received since its last poll
+//
+//   all            Every entry, oldest first. Entries overwritten in the
+//                  Trader's pool before being polled are counted as dropped.
+//   latest_only    Only the newest entry; the rest are counted as conflated.
+//   conflate       The newest entry of each conflate_interval_ms window
+//                  (by creation timestamp); the rest are counted as
+//                  conflated. A window is delivered once it has closed,
+//                  i.e. once an entry of a later window has been received,
+//                  so at most one entry per window is ever delivered and
+//                  the newest entry waits for the next window to start.
+//                  Entries overwritten before being polled may have closed
+//                  windows of their own, so they are counted as dropped.
+enum class DeliveryPolicy { all, latest_only, conflate };
+
+// Market data stream of an active symbol
+enum class MarketDataChannel { lob, trade };
+
+// Delivery counters of a subscription. Every entry received on the symbol
+// after the subscription was made ends up in exactly one of delivered_,
+// conflated_ and dropped_, once polled.
+class SubscriptionStats {
+ public:
+  uint64_t delivered_ = 0;      // Entries handed to the consumer
+  uint64_t conflated_ = 0;      // Entries skipped by the delivery policy
+  uint64_t dropped_ = 0;        // Entries lost before they could be polled
+  uint64_t last_sequence_ = 0;  // Sequence number of the newest entry seen
+  uint64_t backlog_ = 0;        // Entries pending at the last poll
+};
+
+// One consumer's cursor into the market data pool of a symbol. Not thread
+// safe; the Trader polls it under the symbol's mutex.
+class Subscription {
+ public:
+  Subscription(const std::string &symbol, MarketDataChannel channel,
+               DeliveryPolicy policy, uint64_t conflate_interval_ms,
+               uint64_t next_sequence)
+      : symbol_(symbol),
+        channel_(channel),
+        policy_(policy),
+        conflate_interval_(
+            std::max<uint64_t>(conflate_interval_ms, 1) * 1000),
+        next_sequence_(next_sequence) {}
+
+  // Replace *out with the entries of pool due to this subscription and
+  // advance past everything pending (past all but the entry of the open
+  // window, when conflating). Returns the number of entries dropped by this
+  // poll.
+  template <typename T>
+  uint64_t Poll(const RingPool<T> &pool,
+                std::vector<std::shared_ptr<const T> > *out);
+
+  const std::string &symbol() const { return symbol_; }
+  MarketDataChannel channel() const { return channel_; }
+  DeliveryPolicy policy() const { return policy_; }
+  const SubscriptionStats &stats() const { return stats_; }
+
+ private:
+  std::string symbol_;
+  MarketDataChannel channel_;
+  DeliveryPolicy policy_;
+  uint64_t conflate_interval_;  // Microseconds
+  uint64_t next_sequence_;
+  SubscriptionStats stats_;
+};
+
+template <typename T>
+uint64_t Subscription::Poll(const RingPool<T> &pool,
+                            std::vector<std::shared_ptr<const T> > *out) {
+  out->clear();
+  uint64_t last = pool.last_sequence();
+  if (next_sequence_ > last) {
+    stats_.backlog_ = 0;
+    return 0;
+  }
+  uint64_t dropped = 0;
+  uint64_t first = pool.first_sequence();
+  if (next_sequence_ < first) {
+    // Overwritten before this poll. Not a loss only when just the newest
+    // entry was wanted.
+    if (policy_ != DeliveryPolicy::latest_only) {
+      dropped = first - next_sequence_;
+      stats_.dropped_ += dropped;
+    } else {
+      stats_.conflated_ += first - next_sequence_;
+    }
+    next_sequence_ = first;
+  }
+  stats_.backlog_ = last - next_sequence_ + 1;
+
+  switch (policy_) {
+    case DeliveryPolicy::all:
+      for (uint64_t sequence = next_sequence_; sequence <= last; sequence++) {
+        out->push_back(pool.View(sequence));
+      }
+      break;
+    case DeliveryPolicy::latest_only:
+      out->push_back(pool.View(last));
+      stats_.conflated_ += last - next_sequence_;
+      break;
+    case DeliveryPolicy::conflate: {
+      std::shared_ptr<const T> entry = pool.View(next_sequence_);
+      for (uint64_t sequence = next_sequence_; sequence < last; sequence++) {
+        std::shared_ptr<const T> next = pool.View(sequence + 1);
+        if (next->creation_timestamp_ / conflate_interval_ ==
+            entry->creation_timestamp_ / conflate_interval_) {
+          stats_.conflated_++;
+        } else {
+          out->push_back(entry);
+        }
+        entry = next;
+      }
+      // The last entry's window is still open; it is settled by a later poll
+      stats_.delivered_ += out->size();
+      stats_.last_sequence_ = last;
+      next_sequence_ = last;
+      return dropped;
+    }
+  }
+  stats_.delivered_ += out->size();
+  stats_.last_sequence_ = last;
+  next_sequence_ = last + 1;
+  return dropped;
+}
+
+#endif  // TRADER_SUBSCRIPTION_H_
@@ -0,0 +1,129 @@
+#include "trader/subscription.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+namespace {
+
+class Entry {
+ public:
+  uint64_t creation_timestamp_ = 0;
+};
+
+void Put(RingPool<Entry> *pool, uint64_t timestamp) {
+  Entry entry;
+  entry.creation_timestamp_ = timestamp;
+  pool->Put(entry);
+}
+
+std::vector<uint64_t> Timestamps(
+    const std::vector<std::shared_ptr<const Entry> > &entries) {
+  std::vector<uint64_t> timestamps;
+  for (auto &entry : entries) timestamps.push_back(entry->creation_timestamp_);
+  return timestamps;
+}
+
+TEST(SubscriptionTest, AllDeliversEveryEntryOldestFirst) {
+  RingPool<Entry> pool(8);
+  Subscription subscription("AA", MarketDataChannel::lob, DeliveryPolicy::all,
+                            0, pool.last_sequence() + 1);
+  std::vector<std::shared_ptr<const Entry> > out;
+  EXPECT_EQ(subscription.Poll(pool, &out), 0u);
+  EXPECT_TRUE(out.empty());
+
+  Put(&pool, 10);
+  Put(&pool, 20);
+  Put(&pool, 30);
+  EXPECT_EQ(subscription.Poll(pool, &out), 0u);
+  EXPECT_EQ(Timestamps(out), std::vector<uint64_t>({10, 20, 30}));
+  EXPECT_EQ(subscription.Poll(pool, &out), 0u);
+  EXPECT_TRUE(out.empty());
+  EXPECT_EQ(subscription.stats().delivered_, 3u);
+}
+
+TEST(SubscriptionTest, AllCountsOverwrittenEntriesAsDropped) {
+  RingPool<Entry> pool(2);
+  Subscription subscription("AA", MarketDataChannel::trade,
+                            DeliveryPolicy::all, 0, 1);
+  for (uint64_t timestamp = 1; timestamp <= 5; timestamp++) {
+    Put(&pool, timestamp);
+  }
+  std::vector<std::shared_ptr<const Entry> > out;
+  EXPECT_EQ(subscription.Poll(pool, &out), 3u);
+  EXPECT_EQ(Timestamps(out), std::vector<uint64_t>({4, 5}));
+  EXPECT_EQ(subscription.stats().dropped_, 3u);
+  EXPECT_EQ(subscription.stats().delivered_, 2u);
+}
+
+TEST(SubscriptionTest, LatestOnlyConflatesTheRest) {
+  RingPool<Entry> pool(2);
+  Subscription subscription("AA", MarketDataChannel::lob,
+                            DeliveryPolicy::latest_only, 0, 1);
+  for (uint64_t timestamp = 1; timestamp <= 5; timestamp++) {
+    Put(&pool, timestamp);
+  }
+  std::vector<std::shared_ptr<const Entry> > out;
+  EXPECT_EQ(subscription.Poll(pool, &out), 0u);
+  EXPECT_EQ(Timestamps(out), std::vector<uint64_t>({5}));
+  EXPECT_EQ(subscription.stats().conflated_, 4u);
+  EXPECT_EQ(subscription.stats().dropped_, 0u);
+}
+
+TEST(SubscriptionTest, ConflateDeliversOnePerClosedWindow) {
+  RingPool<Entry> pool(16);
+  // 1 ms windows
+  Subscription subscription("AA", MarketDataChannel::lob,
+                            DeliveryPolicy::conflate, 1, 1);
+  std::vector<std::shared_ptr<const Entry> > out;
+  Put(&pool, 1000);
+  Put(&pool, 1500);
+  subscription.Poll(pool, &out);
+  // Window 1 is still open
+  EXPECT_TRUE(out.empty());
+
+  Put(&pool, 1900);
+  subscription.Poll(pool, &out);
+  EXPECT_TRUE(out.empty());
+
+  Put(&pool, 2100);
+  Put(&pool, 3000);
+  subscription.Poll(pool, &out);
+  EXPECT_EQ(Timestamps(out), std::vector<uint64_t>({1900, 2100}));
+
+  // Polling faster than the window never delivers a second entry of it
+  Put(&pool, 3100);
+  subscription.Poll(pool, &out);
+  EXPECT_TRUE(out.empty());
+  Put(&pool, 3200);
+  subscription.Poll(pool, &out);
+  EXPECT_TRUE(out.empty());
+  Put(&pool, 4000);
+  subscription.Poll(pool, &out);
+  EXPECT_EQ(Timestamps(out), std::vector<uint64_t>({3200}));
+
+  const SubscriptionStats &stats = subscription.stats();
+  EXPECT_EQ(stats.delivered_, 3u);
+  EXPECT_EQ(stats.conflated_, 4u);
+  EXPECT_EQ(stats.backlog_, 2u);
+  EXPECT_EQ(stats.last_sequence_, 8u);
+}
+
+TEST(SubscriptionTest, ConflateCountsOverwrittenEntriesAsDropped) {
+  RingPool<Entry> pool(2);
+  Subscription subscription("AA", MarketDataChannel::lob,
+                            DeliveryPolicy::conflate, 1, 1);
+  for (uint64_t timestamp = 1000; timestamp <= 5000; timestamp += 1000) {
+    Put(&pool, timestamp);
+  }
+  std::vector<std::shared_ptr<const Entry> > out;
+  // The windows of 1000, 2000 and 3000 are lost with their entries
+  EXPECT_EQ(subscription.Poll(pool, &out), 3u);
+  EXPECT_EQ(Timestamps(out), std::vector<uint64_t>({4000}));
+  EXPECT_EQ(subscription.stats().conflated_, 0u);
+  EXPECT_EQ(subscription.stats().dropped_, 3u);
+  EXPECT_EQ(subscription.stats().delivered_, 1u);
+}
+
+}  // namespace
@@ -0,0 +1,500 @@
+#include "common/text_parser.h"
+
+#include <limits.h>
+#include <string.h>
+
+#include <atomic>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define TEXT_PARSER_HAVE_AVX2 1
+#endif
+
+#include "common/utils.h"
+
+// Fields of at least this many digits are converted with SIMD; shorter
+// ones are quicker digit by digit
+#define TEXT_SIMD_MIN_DIGITS 8
+// Header fields of a book and a snapshot
+#define TEXT_BOOK_HEADER_FIELDS 5
+#define TEXT_SNAPSHOT_HEADER_FIELDS 4
+
+namespace {
+
+typedef std::map<std::string, Order> OrderQueue;
+
+// Kernels, scalar and AVX2 as in indicators.cpp
+
+// Offsets of the delimiters in data[begin, len), written to ends. Returns
+// the count.
+size_t ScalarScan(const char *data, size_t begin, size_t len, uint32_t *ends) {
+  size_t count = 0;
+  for (size_t i = begin; i < len; i++) {
+    if (data[i] == TEXT_FIELD_DELIMITER) ends[count++] = i;
+  }
+  return count;
+}
+
+// As SkipTextFields, for n > 0
+size_t ScalarSkip(const char *data, size_t len, size_t begin, size_t n) {
+  for (size_t i = begin; i < len; i++) {
+    if (data[i] == TEXT_FIELD_DELIMITER && --n == 0) return i + 1;
+  }
+  return len + 1;
+}
+
+// Value of the len digits at field
+bool ScalarDigits(const char *field, size_t len, uint64_t *value) {
+  uint64_t result = 0;
+  for (size_t i = 0; i < len; i++) {
+    unsigned digit = static_cast<unsigned char>(field[i]) - '0';
+    if (digit > 9) return false;
+    result = result * 10 + digit;
+  }
+  *value = result;
+  return true;
+}
+
+#ifdef TEXT_PARSER_HAVE_AVX2
+
+__attribute__((target("avx2"))) size_t Avx2Scan(const char *data,
+                                                size_t begin, size_t len,
+                                                uint32_t *ends) {
+  const __m256i delimiter = _mm256_set1_epi8(TEXT_FIELD_DELIMITER);
+  size_t count = 0;
+  size_t i = begin;
+  for (; i + 32 <= len; i += 32) {
+    __m256i bytes =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+    uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, delimiter));
+    while (mask != 0) {
+      ends[count++] = i + __builtin_ctz(mask);
+      mask &= mask - 1;
+    }
+  }
+  return count + ScalarScan(data, i, len, ends + count);
+}
+
+__attribute__((target("avx2,popcnt"))) size_t Avx2Skip(const char *data,
+                                                       size_t len,
+                                                       size_t begin,
+                                                       size_t n) {
+  const __m256i delimiter = _mm256_set1_epi8(TEXT_FIELD_DELIMITER);
+  size_t i = begin;
+  for (; i + 32 <= len; i += 32) {
+    __m256i bytes =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+    uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, delimiter));
+    size_t count = __builtin_popcount(mask);
+    if (count < n) {
+      n -= count;
+      continue;
+    }
+    // The n-th delimiter is in this block
+    while (--n > 0) mask &= mask - 1;
+    return i + __builtin_ctz(mask) + 1;
+  }
+  return ScalarSkip(data, len, i, n);
+}
+
+// Value of 1 to 16 digits at field, reading the 16 bytes that end with
+// them (the caller guarantees they are readable)
+__attribute__((target("avx2"))) bool Avx2Digits(const char *field,
+                                                size_t len,
+                                                uint64_t *value) {
+  // Right-align the digits in 16 lanes and zero the lanes before the field
+  __m128i bytes =
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(field + len - 16));
+  __m128i digits = _mm_sub_epi8(bytes, _mm_set1_epi8('0'));
+  __m128i lanes =
+      _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  __m128i outside = _mm_cmplt_epi8(lanes, _mm_set1_epi8(16 - len));
+  __m128i valid =
+      _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+  if (_mm_movemask_epi8(_mm_or_si128(valid, outside)) != 0xFFFF) {
+    return false;
+  }
+  digits = _mm_andnot_si128(outside, digits);
+  // Pairs of digits, then 4, then 8
+  __m128i pairs = _mm_maddubs_epi16(
+      digits, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1,
+                            10, 1));
+  __m128i quads =
+      _mm_madd_epi16(pairs, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+  __m128i eights = _mm_madd_epi16(
+      _mm_packus_epi32(quads, quads),
+      _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+  *value = static_cast<uint64_t>(_mm_cvtsi128_si32(eights)) * 100000000 +
+           static_cast<uint32_t>(_mm_extract_epi32(eights, 1));
+  return true;
+}
+
+#endif
+
+struct Kernels {
+  size_t (*scan)(const char *, size_t, size_t, uint32_t *);
+  size_t (*skip)(const char *, size_t, size_t, size_t);
+  bool (*digits)(const char *, size_t, uint64_t *);
+};
+
+const Kernels kScalarKernels = {ScalarScan, ScalarSkip, ScalarDigits};
+
+#ifdef TEXT_PARSER_HAVE_AVX2
+const Kernels kAvx2Kernels = {Avx2Scan, Avx2Skip, Avx2Digits};
+#endif
+
+const Kernels *SelectKernels() {
+#ifdef TEXT_PARSER_HAVE_AVX2
+  if (__builtin_cpu_supports("avx2")) return &kAvx2Kernels;
+#endif
+  return &kScalarKernels;
+}
+
+const Kernels *active_kernels = SelectKernels();
+
+// Delimiter offsets of the message being parsed, reused by each thread
+thread_local std::vector<uint32_t> field_ends;
+// Map nodes of parsed-over book queues, kept for the next book
+thread_local std::vector<OrderQueue::node_type> spare_nodes;
+
+// Digits of data[begin, begin + len), where data is the start of the
+// message: the SIMD path reads the 16 bytes ending at the field, so it is
+// taken only where those lie inside the message
+bool ParseDigits(const char *data, size_t begin, size_t len,
+                 uint64_t *value) {
+  if (len == 0 || len > 19) return false;
+  const char *field = data + begin;
+  if (len < TEXT_SIMD_MIN_DIGITS || begin + len < 16) {
+    return ScalarDigits(field, len, value);
+  }
+  if (len <= 16) return active_kernels->digits(field, len, value);
+  // The digits before the last 16
+  uint64_t high, low;
+  if (!ScalarDigits(field, len - 16, &high) ||
+      !active_kernels->digits(field + len - 16, 16, &low)) {
+    return false;
+  }
+  *value = high * 10000000000000000ULL + low;
+  return true;
+}
+
+// parsed with its sign, if it fits in [min, max]; min's magnitude is one
+// more than max
+template <typename T>
+bool FitSigned(uint64_t parsed, bool negative, T max, T *value) {
+  uint64_t limit = static_cast<uint64_t>(max) + (negative ? 1 : 0);
+  if (parsed > limit) return false;
+  if (!negative) {
+    *value = static_cast<T>(parsed);
+  } else if (parsed == limit) {
+    *value = -max - 1;
+  } else {
+    *value = -static_cast<T>(parsed);
+  }
+  return true;
+}
+
+// Fields of one message, read in order
+class FieldReader {
+ public:
+  FieldReader(const char *data, size_t len) : data_(data) {
+    // One past the last delimiter closes the last field
+    if (field_ends.size() < len + 1) field_ends.resize(len + 1);
+    count_ = active_kernels->scan(data, 0, len, field_ends.data());
+    field_ends[count_++] = len;
+  }
+
+  size_t remaining() const { return count_ - next_; }
+
+  bool String(std::string *value) {
+    if (next_ == count_) return false;
+    value->assign(data_ + begin_, field_ends[next_] - begin_);
+    Advance();
+    return true;
+  }
+  bool Char(char *value) {
+    if (next_ == count_ || field_ends[next_] - begin_ != 1) return false;
+    *value = data_[begin_];
+    Advance();
+    return true;
+  }
+  template <typename T>
+  bool Unsigned(T *value) {
+    uint64_t parsed;
+    if (next_ == count_ ||
+        !ParseDigits(data_, begin_, field_ends[next_] - begin_, &parsed)) {
+      return false;
+    }
+    *value = static_cast<T>(parsed);
+    Advance();
+    return true;
+  }
+  bool Signed(int *value) {
+    if (next_ == count_ || field_ends[next_] == begin_) return false;
+    size_t begin = begin_;
+    bool negative = data_[begin] == '-';
+    if (negative) begin++;
+    uint64_t parsed;
+    if (!ParseDigits(data_, begin, field_ends[next_] - begin, &parsed) ||
+        !FitSigned(parsed, negative, INT_MAX, value)) {
+      return false;
+    }
+    Advance();
+    return true;
+  }
+
+ private:
+  void Advance() { begin_ = field_ends[next_++] + 1; }
+
+  const char *data_;
+  size_t count_;
+  size_t next_ = 0;
+  size_t begin_ = 0;  // Start of the next field
+};
+
+bool ReadOrder(FieldReader *reader, Order *order) {
+  char type, action, result;
+  if (!reader->String(&order->symbol_) ||
+      !reader->String(&order->order_id_) ||
+      !reader->String(&order->cancel_id_) ||
+      !reader->String(&order->client_id_) || !reader->Char(&type) ||
+      !reader->Char(&action) ||
+      !reader->Unsigned(&order->genesis_timestamp_) ||
+      !reader->Unsigned(&order->gateway_timestamp_) ||
+      !reader->Unsigned(&order->enqueue_timestamp_) ||
+      !reader->Unsigned(&order->dequeue_timestamp_) ||
+      !reader->Unsigned(&order->order_serial_num_) ||
+      !reader->Signed(&order->limit_price_) || !reader->Char(&result) ||
+      !reader->Signed(&order->num_shares_)) {
+    return false;
+  }
+  order->type_ = DeserializeType(type);
+  order->action_ = DeserializeAction(action);
+  order->result_ = DeserializeResult(result);
+  return true;
+}
+
+// Refill queue with count orders, reusing the nodes of its previous orders
+bool ReadQueue(FieldReader *reader, uint64_t count, OrderQueue *queue) {
+  while (!queue->empty()) {
+    spare_nodes.push_back(queue->extract(queue->begin()));
+  }
+  Order order;
+  for (uint64_t i = 0; i < count; i++) {
+    if (spare_nodes.empty()) {
+      if (!ReadOrder(reader, &order)) return false;
+      // Orders come in key order, so the hint makes this constant time. A
+      // duplicate id inserts nothing.
+      size_t size = queue->size();
+      queue->emplace_hint(queue->end(), order.order_id_, order);
+      if (queue->size() == size) return false;
+      continue;
+    }
+    OrderQueue::node_type node = std::move(spare_nodes.back());
+    spare_nodes.pop_back();
+    if (!ReadOrder(reader, &node.mapped())) return false;
+    node.key() = node.mapped().order_id_;
+    queue->insert(queue->end(), std::move(node));
+    // A duplicate id leaves the node unconsumed
+    if (!node.empty()) return false;
+  }
+  return true;
+}
+
+// Outcome of checking a guessed layout against the constructor
+enum class LayoutCheck { unchecked, valid, invalid };
+
+std::atomic<LayoutCheck> book_layout{LayoutCheck::unchecked};
+std::atomic<LayoutCheck> snapshot_layout{LayoutCheck::unchecked};
+
+void RecordLayoutCheck(std::atomic<LayoutCheck> *check, bool same,
+                       const char *layout) {
+  if (same) {
+    LayoutCheck unchecked = LayoutCheck::unchecked;
+    check->compare_exchange_strong(unchecked, LayoutCheck::valid);
+    return;
+  }
+  if (check->exchange(LayoutCheck::invalid) != LayoutCheck::invalid) {
+    LOG(WARNING) << "Serialized " << layout
+                 << " Does Not Match the Parser, Constructing Instead";
+  }
+}
+
+bool SameOrder(const Order &a, const Order &b) {
+  return a.symbol_ == b.symbol_ && a.order_id_ == b.order_id_ &&
+         a.cancel_id_ == b.cancel_id_ && a.client_id_ == b.client_id_ &&
+         a.type_ == b.type_ && a.action_ == b.action_ &&
+         a.genesis_timestamp_ == b.genesis_timestamp_ &&
+         a.gateway_timestamp_ == b.gateway_timestamp_ &&
+         a.enqueue_timestamp_ == b.enqueue_timestamp_ &&
+         a.dequeue_timestamp_ == b.dequeue_timestamp_ &&
+         a.order_serial_num_ == b.order_serial_num_ &&
+         a.limit_price_ == b.limit_price_ && a.result_ == b.result_ &&
+         a.num_shares_ == b.num_shares_;
+}
+
+bool SameQueue(const OrderQueue &a, const OrderQueue &b) {
+  if (a.size() != b.size()) return false;
+  for (auto i = a.begin(), j = b.begin(); i != a.end(); ++i, ++j) {
+    if (i->first != j->first || !SameOrder(i->second, j->second)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SameBook(const LimitOrderBook &a, const LimitOrderBook &b) {
+  return a.symbol_ == b.symbol_ &&
+         a.creation_timestamp_ == b.creation_timestamp_ &&
+         a.release_timestamp_ == b.release_timestamp_ &&
+         SameQueue(a.buy_queue_, b.buy_queue_) &&
+         SameQueue(a.sell_queue_, b.sell_queue_);
+}
+
+bool SameSnapshot(const ClientInformationSnapshot &a,
+                  const ClientInformationSnapshot &b) {
+  if (a.client_id_ != b.client_id_ ||
+      a.global_serial_num_ != b.global_serial_num_ ||
+      a.order_serial_num_ != b.order_serial_num_ ||
+      a.my_portfolio_ != b.my_portfolio_ ||
+      a.outstanding_orders_.size() != b.outstanding_orders_.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.outstanding_orders_.size(); i++) {
+    if (!SameOrder(a.outstanding_orders_[i], b.outstanding_orders_[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+void ParseLimitOrderBookOrConstruct(const char *data, size_t len,
+                                    LimitOrderBook *book) {
+  LayoutCheck check = book_layout.load(std::memory_order_relaxed);
+  if (check == LayoutCheck::valid && ParseLimitOrderBook(data, len, book)) {
+    return;
+  }
+  LimitOrderBook constructed(std::string(data, len));
+  // A book with an empty side would leave the order layout untested
+  if (check == LayoutCheck::unchecked && !constructed.buy_queue_.empty() &&
+      !constructed.sell_queue_.empty()) {
+    RecordLayoutCheck(&book_layout,
+                      ParseLimitOrderBook(data, len, book) &&
+                          SameBook(*book, constructed),
+                      "Book");
+  }
+  *book = std::move(constructed);
+}
+
+void ParseClientInformationSnapshotOrConstruct(
+    const char *data, size_t len, ClientInformationSnapshot *snapshot) {
+  LayoutCheck check = snapshot_layout.load(std::memory_order_relaxed);
+  if (check == LayoutCheck::valid &&
+      ParseClientInformationSnapshot(data, len, snapshot)) {
+    return;
+  }
+  ClientInformationSnapshot constructed(std::string(data, len));
+  if (check == LayoutCheck::unchecked && !constructed.my_portfolio_.empty() &&
+      !constructed.outstanding_orders_.empty()) {
+    RecordLayoutCheck(&snapshot_layout,
+                      ParseClientInformationSnapshot(data, len, snapshot) &&
+                          SameSnapshot(*snapshot, constructed),
+                      "Snapshot");
+  }
+  *snapshot = std::move(constructed);
+}
+
+bool TextBookLayoutValid() {
+  return book_layout.load(std::memory_order_relaxed) == LayoutCheck::valid;
+}
+
+size_t SkipTextFields(const char *data, size_t len, size_t begin, size_t n) {
+  if (n == 0) return begin;
+  return active_kernels->skip(data, len, begin, n);
+}
+
+bool ParseTextUint(const char *data, size_t len, uint64_t *value) {
+  return ParseDigits(data, 0, len, value);
+}
+
+bool ParseTextInt(const char *data, size_t len, int64_t *value) {
+  bool negative = len > 0 && data[0] == '-';
+  uint64_t parsed;
+  return ParseDigits(data, negative ? 1 : 0, len - (negative ? 1 : 0),
+                     &parsed) &&
+         FitSigned<int64_t>(parsed, negative, INT64_MAX, value);
+}
+
+bool ParseOrder(const char *data, size_t len, Order *order) {
+  FieldReader reader(data, len);
+  return reader.remaining() == TEXT_ORDER_FIELDS && ReadOrder(&reader, order);
+}
+
+bool ParseTrade(const char *data, size_t len, Trade *trade) {
+  FieldReader reader(data, len);
+  return reader.remaining() == TEXT_TRADE_FIELDS &&
+         reader.String(&trade->symbol_) &&
+         reader.Unsigned(&trade->buyer_serial_num_) &&
+         reader.Unsigned(&trade->seller_serial_num_) &&
+         reader.String(&trade->buyer_order_id_) &&
+         reader.String(&trade->seller_order_id_) &&
+         reader.String(&trade->buyer_client_id_) &&
+         reader.String(&trade->seller_client_id_) &&
+         reader.Signed(&trade->exec_price_) &&
+         reader.Signed(&trade->cash_traded_) &&
+         reader.Signed(&trade->shares_traded_) &&
+         reader.Unsigned(&trade->creation_timestamp_) &&
+         reader.Unsigned(&trade->release_timestamp_) &&
+         reader.Unsigned(&trade->trade_serial_num_);
+}
+
+bool ParseLimitOrderBook(const char *data, size_t len, LimitOrderBook *book) {
+  FieldReader reader(data, len);
+  uint64_t num_buys, num_sells;
+  if (reader.remaining() < TEXT_BOOK_HEADER_FIELDS ||
+      !reader.String(&book->symbol_) ||
+      !reader.Unsigned(&book->creation_timestamp_) ||
+      !reader.Unsigned(&book->release_timestamp_) ||
+      !reader.Unsigned(&num_buys) || !reader.Unsigned(&num_sells) ||
+      num_buys > reader.remaining() || num_sells > reader.remaining() ||
+      reader.remaining() != (num_buys + num_sells) * TEXT_ORDER_FIELDS) {
+    return false;
+  }
+  return ReadQueue(&reader, num_buys, &book->buy_queue_) &&
+         ReadQueue(&reader, num_sells, &book->sell_queue_);
+}
+
+bool ParseClientInformationSnapshot(const char *data, size_t len,
+                                    ClientInformationSnapshot *snapshot) {
+  FieldReader reader(data, len);
+  uint64_t num_holdings, num_orders;
+  if (reader.remaining() < TEXT_SNAPSHOT_HEADER_FIELDS ||
+      !reader.String(&snapshot->client_id_) ||
+      !reader.Unsigned(&snapshot->global_serial_num_) ||
+      !reader.Unsigned(&snapshot->order_serial_num_) ||
+      !reader.Unsigned(&num_holdings) || num_holdings > reader.remaining() ||
+      reader.remaining() < num_holdings * 2 + 1) {
+    return false;
+  }
+  snapshot->my_portfolio_.clear();
+  std::string symbol;
+  for (uint64_t i = 0; i < num_holdings; i++) {
+    int shares;
+    if (!reader.String(&symbol) || !reader.Signed(&shares)) return false;
+    snapshot->my_portfolio_.emplace_hint(snapshot->my_portfolio_.end(),
+                                         symbol, shares);
+  }
+  if (!reader.Unsigned(&num_orders) || num_orders > reader.remaining() ||
+      reader.remaining() != num_orders * TEXT_ORDER_FIELDS) {
+    return false;
+  }
+  // Reuses the strings of the orders already there
+  snapshot->outstanding_orders_.resize(num_orders);
+  for (auto &order : snapshot->outstanding_orders_) {
+    if (!ReadOrder(&reader, &order)) return false;
+  }
+  return true;
+}
@@ -0,0 +1,87 @@
+#ifndef COMMON_TEXT_PARSER_H_
+#define COMMON_TEXT_PARSER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "common/message_types.h"
+
+// Fast parsers for the gateway's text messages, equivalent to the
+// constructors from a serialized string but reading straight from a receive
+// buffer into an existing object. One pass finds every field delimiter (32
+// bytes at a time with AVX2 when the CPU has it, as in indicators.h);
+// numbers are converted 16 digits at a time with SIMD multiply-adds, and
+// strings are assigned into the object's own buffers, so a parse into a
+// reused object allocates nothing once its strings, and for books its map
+// nodes, have grown to size.
+//
+// Layouts, fields separated by TEXT_FIELD_DELIMITER:
+//
+//   Order (TEXT_ORDER_FIELDS)  symbol, order id, cancel id, client id,
+//       type, action, genesis, gateway, enqueue and dequeue timestamps,
+//       serial number, limit price, result, shares
+//   Trade (TEXT_TRADE_FIELDS)  symbol, buyer and seller serial numbers,
+//       buyer and seller order ids, buyer and seller client ids, price,
+//       cash, shares, creation and release timestamps, serial number
+//   LimitOrderBook  symbol, creation and release timestamps, number of buy
+//       orders, number of sell orders, then the buy orders and the sell
+//       orders, each as an Order
+//   ClientInformationSnapshot  client id, global and order serial numbers,
+//       number of holdings, then symbol and shares of each, number of
+//       orders, then each order as an Order
+//
+// Type, action and result are the one-letter codes of message_primitives.h.
+// Book queues are keyed by order id, as the gateway keys them. The Order
+// and Trade layouts are SerializeOrder and SerializeTrade; the book and
+// snapshot layouts are what SerializeBook and SerializeSnapshot are taken
+// to write, and are checked against the constructors before the parsers
+// are relied on (see the Parse...OrConstruct helpers).
+#define TEXT_FIELD_DELIMITER '|'
+#define TEXT_ORDER_FIELDS 14
+#define TEXT_TRADE_FIELDS 13
+
+// Each returns false, leaving the object in an unspecified state, if data
+// does not hold exactly one message of the layout
+bool ParseOrder(const char *data, size_t len, Order *order);
+bool ParseTrade(const char *data, size_t len, Trade *trade);
+bool ParseLimitOrderBook(const char *data, size_t len, LimitOrderBook *book);
+bool ParseClientInformationSnapshot(const char *data, size_t len,
+                                    ClientInformationSnapshot *snapshot);
+
+// Parse, or construct from the string if the layout does not match
+inline void ParseOrderOrConstruct(const char *data, size_t len,
+                                  Order *order) {
+  if (!ParseOrder(data, len, order)) *order = Order(std::string(data, len));
+}
+inline void ParseTradeOrConstruct(const char *data, size_t len,
+                                  Trade *trade) {
+  if (!ParseTrade(data, len, trade)) *trade = Trade(std::string(data, len));
+}
+// The book and snapshot layouts are checked on the first message of each
+// kind that has orders on every list: it is both constructed and parsed,
+// and the parser is used alone only once the two agree. After a mismatch
+// the constructor is used from then on, without trying the parser first.
+void ParseLimitOrderBookOrConstruct(const char *data, size_t len,
+                                    LimitOrderBook *book);
+void ParseClientInformationSnapshotOrConstruct(
+    const char *data, size_t len, ClientInformationSnapshot *snapshot);
+
+// Whether the book layout has been checked and matches, so that books can
+// be read without the constructor (as LazyLimitOrderBook does)
+bool TextBookLayoutValid();
+
+// Offset just past the n-th delimiter at or after data[begin], i.e. the
+// start of the field n fields on, or len + 1 if there are fewer. Counts
+// delimiters 32 bytes at a time without looking at the fields, for skipping
+// over parts of a message that are not needed.
+size_t SkipTextFields(const char *data, size_t len, size_t begin, size_t n);
+
+// Decimal conversion of data[0, len), with an optional leading '-' for the
+// signed one. Returns false on an empty field, any other character, more
+// than 19 digits, or a value out of the type's range.
+bool ParseTextUint(const char *data, size_t len, uint64_t *value);
+bool ParseTextInt(const char *data, size_t len, int64_t *value);
+
+#endif  // COMMON_TEXT_PARSER_H_
@@ -0,0 +1,246 @@
+#include "common/text_parser.h"
+
+#include <gtest/gtest.h>
+#include <limits.h>
+#include <stdint.h>
+
+#include <random>
+#include <string>
+
+namespace {
+
+// An order in the text layout, its fields derived from i
+std::string OrderText(int i, char action) {
+  return "AA|G1_C" + std::to_string(i % 3) + "_" + std::to_string(1000 + i) +
+         "|NULL|C" + std::to_string(i % 3) + "|L|" + action + "|" +
+         std::to_string(1602182726927431ULL + i) + "|1602182726934577|" +
+         std::to_string(1602182726934784ULL + 7 * i) + "|1602182726934928|" +
+         std::to_string(i) + "|" + std::to_string(100 - i) + "|V|" +
+         std::to_string(100 * (i + 1));
+}
+
+std::string BookText(int num_buys, int num_sells) {
+  std::string book = "AA|1602182726927431|1602182726934577|" +
+                     std::to_string(num_buys) + "|" +
+                     std::to_string(num_sells);
+  for (int i = 0; i < num_buys; i++) book += "|" + OrderText(i, 'B');
+  for (int i = 0; i < num_sells; i++) {
+    book += "|" + OrderText(num_buys + i, 'S');
+  }
+  return book;
+}
+
+TEST(TextParserTest, UintAtEveryLength) {
+  std::mt19937_64 rng(1);
+  for (size_t len = 1; len <= 19; len++) {
+    for (int trial = 0; trial < 100; trial++) {
+      std::string digits;
+      for (size_t i = 0; i < len; i++) digits += '0' + rng() % 10;
+      uint64_t value = 0;
+      ASSERT_TRUE(ParseTextUint(digits.data(), len, &value)) << digits;
+      EXPECT_EQ(value, std::stoull(digits)) << digits;
+    }
+  }
+  uint64_t value = 0;
+  ASSERT_TRUE(ParseTextUint("9999999999999999999", 19, &value));
+  EXPECT_EQ(value, 9999999999999999999ULL);
+  ASSERT_TRUE(ParseTextUint("0000000000000000042", 19, &value));
+  EXPECT_EQ(value, 42u);
+}
+
+TEST(TextParserTest, UintRejectsMalformedFields) {
+  uint64_t value = 0;
+  EXPECT_FALSE(ParseTextUint("", 0, &value));
+  EXPECT_FALSE(ParseTextUint("12345678901234567890", 20, &value));
+  EXPECT_FALSE(ParseTextUint("-1", 2, &value));
+  EXPECT_FALSE(ParseTextUint("+1", 2, &value));
+  // A bad character anywhere, on the scalar and SIMD paths alike
+  for (size_t len : {1, 7, 8, 16, 17, 19}) {
+    for (size_t at = 0; at < len; at++) {
+      for (char bad : {'/', ':', ' ', 'a', '|'}) {
+        std::string digits(len, '5');
+        digits[at] = bad;
+        EXPECT_FALSE(ParseTextUint(digits.data(), len, &value))
+            << digits;
+      }
+    }
+  }
+}
+
+TEST(TextParserTest, Int) {
+  int64_t value = 0;
+  ASSERT_TRUE(ParseTextInt("-1234567890123", 14, &value));
+  EXPECT_EQ(value, -1234567890123LL);
+  ASSERT_TRUE(ParseTextInt("77", 2, &value));
+  EXPECT_EQ(value, 77);
+  EXPECT_FALSE(ParseTextInt("-", 1, &value));
+  EXPECT_FALSE(ParseTextInt("--1", 3, &value));
+  EXPECT_FALSE(ParseTextInt("", 0, &value));
+  // The ends of the range, and one past them
+  ASSERT_TRUE(ParseTextInt("9223372036854775807", 19, &value));
+  EXPECT_EQ(value, INT64_MAX);
+  ASSERT_TRUE(ParseTextInt("-9223372036854775808", 20, &value));
+  EXPECT_EQ(value, INT64_MIN);
+  EXPECT_FALSE(ParseTextInt("9223372036854775808", 19, &value));
+  EXPECT_FALSE(ParseTextInt("-9223372036854775809", 20, &value));
+}
+
+TEST(TextParserTest, SkipTextFields) {
+  std::string fields;
+  for (int i = 0; i < 40; i++) fields += std::to_string(i) + "|";
+  fields += "end";
+  const char *data = fields.data();
+  size_t len = fields.size();
+  EXPECT_EQ(SkipTextFields(data, len, 0, 0), 0u);
+  EXPECT_EQ(SkipTextFields(data, len, 0, 1), 2u);
+  EXPECT_EQ(SkipTextFields(data, len, 2, 1), 4u);
+  // Across 32-byte blocks
+  EXPECT_EQ(fields.substr(SkipTextFields(data, len, 0, 25), 3), "25|");
+  EXPECT_EQ(fields.substr(SkipTextFields(data, len, 0, 40)), "end");
+  EXPECT_EQ(SkipTextFields(data, len, 0, 41), len + 1);
+  EXPECT_EQ(SkipTextFields(data, len, len, 1), len + 1);
+}
+
+TEST(TextParserTest, Order) {
+  // Numbers deep enough into the message to take the SIMD path
+  std::string text = OrderText(7, 'S');
+  Order order;
+  ASSERT_TRUE(ParseOrder(text.data(), text.size(), &order));
+  EXPECT_EQ(order.symbol_, "AA");
+  EXPECT_EQ(order.order_id_, "G1_C1_1007");
+  EXPECT_EQ(order.cancel_id_, "NULL");
+  EXPECT_EQ(order.client_id_, "C1");
+  EXPECT_EQ(order.type_, OrderType::limit);
+  EXPECT_EQ(order.action_, OrderAction::sell);
+  EXPECT_EQ(order.genesis_timestamp_, 1602182726927438u);
+  EXPECT_EQ(order.gateway_timestamp_, 1602182726934577u);
+  EXPECT_EQ(order.enqueue_timestamp_, 1602182726934833u);
+  EXPECT_EQ(order.dequeue_timestamp_, 1602182726934928u);
+  EXPECT_EQ(order.order_serial_num_, 7u);
+  EXPECT_EQ(order.limit_price_, 93);
+  EXPECT_EQ(order.result_, OrderResult::valid);
+  EXPECT_EQ(order.num_shares_, 800);
+
+  std::string negative = OrderText(150, 'B');
+  ASSERT_TRUE(ParseOrder(negative.data(), negative.size(), &order));
+  EXPECT_EQ(order.limit_price_, -50);
+}
+
+TEST(TextParserTest, OrderRejectsMalformedMessages) {
+  std::string text = OrderText(3, 'B');
+  Order order;
+  // Too few and too many fields
+  EXPECT_FALSE(ParseOrder(text.data(), text.rfind('|'), &order));
+  std::string longer = text + "|1";
+  EXPECT_FALSE(ParseOrder(longer.data(), longer.size(), &order));
+  // Two-letter action, letter in a timestamp, empty shares
+  std::string action = text;
+  action.insert(action.find("|B|") + 2, "B");
+  EXPECT_FALSE(ParseOrder(action.data(), action.size(), &order));
+  std::string timestamp = text;
+  timestamp[timestamp.find("1602182726934577") + 9] = 'x';
+  EXPECT_FALSE(ParseOrder(timestamp.data(), timestamp.size(), &order));
+  std::string shares = text.substr(0, text.rfind('|') + 1);
+  EXPECT_FALSE(ParseOrder(shares.data(), shares.size(), &order));
+  // Shares past the range of an int, which they were once wrapped into
+  std::string wide = shares + "4294967396";
+  EXPECT_FALSE(ParseOrder(wide.data(), wide.size(), &order));
+  std::string low = shares + "-2147483649";
+  EXPECT_FALSE(ParseOrder(low.data(), low.size(), &order));
+  std::string lowest = shares + "-2147483648";
+  ASSERT_TRUE(ParseOrder(lowest.data(), lowest.size(), &order));
+  EXPECT_EQ(order.num_shares_, INT_MIN);
+}
+
+TEST(TextParserTest, Trade) {
+  std::string text =
+      "AA|4|5|G1_C3_12|G1_C4_13|C3|C4|-50|5000|100|1602182417783908|"
+      "1602182417784258|10003";
+  Trade trade;
+  ASSERT_TRUE(ParseTrade(text.data(), text.size(), &trade));
+  EXPECT_EQ(trade.symbol_, "AA");
+  EXPECT_EQ(trade.buyer_serial_num_, 4u);
+  EXPECT_EQ(trade.seller_serial_num_, 5u);
+  EXPECT_EQ(trade.buyer_order_id_, "G1_C3_12");
+  EXPECT_EQ(trade.seller_order_id_, "G1_C4_13");
+  EXPECT_EQ(trade.buyer_client_id_, "C3");
+  EXPECT_EQ(trade.seller_client_id_, "C4");
+  EXPECT_EQ(trade.exec_price_, -50);
+  EXPECT_EQ(trade.cash_traded_, 5000);
+  EXPECT_EQ(trade.shares_traded_, 100);
+  EXPECT_EQ(trade.creation_timestamp_, 1602182417783908u);
+  EXPECT_EQ(trade.release_timestamp_, 1602182417784258u);
+  EXPECT_EQ(trade.trade_serial_num_, 10003u);
+
+  std::string order = OrderText(1, 'B');
+  EXPECT_FALSE(ParseTrade(order.data(), order.size(), &trade));
+}
+
+TEST(TextParserTest, LimitOrderBook) {
+  LimitOrderBook book;
+  // Parsing into the same book again reuses its map nodes
+  for (int depth : {3, 40, 5, 0}) {
+    std::string text = BookText(depth, depth + 1);
+    ASSERT_TRUE(ParseLimitOrderBook(text.data(), text.size(), &book));
+    EXPECT_EQ(book.symbol_, "AA");
+    EXPECT_EQ(book.creation_timestamp_, 1602182726927431u);
+    EXPECT_EQ(book.release_timestamp_, 1602182726934577u);
+    ASSERT_EQ(book.buy_queue_.size(), static_cast<size_t>(depth));
+    ASSERT_EQ(book.sell_queue_.size(), static_cast<size_t>(depth + 1));
+    for (int i = 0; i < 2 * depth + 1; i++) {
+      std::string text = OrderText(i, i < depth ? 'B' : 'S');
+      Order expected;
+      ASSERT_TRUE(ParseOrder(text.data(), text.size(), &expected));
+      auto &queue = i < depth ? book.buy_queue_ : book.sell_queue_;
+      auto it = queue.find(expected.order_id_);
+      ASSERT_NE(it, queue.end()) << expected.order_id_;
+      EXPECT_EQ(it->second.limit_price_, expected.limit_price_);
+      EXPECT_EQ(it->second.num_shares_, expected.num_shares_);
+      EXPECT_EQ(it->second.enqueue_timestamp_, expected.enqueue_timestamp_);
+    }
+  }
+}
+
+TEST(TextParserTest, LimitOrderBookRejectsMalformedBooks) {
+  LimitOrderBook book;
+  std::string text = BookText(2, 2);
+  // Counts that do not match the orders, and a truncated last order
+  std::string counts = text;
+  counts.replace(counts.find("|2|2|"), 5, "|2|3|");
+  EXPECT_FALSE(ParseLimitOrderBook(counts.data(), counts.size(), &book));
+  EXPECT_FALSE(ParseLimitOrderBook(text.data(), text.rfind('|'), &book));
+  std::string header = "AA|1|2|0";
+  EXPECT_FALSE(ParseLimitOrderBook(header.data(), header.size(), &book));
+}
+
+TEST(TextParserTest, LimitOrderBookRejectsDuplicateIds) {
+  std::string order = OrderText(1, 'B');
+  std::string text = "AA|1|2|2|0|" + order + "|" + order;
+  // Into a new book, then into one whose nodes are reused
+  LimitOrderBook book;
+  EXPECT_FALSE(ParseLimitOrderBook(text.data(), text.size(), &book));
+  std::string valid = BookText(4, 4);
+  ASSERT_TRUE(ParseLimitOrderBook(valid.data(), valid.size(), &book));
+  EXPECT_FALSE(ParseLimitOrderBook(text.data(), text.size(), &book));
+}
+
+TEST(TextParserTest, ClientInformationSnapshot) {
+  std::string text = "C1|12|34|2|AA|100|AB|-50|2|" + OrderText(1, 'B') +
+                     "|" + OrderText(2, 'S');
+  ClientInformationSnapshot snapshot;
+  ASSERT_TRUE(
+      ParseClientInformationSnapshot(text.data(), text.size(), &snapshot));
+  EXPECT_EQ(snapshot.client_id_, "C1");
+  EXPECT_EQ(snapshot.global_serial_num_, 12u);
+  EXPECT_EQ(snapshot.order_serial_num_, 34u);
+  EXPECT_EQ(snapshot.my_portfolio_,
+            (std::map<std::string, int>{{"AA", 100}, {"AB", -50}}));
+  ASSERT_EQ(snapshot.outstanding_orders_.size(), 2u);
+  EXPECT_EQ(snapshot.outstanding_orders_[1].order_id_, "G1_C2_1002");
+
+  std::string missing = text.substr(0, text.rfind("|AA|"));
+  EXPECT_FALSE(ParseClientInformationSnapshot(missing.data(), missing.size(),
+                                              &snapshot));
+}
+
+}  // namespace
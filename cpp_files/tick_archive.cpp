@@ -0,0 +1,652 @@
+#include "trader/tick_archive.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "common/utils.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define TICK_ARCHIVE_HAVE_AVX2 1
+#endif
+
+namespace {
+
+// Column modes
+const uint8_t kFrameOfReference = 0;  // value - reference
+const uint8_t kDelta = 1;             // zigzag(value - previous) - reference
+
+// Column header: mode, bit width, 2 reserved bytes, uint32 number of packed
+// words, int64 reference, int64 first value. The packed words are followed
+// by one zero word so a decoder may always load the word after the one a
+// value starts in.
+const size_t kColumnHeaderSize = 24;
+
+// Footer: index offset, number of blocks, number of records, kind,
+// reserved, magic
+const size_t kFooterSize = 40;
+const size_t kIndexEntrySize = 28;
+// num_records, num_columns, dictionary byte length
+const size_t kBlockHeaderSize = 12;
+
+uint64_t ZigZag(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+int BitWidth(uint64_t value) {
+  return value == 0 ? 0 : 64 - __builtin_clzll(value);
+}
+
+uint64_t WidthMask(int width) {
+  return width == 64 ? ~0ULL : (1ULL << width) - 1;
+}
+
+template <typename T>
+void Put(std::string *out, T value) {
+  out->append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T>
+T Get(const char *data) {
+  T value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+// Unpack count width-bit values starting at words into out. The loop has no
+// data dependent branches, so compilers can vectorize it; the AVX2 version
+// does four values per step with gathers.
+void ScalarUnpack(const char *words, int width, size_t begin, size_t count,
+                  uint64_t *out) {
+  uint64_t mask = WidthMask(width);
+  for (size_t i = begin; i < count; i++) {
+    uint64_t bit = i * width;
+    uint64_t shift = bit & 63;
+    uint64_t lo = Get<uint64_t>(words + (bit >> 6) * 8);
+    uint64_t hi = Get<uint64_t>(words + (bit >> 6) * 8 + 8);
+    // hi only contributes when the value straddles two words
+    uint64_t spill = shift == 0 ? 0 : hi << (64 - shift);
+    out[i] = ((lo >> shift) | spill) & mask;
+  }
+}
+
+#ifdef TICK_ARCHIVE_HAVE_AVX2
+__attribute__((target("avx2"))) void Avx2Unpack(const char *words, int width,
+                                                size_t count, uint64_t *out) {
+  const long long *base = reinterpret_cast<const long long *>(words);
+  const __m256i mask = _mm256_set1_epi64x(WidthMask(width));
+  const __m256i sixty_three = _mm256_set1_epi64x(63);
+  const __m256i sixty_four = _mm256_set1_epi64x(64);
+  const __m256i one = _mm256_set1_epi64x(1);
+  const __m256i step = _mm256_set1_epi64x(4 * width);
+  __m256i bits = _mm256_setr_epi64x(0, width, 2 * width, 3 * width);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256i word = _mm256_srli_epi64(bits, 6);
+    __m256i shift = _mm256_and_si256(bits, sixty_three);
+    __m256i lo = _mm256_i64gather_epi64(base, word, 8);
+    __m256i hi = _mm256_i64gather_epi64(base, _mm256_add_epi64(word, one), 8);
+    // Shifting by 64 yields 0, which drops hi for values within one word
+    __m256i value = _mm256_or_si256(
+        _mm256_srlv_epi64(lo, shift),
+        _mm256_sllv_epi64(hi, _mm256_sub_epi64(sixty_four, shift)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i),
+                        _mm256_and_si256(value, mask));
+    bits = _mm256_add_epi64(bits, step);
+  }
+  ScalarUnpack(words, width, i, count, out);
+}
+
+bool UseAvx2() {
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+}
+#endif
+
+void Unpack(const char *words, int width, size_t count, uint64_t *out) {
+  if (width == 0) {
+    std::fill(out, out + count, 0);
+    return;
+  }
+#ifdef TICK_ARCHIVE_HAVE_AVX2
+  if (UseAvx2()) {
+    Avx2Unpack(words, width, count, out);
+    return;
+  }
+#endif
+  ScalarUnpack(words, width, 0, count, out);
+}
+
+void Pack(const uint64_t *values, size_t count, int width,
+          std::vector<uint64_t> *words) {
+  words->assign((count * width + 63) / 64 + 1, 0);
+  if (width == 0) return;
+  for (size_t i = 0; i < count; i++) {
+    uint64_t bit = i * width;
+    uint64_t shift = bit & 63;
+    (*words)[bit >> 6] |= values[i] << shift;
+    if (shift + width > 64) {
+      (*words)[(bit >> 6) + 1] |= values[i] >> (64 - shift);
+    }
+  }
+}
+
+}  // namespace
+
+void EncodeColumn(const int64_t *values, size_t count, std::string *out) {
+  // Both encodings are sized up front; the narrower one is written
+  std::vector<uint64_t> deltas(count, 0);
+  int64_t min_value = count > 0 ? values[0] : 0;
+  int64_t max_value = min_value;
+  uint64_t min_delta = 0;
+  uint64_t max_delta = 0;
+  for (size_t i = 0; i < count; i++) {
+    min_value = std::min(min_value, values[i]);
+    max_value = std::max(max_value, values[i]);
+    if (i > 0) {
+      deltas[i] = ZigZag(static_cast<int64_t>(static_cast<uint64_t>(values[i]) -
+                                              values[i - 1]));
+      min_delta = i == 1 ? deltas[i] : std::min(min_delta, deltas[i]);
+      max_delta = std::max(max_delta, deltas[i]);
+    }
+  }
+  int value_width = BitWidth(static_cast<uint64_t>(max_value) - min_value);
+  int delta_width = BitWidth(max_delta - min_delta);
+
+  uint8_t mode = delta_width < value_width ? kDelta : kFrameOfReference;
+  int width = mode == kDelta ? delta_width : value_width;
+  int64_t reference = mode == kDelta ? min_delta : min_value;
+  std::vector<uint64_t> &packed = deltas;
+  for (size_t i = 0; i < count; i++) {
+    packed[i] = mode == kDelta ? (i == 0 ? 0 : deltas[i] - min_delta)
+                               : static_cast<uint64_t>(values[i]) - min_value;
+  }
+  std::vector<uint64_t> words;
+  Pack(packed.data(), count, width, &words);
+
+  Put<uint8_t>(out, mode);
+  Put<uint8_t>(out, width);
+  Put<uint16_t>(out, 0);
+  Put<uint32_t>(out, words.size() - 1);
+  Put<int64_t>(out, reference);
+  Put<int64_t>(out, count > 0 ? values[0] : 0);
+  out->append(reinterpret_cast<const char *>(words.data()),
+              words.size() * sizeof(uint64_t));
+}
+
+size_t DecodeColumn(const char *data, size_t size, size_t count,
+                    int64_t *values) {
+  if (size < kColumnHeaderSize) return 0;
+  uint8_t mode = Get<uint8_t>(data);
+  int width = Get<uint8_t>(data + 1);
+  uint32_t num_words = Get<uint32_t>(data + 4);
+  int64_t reference = Get<int64_t>(data + 8);
+  int64_t first = Get<int64_t>(data + 16);
+  size_t length = kColumnHeaderSize + (num_words + 1) * sizeof(uint64_t);
+  if (mode > kDelta || width > 64 || length > size ||
+      num_words < (count * width + 63) / 64) {
+    return 0;
+  }
+  uint64_t *out = reinterpret_cast<uint64_t *>(values);
+  Unpack(data + kColumnHeaderSize, width, count, out);
+  if (mode == kFrameOfReference) {
+    for (size_t i = 0; i < count; i++) {
+      out[i] += reference;
+    }
+    return length;
+  }
+  // Undo the zigzag in one vectorizable pass, then the running sum
+  for (size_t i = 0; i < count; i++) {
+    uint64_t zigzag = out[i] + reference;
+    out[i] = (zigzag >> 1) ^ (0 - (zigzag & 1));
+  }
+  if (count > 0) out[0] = first;
+  for (size_t i = 1; i < count; i++) {
+    out[i] += out[i - 1];
+  }
+  return length;
+}
+
+TickArchiveWriter::TickArchiveWriter(const std::string &path,
+                                     ArchiveKind kind)
+    : file_(fopen(path.c_str(), "wb")),
+      kind_(kind),
+      columns_(kind == ArchiveKind::trade ? NUM_TRADE_COLUMNS
+                                          : NUM_BOOK_COLUMNS) {
+  if (file_ == nullptr) {
+    LOG(ERROR) << "Failed to Open Archive: " << path;
+    return;
+  }
+  for (auto &column : columns_) {
+    column.reserve(ARCHIVE_BLOCK_SIZE);
+  }
+  fwrite(ARCHIVE_MAGIC, 1, ARCHIVE_MAGIC_SIZE, file_);
+  offset_ = ARCHIVE_MAGIC_SIZE;
+}
+
+TickArchiveWriter::~TickArchiveWriter() { Close(); }
+
+uint32_t TickArchiveWriter::Code(const std::string &value) {
+  auto it = codes_.find(value);
+  if (it != codes_.end()) return it->second;
+  uint32_t code = dictionary_.size();
+  codes_[value] = code;
+  dictionary_.push_back(value);
+  return code;
+}
+
+bool TickArchiveWriter::Append(const Trade &trade) {
+  if (file_ == nullptr || kind_ != ArchiveKind::trade) return false;
+  int64_t row[NUM_TRADE_COLUMNS];
+  row[TRADE_SYMBOL] = Code(trade.symbol_);
+  row[TRADE_BUYER_SERIAL_NUM] = trade.buyer_serial_num_;
+  row[TRADE_SELLER_SERIAL_NUM] = trade.seller_serial_num_;
+  row[TRADE_BUYER_ORDER_ID] = Code(trade.buyer_order_id_);
+  row[TRADE_SELLER_ORDER_ID] = Code(trade.seller_order_id_);
+  row[TRADE_BUYER_CLIENT_ID] = Code(trade.buyer_client_id_);
+  row[TRADE_SELLER_CLIENT_ID] = Code(trade.seller_client_id_);
+  row[TRADE_EXEC_PRICE] = trade.exec_price_;
+  row[TRADE_CASH_TRADED] = trade.cash_traded_;
+  row[TRADE_SHARES_TRADED] = trade.shares_traded_;
+  row[TRADE_CREATION_TIMESTAMP] = trade.creation_timestamp_;
+  row[TRADE_RELEASE_OFFSET] =
+      trade.release_timestamp_ - trade.creation_timestamp_;
+  row[TRADE_SERIAL_NUM] = trade.trade_serial_num_;
+  for (int i = 0; i < NUM_TRADE_COLUMNS; i++) {
+    columns_[i].push_back(row[i]);
+  }
+  return ++block_records_ < ARCHIVE_BLOCK_SIZE || FlushBlock();
+}
+
+bool TickArchiveWriter::Append(const std::string &symbol,
+                               const TopOfBook &depth) {
+  if (file_ == nullptr || kind_ != ArchiveKind::book) return false;
+  columns_[BOOK_SYMBOL].push_back(Code(symbol));
+  columns_[BOOK_CREATION_TIMESTAMP].push_back(depth.creation_timestamp_);
+  columns_[BOOK_NUM_BUY_LEVELS].push_back(depth.num_buy_levels_);
+  columns_[BOOK_NUM_SELL_LEVELS].push_back(depth.num_sell_levels_);
+  // Missing levels are stored as 0 to keep the columns narrow
+  for (int i = 0; i < TOP_OF_BOOK_DEPTH; i++) {
+    bool buy_level = i < depth.num_buy_levels_;
+    bool sell_level = i < depth.num_sell_levels_;
+    columns_[BookLevelColumn(BUY_PRICE, i)].push_back(
+        buy_level ? depth.buy_prices_[i] : 0);
+    columns_[BookLevelColumn(BUY_SHARES, i)].push_back(
+        buy_level ? depth.buy_shares_[i] : 0);
+    columns_[BookLevelColumn(SELL_PRICE, i)].push_back(
+        sell_level ? depth.sell_prices_[i] : 0);
+    columns_[BookLevelColumn(SELL_SHARES, i)].push_back(
+        sell_level ? depth.sell_shares_[i] : 0);
+  }
+  return ++block_records_ < ARCHIVE_BLOCK_SIZE || FlushBlock();
+}
+
+bool TickArchiveWriter::FlushBlock() {
+  if (block_records_ == 0) return true;
+  const std::vector<int64_t> &timestamps =
+      columns_[kind_ == ArchiveKind::trade
+                   ? static_cast<int>(TRADE_CREATION_TIMESTAMP)
+                   : static_cast<int>(BOOK_CREATION_TIMESTAMP)];
+  ArchiveBlockInfo info;
+  info.offset_ = offset_;
+  info.first_timestamp_ = timestamps.front();
+  info.last_timestamp_ = timestamps.back();
+  info.num_records_ = block_records_;
+
+  block_buffer_.clear();
+  Put<uint32_t>(&block_buffer_, block_records_);
+  Put<uint32_t>(&block_buffer_, columns_.size());
+  Put<uint32_t>(&block_buffer_, 0);
+  Put<uint32_t>(&block_buffer_, dictionary_.size());
+  for (auto &value : dictionary_) {
+    Put<uint32_t>(&block_buffer_, value.size());
+    block_buffer_ += value;
+  }
+  uint32_t dictionary_size = block_buffer_.size() - kBlockHeaderSize;
+  memcpy(&block_buffer_[8], &dictionary_size, sizeof(dictionary_size));
+  codes_.clear();
+  dictionary_.clear();
+  std::string column_buffer;
+  for (auto &column : columns_) {
+    column_buffer.clear();
+    EncodeColumn(column.data(), column.size(), &column_buffer);
+    Put<uint32_t>(&block_buffer_, column_buffer.size());
+    block_buffer_ += column_buffer;
+    column.clear();
+  }
+  block_records_ = 0;
+  if (fwrite(block_buffer_.data(), 1, block_buffer_.size(), file_) !=
+      block_buffer_.size()) {
+    LOG(ERROR) << "Failed to Write Archive Block";
+    return false;
+  }
+  offset_ += block_buffer_.size();
+  num_records_ += info.num_records_;
+  index_.push_back(info);
+  return true;
+}
+
+bool TickArchiveWriter::Close() {
+  if (file_ == nullptr) return false;
+  bool ok = FlushBlock();
+
+  std::string tail;
+  uint64_t index_offset = offset_;
+  for (auto &info : index_) {
+    Put<uint64_t>(&tail, info.offset_);
+    Put<uint64_t>(&tail, info.first_timestamp_);
+    Put<uint64_t>(&tail, info.last_timestamp_);
+    Put<uint32_t>(&tail, info.num_records_);
+  }
+  Put<uint64_t>(&tail, index_offset);
+  Put<uint64_t>(&tail, index_.size());
+  Put<uint64_t>(&tail, num_records_);
+  Put<uint32_t>(&tail, static_cast<uint32_t>(kind_));
+  Put<uint32_t>(&tail, 0);
+  tail.append(ARCHIVE_MAGIC, ARCHIVE_MAGIC_SIZE);
+  ok = ok && fwrite(tail.data(), 1, tail.size(), file_) == tail.size();
+  ok = fclose(file_) == 0 && ok;
+  file_ = nullptr;
+  if (!ok) {
+    LOG(ERROR) << "Failed to Write Archive";
+  }
+  return ok;
+}
+
+TickArchiveReader::TickArchiveReader(const std::string &path)
+    : fd_(open(path.c_str(), O_RDONLY)),
+      data_(nullptr),
+      size_(0),
+      kind_(ArchiveKind::trade),
+      num_records_(0) {
+  struct stat info;
+  if (fd_ < 0 || fstat(fd_, &info) != 0 ||
+      static_cast<size_t>(info.st_size) < ARCHIVE_MAGIC_SIZE + kFooterSize) {
+    LOG(ERROR) << "Failed to Open Archive: " << path;
+    return;
+  }
+  size_ = info.st_size;
+  void *mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+  if (mapping == MAP_FAILED) {
+    LOG(ERROR) << "Failed to Map Archive: " << path;
+    return;
+  }
+  madvise(mapping, size_, MADV_SEQUENTIAL);
+  const char *data = static_cast<const char *>(mapping);
+
+  const char *footer = data + size_ - kFooterSize;
+  uint64_t index_offset = Get<uint64_t>(footer);
+  uint64_t num_blocks = Get<uint64_t>(footer + 8);
+  num_records_ = Get<uint64_t>(footer + 16);
+  kind_ = static_cast<ArchiveKind>(Get<uint32_t>(footer + 24));
+  bool ok = memcmp(data, ARCHIVE_MAGIC, ARCHIVE_MAGIC_SIZE) == 0 &&
+            memcmp(footer + 32, ARCHIVE_MAGIC, ARCHIVE_MAGIC_SIZE) == 0 &&
+            (kind_ == ArchiveKind::trade || kind_ == ArchiveKind::book) &&
+            index_offset <= size_ - kFooterSize &&
+            num_blocks <= (size_ - kFooterSize - index_offset) /
+                              kIndexEntrySize &&
+            index_offset + num_blocks * kIndexEntrySize ==
+                size_ - kFooterSize;
+
+  // Block index
+  const char *cursor = data + index_offset;
+  for (uint64_t i = 0; ok && i < num_blocks; i++) {
+    ArchiveBlockInfo block;
+    block.offset_ = Get<uint64_t>(cursor);
+    block.first_timestamp_ = Get<uint64_t>(cursor + 8);
+    block.last_timestamp_ = Get<uint64_t>(cursor + 16);
+    block.num_records_ = Get<uint32_t>(cursor + 24);
+    ok = block.offset_ >= ARCHIVE_MAGIC_SIZE &&
+         block.offset_ <= index_offset &&
+         index_offset - block.offset_ >= kBlockHeaderSize &&
+         block.num_records_ <= ARCHIVE_BLOCK_SIZE;
+    index_.push_back(block);
+    cursor += kIndexEntrySize;
+  }
+  if (!ok) {
+    LOG(ERROR) << "Not a Tick Archive: " << path;
+    munmap(mapping, size_);
+    index_.clear();
+    return;
+  }
+  data_ = data;
+  scratch_.resize(ARCHIVE_BLOCK_SIZE);
+}
+
+TickArchiveReader::~TickArchiveReader() {
+  if (data_ != nullptr) munmap(const_cast<char *>(data_), size_);
+  if (fd_ >= 0) close(fd_);
+}
+
+size_t TickArchiveReader::FindBlock(uint64_t timestamp) const {
+  return std::lower_bound(index_.begin(), index_.end(), timestamp,
+                          [](const ArchiveBlockInfo &block,
+                             uint64_t timestamp) {
+                            return block.last_timestamp_ < timestamp;
+                          }) -
+         index_.begin();
+}
+
+bool TickArchiveReader::LoadDictionary(size_t block) {
+  if (data_ == nullptr || block >= index_.size()) return false;
+  if (block == dictionary_block_) return true;
+  dictionary_block_ = SIZE_MAX;
+  dictionary_.clear();
+  const char *cursor = data_ + index_[block].offset_;
+  const char *end = data_ + size_;
+  uint32_t dictionary_size = Get<uint32_t>(cursor + 8);
+  cursor += kBlockHeaderSize;
+  bool ok = dictionary_size >= 4 &&
+            dictionary_size <= static_cast<size_t>(end - cursor);
+  if (ok) {
+    end = cursor + dictionary_size;
+    uint32_t num_entries = Get<uint32_t>(cursor);
+    cursor += 4;
+    for (uint32_t i = 0; ok && i < num_entries; i++) {
+      ok = end - cursor >= 4 && end - cursor - 4 >= Get<uint32_t>(cursor);
+      if (!ok) break;
+      uint32_t length = Get<uint32_t>(cursor);
+      dictionary_.emplace_back(cursor + 4, length);
+      cursor += 4 + length;
+    }
+  }
+  if (!ok) {
+    LOG(ERROR) << "Bad Dictionary in Archive Block " << block;
+    dictionary_.clear();
+    return false;
+  }
+  dictionary_block_ = block;
+  symbol_codes_.assign(dictionary_.size(), -1);
+  client_codes_.assign(dictionary_.size(), -1);
+  return true;
+}
+
+bool TickArchiveReader::ReadDictionary(size_t block,
+                                       std::vector<std::string> *dictionary) {
+  if (!LoadDictionary(block)) return false;
+  *dictionary = dictionary_;
+  return true;
+}
+
+bool TickArchiveReader::FindColumn(size_t block, int column,
+                                   const char **data, size_t *size) {
+  if (data_ == nullptr || block >= index_.size()) return false;
+  const char *cursor = data_ + index_[block].offset_;
+  const char *end = data_ + size_;
+  uint32_t num_columns = Get<uint32_t>(cursor + 4);
+  uint32_t dictionary_size = Get<uint32_t>(cursor + 8);
+  if (column < 0 || static_cast<uint32_t>(column) >= num_columns ||
+      dictionary_size > static_cast<size_t>(end - cursor) - kBlockHeaderSize) {
+    return false;
+  }
+  cursor += kBlockHeaderSize + dictionary_size;
+  // Skip the columns in front, using their length prefixes
+  for (int i = 0; cursor + 4 <= end; i++) {
+    uint32_t length = Get<uint32_t>(cursor);
+    if (cursor + 4 + length > end) return false;
+    if (i == column) {
+      *data = cursor + 4;
+      *size = length;
+      return true;
+    }
+    cursor += 4 + length;
+  }
+  return false;
+}
+
+bool TickArchiveReader::ReadColumn(size_t block, int column,
+                                   std::vector<int64_t> *values) {
+  const char *data;
+  size_t size;
+  if (!FindColumn(block, column, &data, &size)) return false;
+  values->resize(index_[block].num_records_);
+  return DecodeColumn(data, size, values->size(), values->data()) > 0;
+}
+
+bool TickArchiveReader::SymbolCode(int64_t entry, uint32_t *code) {
+  if (symbol_codes_[entry] < 0) {
+    uint16_t id;
+    if (!SymbolTable()->Intern(dictionary_[entry], &id)) {
+      LOG(ERROR) << "Symbol Table Full: " << dictionary_[entry];
+      return false;
+    }
+    symbol_codes_[entry] = id;
+  }
+  *code = symbol_codes_[entry];
+  return true;
+}
+
+bool TickArchiveReader::ClientCode(int64_t entry, uint32_t *code) {
+  if (client_codes_[entry] < 0) {
+    uint16_t id;
+    if (!ClientTable()->Intern(dictionary_[entry], &id)) {
+      LOG(ERROR) << "Client Table Full: " << dictionary_[entry];
+      return false;
+    }
+    client_codes_[entry] = id;
+  }
+  *code = client_codes_[entry];
+  return true;
+}
+
+bool TickArchiveReader::ReadStrings(size_t block, int column) {
+  if (!LoadDictionary(block) || !ReadColumn(block, column, &scratch_)) {
+    return false;
+  }
+  for (int64_t entry : scratch_) {
+    if (entry < 0 || static_cast<size_t>(entry) >= dictionary_.size()) {
+      LOG(ERROR) << "Bad Dictionary Code in Archive Block " << block;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool TickArchiveReader::ReadBlock(size_t block, TradeColumns *columns) {
+  if (kind_ != ArchiveKind::trade || block >= index_.size()) return false;
+  size_t begin = columns->size();
+  size_t count = index_[block].num_records_;
+  bool ok = true;
+  uint32_t code;
+  auto order_id_code = [this, columns](int64_t entry, uint32_t *code) {
+    *code = columns->order_ids_.Code(dictionary_[entry]);
+    return true;
+  };
+
+#define READ_STRINGS(column, field, convert)                 \
+  ok = ok && ReadStrings(block, column);                     \
+  for (size_t i = 0; ok && i < count; i++) {                 \
+    ok = convert(scratch_[i], &code);                        \
+    columns->field.push_back(code);                          \
+  }
+#define READ_NUMBERS(column, field, type)                    \
+  ok = ok && ReadColumn(block, column, &scratch_);           \
+  for (size_t i = 0; ok && i < count; i++) {                 \
+    columns->field.push_back(static_cast<type>(scratch_[i])); \
+  }
+
+  columns->Reserve(begin + count);
+  READ_STRINGS(TRADE_SYMBOL, symbol_, SymbolCode);
+  READ_NUMBERS(TRADE_BUYER_SERIAL_NUM, buyer_serial_num_, uint64_t);
+  READ_NUMBERS(TRADE_SELLER_SERIAL_NUM, seller_serial_num_, uint64_t);
+  READ_STRINGS(TRADE_BUYER_ORDER_ID, buyer_order_id_, order_id_code);
+  READ_STRINGS(TRADE_SELLER_ORDER_ID, seller_order_id_, order_id_code);
+  READ_STRINGS(TRADE_BUYER_CLIENT_ID, buyer_client_id_, ClientCode);
+  READ_STRINGS(TRADE_SELLER_CLIENT_ID, seller_client_id_, ClientCode);
+  READ_NUMBERS(TRADE_EXEC_PRICE, exec_price_, int32_t);
+  READ_NUMBERS(TRADE_CASH_TRADED, cash_traded_, int32_t);
+  READ_NUMBERS(TRADE_SHARES_TRADED, shares_traded_, int32_t);
+  READ_NUMBERS(TRADE_CREATION_TIMESTAMP, creation_timestamp_, uint64_t);
+  READ_NUMBERS(TRADE_SERIAL_NUM, trade_serial_num_, uint64_t);
+  ok = ok && ReadColumn(block, TRADE_RELEASE_OFFSET, &scratch_);
+  for (size_t i = 0; ok && i < count; i++) {
+    columns->release_timestamp_.push_back(
+        columns->creation_timestamp_[begin + i] + scratch_[i]);
+  }
+#undef READ_STRINGS
+#undef READ_NUMBERS
+
+  if (!ok) {
+    LOG(ERROR) << "Corrupt Archive Block " << block;
+    columns->Resize(begin);
+  }
+  return ok;
+}
+
+bool TickArchiveReader::ReadBlock(size_t block, BookColumns *columns) {
+  if (kind_ != ArchiveKind::book || block >= index_.size()) return false;
+  size_t begin = columns->size();
+  size_t count = index_[block].num_records_;
+  columns->Reserve(begin + count);
+
+  bool ok = ReadStrings(block, BOOK_SYMBOL);
+  uint32_t code;
+  for (size_t i = 0; ok && i < count; i++) {
+    ok = SymbolCode(scratch_[i], &code);
+    columns->symbol_.push_back(code);
+  }
+  ok = ok && ReadColumn(block, BOOK_CREATION_TIMESTAMP, &scratch_);
+  for (size_t i = 0; ok && i < count; i++) {
+    columns->creation_timestamp_.push_back(scratch_[i]);
+  }
+  ok = ok && ReadColumn(block, BOOK_NUM_BUY_LEVELS, &scratch_);
+  for (size_t i = 0; ok && i < count; i++) {
+    columns->num_buy_levels_.push_back(scratch_[i]);
+  }
+  ok = ok && ReadColumn(block, BOOK_NUM_SELL_LEVELS, &scratch_);
+  for (size_t i = 0; ok && i < count; i++) {
+    columns->num_sell_levels_.push_back(scratch_[i]);
+  }
+
+  // Level columns are stored level by level and scattered into the
+  // row-major [size() x TOP_OF_BOOK_DEPTH] layout of BookColumns
+  std::vector<int32_t> *fields[4] = {&columns->buy_prices_,
+                                     &columns->buy_shares_,
+                                     &columns->sell_prices_,
+                                     &columns->sell_shares_};
+  for (int field = 0; ok && field < 4; field++) {
+    fields[field]->resize((begin + count) * TOP_OF_BOOK_DEPTH, 0);
+    int32_t *out = fields[field]->data() + begin * TOP_OF_BOOK_DEPTH;
+    for (int level = 0; ok && level < TOP_OF_BOOK_DEPTH; level++) {
+      ok = ReadColumn(block,
+                      BookLevelColumn(static_cast<BookLevelField>(field),
+                                      level),
+                      &scratch_);
+      for (size_t i = 0; ok && i < count; i++) {
+        out[i * TOP_OF_BOOK_DEPTH + level] = scratch_[i];
+      }
+    }
+  }
+
+  if (!ok) {
+    LOG(ERROR) << "Corrupt Archive Block " << block;
+    columns->Resize(begin);
+  }
+  return ok;
+}
@@ -0,0 +1,185 @@
+#ifndef TRADER_TICK_ARCHIVE_H_
+#define TRADER_TICK_ARCHIVE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/message_types.h"
+#include "trader/columnar.h"
+#include "trader/top_of_book.h"
+
+// Compressed column archive of a Trade or book stream. Records are grouped
+// in blocks of up to ARCHIVE_BLOCK_SIZE; within a block every field is a
+// column of integers stored frame-of-reference bit-packed, either as is or
+// as zigzag deltas, whichever packs narrower. Timestamps and serial numbers
+// therefore cost a few bits each, and strings (symbols, client and order
+// ids) are codes into the dictionary of their block, so the writer and
+// reader only ever hold one block's strings and blocks decode on their own.
+// A block index at the end of the file maps blocks to their time range for
+// seeking.
+//
+// Layout: ARCHIVE_MAGIC, blocks, index, footer. Each block is uint32
+// num_records, uint32 num_columns, uint32 dictionary byte length, the
+// dictionary (uint32 num_entries, then a uint32 length and the bytes of each
+// string), then per column a uint32 byte length and the packed column, so
+// single columns can be read on their own.
+//
+// Books are archived as their TopOfBook summaries, which is lossy: only the
+// best TOP_OF_BOOK_DEPTH price levels of each side with their total shares,
+// and the creation timestamp. Deeper levels, the individual orders (ids,
+// clients, timestamps) and the release timestamp are not kept, so the
+// LimitOrderBook cannot be rebuilt from a book archive.
+#define ARCHIVE_MAGIC "CXTARC02"
+#define ARCHIVE_MAGIC_SIZE 8
+#define ARCHIVE_BLOCK_SIZE 4096
+
+enum class ArchiveKind : uint32_t { trade = 1, book = 2 };
+
+// Columns of a trade archive. Release timestamps are stored as the offset
+// from the creation timestamp.
+enum TradeArchiveColumn {
+  TRADE_SYMBOL,
+  TRADE_BUYER_SERIAL_NUM,
+  TRADE_SELLER_SERIAL_NUM,
+  TRADE_BUYER_ORDER_ID,
+  TRADE_SELLER_ORDER_ID,
+  TRADE_BUYER_CLIENT_ID,
+  TRADE_SELLER_CLIENT_ID,
+  TRADE_EXEC_PRICE,
+  TRADE_CASH_TRADED,
+  TRADE_SHARES_TRADED,
+  TRADE_CREATION_TIMESTAMP,
+  TRADE_RELEASE_OFFSET,
+  TRADE_SERIAL_NUM,
+  NUM_TRADE_COLUMNS
+};
+
+// Columns of a book archive, followed by the level columns of
+// BookLevelColumn
+enum BookArchiveColumn {
+  BOOK_SYMBOL,
+  BOOK_CREATION_TIMESTAMP,
+  BOOK_NUM_BUY_LEVELS,
+  BOOK_NUM_SELL_LEVELS,
+  NUM_BOOK_FIXED_COLUMNS
+};
+enum BookLevelField { BUY_PRICE, BUY_SHARES, SELL_PRICE, SELL_SHARES };
+#define NUM_BOOK_COLUMNS (NUM_BOOK_FIXED_COLUMNS + 4 * TOP_OF_BOOK_DEPTH)
+
+inline int BookLevelColumn(BookLevelField field, int level) {
+  return NUM_BOOK_FIXED_COLUMNS + field * TOP_OF_BOOK_DEPTH + level;
+}
+
+// Block index entry
+class ArchiveBlockInfo {
+ public:
+  uint64_t offset_;           // File offset of the block
+  uint64_t first_timestamp_;  // Creation timestamp of the first record
+  uint64_t last_timestamp_;   // Creation timestamp of the last record
+  uint32_t num_records_;
+};
+
+// Pack and unpack one column (exposed for the decoders' callers and tools)
+void EncodeColumn(const int64_t *values, size_t count, std::string *out);
+// Decode a column of count values from data. Returns the bytes consumed, or
+// 0 if the column is malformed.
+size_t DecodeColumn(const char *data, size_t size, size_t count,
+                    int64_t *values);
+
+class TickArchiveWriter {
+ public:
+  TickArchiveWriter(const std::string &path, ArchiveKind kind);
+  ~TickArchiveWriter();
+
+  bool ok() const { return file_ != nullptr; }
+
+  // Records should be appended in creation timestamp order for seeks to be
+  // exact
+  bool Append(const Trade &trade);
+  bool Append(const std::string &symbol, const TopOfBook &depth);
+
+  // Write the last block, dictionary, index and footer. Called by the
+  // destructor if needed.
+  bool Close();
+
+ private:
+  // Code of value in the dictionary of the open block
+  uint32_t Code(const std::string &value);
+  bool FlushBlock();
+
+  FILE *file_;
+  ArchiveKind kind_;
+  std::vector<std::vector<int64_t> > columns_;
+  size_t block_records_ = 0;
+  uint64_t num_records_ = 0;
+  uint64_t offset_ = 0;  // File offset of the next block
+  std::unordered_map<std::string, uint32_t> codes_;
+  std::vector<std::string> dictionary_;
+  std::vector<ArchiveBlockInfo> index_;
+  std::string block_buffer_;
+};
+
+// Reads an archive through a read-only memory mapping, so scans run at
+// memory speed once the file is cached
+class TickArchiveReader {
+ public:
+  explicit TickArchiveReader(const std::string &path);
+  ~TickArchiveReader();
+
+  bool ok() const { return data_ != nullptr; }
+  ArchiveKind kind() const { return kind_; }
+  uint64_t num_records() const { return num_records_; }
+  const std::vector<ArchiveBlockInfo> &index() const { return index_; }
+
+  // First block that can hold records created at or after timestamp
+  size_t FindBlock(uint64_t timestamp) const;
+
+  // Copy out the dictionary of block
+  bool ReadDictionary(size_t block, std::vector<std::string> *dictionary);
+
+  // Decode one column of block into values (resized to the block size).
+  // String columns hold codes into the block's dictionary.
+  bool ReadColumn(size_t block, int column, std::vector<int64_t> *values);
+
+  // Decode block and append it to columns, with symbols and client ids
+  // converted to the process intern table codes and order ids to codes of
+  // columns->order_ids_, as columnar.h has them. Columns may therefore
+  // collect blocks of any archives along with appended trades. On failure
+  // no rows are added.
+  bool ReadBlock(size_t block, TradeColumns *columns);
+  bool ReadBlock(size_t block, BookColumns *columns);
+
+ private:
+  // Parse the dictionary of block into dictionary_, unless already there
+  bool LoadDictionary(size_t block);
+  // Locate column of block
+  bool FindColumn(size_t block, int column, const char **data,
+                  size_t *size);
+  // Decode a string column into scratch_ and check its codes
+  bool ReadStrings(size_t block, int column);
+
+  // Intern table ids of dictionary_ entries, resolved on first use. False
+  // if the table is full.
+  bool SymbolCode(int64_t entry, uint32_t *code);
+  bool ClientCode(int64_t entry, uint32_t *code);
+
+  int fd_;
+  const char *data_;
+  size_t size_;
+  ArchiveKind kind_;
+  uint64_t num_records_;
+  std::vector<ArchiveBlockInfo> index_;
+  // Dictionary of block dictionary_block_, and the intern table codes of
+  // its entries
+  size_t dictionary_block_ = SIZE_MAX;
+  std::vector<std::string> dictionary_;
+  std::vector<int32_t> symbol_codes_;  // SymbolTable() code, or -1
+  std::vector<int32_t> client_codes_;  // ClientTable() code, or -1
+  std::vector<int64_t> scratch_;
+};
+
+#endif  // TRADER_TICK_ARCHIVE_H_
@@ -0,0 +1,272 @@
+#include "trader/tick_archive.h"
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string TempPath(const std::string &name) {
+  const char *dir = getenv("TEST_TMPDIR");
+  return std::string(dir != nullptr ? dir : "/tmp") + "/" + name + "." +
+         std::to_string(getpid());
+}
+
+// String of an intern table id, empty if unknown
+std::string Name(const std::string *value) {
+  return value != nullptr ? *value : std::string();
+}
+
+Trade MakeTrade(uint64_t i) {
+  Trade trade;
+  trade.symbol_ = i % 3 == 0 ? "AA" : "AB";
+  trade.buyer_serial_num_ = 1000 + 2 * i;
+  trade.seller_serial_num_ = 1001 + 2 * i;
+  trade.buyer_order_id_ = "G1_C" + std::to_string(i % 5) + "_" +
+                          std::to_string(i);
+  trade.seller_order_id_ = "G1_C" + std::to_string(i % 7) + "_" +
+                           std::to_string(i + 1);
+  trade.buyer_client_id_ = "C" + std::to_string(i % 5);
+  trade.seller_client_id_ = "C" + std::to_string(i % 7);
+  trade.exec_price_ = 10000 + static_cast<int32_t>(i % 40) - 20;
+  trade.shares_traded_ = 100 + static_cast<int32_t>(i % 9);
+  trade.cash_traded_ = trade.exec_price_ * trade.shares_traded_;
+  trade.creation_timestamp_ = 1600000000000000ULL + 250 * i;
+  trade.release_timestamp_ = trade.creation_timestamp_ + 17 + i % 4;
+  trade.trade_serial_num_ = i;
+  return trade;
+}
+
+TEST(TickArchiveTest, ColumnRoundTripsAtEveryWidth) {
+  std::mt19937_64 rng(1);
+  for (int width = 0; width <= 64; width++) {
+    for (size_t count : {0, 1, 3, 4, 5, 100, ARCHIVE_BLOCK_SIZE}) {
+      std::vector<int64_t> values(count);
+      uint64_t mask = width == 64 ? ~0ULL : (1ULL << width) - 1;
+      for (size_t i = 0; i < count; i++) {
+        values[i] = static_cast<int64_t>(rng() & mask);
+      }
+      // Slowly moving series take the delta encoding
+      if (width % 3 == 0) {
+        for (size_t i = 1; i < count; i++) {
+          values[i] = values[i - 1] + static_cast<int64_t>(rng() % 7) - 2;
+        }
+      }
+      std::string encoded;
+      EncodeColumn(values.data(), count, &encoded);
+      std::vector<int64_t> decoded(count);
+      EXPECT_EQ(DecodeColumn(encoded.data(), encoded.size(), count,
+                             decoded.data()),
+                encoded.size())
+          << "width " << width << " count " << count;
+      EXPECT_EQ(decoded, values) << "width " << width << " count " << count;
+    }
+  }
+}
+
+TEST(TickArchiveTest, DecodeRejectsTruncatedColumn) {
+  std::vector<int64_t> values = {5, -3, 1 << 20, 7, 42};
+  std::string encoded;
+  EncodeColumn(values.data(), values.size(), &encoded);
+  std::vector<int64_t> decoded(values.size());
+  EXPECT_EQ(DecodeColumn(encoded.data(), 10, values.size(), decoded.data()),
+            0u);
+  EXPECT_EQ(DecodeColumn(encoded.data(), encoded.size() - 1, values.size(),
+                         decoded.data()),
+            0u);
+  // More values than were packed
+  EXPECT_EQ(DecodeColumn(encoded.data(), encoded.size(), 1000,
+                         decoded.data()),
+            0u);
+}
+
+class TradeArchiveTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = TempPath("trade_archive");
+    TickArchiveWriter writer(path_, ArchiveKind::trade);
+    ASSERT_TRUE(writer.ok());
+    for (uint64_t i = 0; i < kNumTrades; i++) {
+      trades_.push_back(MakeTrade(i));
+      ASSERT_TRUE(writer.Append(trades_.back()));
+    }
+    ASSERT_TRUE(writer.Close());
+  }
+  void TearDown() override { unlink(path_.c_str()); }
+
+  static constexpr uint64_t kNumTrades = 2 * ARCHIVE_BLOCK_SIZE + 123;
+  std::string path_;
+  std::vector<Trade> trades_;
+};
+
+TEST_F(TradeArchiveTest, ReadBlocksReturnTheTrades) {
+  TickArchiveReader reader(path_);
+  ASSERT_TRUE(reader.ok());
+  EXPECT_EQ(reader.kind(), ArchiveKind::trade);
+  EXPECT_EQ(reader.num_records(), kNumTrades);
+  ASSERT_EQ(reader.index().size(), 3u);
+
+  TradeColumns columns;
+  for (size_t block = 0; block < reader.index().size(); block++) {
+    ASSERT_TRUE(reader.ReadBlock(block, &columns));
+  }
+  ASSERT_EQ(columns.size(), trades_.size());
+  for (size_t i = 0; i < trades_.size(); i++) {
+    const Trade &trade = trades_[i];
+    EXPECT_EQ(Name(SymbolTable()->Lookup(columns.symbol_[i])), trade.symbol_);
+    EXPECT_EQ(Name(columns.order_ids_.Lookup(columns.buyer_order_id_[i])),
+              trade.buyer_order_id_);
+    EXPECT_EQ(Name(columns.order_ids_.Lookup(columns.seller_order_id_[i])),
+              trade.seller_order_id_);
+    EXPECT_EQ(Name(ClientTable()->Lookup(columns.buyer_client_id_[i])),
+              trade.buyer_client_id_);
+    EXPECT_EQ(Name(ClientTable()->Lookup(columns.seller_client_id_[i])),
+              trade.seller_client_id_);
+    EXPECT_EQ(columns.buyer_serial_num_[i], trade.buyer_serial_num_);
+    EXPECT_EQ(columns.seller_serial_num_[i], trade.seller_serial_num_);
+    EXPECT_EQ(columns.exec_price_[i], trade.exec_price_);
+    EXPECT_EQ(columns.cash_traded_[i], trade.cash_traded_);
+    EXPECT_EQ(columns.shares_traded_[i], trade.shares_traded_);
+    EXPECT_EQ(columns.creation_timestamp_[i], trade.creation_timestamp_);
+    EXPECT_EQ(columns.release_timestamp_[i], trade.release_timestamp_);
+    EXPECT_EQ(columns.trade_serial_num_[i], trade.trade_serial_num_);
+  }
+}
+
+TEST_F(TradeArchiveTest, ReadColumnReturnsDictionaryCodes) {
+  TickArchiveReader reader(path_);
+  ASSERT_TRUE(reader.ok());
+  std::vector<int64_t> codes;
+  std::vector<std::string> dictionary;
+  ASSERT_TRUE(reader.ReadColumn(1, TRADE_SYMBOL, &codes));
+  ASSERT_TRUE(reader.ReadDictionary(1, &dictionary));
+  ASSERT_EQ(codes.size(), ARCHIVE_BLOCK_SIZE);
+  for (size_t i = 0; i < codes.size(); i++) {
+    ASSERT_LT(static_cast<size_t>(codes[i]), dictionary.size());
+    EXPECT_EQ(dictionary[codes[i]], trades_[ARCHIVE_BLOCK_SIZE + i].symbol_);
+  }
+  // Only the strings of the block: 2 symbols, 12 clients and at most two
+  // order ids per trade
+  ASSERT_TRUE(reader.ReadDictionary(2, &dictionary));
+  EXPECT_LE(dictionary.size(), 2u + 12u + 2 * 123u);
+  EXPECT_FALSE(reader.ReadDictionary(3, &dictionary));
+  EXPECT_FALSE(reader.ReadColumn(1, NUM_TRADE_COLUMNS, &codes));
+  EXPECT_FALSE(reader.ReadColumn(3, TRADE_SYMBOL, &codes));
+}
+
+TEST_F(TradeArchiveTest, ReadBlockMergesWithOtherTrades) {
+  TickArchiveReader reader(path_);
+  ASSERT_TRUE(reader.ok());
+  TradeColumns columns;
+  Trade other = MakeTrade(0);
+  other.buyer_order_id_ = "G9_C9_1";
+  ASSERT_TRUE(columns.Append(other));
+  // Out of order, and block 2 again
+  ASSERT_TRUE(reader.ReadBlock(2, &columns));
+  ASSERT_TRUE(reader.ReadBlock(0, &columns));
+  ASSERT_TRUE(reader.ReadBlock(2, &columns));
+  ASSERT_EQ(columns.size(), 1 + 2 * 123u + ARCHIVE_BLOCK_SIZE);
+  EXPECT_EQ(Name(columns.order_ids_.Lookup(columns.buyer_order_id_[0])),
+            other.buyer_order_id_);
+  const Trade &first = trades_[2 * ARCHIVE_BLOCK_SIZE];
+  const Trade &second = trades_[0];
+  EXPECT_EQ(Name(columns.order_ids_.Lookup(columns.seller_order_id_[1])),
+            first.seller_order_id_);
+  EXPECT_EQ(Name(columns.order_ids_.Lookup(columns.buyer_order_id_[124])),
+            second.buyer_order_id_);
+  EXPECT_EQ(columns.buyer_order_id_[1],
+            columns.buyer_order_id_[1 + 123 + ARCHIVE_BLOCK_SIZE]);
+}
+
+TEST_F(TradeArchiveTest, FindBlock) {
+  TickArchiveReader reader(path_);
+  ASSERT_TRUE(reader.ok());
+  const std::vector<ArchiveBlockInfo> &index = reader.index();
+  EXPECT_EQ(reader.FindBlock(0), 0u);
+  EXPECT_EQ(reader.FindBlock(index[0].first_timestamp_), 0u);
+  EXPECT_EQ(reader.FindBlock(index[0].last_timestamp_), 0u);
+  EXPECT_EQ(reader.FindBlock(index[0].last_timestamp_ + 1), 1u);
+  EXPECT_EQ(reader.FindBlock(index[1].first_timestamp_), 1u);
+  EXPECT_EQ(reader.FindBlock(index[2].last_timestamp_), 2u);
+  // Past the end
+  EXPECT_EQ(reader.FindBlock(index[2].last_timestamp_ + 1), index.size());
+
+  uint64_t timestamp = trades_[kNumTrades / 2].creation_timestamp_;
+  size_t block = reader.FindBlock(timestamp);
+  ASSERT_LT(block, index.size());
+  EXPECT_LE(index[block].first_timestamp_, timestamp);
+  EXPECT_GE(index[block].last_timestamp_, timestamp);
+}
+
+TEST(TickArchiveTest, BookRoundTrip) {
+  std::string path = TempPath("book_archive");
+  std::vector<TopOfBook> depths;
+  {
+    TickArchiveWriter writer(path, ArchiveKind::book);
+    ASSERT_TRUE(writer.ok());
+    for (int i = 0; i < 1000; i++) {
+      TopOfBook depth = {};
+      depth.creation_timestamp_ = 1600000000000000ULL + 1000 * i;
+      depth.num_buy_levels_ = i % (TOP_OF_BOOK_DEPTH + 1);
+      depth.num_sell_levels_ = TOP_OF_BOOK_DEPTH - i % (TOP_OF_BOOK_DEPTH + 1);
+      for (int level = 0; level < depth.num_buy_levels_; level++) {
+        depth.buy_prices_[level] = 9999 - level - i % 3;
+        depth.buy_shares_[level] = 100 * (level + 1) + i;
+      }
+      for (int level = 0; level < depth.num_sell_levels_; level++) {
+        depth.sell_prices_[level] = 10001 + level + i % 3;
+        depth.sell_shares_[level] = 50 * (level + 1) + i;
+      }
+      depths.push_back(depth);
+      ASSERT_TRUE(writer.Append("AA", depth));
+    }
+    ASSERT_TRUE(writer.Close());
+  }
+
+  TickArchiveReader reader(path);
+  ASSERT_TRUE(reader.ok());
+  EXPECT_EQ(reader.kind(), ArchiveKind::book);
+  BookColumns columns;
+  for (size_t block = 0; block < reader.index().size(); block++) {
+    ASSERT_TRUE(reader.ReadBlock(block, &columns));
+  }
+  TradeColumns trades;
+  EXPECT_FALSE(reader.ReadBlock(0, &trades));
+  unlink(path.c_str());
+
+  BookColumns expected;
+  uint16_t symbol = 0;
+  SymbolTable()->Intern("AA", &symbol);
+  for (auto &depth : depths) {
+    expected.Append(symbol, depth);
+  }
+  EXPECT_EQ(columns.symbol_, expected.symbol_);
+  EXPECT_EQ(columns.creation_timestamp_, expected.creation_timestamp_);
+  EXPECT_EQ(columns.num_buy_levels_, expected.num_buy_levels_);
+  EXPECT_EQ(columns.num_sell_levels_, expected.num_sell_levels_);
+  EXPECT_EQ(columns.buy_prices_, expected.buy_prices_);
+  EXPECT_EQ(columns.buy_shares_, expected.buy_shares_);
+  EXPECT_EQ(columns.sell_prices_, expected.sell_prices_);
+  EXPECT_EQ(columns.sell_shares_, expected.sell_shares_);
+}
+
+TEST(TickArchiveTest, RejectsFilesThatAreNotArchives) {
+  std::string path = TempPath("not_archive");
+  FILE *file = fopen(path.c_str(), "wb");
+  ASSERT_NE(file, nullptr);
+  std::string junk(200, 'x');
+  fwrite(junk.data(), 1, junk.size(), file);
+  fclose(file);
+  TickArchiveReader reader(path);
+  EXPECT_FALSE(reader.ok());
+  unlink(path.c_str());
+
+  TickArchiveReader missing(path);
+  EXPECT_FALSE(missing.ok());
+}
+
+}  // namespace
@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "common/clock.h"
+#include "common/utils.h"
+#include "trader/backtest.h"
+#include "trader/tick_archive.h"
+
+// Google Command Flags
+DEFINE_string(csv_paths, "",
+              "Comma separated trade CSVs (market_data_CC_to_train.csv "
+              "format) to archive");
+DEFINE_string(tape_path, "",
+              "Market tape (see parameter_sweep) whose books to archive");
+DEFINE_string(archive_path, "ticks.archive",
+              "Archive to write, or to scan if no input is given");
+DEFINE_int32(scan_passes, 1, "Times to decode the whole archive when timing");
+
+// Split on delimiter, keeping empty items
+std::vector<std::string> Split(const std::string &value, char delimiter) {
+  std::vector<std::string> items;
+  std::stringstream stream(value);
+  std::string item;
+  while (std::getline(stream, item, delimiter)) {
+    items.push_back(item);
+  }
+  return items;
+}
+
+// Rows of ",Symbol,BuyerSerialNum,SellerSerialNum,BuyerOrderID,SellerOrderID,
+// BuyerClientID,SellerClientID,ExecPrice,CashTraded,SharesTraded,
+// CreationTimestamp,ReleaseTimestamp,TradeSerialNum" (the first column is a
+// row number)
+bool LoadTradeCsv(const std::string &path, std::vector<Trade> *trades) {
+  std::ifstream input(path);
+  std::string line;
+  if (!input.good() || !std::getline(input, line)) {
+    LOG(ERROR) << "Failed to Open: " << path;
+    return false;
+  }
+  while (std::getline(input, line)) {
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (line.empty()) continue;
+    std::vector<std::string> fields = Split(line, ',');
+    if (fields.size() != 14) {
+      LOG(ERROR) << "Malformed Trade Row in " << path << ": " << line;
+      return false;
+    }
+    Trade trade;
+    trade.symbol_ = fields[1];
+    trade.buyer_serial_num_ = strtoull(fields[2].c_str(), nullptr, 10);
+    trade.seller_serial_num_ = strtoull(fields[3].c_str(), nullptr, 10);
+    trade.buyer_order_id_ = fields[4];
+    trade.seller_order_id_ = fields[5];
+    trade.buyer_client_id_ = fields[6];
+    trade.seller_client_id_ = fields[7];
+    trade.exec_price_ = atoi(fields[8].c_str());
+    trade.cash_traded_ = atoi(fields[9].c_str());
+    trade.shares_traded_ = atoi(fields[10].c_str());
+    trade.creation_timestamp_ = strtoull(fields[11].c_str(), nullptr, 10);
+    trade.release_timestamp_ = strtoull(fields[12].c_str(), nullptr, 10);
+    trade.trade_serial_num_ = strtoull(fields[13].c_str(), nullptr, 10);
+    trades->push_back(trade);
+  }
+  return true;
+}
+
+bool ArchiveTrades(size_t *input_bytes) {
+  std::vector<Trade> trades;
+  for (auto &path : Split(FLAGS_csv_paths, ',')) {
+    if (path.empty()) continue;
+    if (!LoadTradeCsv(path, &trades)) return false;
+    *input_bytes += std::ifstream(path, std::ios::ate).tellg();
+  }
+  // Files hold one symbol each; merge them into one time ordered stream
+  std::stable_sort(trades.begin(), trades.end(),
+                   [](const Trade &a, const Trade &b) {
+                     return a.creation_timestamp_ < b.creation_timestamp_;
+                   });
+  TickArchiveWriter writer(FLAGS_archive_path, ArchiveKind::trade);
+  bool ok = writer.ok();
+  for (size_t i = 0; ok && i < trades.size(); i++) {
+    ok = writer.Append(trades[i]);
+  }
+  return writer.Close() && ok;
+}
+
+bool ArchiveBooks(size_t *input_bytes) {
+  MarketTape tape;
+  if (!LoadMarketTapeFile(FLAGS_tape_path, &tape)) return false;
+  *input_bytes = tape.events_.size() * sizeof(TapeEvent);
+  TickArchiveWriter writer(FLAGS_archive_path, ArchiveKind::book);
+  bool ok = writer.ok();
+  for (size_t i = 0; ok && i < tape.events_.size(); i++) {
+    const TapeEvent &event = tape.events_[i];
+    ok = writer.Append(tape.symbols_[event.symbol_index_], event.depth_);
+  }
+  return writer.Close() && ok;
+}
+
+int main(int argc, char **argv) {
+  // GFLAGS and GLOG Parsing
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = 1;
+
+  size_t input_bytes = 0;
+  if (!FLAGS_csv_paths.empty() && !ArchiveTrades(&input_bytes)) {
+    return -1;
+  }
+  if (!FLAGS_tape_path.empty() && !ArchiveBooks(&input_bytes)) {
+    return -1;
+  }
+
+  TickArchiveReader reader(FLAGS_archive_path);
+  if (!reader.ok()) {
+    return -1;
+  }
+  size_t archive_bytes = std::ifstream(FLAGS_archive_path, std::ios::ate)
+                             .tellg();
+  LOG(INFO) << "Archive " << FLAGS_archive_path << ": "
+            << reader.num_records() << " Records in " << reader.index().size()
+            << " Blocks, " << archive_bytes << " Bytes";
+  if (input_bytes > 0) {
+    LOG(INFO) << "Compression Ratio: "
+              << static_cast<double>(input_bytes) / archive_bytes;
+  }
+
+  // Full decode of every block, to check the archive and time the decoder
+  Clock *clock = RealTimeClock();
+  uint64_t start = clock->Now();
+  size_t decoded = 0;
+  for (int pass = 0; pass < FLAGS_scan_passes; pass++) {
+    for (size_t block = 0; block < reader.index().size(); block++) {
+      bool ok;
+      if (reader.kind() == ArchiveKind::trade) {
+        TradeColumns columns;
+        ok = reader.ReadBlock(block, &columns);
+        decoded += columns.size();
+      } else {
+        BookColumns columns;
+        ok = reader.ReadBlock(block, &columns);
+        decoded += columns.size();
+      }
+      if (!ok) return -1;
+    }
+  }
+  uint64_t elapsed = clock->Now() - start;
+  double seconds = std::max<uint64_t>(elapsed, 1) / 1e6;
+  LOG(INFO) << "Decoded " << decoded << " Records in " << seconds << "s ("
+            << decoded / seconds / 1e6 << "M Records/s, "
+            << archive_bytes * FLAGS_scan_passes / seconds / 1e6
+            << " MB/s of Archive)";
+  return 0;
+}
@@ -0,0 +1,63 @@
+#include "trader/top_of_book.h"
+
+namespace {
+
+// Add shares at price to the sorted level arrays, keeping the best
+// TOP_OF_BOOK_DEPTH levels. better(a, b) is true if price a ranks above b. A
+// level pushed out can never return, since only better levels push it out.
+template <typename Better>
+void AddToLevels(int32_t price, int32_t shares, int32_t *prices,
+                 int32_t *level_shares, int32_t *num_levels, Better better) {
+  int i = 0;
+  while (i < *num_levels && better(prices[i], price)) i++;
+  if (i < *num_levels && prices[i] == price) {
+    level_shares[i] += shares;
+    return;
+  }
+  if (i == TOP_OF_BOOK_DEPTH) return;
+  int last = *num_levels < TOP_OF_BOOK_DEPTH ? *num_levels
+                                             : TOP_OF_BOOK_DEPTH - 1;
+  for (int j = last; j > i; j--) {
+    prices[j] = prices[j - 1];
+    level_shares[j] = level_shares[j - 1];
+  }
+  prices[i] = price;
+  level_shares[i] = shares;
+  if (*num_levels < TOP_OF_BOOK_DEPTH) (*num_levels)++;
+}
+
+}  // namespace
+
+void TopOfBook::Build(const LimitOrderBook &lob) {
+  creation_timestamp_ = lob.creation_timestamp_;
+  num_buy_levels_ = 0;
+  num_sell_levels_ = 0;
+  for (auto &p : lob.buy_queue_) {
+    AddToLevels(p.second.limit_price_, p.second.num_shares_, buy_prices_,
+                buy_shares_, &num_buy_levels_,
+                [](int32_t a, int32_t b) { return a > b; });
+  }
+  for (auto &p : lob.sell_queue_) {
+    AddToLevels(p.second.limit_price_, p.second.num_shares_, sell_prices_,
+                sell_shares_, &num_sell_levels_,
+                [](int32_t a, int32_t b) { return a < b; });
+  }
+}
+
+void TopOfBook::Build(const LazyLimitOrderBook &lob) {
+  creation_timestamp_ = lob.creation_timestamp();
+  num_buy_levels_ = 0;
+  num_sell_levels_ = 0;
+  while (num_buy_levels_ < TOP_OF_BOOK_DEPTH &&
+         lob.Level(OrderAction::buy, num_buy_levels_,
+                   &buy_prices_[num_buy_levels_],
+                   &buy_shares_[num_buy_levels_])) {
+    num_buy_levels_++;
+  }
+  while (num_sell_levels_ < TOP_OF_BOOK_DEPTH &&
+         lob.Level(OrderAction::sell, num_sell_levels_,
+                   &sell_prices_[num_sell_levels_],
+                   &sell_shares_[num_sell_levels_])) {
+    num_sell_levels_++;
+  }
+}
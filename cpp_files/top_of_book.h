@@ -0,0 +1,31 @@
+#ifndef TRADER_TOP_OF_BOOK_H_
+#define TRADER_TOP_OF_BOOK_H_
+
+#include <stdint.h>
+
+#include "common/lazy_book.h"
+#include "common/message_types.h"
+
+#define TOP_OF_BOOK_DEPTH 5
+
+// Fixed-size summary of the best TOP_OF_BOOK_DEPTH price levels on each side
+// of a LimitOrderBook. Level 0 is the best price; shares are summed over all
+// resting orders at that price. Trivially copyable, so it can be published
+// through a SeqLock.
+class TopOfBook {
+ public:
+  uint64_t creation_timestamp_;  // creation_timestamp_ of the source book
+  int32_t num_buy_levels_;       // Valid entries in buy_prices_/buy_shares_
+  int32_t num_sell_levels_;      // Valid entries in sell_prices_/sell_shares_
+  int32_t buy_prices_[TOP_OF_BOOK_DEPTH];    // Descending
+  int32_t buy_shares_[TOP_OF_BOOK_DEPTH];
+  int32_t sell_prices_[TOP_OF_BOOK_DEPTH];   // Ascending
+  int32_t sell_shares_[TOP_OF_BOOK_DEPTH];
+
+  // Summarize lob. Orders are visited once; no allocation.
+  void Build(const LimitOrderBook &lob);
+  // Summarize a serialized book from its level index, parsing no orders
+  void Build(const LazyLimitOrderBook &lob);
+};
+
+#endif  // TRADER_TOP_OF_BOOK_H_
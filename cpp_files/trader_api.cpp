@@ -0,0 +1,680 @@
+#include "trader/trader_api.h"
+
+#include <set>
+
+#include "common/text_parser.h"
+
+// Lists REDISDataStructures keeps the client's order and trade history in,
+// one SerializeOrder/SerializeTrade record per element
+#define ORDER_HISTORY_KEY "HISTORICAL_ORDERS"
+#define TRADE_HISTORY_KEY "HISTORICAL_TRADES"
+
+REDISPipeline *Trader::HistoryPipeline() {
+  std::lock_guard<std::mutex> lock(history_pipeline_mutex_);
+  if (!history_pipeline_) {
+    history_pipeline_.reset(new REDISPipeline());
+  }
+  return history_pipeline_.get();
+}
+
+bool Trader::GetAllHistoricalOrders(std::vector<Order> *order_vec) {
+  return GetAllHistoricalOrders(order_vec, HISTORY_PARSE_THREADS);
+}
+
+bool Trader::GetAllHistoricalTrades(std::vector<Trade> *trade_vec) {
+  return GetAllHistoricalTrades(trade_vec, HISTORY_PARSE_THREADS);
+}
+
+bool Trader::GetAllHistoricalOrders(std::vector<Order> *order_vec,
+                                    int num_parse_threads) {
+  std::vector<std::string> records;
+  if (!HistoryPipeline()->FetchList(ORDER_HISTORY_KEY, &records)) {
+    return false;
+  }
+  return ParallelDecode(records, &DecodeOrder, num_parse_threads, order_vec);
+}
+
+bool Trader::GetAllHistoricalTrades(std::vector<Trade> *trade_vec,
+                                    int num_parse_threads) {
+  std::vector<std::string> records;
+  if (!HistoryPipeline()->FetchList(TRADE_HISTORY_KEY, &records)) {
+    return false;
+  }
+  return ParallelDecode(records, &DecodeTrade, num_parse_threads, trade_vec);
+}
+
+void Trader::InitTopOfBooks() {
+  std::call_once(top_of_books_once_, [this]() {
+    for (size_t i = 0; i < symbols_.size(); i++) {
+      symbol_indices_[symbols_[i]] = i;
+    }
+    symbol_top_of_books_.reset(new SeqLock<TopOfBook>[symbols_.size()]);
+    market_data_pools_.reset(
+        new std::atomic<MarketDataPools *>[symbols_.size()]);
+    for (size_t i = 0; i < symbols_.size(); i++) {
+      market_data_pools_[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    MetricsRegistry *registry = MetricsRegistry::Get();
+    for (auto &symbol : symbols_) {
+      lob_message_metrics_.push_back(registry->AddCounter(
+          "trader_market_data_messages_total",
+          "Books and trade reports received on active symbols",
+          MetricLabels({{"gateway", gateway_ip_},
+                        {"symbol", symbol},
+                        {"channel", "lob"}})));
+      trade_message_metrics_.push_back(registry->AddCounter(
+          "trader_market_data_messages_total",
+          "Books and trade reports received on active symbols",
+          MetricLabels({{"gateway", gateway_ip_},
+                        {"symbol", symbol},
+                        {"channel", "trade"}})));
+    }
+    symbol_lock_wait_metric_ = registry->AddHistogram(
+        "trader_lock_wait_ns", "Time spent waiting for contended mutexes",
+        MetricLabels({{"gateway", gateway_ip_}, {"mutex", "symbol"}}));
+    metrics_collector_.Reset(registry->AddCollector(
+        [this](MetricsWriter *writer) { CollectMetrics(writer); }));
+  });
+}
+
+void Trader::CollectMetrics(MetricsWriter *writer) {
+  for (size_t i = 0; i < symbols_.size(); i++) {
+    MarketDataPools *pools =
+        market_data_pools_[i].load(std::memory_order_acquire);
+    if (pools == nullptr) continue;
+    const std::string &symbol = symbols_[i];
+    PoolStats stats[2];
+    {
+      std::lock_guard<std::mutex> lock(symbol_mtxes[symbol]);
+      stats[0] = pools->lobs_.stats();
+      stats[1] = pools->trades_.stats();
+    }
+    for (int channel = 0; channel < 2; channel++) {
+      std::string labels =
+          MetricLabels({{"gateway", gateway_ip_},
+                        {"symbol", symbol},
+                        {"channel", channel == 0 ? "lob" : "trade"}});
+      writer->Gauge("trader_ring_entries", "Entries held in a history pool",
+                    labels, stats[channel].size_);
+      writer->Gauge("trader_ring_capacity", "Slots of a history pool",
+                    labels, stats[channel].capacity_);
+      writer->Counter("trader_ring_overwrites_total",
+                      "History pool entries overwritten when full", labels,
+                      stats[channel].overwrites_);
+      writer->Counter("trader_ring_reallocations_total",
+                      "History pool puts into a slot still held by a view",
+                      labels, stats[channel].reallocations_);
+    }
+  }
+}
+
+int Trader::GetSymbolIndex(const std::string &symbol) {
+  InitTopOfBooks();
+  auto it = symbol_indices_.find(symbol);
+  return it == symbol_indices_.end() ? -1 : it->second;
+}
+
+bool Trader::GetTopOfBook(const std::string &symbol, TopOfBook *top) {
+  return GetTopOfBook(GetSymbolIndex(symbol), top);
+}
+
+bool Trader::GetTopOfBook(int symbol_index, TopOfBook *top) {
+  InitTopOfBooks();
+  if (symbol_index < 0 || symbol_index >= static_cast<int>(symbols_.size())) {
+    return false;
+  }
+  symbol_top_of_books_[symbol_index].Load(top);
+  return top->creation_timestamp_ != 0;
+}
+
+void Trader::SetMarketDataCapacity(const std::string &symbol,
+                                   size_t num_lobs, size_t num_trades) {
+  std::lock_guard<std::mutex> lock(market_data_pools_mutex_);
+  market_data_capacities_[symbol] = std::make_pair(num_lobs, num_trades);
+}
+
+void Trader::AllocateMarketDataPools(const std::vector<std::string> &symbols) {
+  InitTopOfBooks();
+  std::lock_guard<std::mutex> lock(market_data_pools_mutex_);
+  for (auto &symbol : symbols) {
+    int symbol_index = GetSymbolIndex(symbol);
+    if (symbol_index < 0 ||
+        market_data_pools_[symbol_index].load(std::memory_order_relaxed)) {
+      continue;
+    }
+    auto it = market_data_capacities_.find(symbol);
+    market_data_pool_storage_.emplace_back(
+        it == market_data_capacities_.end()
+            ? new MarketDataPools(MARKET_DATA_LIMIT, MARKET_DATA_LIMIT)
+            : new MarketDataPools(it->second.first, it->second.second));
+    market_data_pools_[symbol_index].store(
+        market_data_pool_storage_.back().get(), std::memory_order_release);
+  }
+}
+
+MarketDataPools *Trader::Pools(const std::string &symbol) {
+  int symbol_index = GetSymbolIndex(symbol);
+  if (symbol_index < 0) return nullptr;
+  return market_data_pools_[symbol_index].load(std::memory_order_acquire);
+}
+
+bool Trader::GetMarketDataPoolStats(const std::string &symbol,
+                                    PoolStats *lob_stats,
+                                    PoolStats *trade_stats) {
+  if (!CheckActiveSymbolValidity(symbol)) {
+    return false;
+  }
+  MarketDataPools *pools = Pools(symbol);
+  if (pools == nullptr) {
+    return false;
+  }
+  MeteredLockGuard<std::mutex> lock(symbol_mtxes[symbol], SymbolLockMetric());
+  *lob_stats = pools->lobs_.stats();
+  *trade_stats = pools->trades_.stats();
+  return true;
+}
+
+bool Trader::GetRecentLOBs(std::string symbol,
+                           std::vector<LimitOrderBook> *ans_lob,
+                           uint64_t start_timestamp) {
+  MarketDataPools *pools =
+      CheckActiveSymbolValidity(symbol) ? Pools(symbol) : nullptr;
+  if (pools == nullptr) {
+    ans_lob->clear();
+    return false;
+  }
+  MeteredLockGuard<std::mutex> lock(symbol_mtxes[symbol], SymbolLockMetric());
+  pools->lobs_.CopyRecent(start_timestamp, ans_lob);
+  return true;
+}
+
+bool Trader::GetRecentTrades(std::string symbol,
+                             std::vector<Trade> *ans_trades,
+                             uint64_t start_timestamp) {
+  MarketDataPools *pools =
+      CheckActiveSymbolValidity(symbol) ? Pools(symbol) : nullptr;
+  if (pools == nullptr) {
+    ans_trades->clear();
+    return false;
+  }
+  MeteredLockGuard<std::mutex> lock(symbol_mtxes[symbol], SymbolLockMetric());
+  pools->trades_.CopyRecent(start_timestamp, ans_trades);
+  return true;
+}
+
+bool Trader::GetRecentLOBViews(
+    std::string symbol,
+    std::vector<std::shared_ptr<const LimitOrderBook> > *ans_lob,
+    uint64_t start_timestamp) {
+  if (!CheckActiveSymbolValidity(symbol)) {
+    ans_lob->clear();
+    return false;
+  }
+  MarketDataPools *pools = Pools(symbol);
+  if (pools == nullptr) {
+    ans_lob->clear();
+    return false;
+  }
+  MeteredLockGuard<std::mutex> lock(symbol_mtxes[symbol], SymbolLockMetric());
+  pools->lobs_.ViewRecent(start_timestamp, ans_lob);
+  return true;
+}
+
+bool Trader::GetRecentTradeViews(
+    std::string symbol,
+    std::vector<std::shared_ptr<const Trade> > *ans_trades,
+    uint64_t start_timestamp) {
+  if (!CheckActiveSymbolValidity(symbol)) {
+    ans_trades->clear();
+    return false;
+  }
+  MarketDataPools *pools = Pools(symbol);
+  if (pools == nullptr) {
+    ans_trades->clear();
+    return false;
+  }
+  MeteredLockGuard<std::mutex> lock(symbol_mtxes[symbol], SymbolLockMetric());
+  pools->trades_.ViewRecent(start_timestamp, ans_trades);
+  return true;
+}
+
+bool Trader::GetLatestLOB(const std::string &symbol,
+                          std::shared_ptr<const LimitOrderBook> *lob) {
+  if (!CheckActiveSymbolValidity(symbol)) {
+    return false;
+  }
+  MarketDataPools *pools = Pools(symbol);
+  if (pools == nullptr) {
+    return false;
+  }
+  MeteredLockGuard<std::mutex> lock(symbol_mtxes[symbol], SymbolLockMetric());
+  *lob = pools->lobs_.NewestView();
+  return *lob != nullptr;
+}
+
+bool Trader::GetLatestTrade(const std::string &symbol,
+                            std::shared_ptr<const Trade> *trade) {
+  if (!CheckActiveSymbolValidity(symbol)) {
+    return false;
+  }
+  MarketDataPools *pools = Pools(symbol);
+  if (pools == nullptr) {
+    return false;
+  }
+  MeteredLockGuard<std::mutex> lock(symbol_mtxes[symbol], SymbolLockMetric());
+  *trade = pools->trades_.NewestView();
+  return *trade != nullptr;
+}
+
+int Trader::Subscribe(const std::string &symbol, MarketDataChannel channel,
+                      DeliveryPolicy policy, uint64_t conflate_interval_ms) {
+  if (!CheckActiveSymbolValidity(symbol)) {
+    return -1;
+  }
+  MarketDataPools *pools = Pools(symbol);
+  if (pools == nullptr) {
+    return -1;
+  }
+  uint64_t next_sequence;
+  {
+    MeteredLockGuard<std::mutex> lock(symbol_mtxes[symbol], SymbolLockMetric());
+    next_sequence = channel == MarketDataChannel::lob
+                        ? pools->lobs_.last_sequence() + 1
+                        : pools->trades_.last_sequence() + 1;
+  }
+  std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+  subscriptions_.emplace_back(new Subscription(
+      symbol, channel, policy, conflate_interval_ms, next_sequence));
+  return subscriptions_.size() - 1;
+}
+
+std::shared_ptr<Subscription> Trader::GetSubscription(
+    int subscription_id, MarketDataChannel channel) {
+  std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+  if (subscription_id < 0 ||
+      subscription_id >= static_cast<int>(subscriptions_.size()) ||
+      subscriptions_[subscription_id] == nullptr ||
+      subscriptions_[subscription_id]->channel() != channel) {
+    LOG(ERROR) << "Invalid Subscription: " << subscription_id;
+    return nullptr;
+  }
+  return subscriptions_[subscription_id];
+}
+
+bool Trader::Unsubscribe(int subscription_id) {
+  std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+  if (subscription_id < 0 ||
+      subscription_id >= static_cast<int>(subscriptions_.size()) ||
+      subscriptions_[subscription_id] == nullptr) {
+    LOG(ERROR) << "Invalid Subscription: " << subscription_id;
+    return false;
+  }
+  subscriptions_[subscription_id].reset();
+  return true;
+}
+
+bool Trader::PollLOBs(
+    int subscription_id,
+    std::vector<std::shared_ptr<const LimitOrderBook> > *lobs) {
+  std::shared_ptr<Subscription> subscription =
+      GetSubscription(subscription_id, MarketDataChannel::lob);
+  if (subscription == nullptr) {
+    lobs->clear();
+    return false;
+  }
+  MarketDataPools *pools = Pools(subscription->symbol());
+  if (pools == nullptr) {
+    lobs->clear();
+    return false;
+  }
+  uint64_t dropped;
+  {
+    MeteredLockGuard<std::mutex> lock(symbol_mtxes[subscription->symbol()],
+                                      SymbolLockMetric());
+    dropped = subscription->Poll(pools->lobs_, lobs);
+  }
+  if (dropped > 0) {
+    LOG(WARNING) << "Subscription " << subscription_id << " Dropped "
+                 << dropped << " Books of " << subscription->symbol();
+  }
+  return true;
+}
+
+bool Trader::PollTrades(int subscription_id,
+                        std::vector<std::shared_ptr<const Trade> > *trades) {
+  std::shared_ptr<Subscription> subscription =
+      GetSubscription(subscription_id, MarketDataChannel::trade);
+  if (subscription == nullptr) {
+    trades->clear();
+    return false;
+  }
+  MarketDataPools *pools = Pools(subscription->symbol());
+  if (pools == nullptr) {
+    trades->clear();
+    return false;
+  }
+  uint64_t dropped;
+  {
+    MeteredLockGuard<std::mutex> lock(symbol_mtxes[subscription->symbol()],
+                                      SymbolLockMetric());
+    dropped = subscription->Poll(pools->trades_, trades);
+  }
+  if (dropped > 0) {
+    LOG(WARNING) << "Subscription " << subscription_id << " Dropped "
+                 << dropped << " Trades of " << subscription->symbol();
+  }
+  return true;
+}
+
+bool Trader::GetSubscriptionStats(int subscription_id,
+                                  SubscriptionStats *stats) {
+  std::shared_ptr<Subscription> subscription;
+  {
+    std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+    if (subscription_id >= 0 &&
+        subscription_id < static_cast<int>(subscriptions_.size())) {
+      subscription = subscriptions_[subscription_id];
+    }
+  }
+  if (subscription == nullptr) {
+    return false;
+  }
+  MeteredLockGuard<std::mutex> lock(symbol_mtxes[subscription->symbol()],
+                                    SymbolLockMetric());
+  *stats = subscription->stats();
+  return true;
+}
+
+void Trader::OnLimitBook(const std::string &symbol, const LimitOrderBook &lob,
+                         bool replay) {
+  // Replays run on other threads
+  if (!replay) ingest_placement_.Apply();
+  // Pools come from ConfigActiveSymbols, so the ingest path never allocates
+  // them nor takes the pool mutex
+  MarketDataPools *pools = Pools(symbol);
+  if (pools == nullptr) return;
+  int symbol_index = GetSymbolIndex(symbol);
+  TopOfBook top;
+  top.Build(lob);
+  {
+    MeteredLockGuard<std::mutex> lock(symbol_mtxes[symbol], SymbolLockMetric());
+    const LimitOrderBook *newest = pools->lobs_.Newest();
+    if (replay && newest != nullptr &&
+        newest->creation_timestamp_ >= lob.creation_timestamp_) {
+      return;
+    }
+    pools->lobs_.Put(lob);
+    // Under the symbol lock, so a replay from another thread never races
+    // the ingest thread on the SeqLock and the top follows the newest book
+    symbol_top_of_books_[symbol_index].Store(top);
+  }
+  JournalWriter *journal = journal_.load(std::memory_order_acquire);
+  if (journal != nullptr && !replay) {
+    // SerializeBook is not const
+    LimitOrderBook copy = lob;
+    std::string text = copy.SerializeBook();
+    journal->Record(JournalChannel::limit_book, JOURNAL_DECODED_PORT,
+                    text.data(), text.size(), false, clock_->Now());
+  }
+  MetricsRegistry::Get()->Add(lob_message_metrics_[symbol_index]);
+}
+
+bool Trader::ConfigBars(BarType type, uint64_t interval) {
+  if (interval == 0) {
+    LOG(ERROR) << "Invalid Bar Interval: " << interval;
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(bar_mutex_);
+  bar_aggregator_.reset(new BarAggregator(type, interval));
+  active_symbol_bars_.clear();
+  return true;
+}
+
+bool Trader::GetRecentBars(std::string symbol, std::vector<Bar> *ans_bars,
+                           uint64_t start_timestamp) {
+  ans_bars->clear();
+  if (!CheckActiveSymbolValidity(symbol)) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(bar_mutex_);
+  auto it = active_symbol_bars_.find(symbol);
+  if (it == active_symbol_bars_.end()) {
+    return true;
+  }
+  for (auto bar = it->second.rbegin(); bar != it->second.rend(); ++bar) {
+    if (bar->start_timestamp_ < start_timestamp) break;
+    ans_bars->push_back(*bar);
+  }
+  return true;
+}
+
+void Trader::OnTradeReport(const std::string &symbol,
+                           const Trade &trade_report, bool replay) {
+  if (!replay) ingest_placement_.Apply();
+  MarketDataPools *pools = Pools(symbol);
+  if (pools == nullptr) return;
+  {
+    MeteredLockGuard<std::mutex> lock(symbol_mtxes[symbol], SymbolLockMetric());
+    const Trade *newest = pools->trades_.Newest();
+    if (replay && newest != nullptr &&
+        newest->creation_timestamp_ >= trade_report.creation_timestamp_) {
+      return;
+    }
+    pools->trades_.Put(trade_report);
+  }
+  JournalWriter *journal = journal_.load(std::memory_order_acquire);
+  if (journal != nullptr && !replay) {
+    std::string text = trade_report.SerializeTrade();
+    journal->Record(JournalChannel::trade_report, JOURNAL_DECODED_PORT,
+                    text.data(), text.size(), false, clock_->Now());
+  }
+  MetricsRegistry::Get()->Add(trade_message_metrics_[GetSymbolIndex(symbol)]);
+  std::lock_guard<std::mutex> lock(bar_mutex_);
+  if (!bar_aggregator_) return;
+  std::vector<Bar> completed_bars;
+  bar_aggregator_->AddTrade(trade_report, &completed_bars);
+  StoreBars(completed_bars);
+}
+
+void Trader::AdvanceBars(uint64_t timestamp) {
+  std::lock_guard<std::mutex> lock(bar_mutex_);
+  if (!bar_aggregator_) return;
+  std::vector<Bar> completed_bars;
+  bar_aggregator_->AdvanceTime(timestamp, &completed_bars);
+  StoreBars(completed_bars);
+}
+
+void Trader::StoreBars(const std::vector<Bar> &completed_bars) {
+  for (auto &bar : completed_bars) {
+    std::deque<Bar> &bars = active_symbol_bars_[bar.symbol_];
+    bars.push_back(bar);
+    if (bars.size() > MARKET_DATA_LIMIT) {
+      bars.pop_front();
+    }
+  }
+}
+
+bool Trader::PinThreads(int ingest_core, int trade_confirmation_core,
+                        int order_confirmation_core) {
+  bool ok = true;
+  if (ingest_core >= 0) {
+    ok &= ingest_placement_.Pin(active_symbol_thread_, ingest_core);
+  }
+  if (trade_confirmation_core >= 0) {
+    ok &= trade_confirmation_placement_.Pin(subscriber_thread_,
+                                            trade_confirmation_core);
+  }
+  if (order_confirmation_core >= 0) {
+    ok &= order_confirmation_placement_.Pin(confirmation_subscriber_thread_,
+                                            order_confirmation_core);
+  }
+  return ok;
+}
+
+void Trader::GetClientInformation(ClientInformationSnapshot *snapshot) {
+  std::lock_guard<std::mutex> lock(client_information_mutex_);
+  *snapshot = client_information_;
+}
+
+bool Trader::SaveState(CheckpointWriter *writer, size_t max_entries) {
+  std::vector<std::shared_ptr<const LimitOrderBook> > lobs;
+  std::vector<std::shared_ptr<const Trade> > trades;
+  std::string record;
+  writer->Put<uint32_t>(active_symbols_.size());
+  for (auto &symbol : active_symbols_) {
+    GetRecentLOBViews(symbol, &lobs, 0);
+    GetRecentTradeViews(symbol, &trades, 0);
+    size_t num_lobs = std::min(lobs.size(), max_entries);
+    size_t num_trades = std::min(trades.size(), max_entries);
+    writer->PutString(symbol);
+    // Oldest first, so restoring replays them in arrival order
+    writer->Put<uint32_t>(num_lobs);
+    for (size_t i = num_lobs; i-- > 0;) {
+      LimitOrderBook lob = *lobs[i];
+      writer->PutString(lob.SerializeBook());
+    }
+    writer->Put<uint32_t>(num_trades);
+    for (size_t i = num_trades; i-- > 0;) {
+      // Text for the rare trade too long for the binary encoding
+      if (!EncodeTrade(*trades[i], RecordEncoding::binary, &record)) {
+        EncodeTrade(*trades[i], RecordEncoding::text, &record);
+      }
+      writer->PutString(record);
+    }
+  }
+
+  std::map<std::string, Order> outstanding_orders;
+  std::map<std::string, int> portfolio;
+  if (!GetOutstandingOrders(&outstanding_orders) ||
+      !GetPortfolioMatrix(&portfolio)) {
+    LOG(ERROR) << "Failed to Read Orders and Portfolio for Checkpoint";
+    return false;
+  }
+  writer->Put<uint32_t>(outstanding_orders.size());
+  for (auto &entry : outstanding_orders) {
+    if (!EncodeOrder(entry.second, RecordEncoding::binary, &record)) {
+      EncodeOrder(entry.second, RecordEncoding::text, &record);
+    }
+    writer->PutString(record);
+  }
+  writer->Put<uint32_t>(portfolio.size());
+  for (auto &entry : portfolio) {
+    writer->PutString(entry.first);
+    writer->Put<int32_t>(entry.second);
+  }
+  return true;
+}
+
+bool Trader::RestoreState(CheckpointReader *reader,
+                          StateReconciliation *reconciliation) {
+  std::map<std::string, Order> saved_orders;
+  std::map<std::string, int> saved_portfolio;
+  return RestoreMarketData(reader) &&
+         ReadClientState(reader, &saved_orders, &saved_portfolio) &&
+         Reconcile(saved_orders, saved_portfolio, reconciliation);
+}
+
+bool Trader::RestoreMarketData(CheckpointReader *reader) {
+  uint32_t num_symbols;
+  if (!reader->Get(&num_symbols)) return false;
+  std::string symbol;
+  std::string record;
+  LimitOrderBook lob;
+  for (uint32_t i = 0; i < num_symbols; i++) {
+    uint32_t num_lobs;
+    if (!reader->GetString(&symbol) || !reader->Get(&num_lobs)) return false;
+    bool active = std::find(active_symbols_.begin(), active_symbols_.end(),
+                            symbol) != active_symbols_.end();
+    for (uint32_t j = 0; j < num_lobs; j++) {
+      if (!reader->GetString(&record)) return false;
+      if (!active) continue;
+      ParseLimitOrderBookOrConstruct(record.data(), record.size(), &lob);
+      OnLimitBook(symbol, lob, true);
+    }
+    uint32_t num_trades;
+    if (!reader->Get(&num_trades)) return false;
+    for (uint32_t j = 0; j < num_trades; j++) {
+      Trade trade;
+      if (!reader->GetString(&record) ||
+          !DecodeTrade(record.data(), record.size(), &trade)) {
+        return false;
+      }
+      if (active) OnTradeReport(symbol, trade, true);
+    }
+  }
+  return true;
+}
+
+bool Trader::ReadClientState(CheckpointReader *reader,
+                             std::map<std::string, Order> *saved_orders,
+                             std::map<std::string, int> *saved_portfolio) {
+  std::string symbol;
+  std::string record;
+  uint32_t num_orders;
+  if (!reader->Get(&num_orders)) return false;
+  for (uint32_t i = 0; i < num_orders; i++) {
+    Order order;
+    if (!reader->GetString(&record) ||
+        !DecodeOrder(record.data(), record.size(), &order)) {
+      return false;
+    }
+    (*saved_orders)[order.order_id_] = order;
+  }
+  uint32_t num_holdings;
+  if (!reader->Get(&num_holdings)) return false;
+  for (uint32_t i = 0; i < num_holdings; i++) {
+    int32_t shares;
+    if (!reader->GetString(&symbol) || !reader->Get(&shares)) return false;
+    (*saved_portfolio)[symbol] = shares;
+  }
+  return true;
+}
+
+bool Trader::Reconcile(const std::map<std::string, Order> &saved_orders,
+                       const std::map<std::string, int> &saved_portfolio,
+                       StateReconciliation *reconciliation) {
+  // The gateway's view wins; report what moved while we were down
+  ClientInformationSnapshot &snapshot = reconciliation->snapshot_;
+  if (!MarketDataAPI::PullClientInformation(client_id_, gateway_ip_,
+                                            authentication_token_,
+                                            &snapshot)) {
+    LOG(ERROR) << "Failed to Pull Client Information for Reconciliation";
+    return false;
+  }
+  reconciliation->closed_orders_.clear();
+  reconciliation->new_orders_.clear();
+  reconciliation->position_changes_.clear();
+  std::set<std::string> outstanding;
+  for (auto &order : snapshot.outstanding_orders_) {
+    outstanding.insert(order.order_id_);
+    if (saved_orders.find(order.order_id_) == saved_orders.end()) {
+      reconciliation->new_orders_.push_back(order);
+    }
+  }
+  for (auto &entry : saved_orders) {
+    if (outstanding.find(entry.first) == outstanding.end()) {
+      reconciliation->closed_orders_.push_back(entry.second);
+    }
+  }
+  for (auto &entry : snapshot.my_portfolio_) {
+    auto saved = saved_portfolio.find(entry.first);
+    int change = entry.second -
+                 (saved == saved_portfolio.end() ? 0 : saved->second);
+    if (change != 0) reconciliation->position_changes_[entry.first] = change;
+  }
+  for (auto &entry : saved_portfolio) {
+    if (snapshot.my_portfolio_.find(entry.first) ==
+        snapshot.my_portfolio_.end() && entry.second != 0) {
+      reconciliation->position_changes_[entry.first] = -entry.second;
+    }
+  }
+  // Later deltas start from the reconciled state
+  SetClientInformation(snapshot);
+  return true;
+}
+
+void Trader::SetClientInformation(const ClientInformationSnapshot &snapshot) {
+  std::lock_guard<std::mutex> lock(client_information_mutex_);
+  client_information_ = snapshot;
+}
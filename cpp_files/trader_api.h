@@ -2,20 +2,47 @@
 #define TRADER_TRADER_API_H_
 
 #define MARKET_DATA_LIMIT (100000)
+// Decode workers of the one-argument historical getters
+#define HISTORY_PARSE_THREADS (4)
 #include <limits.h>
 #include <stdint.h>
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
 
+#include "common/clock.h"
+#include "common/cpu_affinity.h"
 #include "common/message_types.h"
+#include "common/metrics.h"
 #include "common/network_utils.h"
+#include "common/record_codec.h"
 #include "common/redis_data_structures.h"
+#include "common/redis_pipeline.h"
+#include "common/ring_pool.h"
+#include "common/seqlock.h"
 #include "database/data_aggregator.h"
+#include "trader/bar_aggregator.h"
+#include "trader/checkpoint.h"
+#include "trader/journal.h"
 #include "trader/market_data_api.h"
+#include "trader/subscription.h"
+#include "trader/top_of_book.h"
+
+// Book and trade history of one active symbol
+class MarketDataPools {
+ public:
+  MarketDataPools(size_t num_lobs, size_t num_trades)
+      : lobs_(num_lobs), trades_(num_trades) {}
+
+  RingPool<LimitOrderBook> lobs_;
+  RingPool<Trade> trades_;
+};
 
 class Trader {
  public:
@@ -56,30 +83,212 @@ class Trader {
   // else's order before your cancel got through the sequencing buffer.
   OrderResult SubmitCancel(const std::string &order_id);
 
+  // Activate symbols. Their history pools are allocated here, before any of
+  // their market data is ingested (see AllocateMarketDataPools).
   bool ConfigActiveSymbols(std::vector<std::string> active_symbols);
 
+  // Set how many books and trades of history to preallocate for symbol.
+  // Must be called before the symbol is first activated; symbols without a
+  // setting keep MARKET_DATA_LIMIT of each.
+  void SetMarketDataCapacity(const std::string &symbol, size_t num_lobs,
+                             size_t num_trades);
+
+  // Usage statistics of the book and trade history pools of an active symbol
+  bool GetMarketDataPoolStats(const std::string &symbol, PoolStats *lob_stats,
+                              PoolStats *trade_stats);
+
   bool GetRecentLOBs(std::string symbol, std::vector<LimitOrderBook> *ans_lob,
                      uint64_t start_timestamp);
 
   bool GetRecentTrades(std::string symbol, std::vector<Trade> *ans_trades,
                        uint64_t start_timestamp);
 
+  // Zero-copy variants of GetRecentLOBs and GetRecentTrades, served from the
+  // history pools. The views share the stored books and trades and stay
+  // valid and unchanged for as long as the caller holds them, so only what
+  // is actually read is paid for.
+  bool GetRecentLOBViews(
+      std::string symbol,
+      std::vector<std::shared_ptr<const LimitOrderBook> > *ans_lob,
+      uint64_t start_timestamp);
+  bool GetRecentTradeViews(
+      std::string symbol,
+      std::vector<std::shared_ptr<const Trade> > *ans_trades,
+      uint64_t start_timestamp);
+
+  // View of the most recent book or trade of an active symbol. Returns false
+  // if none has been received yet.
+  bool GetLatestLOB(const std::string &symbol,
+                    std::shared_ptr<const LimitOrderBook> *lob);
+  bool GetLatestTrade(const std::string &symbol,
+                      std::shared_ptr<const Trade> *trade);
+
+  // Subscribe to the books or trade reports of an active symbol received from
+  // now on, delivered according to policy (see DeliveryPolicy). Returns the
+  // subscription id, or -1 if the symbol is not active.
+  int Subscribe(const std::string &symbol, MarketDataChannel channel,
+                DeliveryPolicy policy, uint64_t conflate_interval_ms = 0);
+
+  // Replace the vector with the entries due to a subscription since its last
+  // poll, oldest first. Entries lost to the pool wrapping around are logged
+  // and counted in the subscription's stats.
+  bool PollLOBs(int subscription_id,
+                std::vector<std::shared_ptr<const LimitOrderBook> > *lobs);
+  bool PollTrades(int subscription_id,
+                  std::vector<std::shared_ptr<const Trade> > *trades);
+
+  bool GetSubscriptionStats(int subscription_id, SubscriptionStats *stats);
+
+  // Stop a subscription and free its state. Its id is not reused; polling it
+  // fails from now on. Returns false if there is no such subscription.
+  bool Unsubscribe(int subscription_id);
+
+  // Copy out the best TOP_OF_BOOK_DEPTH levels of the most recent book of an
+  // active symbol. Lock-free and allocation-free, safe to call from any number
+  // of threads. Returns false if no book has been received yet.
+  bool GetTopOfBook(const std::string &symbol, TopOfBook *top);
+
+  // Same as above, with the index from GetSymbolIndex, skipping the symbol
+  // lookup on the tick path.
+  bool GetTopOfBook(int symbol_index, TopOfBook *top);
+
+  // Dense index of a tradable symbol, or -1 if the symbol does not exist
+  int GetSymbolIndex(const std::string &symbol);
+
+  // Aggregate the trade reports of all active symbols into bars of the given
+  // type and interval (see BarAggregator). Replaces any previous bar setup.
+  bool ConfigBars(BarType type, uint64_t interval);
+
+  // Returns the completed bars of symbol that started at or after
+  // start_timestamp, most recent first (same order as GetRecentTrades).
+  bool GetRecentBars(std::string symbol, std::vector<Bar> *ans_bars,
+                     uint64_t start_timestamp);
+
+  // Close the time bars that end at or before timestamp, so symbols without
+  // trades still produce bars. Called by the strategy runner every tick.
+  void AdvanceBars(uint64_t timestamp);
+
   // Redis wrappers
   bool GetOutstandingOrders(std::map<std::string, Order> *outstanding_orders);
   bool GetPortfolioMatrix(std::map<std::string, int> *portfolio_mtx);
   bool GetAllHistoricalOrders(std::vector<Order> *order_vec);
   bool GetAllHistoricalTrades(std::vector<Trade> *trade_vec);
 
+  // Same as above, with the records decoded by num_parse_threads workers.
+  // The history lists are read with pipelined LRANGEs, so a full day of
+  // history costs a handful of round trips; the getters above forward here
+  // with HISTORY_PARSE_THREADS.
+  bool GetAllHistoricalOrders(std::vector<Order> *order_vec,
+                              int num_parse_threads);
+  bool GetAllHistoricalTrades(std::vector<Trade> *trade_vec,
+                              int num_parse_threads);
+
   std::vector<std::string> GetSymbols();
 
+  // Warm restart. SaveState writes the newest max_entries books and trades
+  // of every active symbol and the outstanding orders and portfolio held in
+  // redis. RestoreState, called after ConfigActiveSymbols, feeds the saved
+  // books and trades of symbols that are still active through the ingest
+  // path (pools, top of book, bars), skipping any not newer than what has
+  // been received live since, then pulls the client information from
+  // the gateway, which is authoritative, and reports how it differs from
+  // the checkpoint.
+  bool SaveState(CheckpointWriter *writer, size_t max_entries);
+  bool RestoreState(CheckpointReader *reader,
+                    StateReconciliation *reconciliation);
+
+  // The steps of RestoreState, for Traders of one client restored together
+  // (GatewayRouter). RestoreMarketData replays the books and trades of a
+  // saved state and leaves reader at its client information, which
+  // ReadClientState merges into saved_orders and saved_portfolio.
+  // Reconcile pulls the client information once and compares it with them.
+  bool RestoreMarketData(CheckpointReader *reader);
+  static bool ReadClientState(CheckpointReader *reader,
+                              std::map<std::string, Order> *saved_orders,
+                              std::map<std::string, int> *saved_portfolio);
+  bool Reconcile(const std::map<std::string, Order> &saved_orders,
+                 const std::map<std::string, int> &saved_portfolio,
+                 StateReconciliation *reconciliation);
+
+  // Copy of the client information as of the last pull
+  void GetClientInformation(ClientInformationSnapshot *snapshot);
+  // Replace it, e.g. with a snapshot another Trader of the client pulled
+  void SetClientInformation(const ClientInformationSnapshot &snapshot);
+
+  // Low-latency mode: pin the market data ingest thread and the trade and
+  // order confirmation threads to cores (-1 leaves a thread unpinned).
+  // Threads not started yet are pinned when they start. Each thread also
+  // prefers its core's NUMA node for what it allocates from then on (see
+  // ThreadPlacement); the ingest thread applies it in the ingest hooks and
+  // the confirmation loops before each fetch. Call before
+  // ConfigActiveSymbols, so the ingest thread is placed from its first
+  // message, and again after ConfigActiveSymbols restarts the thread.
+  // Returns false if a thread was not pinned.
+  bool PinThreads(int ingest_core, int trade_confirmation_core,
+                  int order_confirmation_core);
+
+  // Clock used for all waits and local timestamps of this Trader and of the
+  // strategies run on it. Defaults to RealTimeClock(); the clock must
+  // outlive the Trader.
+  void SetClock(Clock *clock) { clock_ = clock; }
+  Clock *clock() const { return clock_; }
+
+  // Record every book and trade report stored from now on in journal,
+  // stamped with the clock (see JOURNAL_DECODED_PORT); entries replayed by
+  // a restore are not recorded. nullptr stops recording. The journal must
+  // outlive the Trader or be unset first.
+  void SetJournal(JournalWriter *journal) { journal_.store(journal); }
+
  private:
   // Used in Construtor
   bool PullAllHistoricalOrdersFromBigTable(std::vector<Order> *order_vec);
   bool PullAllHistoricalTradesFromBigTable(std::vector<Trade> *trade_vec);
 
+  // Lazily connected pipeline used for all history list reads
+  REDISPipeline *HistoryPipeline();
+
   // Thread function to continuously fetch matrket data for active symbol set
   void ActiveSymbolProcesserFunc();
 
+  // Ingest hooks, called by ActiveSymbolProcesserFunc for every book and
+  // trade report received on an active symbol. They store it in the
+  // symbol's history pool and update the derived state. A replayed
+  // (checkpointed) entry is dropped unless it is newer than the newest one
+  // in the pool, so it never lands on top of live data.
+  void OnLimitBook(const std::string &symbol, const LimitOrderBook &lob,
+                   bool replay = false);
+  void OnTradeReport(const std::string &symbol, const Trade &trade_report,
+                     bool replay = false);
+
+  // Keep bars closed by bar_aggregator_. Needs bar_mutex_.
+  void StoreBars(const std::vector<Bar> &completed_bars);
+
+  // Build the symbol index, top-of-book and pool slots and metrics on first
+  // use
+  void InitTopOfBooks();
+
+  // Metric of the waits for symbol_mtxes, for MeteredLockGuard
+  int SymbolLockMetric() {
+    InitTopOfBooks();
+    return symbol_lock_wait_metric_;
+  }
+  // Add the market data stats of the active symbols to a metrics export
+  void CollectMetrics(MetricsWriter *writer);
+
+  // Allocate the history pools of the symbols that have none yet, with the
+  // configured capacities. Called by ConfigActiveSymbols before it starts
+  // the ingest thread, so the first message of a symbol never allocates.
+  void AllocateMarketDataPools(const std::vector<std::string> &symbols);
+
+  // History pools of symbol, or nullptr if it was never activated. Lock-free;
+  // the pools themselves are guarded by symbol_mtxes[symbol].
+  MarketDataPools *Pools(const std::string &symbol);
+
+  // Subscription of the given id and channel, or nullptr. Shared, so an
+  // Unsubscribe during a poll does not free it under the poller.
+  std::shared_ptr<Subscription> GetSubscription(int subscription_id,
+                                                MarketDataChannel channel);
+
   // Utility functions to check validity of user-inputted symbols
   bool CheckSymbolValidity(std::vector<std::string> active_symbols);
   bool CheckActiveSymbolValidity(const std::string &symbol);
@@ -112,13 +321,41 @@ class Trader {
   // Set of Active Symbols
   std::vector<std::string> active_symbols_;
   std::map<std::string, std::mutex> symbol_mtxes;
-  std::map<std::string, LimitOrderBook *> active_symbol_lobs_;
-  std::map<std::string, uint64_t> active_symbol_lobs_counters_;
-  std::map<std::string, Trade *> active_symbol_trades_;
-  std::map<std::string, uint64_t> active_symbol_trades_counters_;
+  // History pools of every symbol ever activated, by symbol index, behind
+  // all the market data getters, subscriptions and checkpoints. Set once
+  // and kept for the life of the Trader, so readers need only the atomic
+  // load; market_data_pools_mutex_ serializes the allocations.
+  std::unique_ptr<std::atomic<MarketDataPools *>[]> market_data_pools_;
+  std::vector<std::unique_ptr<MarketDataPools> > market_data_pool_storage_;
+  // (num_lobs, num_trades) set by SetMarketDataCapacity
+  std::map<std::string, std::pair<size_t, size_t> > market_data_capacities_;
+  std::mutex market_data_pools_mutex_;
+
+  // Market data subscriptions, indexed by subscription id, null once
+  // unsubscribed. Each is polled under the mutex of its symbol.
+  std::vector<std::shared_ptr<Subscription> > subscriptions_;
+  std::mutex subscriptions_mutex_;
   std::thread *active_symbol_thread_;
   volatile bool active_thread_run_;
 
+  // Top-of-book of every tradable symbol, indexed by GetSymbolIndex.
+  // Written by OnLimitBook under the symbol's mutex, so each SeqLock has one
+  // writer at a time even while a restore replays books.
+  std::once_flag top_of_books_once_;
+  std::map<std::string, int> symbol_indices_;
+  std::unique_ptr<SeqLock<TopOfBook>[]> symbol_top_of_books_;
+
+  // Metric ids (see metrics.h), set up with the top-of-book slots: books
+  // and trade reports received, by symbol index, and symbol_mtxes waits
+  std::vector<int> lob_message_metrics_;
+  std::vector<int> trade_message_metrics_;
+  int symbol_lock_wait_metric_ = -1;
+
+  // Bars built from the trade reports of active symbols
+  std::unique_ptr<BarAggregator> bar_aggregator_;
+  std::map<std::string, std::deque<Bar> > active_symbol_bars_;
+  std::mutex bar_mutex_;
+
   // Trade Recorder Object Pointer
   TradeConfirmationAPI *trade_confirmation_api_;
 
@@ -134,17 +371,36 @@ class Trader {
   // Thread to Capture Order Confirmation
   std::thread *confirmation_subscriber_thread_;
 
+  // Cores of the ingest and confirmation threads, set by PinThreads
+  ThreadPlacement ingest_placement_;
+  ThreadPlacement trade_confirmation_placement_;
+  ThreadPlacement order_confirmation_placement_;
+
   // Authentication Token
   std::string authentication_token_;
 
+  // Client information as of the last pull, base of the next delta
+  ClientInformationSnapshot client_information_;
+  std::mutex client_information_mutex_;
+
   // Writing loggin statistics to bigtable
   DataAggregator *log_writer_;
 
   // Utility class to wrap around common redis operations
   REDISDataStructures *structures_;
 
+  // Pipelined redis connection for the history lists
+  std::unique_ptr<REDISPipeline> history_pipeline_;
+  std::mutex history_pipeline_mutex_;
+
+  Clock *clock_ = RealTimeClock();
+  std::atomic<JournalWriter *> journal_{nullptr};
+
   // Use this lock to maintain thread safety
   std::mutex thread_safety_lock_;
+
+  // Last, so the collector is removed before anything it reads goes away
+  MetricsCollectorHandle metrics_collector_;
 };
 
 #endif  // TRADER_TRADER_API_H_
@@ -0,0 +1,42 @@
+#include "trader/trader_config.h"
+
+#include <stdlib.h>
+
+#include <fstream>
+#include <sstream>
+
+#include "common/utils.h"
+
+bool LoadTraderConfig(const std::string &path, TraderConfig *config) {
+  std::ifstream config_fstream;
+  config_fstream.open(path.c_str());
+  if (!config_fstream.is_open()) {
+    VLOG(1) << "Failed to Open: " << path << std::endl;
+    return false;
+  }
+  Json::Value root;
+  config_fstream >> root;
+  config_fstream.close();
+  config->gateway_ip_ = root["gateway_ip"].asString();
+  config->client_id_ = root["client_id"].asString();
+  config->client_token_ = root["client_token"].asString();
+  config->project_id_ = root["project_id"].asString();
+  config->bigtable_id_ = root["bigtable_id"].asString();
+  config->table_name_ = root["table_name"].asString();
+  return true;
+}
+
+void ResetLocalRedis() {
+  system("redis-server --daemonize yes");
+  system("redis-cli flushall");
+}
+
+std::vector<std::string> SplitFlag(const std::string &value, char delimiter) {
+  std::vector<std::string> items;
+  std::stringstream stream(value);
+  std::string item;
+  while (std::getline(stream, item, delimiter)) {
+    if (!item.empty()) items.push_back(item);
+  }
+  return items;
+}
@@ -0,0 +1,30 @@
+#ifndef TRADER_TRADER_CONFIG_H_
+#define TRADER_TRADER_CONFIG_H_
+
+#include <string>
+#include <vector>
+
+// VM and CloudEx configuration shared by all trading binaries
+class TraderConfig {
+ public:
+  std::string gateway_ip_;    // IP address of the assigned gateway
+  std::string client_id_;     // Unique Client Identifier
+  std::string client_token_;  // Authentication Token
+  std::string project_id_;    // Bigtable Project
+  std::string bigtable_id_;   // Bigtable Instance
+  std::string table_name_;    // Bigtable Market Data Table
+};
+
+// Read the json configuration file at path. Returns false if the file cannot
+// be opened.
+bool LoadTraderConfig(const std::string &path, TraderConfig *config);
+
+// Split a comma (or other delimiter) separated flag value, dropping empty
+// items
+std::vector<std::string> SplitFlag(const std::string &value, char delimiter);
+
+// Start the local redis server and clear it, which the Trader expects before
+// construction.
+void ResetLocalRedis();
+
+#endif  // TRADER_TRADER_CONFIG_H_